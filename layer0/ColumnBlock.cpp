@@ -0,0 +1,115 @@
+
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+
+#include"os_predef.h"
+#include"os_std.h"
+
+#include"ColumnBlock.h"
+
+static const char ColumnBlockMagic[8] = { 'P', 'y', 'M', 'O', 'L', 'c', 'b', 1 };
+
+#define cColumnByteOrder 0x01020304
+
+/* fixed size part of the header and of each column */
+#define cColumnBlockHeaderSize (8 + 2 * sizeof(int))
+#define cColumnHeaderSize (cColumnNameLen + 4 + sizeof(int) + sizeof(int64_t))
+
+ColumnBlockWriter::ColumnBlockWriter() : m_ncol(0)
+{
+  int byte_order = cColumnByteOrder;
+  m_data.append(ColumnBlockMagic, 8);
+  m_data.append((const char *) &byte_order, sizeof(int));
+  m_data.append((const char *) &m_ncol, sizeof(int));
+}
+
+void ColumnBlockWriter::add(const char *name, char type, int width, size_t count,
+                            const void *values)
+{
+  char head[cColumnNameLen + 4];
+  int zero = 0;
+  int64_t count64 = count;
+
+  memset(head, 0, sizeof(head));
+  strncpy(head, name, cColumnNameLen - 1);
+  head[cColumnNameLen] = type;
+  head[cColumnNameLen + 1] = (char) width;
+
+  m_data.reserve(m_data.size() + cColumnHeaderSize + count * width);
+  m_data.append(head, sizeof(head));
+  m_data.append((const char *) &zero, sizeof(int));
+  m_data.append((const char *) &count64, sizeof(int64_t));
+  if(count)
+    m_data.append((const char *) values, count * width);
+
+  m_ncol++;
+  memcpy(&m_data[8 + sizeof(int)], &m_ncol, sizeof(int));
+}
+
+bool ColumnBlockReader::check(const char *data, size_t size)
+{
+  int byte_order;
+  if(size < cColumnBlockHeaderSize || memcmp(data, ColumnBlockMagic, 8))
+    return false;
+  memcpy(&byte_order, data + 8, sizeof(int));
+  return byte_order == cColumnByteOrder;
+}
+
+bool ColumnBlockReader::init(const char *data, size_t size)
+{
+  const char *p = data + cColumnBlockHeaderSize, *end = data + size;
+  int a, ncol;
+  int64_t count64;
+  column_t col;
+  char name[cColumnNameLen + 1];
+
+  m_columns.clear();
+  if(!check(data, size))
+    return false;
+  memcpy(&ncol, data + 8 + sizeof(int), sizeof(int));
+
+  for(a = 0; a < ncol; a++) {
+    if(end - p < (ptrdiff_t) cColumnHeaderSize)
+      return false;
+    memcpy(name, p, cColumnNameLen);
+    name[cColumnNameLen] = 0;
+    col.type = p[cColumnNameLen];
+    col.width = (unsigned char) p[cColumnNameLen + 1];
+    memcpy(&count64, p + cColumnNameLen + 4 + sizeof(int), sizeof(int64_t));
+    p += cColumnHeaderSize;
+    if(count64 < 0 || !col.width || (uint64_t) (end - p) / col.width < (uint64_t) count64)
+      return false;
+    col.count = (size_t) count64;
+    col.values = p;
+    p += col.count * col.width;
+    m_columns[name] = col;
+  }
+  return true;
+}
+
+const char *ColumnBlockReader::get(const char *name, char type, int width,
+                                   size_t min_count, size_t * count) const
+{
+  std::map<std::string, column_t>::const_iterator it = m_columns.find(name);
+  if(it == m_columns.end())
+    return NULL;
+  const column_t &col = it->second;
+  if(col.type != type || col.width != width || col.count < min_count)
+    return NULL;
+  if(count)
+    *count = col.count;
+  return col.values;
+}
@@ -0,0 +1,83 @@
+
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+#ifndef _H_ColumnBlock
+#define _H_ColumnBlock
+
+#include <string>
+#include <map>
+
+/* typed columnar block, used for binary session data (pse_binary_dump).
+
+   A block is a set of named, typed arrays which are written and read
+   in one piece, instead of as millions of Python objects.  Layout, in
+   native byte order:
+
+     char magic[8] = "PyMOLcb"  (7 characters + version byte)
+     int byte_order = 0x01020304
+     int n_column
+     n_column times:
+       char name[16], char type, char width, char pad[2],
+       int 0, 64-bit count, count * width bytes of data
+
+   Columns are looked up by name, so readers can skip unknown columns
+   and fall back to defaults for missing ones.  Data is not aligned. */
+
+#define cColumnInt 'i'           /* signed integer of width 1, 2, 4 or 8 */
+#define cColumnUInt 'u'          /* unsigned integer */
+#define cColumnFloat 'f'         /* float (4) or double (8) */
+#define cColumnStr 's'           /* fixed width, null padded string */
+#define cColumnBytes 'b'         /* opaque bytes */
+
+#define cColumnNameLen 16
+
+class ColumnBlockWriter {
+  std::string m_data;
+  int m_ncol;
+
+public:
+  ColumnBlockWriter();
+
+  /* appends a column of count values of the given type and width */
+  void add(const char *name, char type, int width, size_t count, const void *values);
+
+  /* the encoded block (the column count is patched in place) */
+  const std::string &str() const { return m_data; }
+};
+
+class ColumnBlockReader {
+  struct column_t {
+    char type;
+    int width;
+    size_t count;
+    const char *values;
+  };
+  std::map<std::string, column_t> m_columns;
+
+public:
+  /* true if data looks like a column block */
+  static bool check(const char *data, size_t size);
+
+  /* parses the column directory, data is referenced, not copied */
+  bool init(const char *data, size_t size);
+
+  /* unaligned values of a column, or NULL if the column is missing or
+     doesn't have the given type, width and at least min_count values */
+  const char *get(const char *name, char type, int width, size_t min_count,
+                  size_t * count = NULL) const;
+};
+
+#endif
@@ -86,7 +86,7 @@ ok_except1:
 #endif
 }
 
-PyObject *FieldAsPyList(CField * I)
+PyObject *FieldAsPyList(CField * I, bool dump_binary)
 {
 #ifdef _PYMOL_NOPY
   return NULL;
@@ -107,10 +107,10 @@ PyObject *FieldAsPyList(CField * I)
   n_elem = I->size / I->base_size;
   switch (I->type) {
   case cFieldInt:
-    PyList_SetItem(result, 6, PConvIntArrayToPyList((int *) I->data, n_elem));
+    PyList_SetItem(result, 6, PConvIntArrayToPyList((int *) I->data, n_elem, dump_binary));
     break;
   case cFieldFloat:
-    PyList_SetItem(result, 6, PConvFloatArrayToPyList((float *) I->data, n_elem));
+    PyList_SetItem(result, 6, PConvFloatArrayToPyList((float *) I->data, n_elem, dump_binary));
     break;
   default:
     PyList_SetItem(result, 6, PConvAutoNone(Py_None));
@@ -31,6 +31,7 @@ Z* -------------------------------------------------------------------
 #include"PConv.h"
 #include"P.h"
 #include"Util.h"
+#include"TaskPool.h"
 
 #define Trace_OFF
 
@@ -118,21 +119,24 @@ void IsosurfFree(PyMOLGlobals * G)
 
 
 /*===========================================================================*/
-PyObject *IsosurfAsPyList(Isofield * field)
+PyObject *IsosurfAsPyList(PyMOLGlobals * G, Isofield * field)
 {
 #ifdef _PYMOL_NOPY
   return NULL;
 #else
 
   PyObject *result = NULL;
+  int pse_export_version = SettingGetGlobal_f(G, cSetting_pse_export_version) * 1000;
+  bool dump_binary = SettingGetGlobal_b(G, cSetting_pse_binary_dump) &&
+    (!pse_export_version || pse_export_version >= 1800);
 
   result = PyList_New(4);
 
   PyList_SetItem(result, 0, PConvIntArrayToPyList(field->dimensions, 3));
   PyList_SetItem(result, 1, PyInt_FromLong(field->save_points));
-  PyList_SetItem(result, 2, FieldAsPyList(field->data));
+  PyList_SetItem(result, 2, FieldAsPyList(field->data, dump_binary));
   if(field->save_points)
-    PyList_SetItem(result, 3, FieldAsPyList(field->points));
+    PyList_SetItem(result, 3, FieldAsPyList(field->points, dump_binary));
   else
     PyList_SetItem(result, 3, PConvAutoNone(NULL));
   return (PConvAutoNone(result));
@@ -182,6 +186,7 @@ Isofield *IsosurfNewFromPyList(PyMOLGlobals * G, PyObject * list)
     result->data = NULL;
     result->points = NULL;
     result->gradients = NULL;
+    result->blocks = NULL;
   }
   if(ok)
     ok = PConvPyListToIntArrayInPlace(PyList_GetItem(list, 0), result->dimensions, 3);
@@ -226,6 +231,7 @@ Isofield *IsosurfNewCopy(PyMOLGlobals * G, const Isofield * src)
   ok = ((result->points = FieldNewCopy(G, src->points)) != NULL);
 
   result->gradients = NULL;
+  result->blocks = NULL;
   if(!ok) {
     if(result->data)
       FieldFree(result->data);
@@ -397,6 +403,217 @@ void IsofieldComputeGradients(PyMOLGlobals * G, Isofield * field)
 }
 
 
+/*===========================================================================*/
+
+#define IsofieldBlockSize 8     /* grid cells along a block edge at level 0 */
+#define IsofieldMaxLevel 32
+
+/* level l has blocks of IsofieldBlockSize << l cells, each holding the
+   min/max of the data at its grid points.  Neighboring blocks share
+   their boundary points, so every cell lies entirely within a block at
+   every level, and a block contains a cell crossing the level only if
+   min <= level < max. */
+struct _IsofieldBlocks {
+  int n_level;
+  int dim[IsofieldMaxLevel][3];
+  float *min_max[IsofieldMaxLevel];
+};
+
+#define IsofieldBlockMinMax(B,l,i,j,k) \
+  ((B)->min_max[l] + 2 * (((i) * (B)->dim[l][1] + (j)) * (B)->dim[l][2] + (k)))
+
+typedef struct {
+  IsofieldBlocks *blocks;
+  Isofield *field;
+} IsofieldBlockJob;
+
+static void IsofieldBlockTask(void *ctx, int bi)
+{
+  IsofieldBlockJob *J = (IsofieldBlockJob *) ctx;
+  IsofieldBlocks *B = J->blocks;
+  CField *data = J->field->data;
+  int *dimensions = J->field->dimensions;
+  int lo[3], hi[3];
+  int bj, bk, c, i, j, k;
+  for(bj = 0; bj < B->dim[0][1]; bj++) {
+    for(bk = 0; bk < B->dim[0][2]; bk++) {
+      float mn = FLT_MAX, mx = -FLT_MAX;
+      float *r = IsofieldBlockMinMax(B, 0, bi, bj, bk);
+      lo[0] = bi * IsofieldBlockSize;
+      lo[1] = bj * IsofieldBlockSize;
+      lo[2] = bk * IsofieldBlockSize;
+      for(c = 0; c < 3; c++) {
+        hi[c] = lo[c] + IsofieldBlockSize;
+        if(hi[c] > dimensions[c] - 1)
+          hi[c] = dimensions[c] - 1;
+      }
+      for(i = lo[0]; i <= hi[0]; i++)
+        for(j = lo[1]; j <= hi[1]; j++)
+          for(k = lo[2]; k <= hi[2]; k++) {
+            float v = F3(data, i, j, k);
+            if(v != v)          /* NaN is never above the level */
+              v = -FLT_MAX;
+            if(v < mn)
+              mn = v;
+            if(v > mx)
+              mx = v;
+          }
+      r[0] = mn;
+      r[1] = mx;
+    }
+  }
+}
+
+static void IsofieldBlocksFree(IsofieldBlocks * B)
+{
+  int l;
+  for(l = 0; l < B->n_level; l++)
+    FreeP(B->min_max[l]);
+  FreeP(B);
+}
+
+void IsofieldUpdateBlocks(PyMOLGlobals * G, Isofield * field)
+{
+  IsofieldBlocks *B;
+  int ok = true;
+  int c, l, i, j, k;
+  if(field->blocks || !field->data)
+    return;
+  B = Calloc(IsofieldBlocks, 1);
+  CHECKOK(ok, B);
+  if(!ok)
+    return;
+
+  for(c = 0; c < 3; c++) {
+    B->dim[0][c] = (field->dimensions[c] + IsofieldBlockSize - 2) / IsofieldBlockSize;
+    if(B->dim[0][c] < 1)
+      B->dim[0][c] = 1;
+  }
+  for(l = 0; ok; l++) {
+    B->min_max[l] = Alloc(float, 2 * B->dim[l][0] * B->dim[l][1] * B->dim[l][2]);
+    CHECKOK(ok, B->min_max[l]);
+    if(!ok)
+      break;
+    B->n_level = l + 1;
+    if(!l) {
+      IsofieldBlockJob job;
+      job.blocks = B;
+      job.field = field;
+      TaskPoolRun(G, 0, B->dim[0][0], IsofieldBlockTask, &job);
+    } else {
+      /* merge the (up to) eight children of each block */
+      for(i = 0; i < B->dim[l][0]; i++)
+        for(j = 0; j < B->dim[l][1]; j++)
+          for(k = 0; k < B->dim[l][2]; k++) {
+            float *r = IsofieldBlockMinMax(B, l, i, j, k);
+            int ci, cj, ck;
+            r[0] = FLT_MAX;
+            r[1] = -FLT_MAX;
+            for(ci = 2 * i; (ci <= 2 * i + 1) && (ci < B->dim[l - 1][0]); ci++)
+              for(cj = 2 * j; (cj <= 2 * j + 1) && (cj < B->dim[l - 1][1]); cj++)
+                for(ck = 2 * k; (ck <= 2 * k + 1) && (ck < B->dim[l - 1][2]); ck++) {
+                  float *cr = IsofieldBlockMinMax(B, l - 1, ci, cj, ck);
+                  if(cr[0] < r[0])
+                    r[0] = cr[0];
+                  if(cr[1] > r[1])
+                    r[1] = cr[1];
+                }
+          }
+    }
+    if((B->dim[l][0] == 1) && (B->dim[l][1] == 1) && (B->dim[l][2] == 1))
+      break;
+    if(l + 1 == IsofieldMaxLevel) {
+      ok = false;
+      break;
+    }
+    for(c = 0; c < 3; c++)
+      B->dim[l + 1][c] = (B->dim[l][c] + 1) / 2;
+  }
+  if(ok)
+    field->blocks = B;
+  else
+    IsofieldBlocksFree(B);
+}
+
+void IsofieldInvalidate(Isofield * field)
+{
+  if(field->blocks) {
+    IsofieldBlocksFree(field->blocks);
+    field->blocks = NULL;
+  }
+  if(field->gradients) {
+    FieldFree(field->gradients);
+    field->gradients = NULL;
+  }
+}
+
+static void IsofieldBlocksFind(const IsofieldBlocks * B, float level, int l,
+                               int i, int j, int k, const int *lo, const int *hi,
+                               int *act_lo, int *act_hi, int *found)
+{
+  int size = IsofieldBlockSize << l;
+  int b_lo[3];
+  const float *r;
+  int c;
+  b_lo[0] = i * size;
+  b_lo[1] = j * size;
+  b_lo[2] = k * size;
+  for(c = 0; c < 3; c++)
+    if((b_lo[c] > hi[c]) || (b_lo[c] + size < lo[c]))
+      return;
+  r = IsofieldBlockMinMax(B, l, i, j, k);
+  if(!((r[0] <= level) && (r[1] > level)))
+    return;
+  if(!l) {
+    for(c = 0; c < 3; c++) {
+      int a = (b_lo[c] > lo[c]) ? b_lo[c] : lo[c];
+      int b = (b_lo[c] + size < hi[c]) ? b_lo[c] + size : hi[c];
+      if(!*found || (a < act_lo[c]))
+        act_lo[c] = a;
+      if(!*found || (b > act_hi[c]))
+        act_hi[c] = b;
+    }
+    *found = true;
+  } else {
+    int ci, cj, ck;
+    for(ci = 2 * i; (ci <= 2 * i + 1) && (ci < B->dim[l - 1][0]); ci++)
+      for(cj = 2 * j; (cj <= 2 * j + 1) && (cj < B->dim[l - 1][1]); cj++)
+        for(ck = 2 * k; (ck <= 2 * k + 1) && (ck < B->dim[l - 1][2]); ck++)
+          IsofieldBlocksFind(B, level, l - 1, ci, cj, ck, lo, hi, act_lo, act_hi, found);
+  }
+}
+
+
+/*
+ * shrinks range (grid points range[0..2] up to but excluding range[3..5])
+ * to the blocks which may contain cells crossing level.  Returns false
+ * if there are none.  Without a block index, range is left unchanged.
+ */
+int IsofieldGetActiveRange(const Isofield * field, float level, int *range)
+{
+  const IsofieldBlocks *B = field->blocks;
+  int lo[3], hi[3], act_lo[3], act_hi[3];
+  int found = false;
+  int c;
+  if(!B)
+    return true;
+  for(c = 0; c < 3; c++) {
+    lo[c] = range[c];
+    hi[c] = range[3 + c] - 1;
+    if(hi[c] < lo[c])
+      return true;
+  }
+  IsofieldBlocksFind(B, level, B->n_level - 1, 0, 0, 0, lo, hi, act_lo, act_hi, &found);
+  if(found) {
+    for(c = 0; c < 3; c++) {
+      range[c] = act_lo[c];
+      range[3 + c] = act_hi[c] + 1;
+    }
+  }
+  return found;
+}
+
+
 /*===========================================================================*/
 Isofield *IsosurfFieldAlloc(PyMOLGlobals * G, int *dims)
 {
@@ -421,6 +638,7 @@ Isofield *IsosurfFieldAlloc(PyMOLGlobals * G, int *dims)
   result->dimensions[2] = dims[2];
   result->save_points = true;
   result->gradients = NULL;
+  result->blocks = NULL;
   return (result);
 }
 
@@ -428,8 +646,7 @@ Isofield *IsosurfFieldAlloc(PyMOLGlobals * G, int *dims)
 /*===========================================================================*/
 void IsosurfFieldFree(PyMOLGlobals * G, Isofield * field)
 {
-  if(field->gradients)
-    FieldFree(field->gradients);
+  IsofieldInvalidate(field);
   FieldFree(field->points);
   FieldFree(field->data);
   mfree(field);
@@ -876,6 +1093,228 @@ int IsosurfGetRange(PyMOLGlobals * G, Isofield * field,
 
 
 /*===========================================================================*/
+
+/* one IsosurfSubSize sub-box of the volume and the lines or points
+   found in it (num holds segment lengths, as in CIsosurf::Num) */
+typedef struct {
+  int off[3], max[3];
+  int ok;
+  int n_line, n_seg;
+  float *line;
+  int *num;
+} IsosurfBox;
+
+typedef struct {
+  CIsosurf *proto;              /* field, level and scratch dimensions */
+  int mode;
+  int n_box;
+  IsosurfBox *box;
+  TaskPoolCounter next;
+} IsosurfBoxJob;
+
+/* private scratch for one thread, set up like the prototype, with room
+   for a sub-box of dim points (the fields are local to the sub-box) */
+static CIsosurf *IsosurfScratchNew(CIsosurf * proto, const int *dim)
+{
+  CIsosurf *I = IsosurfNew(proto->G);
+  int c, x, y, z;
+  if(!I)
+    return NULL;
+  I->Coord = proto->Coord;
+  I->Data = proto->Data;
+  I->Level = proto->Level;
+  I->Skip = proto->Skip;
+  for(c = 0; c < 3; c++) {
+    I->AbsDim[c] = proto->AbsDim[c];
+    I->CurDim[c] = (dim[c] < 1) ? 1 : dim[c];
+  }
+  if(!IsosurfAlloc(proto->G, I)) {
+    _IsosurfFree(I);
+    return NULL;
+  }
+  /* IsosurfDrawLines consumes every link it follows, so this only
+     needs to happen once per scratch */
+  for(x = 0; x < I->CurDim[0]; x++)
+    for(y = 0; y < I->CurDim[1]; y++)
+      for(z = 0; z < I->CurDim[2]; z++)
+        for(c = 0; c < 3; c++)
+          EdgePt(I->Point, x, y, z, c).NLink = 0;
+  return I;
+}
+
+static int IsosurfBoxRun(CIsosurf * I, IsosurfBox * box, int mode)
+{
+  int ok = true;
+  int c;
+  for(c = 0; c < 3; c++) {
+    I->CurOff[c] = box->off[c];
+    I->Max[c] = box->max[c];
+  }
+#ifdef Trace
+  for(c = 0; c < 3; c++)
+    printf(" IsosurfVolume: c: %i CurOff[c]: %i Max[c] %i\n", c,
+           I->CurOff[c], I->Max[c]);
+#endif
+  I->Line = VLAlloc(float, 300);
+  I->Num = VLAlloc(int, 10);
+  CHECKOK(ok, I->Line);
+  CHECKOK(ok, I->Num);
+  if(ok) {
+    I->NLine = 0;
+    I->NSeg = 0;
+    I->Num[I->NSeg] = I->NLine;
+    switch (mode) {
+    case 0:                    /* standard mode - want lines */
+      ok = IsosurfCurrent(I);
+      break;
+    case 1:                    /* point mode - just want points on the isosurface */
+      ok = IsosurfPoints(I);
+      break;
+    case 2:
+      /* reserved */
+      break;
+    }
+  }
+  if(I->G->Interrupt)
+    ok = false;
+  box->line = I->Line;
+  box->num = I->Num;
+  box->n_line = I->NLine;
+  box->n_seg = I->NSeg;
+  I->Line = NULL;
+  I->Num = NULL;
+  return ok;
+}
+
+/* the scratch is only as large as the sub-boxes this thread has met so
+   far: most are narrowed to their active blocks, and a full
+   (IsosurfSubSize + 1)^3 scratch is about 40 MB */
+static void IsosurfBoxTask(void *ctx, int index)
+{
+  IsosurfBoxJob *J = (IsosurfBoxJob *) ctx;
+  CIsosurf *I = NULL;
+  int failed = false;
+  int b, c;
+  while((b = J->next++) < J->n_box) {
+    IsosurfBox *box = J->box + b;
+    if(I && !failed) {
+      int dim[3], grow = false;
+      for(c = 0; c < 3; c++) {
+        dim[c] = I->CurDim[c];
+        if(dim[c] < box->max[c]) {
+          dim[c] = box->max[c];
+          grow = true;
+        }
+      }
+      if(grow) {
+        IsosurfPurge(I);
+        _IsosurfFree(I);
+        I = IsosurfScratchNew(J->proto, dim);
+        failed = !I;
+      }
+    } else if(!failed) {
+      I = IsosurfScratchNew(J->proto, box->max);
+      failed = !I;
+    }
+    if(failed || J->proto->G->Interrupt)
+      box->ok = false;
+    else
+      box->ok = IsosurfBoxRun(I, box, J->mode);
+  }
+  if(I) {
+    IsosurfPurge(I);
+    _IsosurfFree(I);
+  }
+}
+
+/* narrows a sub-box to the part the field's block index says may cross
+   the level; returns false if there is nothing to contour.  Lines are
+   only ever found in active blocks and the walk order is lexicographic,
+   so the output is the same as for the whole sub-box.  The start is kept
+   aligned to "skip" since mesh_skip planes are relative to CurOff. */
+static int IsosurfBoxActive(Isofield * field, float level, int skip, IsosurfBox * box)
+{
+  int active[6];
+  int c;
+  for(c = 0; c < 3; c++) {
+    active[c] = box->off[c];
+    active[3 + c] = box->off[c] + box->max[c];
+  }
+  if(!IsofieldGetActiveRange(field, level, active))
+    return false;
+  for(c = 0; c < 3; c++) {
+    int start = active[c] - box->off[c];
+    if(skip)
+      start = (start / skip) * skip;
+    box->off[c] += start;
+    box->max[c] = active[3 + c] - box->off[c];
+  }
+  return true;
+}
+
+/* processes the sub-boxes concurrently, each thread with its own
+   scratch, then appends their output to I->Line/I->Num in the same
+   order the serial walk used to produce it */
+static int IsosurfBoxes(PyMOLGlobals * G, CIsosurf * I, Isofield * field,
+                        int *Steps, int *range, int mode)
+{
+  int ok = true;
+  int i, j, k, c, b;
+  IsosurfBoxJob job;
+  job.proto = I;
+  job.mode = mode;
+  job.n_box = 0;
+  job.next = 0;
+  job.box = Calloc(IsosurfBox, Steps[0] * Steps[1] * Steps[2]);
+  CHECKOK(ok, job.box);
+  if(ok) {
+    int n_thread = TaskPoolGetNThread(G);
+    for(i = 0; i < Steps[0]; i++)
+      for(j = 0; j < Steps[1]; j++)
+        for(k = 0; k < Steps[2]; k++) {
+          IsosurfBox *box = job.box + job.n_box;
+          box->off[0] = IsosurfSubSize * i;
+          box->off[1] = IsosurfSubSize * j;
+          box->off[2] = IsosurfSubSize * k;
+          for(c = 0; c < 3; c++) {
+            box->off[c] += range[c];
+            box->max[c] = range[3 + c] - box->off[c];
+            if(box->max[c] > (IsosurfSubSize + 1))
+              box->max[c] = (IsosurfSubSize + 1);
+          }
+          if(IsosurfBoxActive(field, I->Level, I->Skip, box))
+            job.n_box++;
+        }
+    if(n_thread > job.n_box)
+      n_thread = job.n_box;
+    if(n_thread)
+      TaskPoolRun(G, n_thread, n_thread, IsosurfBoxTask, &job);
+
+    for(b = 0; b < job.n_box; b++) {
+      IsosurfBox *box = job.box + b;
+      if(ok)
+        ok = box->ok;
+      if(ok && box->n_line) {
+        VLACheck(I->Line, float, (I->NLine + box->n_line) * 3);
+        VLACheck(I->Num, int, I->NSeg + box->n_seg + 1);
+        CHECKOK(ok, I->Line);
+        CHECKOK(ok, I->Num);
+        if(ok) {
+          memcpy(I->Line + I->NLine * 3, box->line, sizeof(float) * 3 * box->n_line);
+          memcpy(I->Num + I->NSeg, box->num, sizeof(int) * box->n_seg);
+          I->NLine += box->n_line;
+          I->NSeg += box->n_seg;
+          I->Num[I->NSeg] = I->NLine;
+        }
+      }
+      VLAFreeP(box->line);
+      VLAFreeP(box->num);
+    }
+  }
+  FreeP(job.box);
+  return ok;
+}
+
 int IsosurfVolume(PyMOLGlobals * G, CSetting * set1, CSetting * set2,
                   Isofield * field, float level, int **num,
                   float **vert, int *range, int mode, int skip, float alt_level)
@@ -890,8 +1329,7 @@ int IsosurfVolume(PyMOLGlobals * G, CSetting * set1, CSetting * set2,
   CHECKOK(ok, I);
   {
     int Steps[3];
-    int c, i, j, k;
-    int x, y, z;
+    int c;
     int range_store[6];
     I->Num = *num;
     I->Line = *vert;
@@ -912,12 +1350,18 @@ int IsosurfVolume(PyMOLGlobals * G, CSetting * set1, CSetting * set2,
         Steps[c] = (I->AbsDim[c] - 2) / IsosurfSubSize + 1;
       }
     }
+    /* no sub-box extends past the range, so the gradient mode doesn't
+       need scratch for more than that (the others size their own) */
+    for(c = 0; c < 3; c++) {
+      if(I->CurDim[c] > (range[3 + c] - range[c]))
+        I->CurDim[c] = range[3 + c] - range[c];
+      if(I->CurDim[c] < 1)
+        I->CurDim[c] = 1;
+    }
 
     I->Coord = field->points;
     I->Data = field->data;
     I->Level = level;
-    if(ok)
-      ok = IsosurfAlloc(G, I);
 
     I->NLine = 0;
     I->NSeg = 0;
@@ -927,57 +1371,13 @@ int IsosurfVolume(PyMOLGlobals * G, CSetting * set1, CSetting * set2,
     if(ok) {
       switch (mode) {
       case 3:
-        ok = IsosurfGradients(G, set1, set2, I, field, range, level, alt_level);
+        ok = IsosurfAlloc(G, I);
+        if(ok)
+          ok = IsosurfGradients(G, set1, set2, I, field, range, level, alt_level);
         IsosurfPurge(I);
         break;
       default:
-        for(i = 0; i < Steps[0]; i++) {
-          for(j = 0; j < Steps[1]; j++) {
-            for(k = 0; k < Steps[2]; k++) {
-              if(ok) {
-                I->CurOff[0] = IsosurfSubSize * i;
-                I->CurOff[1] = IsosurfSubSize * j;
-                I->CurOff[2] = IsosurfSubSize * k;
-                for(c = 0; c < 3; c++)
-                  I->CurOff[c] += range[c];
-                for(c = 0; c < 3; c++) {
-                  I->Max[c] = range[3 + c] - I->CurOff[c];
-                  if(I->Max[c] > (IsosurfSubSize + 1))
-                    I->Max[c] = (IsosurfSubSize + 1);
-                }
-                if(!(i || j || k)) {
-                  for(x = 0; x < I->Max[0]; x++)
-                    for(y = 0; y < I->Max[1]; y++)
-                      for(z = 0; z < I->Max[2]; z++)
-                        for(c = 0; c < 3; c++)
-                          EdgePt(I->Point, x, y, z, c).NLink = 0;
-                }
-#ifdef Trace
-                for(c = 0; c < 3; c++)
-                  printf(" IsosurfVolume: c: %i CurOff[c]: %i Max[c] %i\n", c,
-                         I->CurOff[c], I->Max[c]);
-#endif
-
-                if(ok)
-                  switch (mode) {
-                  case 0:      /* standard mode - want lines */
-                    ok = IsosurfCurrent(I);
-                    break;
-                  case 1:      /* point mode - just want points on the isosurface */
-                    ok = IsosurfPoints(I);
-                    break;
-                  case 2:
-                    /* reserved */
-                    break;
-                  }
-                if(G->Interrupt) {
-                  ok = false;
-                }
-              }
-            }
-          }
-        }
-        IsosurfPurge(I);
+        ok = IsosurfBoxes(G, I, field, Steps, range, mode);
         break;
       }
     }
@@ -26,12 +26,15 @@ Z* -------------------------------------------------------------------
 #include"PyMOLGlobals.h"
 #include"Setting.h"
 
+typedef struct _IsofieldBlocks IsofieldBlocks;
+
 typedef struct {
   int dimensions[3];
   int save_points;
   CField *points;
   CField *data;
   CField *gradients;
+  IsofieldBlocks *blocks;       /* min/max pyramid, see IsofieldUpdateBlocks */
 } Isofield;
 
 #define F3(field,P1,P2,P3) Ffloat3(field,P1,P2,P3)
@@ -59,7 +62,15 @@ void IsosurfFree(PyMOLGlobals * G);
 /* isofield operations -- not part of Isosurf */
 
 void IsofieldComputeGradients(PyMOLGlobals * G, Isofield * field);
-PyObject *IsosurfAsPyList(Isofield * I);
+
+/* the block index records the data min/max over blocks of the grid so
+   that contouring can skip regions which can't contain a level.  It is
+   built by IsofieldUpdateBlocks (if missing) and must be dropped with
+   IsofieldInvalidate whenever field->data is modified in place. */
+void IsofieldUpdateBlocks(PyMOLGlobals * G, Isofield * field);
+void IsofieldInvalidate(Isofield * field);
+int IsofieldGetActiveRange(const Isofield * field, float level, int *range);
+PyObject *IsosurfAsPyList(PyMOLGlobals * G, Isofield * I);
 Isofield *IsosurfNewFromPyList(PyMOLGlobals * G, PyObject * list);
 Isofield *IsosurfNewCopy(PyMOLGlobals * G, const Isofield * src);
 
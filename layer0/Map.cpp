@@ -79,6 +79,23 @@ int MapCacheInit(MapCache * M, MapType * I, int group_id, int block_base)
      *(p++) = 0; */
 }
 
+int MapCacheInitSize(PyMOLGlobals * G, MapCache * M, int n, int group_id, int block_base)
+{
+  /* for callers which index the cache without a map (n entries) */
+  int ok = true;
+
+  M->G = G;
+  M->block_base = block_base;
+  M->Cache = CacheCalloc(G, int, n + 1, group_id, block_base + cCache_map_cache_offset);
+  CHECKOK(ok, M->Cache);
+  if (ok)
+    M->CacheLink =
+      CacheAlloc(G, int, n + 1, group_id, block_base + cCache_map_cache_link_offset);
+  CHECKOK(ok, M->CacheLink);
+  M->CacheStart = -1;
+  return ok;
+}
+
 void MapCacheReset(MapCache * M)
 {
   int i = M->CacheStart;
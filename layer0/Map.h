@@ -75,6 +75,7 @@ int MapExclLocus(MapType * map, float *v, int *a, int *b, int *c);
 #define MapCached(m,a) ((m)->Cache[a])
 
 int MapCacheInit(MapCache * M, MapType * I, int group_id, int block_base);
+int MapCacheInitSize(PyMOLGlobals * G, MapCache * M, int n, int group_id, int block_base);
 void MapCacheReset(MapCache * M);
 void MapCacheFree(MapCache * M, int group_id, int block_base);
 
@@ -28,6 +28,11 @@ Z* -------------------------------------------------------------------
 #include"Feedback.h"
 #include"Parse.h"
 #include"File.h"
+#include"Setting.h"
+
+#ifdef __SSE2__
+#include<emmintrin.h>
+#endif
 
 #ifndef int2
 typedef int int2[2];
@@ -44,9 +49,6 @@ CMatch *MatchNew(PyMOLGlobals * G, unsigned int na, unsigned int nb, int dist_ma
   dim[0] = na;
   dim[1] = nb;
   I->G = G;
-  if(na && nb) {
-    I->mat = (float **) UtilArrayCalloc(dim, 2, sizeof(float));
-  }
 
   if(dist_mats && na) {
     dim[0] = na + 1;
@@ -82,7 +84,7 @@ CMatch *MatchNew(PyMOLGlobals * G, unsigned int na, unsigned int nb, int dist_ma
 
   }
 
-  if(!(I->mat && I->smat && ((!dist_mats) || (I->da && I->db)))) {
+  if(!(I->smat && ((!dist_mats) || (I->da && I->db)))) {
     MatchFree(I);
     I = NULL;
   }
@@ -199,19 +201,72 @@ int MatchPreScore(CMatch * I, int *vla1, int n1, int *vla2, int n2, int quiet)
 {
   PyMOLGlobals *G = I->G;
   int a, b;
+  int ok = true;
   if(!quiet) {
     PRINTFB(G, FB_Match, FB_Details)
       " Match: assigning %d x %d pairwise scores.\n", n1, n2 ENDFB(G);
   }
 
-  for(a = 0; a < n1; a++) {
-    for(b = 0; b < n2; b++) {
-      I->mat[a][b] = I->smat[0x7F & vla1[a * 3 + 2]][0x7F & vla2[b * 3 + 2]];
-      /*      printf("%d %d %c %c %8.1f\n",a,b,0x7F & vla1[a * 3 + 2], 0x7F & vla2[b * 3 + 2], 
-              I->smat[0x7F & vla1[a * 3 + 2]][0x7F & vla2[b * 3 + 2]]);*/
+  /* pair scores are looked up in smat by residue code as they are needed,
+     rather than expanded into an n1 x n2 matrix */
+  FreeP(I->code1);
+  FreeP(I->code2);
+  I->code1 = Alloc(char, n1 + 1);
+  I->code2 = Alloc(char, n2 + 1);
+  CHECKOK(ok, I->code1);
+  CHECKOK(ok, I->code2);
+  if(ok) {
+    for(a = 0; a < n1; a++)
+      I->code1[a] = 0x7F & vla1[a * 3 + 2];
+    for(b = 0; b < n2; b++)
+      I->code2[b] = 0x7F & vla2[b * 3 + 2];
+    if(I->mat) {
+      for(a = 0; a < n1; a++)
+        for(b = 0; b < n2; b++)
+          I->mat[a][b] = I->smat[(int) I->code1[a]][(int) I->code2[b]];
     }
   }
-  return 1;
+  return ok;
+}
+
+/* 
+ * Returns the full na x nb matrix of pair scores, making it from the
+ * residue codes on first use, for callers which add their own terms
+ * (e.g. structure based scores).  Sequence only alignments never need it.
+ */
+float **MatchGetPairScores(CMatch * I)
+{
+  if(!I->mat && I->na && I->nb) {
+    unsigned int dim[2];
+    dim[0] = I->na;
+    dim[1] = I->nb;
+    I->mat = (float **) UtilArrayCalloc(dim, 2, sizeof(float));
+    if(I->mat && I->code1 && I->code2) {
+      int a, b;
+      for(a = 0; a < I->na; a++)
+        for(b = 0; b < I->nb; b++)
+          I->mat[a][b] = I->smat[(int) I->code1[a]][(int) I->code2[b]];
+    }
+  }
+  return I->mat;
+}
+
+/* scores of column b for all residues of A into sc */
+static void MatchPairScoreColumn(CMatch * I, int b, float *sc)
+{
+  int a, na = I->na;
+  if(I->mat) {
+    for(a = 0; a < na; a++)
+      sc[a] = I->mat[a][b];
+  } else if(I->code1 && I->code2) {
+    float **smat = I->smat;
+    int c2 = I->code2[b];
+    for(a = 0; a < na; a++)
+      sc[a] = smat[(int) I->code1[a]][c2];
+  } else {
+    for(a = 0; a < na; a++)
+      sc[a] = 0.0F;
+  }
 }
 
 #define BLOSUM62_ROWS 33
@@ -368,6 +423,285 @@ int MatchMatrixFromFile(CMatch * I, const char *fname, int quiet)
   return (ok);
 }
 
+/*
+ * Banded alignment (window == 0, max_gap >= 0)
+ *
+ * Every cell only looks max_gap (or max_skip) columns ahead, so scores are
+ * kept in a ring of W columns instead of the full (na+1) x (nb+1) matrix.
+ * Traceback pointers are not stored in the first pass: the ring is saved
+ * every K columns and each block of K columns is recomputed once, on
+ * demand, when the traceback enters it.  This gives the same pairs and
+ * score as the full matrix in O(na * (W * nb / K + K)) memory.
+ */
+
+typedef struct {
+  CMatch *match;
+  int na, nb;
+  int W;                        /* columns held in the ring */
+  int max_gap, max_skip;
+  float gap_penalty, ext_penalty;
+  float *pen;                   /* pen[k]: penalty for skipping k residues */
+  float *col;                   /* column g in slot g % W, na scores each */
+  float *row;                   /* the same scores by row, each row held twice */
+  float *sc;                    /* pair scores of the current column */
+} MatchBand;
+
+/* 
+ * Returns the first i < n for which v[i] + pen[i] is largest and exceeds
+ * *best (updating *best), or -1; equivalent to a sequential scan with ">".
+ */
+static int MatchScanMax(const float *v, const float *pen, int n, float *best)
+{
+  float mx = *best;
+  int i = 0;
+#ifdef __SSE2__
+  if(n >= 8) {
+    __m128 m0 = _mm_set1_ps(mx);
+    __m128 m1 = m0;
+    float tmp[4];
+    for(; i + 8 <= n; i += 8) {
+      m0 = _mm_max_ps(m0, _mm_add_ps(_mm_loadu_ps(v + i), _mm_loadu_ps(pen + i)));
+      m1 = _mm_max_ps(m1, _mm_add_ps(_mm_loadu_ps(v + i + 4),
+                                     _mm_loadu_ps(pen + i + 4)));
+    }
+    _mm_storeu_ps(tmp, _mm_max_ps(m0, m1));
+    if(mx < tmp[0])
+      mx = tmp[0];
+    if(mx < tmp[1])
+      mx = tmp[1];
+    if(mx < tmp[2])
+      mx = tmp[2];
+    if(mx < tmp[3])
+      mx = tmp[3];
+  }
+#endif
+  for(; i < n; i++) {
+    float tst = v[i] + pen[i];
+    if(tst > mx)
+      mx = tst;
+  }
+  if(mx > *best) {
+    for(i = 0; i < n; i++) {
+      if(v[i] + pen[i] == mx)
+        break;
+    }
+    *best = mx;
+    return i;
+  }
+  return -1;
+}
+
+/* computes column b of the score matrix into the ring, and the
+   traceback pointers (a pair per residue of A) into pt if given */
+static void MatchBandColumn(MatchBand * B, int b, int *pt)
+{
+  const float MIN_SCORE = 0.0F;
+  int na = B->na, nb = B->nb, W = B->W, W2 = 2 * B->W;
+  int max_gap = B->max_gap, max_skip = B->max_skip;
+  int slot = b % W;
+  float *col = B->col + slot * na;
+  float *next = B->col + ((b + 1) % W) * na;
+  float *sc = B->sc;
+  int a, f, g, i;
+
+  MatchPairScoreColumn(B->match, b, sc);
+
+  for(a = na - 1; a >= 0; a--) {
+    float mxv = MIN_SCORE;
+    int mxa = -1, mxb = -1;
+    float s;
+
+    /* the boundary row and column score zero, so they never win */
+    f = a + 1;
+    g = b + 1;
+    if(f < na) {
+      int sg = b + 2 + max_gap;
+      if(sg > nb)
+        sg = nb;
+      i = MatchScanMax(B->row + f * W2 + (g % W), B->pen, sg - g, &mxv);
+      if(i >= 0) {
+        mxa = f;
+        mxb = g + i;
+      }
+    }
+    if(g < nb) {
+      int sf = a + 2 + max_gap;
+      if(sf > na)
+        sf = na;
+      i = MatchScanMax(next + f, B->pen, sf - f, &mxv);
+      if(i >= 0) {
+        mxa = f + i;
+        mxb = g;
+      }
+    }
+    if(max_skip > 0) {
+      /* as in the full matrix, only the last column of the stretch counts */
+      int sf = a + 1 + max_skip;
+      int sg = b + 1 + max_skip;
+      if(sf > na + 1)
+        sf = na + 1;
+      if(sg > nb + 1)
+        sg = nb + 1;
+      g = sg - 1;
+      if(g < nb) {
+        float *c = B->col + (g % W) * na;
+        for(f = a + 1; (f < sf) && (f < na); f++) {
+          int gap = ((f - (a + 1)) + (g - (b + 1)));
+          float tst = c[f];
+          if(gap > 1)
+            tst += 2 * B->gap_penalty + B->ext_penalty * (gap - 2);
+          if(tst > mxv) {
+            mxv = tst;
+            mxa = f;
+            mxb = sg;
+          }
+        }
+      }
+    }
+    s = mxv + sc[a];
+    col[a] = s;
+    B->row[a * W2 + slot] = s;
+    B->row[a * W2 + slot + W] = s;
+    if(pt) {
+      pt[2 * a] = mxa;
+      pt[2 * a + 1] = mxb;
+    }
+  }
+}
+
+static int MatchAlignBanded(CMatch * I, float gap_penalty, float ext_penalty,
+                            int max_gap, int max_skip, int quiet)
+{
+  PyMOLGlobals *G = I->G;
+  const float MIN_SCORE = 0.0F;
+  int na = I->na, nb = I->nb;
+  int ok = true;
+  MatchBand band, *B = &band;
+  int K, n_blk, n_snap;
+  float *snap = NULL;
+  int *pt = NULL;
+  float mxv = MIN_SCORE;
+  int mxa = 0, mxb = 0;
+  int a, b, k;
+
+  B->match = I;
+  B->na = na;
+  B->nb = nb;
+  B->max_gap = max_gap;
+  B->max_skip = max_skip;
+  B->gap_penalty = gap_penalty;
+  B->ext_penalty = ext_penalty;
+  B->W = 2 + ((max_skip > max_gap) ? max_skip : max_gap);
+  if(B->W > nb + 1)
+    B->W = nb + 1;
+
+  /* block length balancing the snapshots against one block of pointers */
+  K = (int) sqrt(0.5 * nb * B->W);
+  if(K < 1)
+    K = 1;
+  if(K > nb)
+    K = nb;
+  n_blk = (nb + K - 1) / K;
+  n_snap = n_blk - 1;
+
+  B->pen = Alloc(float, max_gap + 2);
+  B->col = Alloc(float, (size_t) B->W * na);
+  B->row = Alloc(float, (size_t) 2 * B->W * na);
+  B->sc = Alloc(float, na);
+  if(n_snap)
+    snap = Alloc(float, (size_t) n_snap * B->W * na);
+  pt = Alloc(int, (size_t) 2 * K * na);
+  CHECKOK(ok, B->pen);
+  CHECKOK(ok, B->col);
+  CHECKOK(ok, B->row);
+  CHECKOK(ok, B->sc);
+  CHECKOK(ok, pt);
+  if(n_snap)
+    CHECKOK(ok, snap);
+
+  if(ok) {
+    B->pen[0] = 0.0F;
+    for(k = 1; k <= max_gap + 1; k++)
+      B->pen[k] = gap_penalty + ext_penalty * (k - 1);
+
+    /* first pass: scores and the best entry point (the first maximum in
+       b-major order, which is the last one seen walking backwards) */
+    for(b = nb - 1; b >= 0; b--) {
+      float *col = B->col + (b % B->W) * na;
+      MatchBandColumn(B, b, NULL);
+      for(a = na - 1; a >= 0; a--) {
+        float tst = col[a];
+        if((tst > MIN_SCORE) && (tst >= mxv)) {
+          mxv = tst;
+          mxa = a;
+          mxb = b;
+        }
+      }
+      if(b && !(b % K) && (b / K <= n_snap))
+        memcpy(snap + (size_t) (b / K - 1) * B->W * na, B->col,
+               sizeof(float) * B->W * na);
+    }
+  }
+
+  if(ok) {
+    int cur = -1;
+    int *p, cnt = 0;
+    I->pair = VLAlloc(int, 2 * (na > nb ? na : nb));
+    CHECKOK(ok, I->pair);
+    if(ok) {
+      p = I->pair;
+      a = mxa;
+      b = mxb;
+      while((a >= 0) && (b >= 0) && (a < na) && (b < nb)) {
+        int j = b / K;
+        int *q;
+        if(j != cur) {
+          /* recompute the pointers of block j, starting from its snapshot */
+          int start = j * K, stop = start + K;
+          if(stop > nb)
+            stop = nb;
+          if(j < n_snap) {
+            float *src = snap + (size_t) j * B->W * na;
+            int s, f;
+            memcpy(B->col, src, sizeof(float) * B->W * na);
+            for(s = 0; s < B->W; s++) {
+              for(f = 0; f < na; f++) {
+                B->row[f * 2 * B->W + s] = B->row[f * 2 * B->W + s + B->W] =
+                  src[s * na + f];
+              }
+            }
+          }
+          for(k = stop - 1; k >= start; k--)
+            MatchBandColumn(B, k, pt + (size_t) 2 * (k - start) * na);
+          cur = j;
+        }
+        *(p++) = a;
+        *(p++) = b;
+        q = pt + 2 * ((size_t) (b - j * K) * na + a);
+        a = q[0];
+        b = q[1];
+        cnt++;
+      }
+      PRINTFD(G, FB_Match)
+        " MatchAlign-DEBUG: best entry %8.3f %d %d %d\n", mxv, mxa, mxb, cnt ENDFD;
+      if(!quiet) {
+        PRINTFB(G, FB_Match, FB_Results)
+          " MatchAlign: score %1.3f\n", mxv ENDFD;
+      }
+      I->score = mxv;
+      I->n_pair = cnt;
+      VLASize(I->pair, int, (p - I->pair));
+    }
+  }
+  FreeP(pt);
+  FreeP(snap);
+  FreeP(B->sc);
+  FreeP(B->row);
+  FreeP(B->col);
+  FreeP(B->pen);
+  return ok;
+}
+
 int MatchAlign(CMatch * I, float gap_penalty, float ext_penalty,
                int max_gap, int max_skip, int quiet, int window, float ante)
 {
@@ -397,12 +731,18 @@ int MatchAlign(CMatch * I, float gap_penalty, float ext_penalty,
       " MatchAlign: aligning residues (%d vs %d)...\n", na, nb ENDFB(G);
   }
 
+  if(!window && (max_gap >= 0) && SettingGetGlobal_b(G, cSetting_align_linear_memory)) {
+    VLAFreeP(I->pair);
+    return MatchAlignBanded(I, gap_penalty, ext_penalty, max_gap, max_skip, quiet);
+  }
+
   dim[0] = nf;
   dim[1] = ng;
   VLAFreeP(I->pair);
   score = (float **) UtilArrayCalloc(dim, 2, sizeof(float));
   point = (int2 **) UtilArrayCalloc(dim, 2, sizeof(int2));
-  if(score && point) {
+  /* the full matrix path is O(na * nb) anyway */
+  if(score && point && MatchGetPairScores(I)) {
 
     /* initialize the scoring matrix */
     for(f = 0; f < nf; f++) {
@@ -613,6 +953,8 @@ void MatchFree(CMatch * I)
   FreeP(I->da);
   FreeP(I->db);
   FreeP(I->mat);
+  FreeP(I->code1);
+  FreeP(I->code2);
   FreeP(I->smat);
   VLAFreeP(I->pair);
   OOFreeP(I);
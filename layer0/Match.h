@@ -24,7 +24,8 @@ Z* -------------------------------------------------------------------
 typedef struct {
   PyMOLGlobals *G;
   float **smat;
-  float **mat;
+  float **mat;                  /* pair scores, only when made by MatchGetPairScores */
+  char *code1, *code2;          /* residue codes from MatchPreScore */
   float **da, **db;
   int na, nb;
   int *pair;
@@ -36,6 +37,7 @@ CMatch *MatchNew(PyMOLGlobals * G, unsigned int na, unsigned int nb, int dist_ma
 int MatchResidueToCode(CMatch * I, int *vla, int n);
 int MatchMatrixFromFile(CMatch * I, const char *fname, int quiet);
 int MatchPreScore(CMatch * I, int *vla1, int n1, int *vla2, int n2, int quiet);
+float **MatchGetPairScores(CMatch * I);
 void MatchFree(CMatch * I);
 int MatchAlign(CMatch * I, float gap_penalty, float ext_penalty,
                int max_gap, int max_skip, int quiet, int window, float ante);
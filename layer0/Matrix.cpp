@@ -850,6 +850,106 @@ float MatrixGetRMS(PyMOLGlobals * G, int n, const float *v1, const float *v2, fl
 }
 
 
+/*========================================================================*/
+float MatrixGetFitRMSQCP(int n, const float *v1, const float *v2, double g1, double g2)
+{
+  /* Least-squares fitted RMS of two centered coordinate sets, without
+     computing the rotation: the largest eigenvalue of Horn's key matrix is
+     the largest root of its characteristic quartic, found by Newton
+     iteration from the upper bound (g1 + g2) / 2 (Theobald, Acta Cryst.
+     A61, 2005).  g1 and g2 are the sums of squared norms of v1 and v2. */
+
+  double Sxx = 0.0, Sxy = 0.0, Sxz = 0.0;
+  double Syx = 0.0, Syy = 0.0, Syz = 0.0;
+  double Szx = 0.0, Szy = 0.0, Szz = 0.0;
+  double Sxx2, Syy2, Szz2, Sxy2, Syz2, Sxz2, Syx2, Szy2, Szx2;
+  double SyzSzymSyySzz2, Sxx2Syy2Szz2Syz2Szy2, Sxy2Sxz2Syx2Szx2;
+  double SxzpSzx, SyzpSzy, SxypSyx, SyzmSzy, SxzmSzx, SxymSyx, SxxpSyy, SxxmSyy;
+  double C0, C1, C2, e0, lambda, err;
+  int c;
+
+  if(n < 1)
+    return 0.0F;
+
+  for(c = 0; c < n; c++) {
+    double x1 = v1[0], y1 = v1[1], z1 = v1[2];
+    double x2 = v2[0], y2 = v2[1], z2 = v2[2];
+    Sxx += x1 * x2;
+    Sxy += x1 * y2;
+    Sxz += x1 * z2;
+    Syx += y1 * x2;
+    Syy += y1 * y2;
+    Syz += y1 * z2;
+    Szx += z1 * x2;
+    Szy += z1 * y2;
+    Szz += z1 * z2;
+    v1 += 3;
+    v2 += 3;
+  }
+
+  Sxx2 = Sxx * Sxx;
+  Syy2 = Syy * Syy;
+  Szz2 = Szz * Szz;
+  Sxy2 = Sxy * Sxy;
+  Syz2 = Syz * Syz;
+  Sxz2 = Sxz * Sxz;
+  Syx2 = Syx * Syx;
+  Szy2 = Szy * Szy;
+  Szx2 = Szx * Szx;
+
+  SyzSzymSyySzz2 = 2.0 * (Syz * Szy - Syy * Szz);
+  Sxx2Syy2Szz2Syz2Szy2 = Syy2 + Szz2 - Sxx2 + Syz2 + Szy2;
+
+  C2 = -2.0 * (Sxx2 + Syy2 + Szz2 + Sxy2 + Syx2 + Sxz2 + Szx2 + Syz2 + Szy2);
+  C1 = 8.0 * (Sxx * Syz * Szy + Syy * Szx * Sxz + Szz * Sxy * Syx -
+              Sxx * Syy * Szz - Syz * Szx * Sxy - Szy * Syx * Sxz);
+
+  SxzpSzx = Sxz + Szx;
+  SyzpSzy = Syz + Szy;
+  SxypSyx = Sxy + Syx;
+  SyzmSzy = Syz - Szy;
+  SxzmSzx = Sxz - Szx;
+  SxymSyx = Sxy - Syx;
+  SxxpSyy = Sxx + Syy;
+  SxxmSyy = Sxx - Syy;
+  Sxy2Sxz2Syx2Szx2 = Sxy2 + Sxz2 - Syx2 - Szx2;
+
+  C0 = Sxy2Sxz2Syx2Szx2 * Sxy2Sxz2Syx2Szx2
+    + (Sxx2Syy2Szz2Syz2Szy2 + SyzSzymSyySzz2) * (Sxx2Syy2Szz2Syz2Szy2 - SyzSzymSyySzz2)
+    + (-(SxzpSzx) * (SyzmSzy) + (SxymSyx) * (SxxmSyy - Szz)) *
+    (-(SxzmSzx) * (SyzpSzy) + (SxymSyx) * (SxxmSyy + Szz))
+    + (-(SxzpSzx) * (SyzpSzy) - (SxypSyx) * (SxxpSyy - Szz)) *
+    (-(SxzmSzx) * (SyzmSzy) - (SxypSyx) * (SxxpSyy + Szz))
+    + ((SxypSyx) * (SyzpSzy) + (SxzpSzx) * (SxxmSyy + Szz)) *
+    (-(SxymSyx) * (SyzmSzy) + (SxzpSzx) * (SxxpSyy + Szz))
+    + ((SxypSyx) * (SyzmSzy) + (SxzmSzx) * (SxxmSyy - Szz)) *
+    (-(SxymSyx) * (SyzpSzy) + (SxzmSzx) * (SxxpSyy - Szz));
+
+  e0 = (g1 + g2) * 0.5;
+  lambda = e0;
+  for(c = 0; c < 50; c++) {
+    double prev = lambda;
+    double x2 = lambda * lambda;
+    double b = (x2 + C2) * lambda;
+    double a = b + C1;
+    double denom = 2.0 * x2 * lambda + b + a;
+    if(denom == 0.0)
+      break;
+    lambda -= (a * lambda + C0) / denom;
+    if(fabs(lambda - prev) < fabs(1e-11 * lambda))
+      break;
+  }
+
+  err = 2.0 * (e0 - lambda) / n;
+  if(err < 0.0)
+    err = 0.0;
+  err = sqrt(err);
+  if(err < R_SMALL4)
+    err = 0.0;
+  return (float) err;
+}
+
+
 /*========================================================================*/
 float MatrixFitRMSTTTf(PyMOLGlobals * G, int n, const float *v1, const float *v2, const float *wt,
                        float *ttt)
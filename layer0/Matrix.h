@@ -101,6 +101,7 @@ float MatrixFitRMSTTTf(PyMOLGlobals * G, int n, const float *v1, const float *v2
                        float *ttt);
 
 float MatrixGetRMS(PyMOLGlobals * G, int n, const float *v1, const float *v2, float *wt);
+float MatrixGetFitRMSQCP(int n, const float *v1, const float *v2, double g1, double g2);
 int *MatrixFilter(float cutoff, int window, int n_pass, int nv, const float *v1, const float *v2);
 
 void MatrixTransformR44fN3f(unsigned int n, float *q, const float *m, const float *p);
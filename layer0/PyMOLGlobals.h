@@ -58,6 +58,7 @@ typedef struct _CType CType;
 typedef struct _CMain CMain;
 typedef struct _CPlugIOManager CPlugIOManager;
 typedef struct _CShaderMgr CShaderMgr;
+typedef struct _CTaskPool CTaskPool;
 
 class CMovieScenes;
 
@@ -147,6 +148,7 @@ struct _PyMOLGlobals {
   OVLexicon *Lexicon;           /* lexicon for data (e.g. label) strings */
   CPlugIOManager *PlugIOManager;
   CShaderMgr* ShaderMgr;
+  CTaskPool *TaskPool;          /* native worker threads */
 
 #ifndef _PYMOL_NOPY
   CP_inst *P_inst;
@@ -0,0 +1,333 @@
+
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+
+#include"os_python.h"
+#include"os_predef.h"
+#include"os_std.h"
+
+#include"Base.h"
+#include"MemoryDebug.h"
+#include"Feedback.h"
+#include"Setting.h"
+#include"TaskPool.h"
+#include"P.h"
+
+#ifndef _PYMOL_NO_CXX11
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
+
+/* one fork-join batch; lives on the stack of the submitting thread */
+typedef struct {
+  TaskPoolFn *fn;
+  void *ctx;
+  int pending;                  /* guarded by lock */
+  std::mutex lock;
+  std::condition_variable done;
+} CTaskBatch;
+
+typedef struct {
+  CTaskBatch *batch;
+  int index;
+} CTask;
+
+/* per-thread deque: the owner pushes and pops at the back,
+   thieves take from the front */
+typedef struct {
+  std::mutex lock;
+  std::deque<CTask> task;
+} CTaskQueue;
+
+struct _CTaskPool {
+  PyMOLGlobals *G;
+  std::atomic<int> NWorker;
+  std::thread Worker[PYMOL_MAX_THREADS];
+
+  /* slot 0 is shared by all threads which are not pool workers */
+  CTaskQueue Queue[PYMOL_MAX_THREADS];
+
+  std::atomic<int> NQueued;
+  int Stop;
+  int Python;                   /* workers are registered with the interpreter */
+  std::mutex Lock;              /* guards worker creation and sleeping */
+  std::condition_variable Wake;
+};
+
+/* queue slot of the current thread (0 unless it is a pool worker) */
+static thread_local int TaskPoolSlot = 0;
+
+static void TaskPoolPush(CTaskPool * I, int slot, CTask task)
+{
+  CTaskQueue *queue = I->Queue + slot;
+  std::lock_guard<std::mutex> guard(queue->lock);
+  queue->task.push_back(task);
+}
+
+static int TaskPoolTake(CTaskPool * I, int slot, CTask * task)
+{
+  int a, n_queue = I->NWorker + 1;
+  if(!I->NQueued.load())
+    return false;
+  /* own work first (most recently pushed = most likely still in cache) */
+  {
+    CTaskQueue *queue = I->Queue + slot;
+    std::lock_guard<std::mutex> guard(queue->lock);
+    if(!queue->task.empty()) {
+      *task = queue->task.back();
+      queue->task.pop_back();
+      I->NQueued--;
+      return true;
+    }
+  }
+  /* then steal the oldest task from somebody else */
+  for(a = 1; a < n_queue; a++) {
+    CTaskQueue *queue = I->Queue + ((slot + a) % n_queue);
+    std::lock_guard<std::mutex> guard(queue->lock);
+    if(!queue->task.empty()) {
+      *task = queue->task.front();
+      queue->task.pop_front();
+      I->NQueued--;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void TaskPoolExecute(CTask * task)
+{
+  CTaskBatch *batch = task->batch;
+  batch->fn(batch->ctx, task->index);
+  {
+    /* decrement under the lock so that the submitter can't return
+       (destroying the batch) while we're still notifying */
+    std::lock_guard<std::mutex> guard(batch->lock);
+    if(!--batch->pending)
+      batch->done.notify_all();
+  }
+}
+
+static void TaskPoolWorker(CTaskPool * I, int slot)
+{
+  PyMOLGlobals *G = I->G;
+  CTask task;
+#ifndef _PYMOL_NOPY
+  PyGILState_STATE gstate = PyGILState_UNLOCKED;
+  if(I->Python) {
+    /* obtain a thread state, then park it in P's saved thread table so
+       that PAutoBlock works from inside of tasks (e.g. busy updates) */
+    gstate = PyGILState_Ensure();
+    PUnblock(G);
+  }
+#endif
+
+  TaskPoolSlot = slot;
+
+  PRINTFB(G, FB_Threads, FB_Blather)
+    " TaskPool: worker %d started.\n", slot ENDFB(G);
+
+  while(true) {
+    if(TaskPoolTake(I, slot, &task)) {
+      TaskPoolExecute(&task);
+      continue;
+    }
+    {
+      std::unique_lock<std::mutex> guard(I->Lock);
+      while(!I->Stop && !I->NQueued.load())
+        I->Wake.wait(guard);
+      if(I->Stop && !I->NQueued.load())
+        break;
+    }
+  }
+
+#ifndef _PYMOL_NOPY
+  if(I->Python) {
+    PBlock(G);
+    PyGILState_Release(gstate);
+  }
+#endif
+}
+
+/* grow the pool so that n_thread threads (including the caller) can run */
+static void TaskPoolEnsure(CTaskPool * I, int n_thread)
+{
+  if(n_thread > PYMOL_MAX_THREADS)
+    n_thread = PYMOL_MAX_THREADS;
+  if(n_thread - 1 > I->NWorker) {
+    std::lock_guard<std::mutex> guard(I->Lock);
+    while(I->NWorker < n_thread - 1) {
+      /* queues are preallocated, so takers may see the new slot early */
+      int slot = ++I->NWorker;
+      I->Worker[slot] = std::thread(TaskPoolWorker, I, slot);
+    }
+  }
+}
+
+int TaskPoolInit(PyMOLGlobals * G)
+{
+  CTaskPool *I = (G->TaskPool = new CTaskPool);
+  I->G = G;
+  I->NWorker = 0;
+  I->NQueued = 0;
+  I->Stop = false;
+  I->Python = false;
+  return 1;
+}
+
+void TaskPoolFree(PyMOLGlobals * G)
+{
+  CTaskPool *I = G->TaskPool;
+  int a;
+  if(!I)
+    return;
+  if(I->NWorker) {
+#ifndef _PYMOL_NOPY
+    int blocked = 0;
+    if(I->Python) {
+      /* workers need the interpreter to unregister themselves */
+      blocked = PAutoBlock(G);
+      PUnblock(G);
+    }
+#endif
+    {
+      std::lock_guard<std::mutex> guard(I->Lock);
+      I->Stop = true;
+    }
+    I->Wake.notify_all();
+    for(a = 1; a <= I->NWorker; a++)
+      I->Worker[a].join();
+#ifndef _PYMOL_NOPY
+    if(I->Python) {
+      PBlock(G);
+      PAutoUnblock(G, blocked);
+    }
+#endif
+  }
+  delete I;
+  G->TaskPool = NULL;
+}
+
+void TaskPoolRun(PyMOLGlobals * G, int n_thread, int n_task, TaskPoolFn * fn, void *ctx)
+{
+  CTaskPool *I = G->TaskPool;
+  int a, slot = TaskPoolSlot;
+
+  if(n_thread < 1)
+    n_thread = TaskPoolGetNThread(G);
+
+  if(!I || (n_thread < 2) || (n_task < 2)) {
+    for(a = 0; a < n_task; a++)
+      fn(ctx, a);
+    return;
+  }
+
+  if(!I->NWorker) {
+#ifndef _PYMOL_NOPY
+    /* decided once, before the first worker exists */
+    I->Python = (G->P_inst && G->P_inst->cmd && Py_IsInitialized());
+#ifdef _PYMOL_EMBEDDED
+    I->Python = false;
+#endif
+#endif
+  }
+  TaskPoolEnsure(I, n_thread);
+
+  {
+    CTaskBatch batch;
+    CTask task;
+    int n_queue = I->NWorker + 1;
+#ifndef _PYMOL_NOPY
+    int blocked = 0;
+    if(I->Python) {
+      /* the interpreter must be free while we wait, since workers may
+         need it (whether or not we currently hold it) */
+      blocked = PAutoBlock(G);
+      PUnblock(G);
+    }
+#endif
+    batch.fn = fn;
+    batch.ctx = ctx;
+    batch.pending = n_task;
+
+    /* spread the batch over all queues, starting with our own; task 0
+       is pushed last onto our queue so that we execute it first */
+    task.batch = &batch;
+    for(a = n_task - 1; a >= 0; a--) {
+      task.index = a;
+      TaskPoolPush(I, (slot + a) % n_queue, task);
+    }
+    {
+      std::lock_guard<std::mutex> guard(I->Lock);
+      I->NQueued += n_task;
+    }
+    I->Wake.notify_all();
+
+    /* help out until nothing is left to take, then wait for the tasks
+       still running on other threads */
+    while(TaskPoolTake(I, slot, &task)) {
+      TaskPoolExecute(&task);
+    }
+    {
+      std::unique_lock<std::mutex> guard(batch.lock);
+      while(batch.pending)
+        batch.done.wait(guard);
+    }
+
+#ifndef _PYMOL_NOPY
+    if(I->Python) {
+      PBlock(G);
+      PAutoUnblock(G, blocked);
+    }
+#endif
+  }
+}
+
+#else
+
+/* no C++11 threading library: everything runs on the calling thread */
+
+int TaskPoolInit(PyMOLGlobals * G)
+{
+  G->TaskPool = NULL;
+  return 1;
+}
+
+void TaskPoolFree(PyMOLGlobals * G)
+{
+}
+
+void TaskPoolRun(PyMOLGlobals * G, int n_thread, int n_task, TaskPoolFn * fn, void *ctx)
+{
+  int a;
+  for(a = 0; a < n_task; a++)
+    fn(ctx, a);
+}
+
+#endif
+
+int TaskPoolGetNThread(PyMOLGlobals * G)
+{
+  int n_thread = SettingGetGlobal_i(G, cSetting_max_threads);
+  if(n_thread < 1)
+    n_thread = 1;
+  if(n_thread > PYMOL_MAX_THREADS)
+    n_thread = PYMOL_MAX_THREADS;
+  return n_thread;
+}
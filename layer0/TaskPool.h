@@ -0,0 +1,61 @@
+
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+#ifndef _H_TaskPool
+#define _H_TaskPool
+
+#include"PyMOLGlobals.h"
+
+#ifndef _PYMOL_NO_CXX11
+#include <atomic>
+#endif
+
+
+/* persistent native worker threads owned by the PyMOL instance.
+
+   Work is submitted as a fork-join batch of n_task independent tasks;
+   each task receives the shared context pointer and its task index.
+   Idle workers steal queued tasks from each other, and the submitting
+   thread executes tasks too while it waits, so batches may be nested
+   (a task may itself call TaskPoolRun).
+
+   Workers are created lazily (up to PYMOL_MAX_THREADS - 1) and live
+   until TaskPoolFree.  Tasks must not assume they are executed in any
+   particular order or on any particular thread. */
+
+typedef void TaskPoolFn(void *ctx, int index);
+
+/* shared counter for tasks which pull work items dynamically;
+   counter++ atomically returns the previous value */
+#ifndef _PYMOL_NO_CXX11
+typedef std::atomic<int> TaskPoolCounter;
+#else
+typedef int TaskPoolCounter;
+#endif
+
+int TaskPoolInit(PyMOLGlobals * G);
+void TaskPoolFree(PyMOLGlobals * G);
+
+
+/* runs fn(ctx, 0..n_task-1) using up to n_thread threads (including
+   the caller) and returns once every task has finished.  n_thread < 1
+   means "use the max_threads setting". */
+void TaskPoolRun(PyMOLGlobals * G, int n_thread, int n_task, TaskPoolFn * fn, void *ctx);
+
+/* number of threads TaskPoolRun(G, 0, ...) would use */
+int TaskPoolGetNThread(PyMOLGlobals * G);
+
+#endif
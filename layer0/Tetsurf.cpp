@@ -593,6 +593,21 @@ int TetsurfVolume(PyMOLGlobals * G, Isofield * field, float level, int **num,
               if(I->Max[c] > (TetsurfSubSize + 1))
                 I->Max[c] = (TetsurfSubSize + 1);
             }
+            {
+              /* only the blocks which may cross the level need
+                 visiting; cells are walked in the same order either way */
+              int active[6];
+              for(c = 0; c < 3; c++) {
+                active[c] = I->CurOff[c];
+                active[3 + c] = I->CurOff[c] + I->Max[c];
+              }
+              if(!IsofieldGetActiveRange(field, level, active))
+                continue;
+              for(c = 0; c < 3; c++) {
+                I->CurOff[c] = active[c];
+                I->Max[c] = active[3 + c] - active[c];
+              }
+            }
             /*         
                for(c=0;c<3;c++)
                printf(" TetsurfVolume: c: %i I->CurOff[c]: %i I->Max[c] %i\n",c,I->CurOff[c],I->Max[c]); 
@@ -21,6 +21,7 @@ Z* -------------------------------------------------------------------
 #include"Util.h"
 #include"MemoryDebug.h"
 #include"Err.h"
+#include"TaskPool.h"
 
 struct _CUtil {
   double StartSec;
@@ -370,6 +371,136 @@ void UtilSortIndexGlobals(PyMOLGlobals *G,int n,void *array,int *x,UtilOrderFnGl
   for(a=0;a<n;a++) x[a]--;
 }
 
+/* LSD radix sort of an index by unsigned keys, 11 bits per pass */
+
+#define RADIX_BITS 11
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_MIN_CHUNK 65536
+
+typedef struct {
+  int n, n_chunk, shift;
+  unsigned int *key, *key_tmp;
+  int *x, *x_tmp;
+  int *count;                   /* RADIX_SIZE counters per chunk */
+} CUtilRadix;
+
+static void UtilRadixCountTask(void *ctx, int c)
+{
+  CUtilRadix *R = (CUtilRadix *) ctx;
+  int a, a1 = (int) (((ov_size) R->n * (c + 1)) / R->n_chunk);
+  int shift = R->shift;
+  unsigned int *key = R->key;
+  int *count = R->count + c * RADIX_SIZE;
+
+  UtilZeroMem(count, sizeof(int) * RADIX_SIZE);
+  for(a = (int) (((ov_size) R->n * c) / R->n_chunk); a < a1; a++)
+    count[(key[a] >> shift) & (RADIX_SIZE - 1)]++;
+}
+
+static void UtilRadixScatterTask(void *ctx, int c)
+{
+  CUtilRadix *R = (CUtilRadix *) ctx;
+  int a, a1 = (int) (((ov_size) R->n * (c + 1)) / R->n_chunk);
+  int shift = R->shift;
+  unsigned int *key = R->key, *key_tmp = R->key_tmp;
+  int *x = R->x, *x_tmp = R->x_tmp;
+  int *offset = R->count + c * RADIX_SIZE;
+
+  for(a = (int) (((ov_size) R->n * c) / R->n_chunk); a < a1; a++) {
+    int b = offset[(key[a] >> shift) & (RADIX_SIZE - 1)]++;
+    key_tmp[b] = key[a];
+    x_tmp[b] = x[a];
+  }
+}
+
+int UtilRadixSortIndex(PyMOLGlobals * G, int n, const unsigned int *key, int *x)
+{
+  CUtilRadix R;
+  unsigned int min_key, range = 0;
+  int a, c, d, ok = true;
+
+  if(n < 2)
+    return true;
+
+  for(a = 1; a < n; a++)
+    if(key[x[a]] < key[x[a - 1]])
+      break;
+  if(a == n)                    /* already in order (or all keys equal) */
+    return true;
+
+  /* x is a permutation, so the keys can be scanned in storage order */
+  min_key = key[0];
+  for(a = 1; a < n; a++)
+    if(key[a] < min_key)
+      min_key = key[a];
+  for(a = 0; a < n; a++)
+    range |= key[a] - min_key;
+  R.n = n;
+  R.n_chunk = 1;
+  if(n >= 2 * RADIX_MIN_CHUNK) {
+    R.n_chunk = TaskPoolGetNThread(G);
+    if(R.n_chunk > n / RADIX_MIN_CHUNK)
+      R.n_chunk = n / RADIX_MIN_CHUNK;
+    if(R.n_chunk < 1)
+      R.n_chunk = 1;
+  }
+  R.key = Alloc(unsigned int, n);
+  R.key_tmp = Alloc(unsigned int, n);
+  R.x_tmp = Alloc(int, n);
+  R.count = Alloc(int, RADIX_SIZE * R.n_chunk);
+  R.x = x;
+  ok = R.key && R.key_tmp && R.x_tmp && R.count;
+
+  if(ok) {
+    /* gather the keys in index order, relative to the smallest one */
+    for(a = 0; a < n; a++)
+      R.key[a] = key[x[a]] - min_key;
+
+    for(R.shift = 0; R.shift < 32 && (range >> R.shift); R.shift += RADIX_BITS) {
+      int sum = 0;
+      if(R.n_chunk > 1)
+        TaskPoolRun(G, R.n_chunk, R.n_chunk, UtilRadixCountTask, &R);
+      else
+        UtilRadixCountTask(&R, 0);
+
+      /* chunk-major offsets within each digit keep the sort stable */
+      for(d = 0; d < RADIX_SIZE; d++) {
+        for(c = 0; c < R.n_chunk; c++) {
+          int cnt = R.count[c * RADIX_SIZE + d];
+          R.count[c * RADIX_SIZE + d] = sum;
+          sum += cnt;
+        }
+      }
+
+      if(R.n_chunk > 1)
+        TaskPoolRun(G, R.n_chunk, R.n_chunk, UtilRadixScatterTask, &R);
+      else
+        UtilRadixScatterTask(&R, 0);
+
+      {
+        unsigned int *key_swap = R.key;
+        int *x_swap = R.x;
+        R.key = R.key_tmp;
+        R.key_tmp = key_swap;
+        R.x = R.x_tmp;
+        R.x_tmp = x_swap;
+      }
+    }
+
+    /* odd number of passes leaves the result in the scratch array */
+    if(R.x != x) {
+      UtilCopyMem(x, R.x, sizeof(int) * n);
+      R.x_tmp = R.x;
+    }
+  }
+
+  FreeP(R.key);
+  FreeP(R.key_tmp);
+  FreeP(R.x_tmp);
+  FreeP(R.count);
+  return ok;
+}
+
 #define MAX_BIN = 100
 
 #ifndef R_SMALL8
@@ -56,6 +56,11 @@ typedef int UtilOrderFnGlobals(PyMOLGlobals * G, void *array, int l, int r);
 void UtilSortIndexGlobals(PyMOLGlobals * G, int n, void *array, int *x,
                           UtilOrderFnGlobals * fOrdered);
 
+/* stable sort of the permutation x (of 0..n-1) by key[x[i]]; only the
+   bits in which the keys differ are sorted, so small key ranges take a
+   single pass.  Returns false if out of memory (x is then unchanged) */
+int UtilRadixSortIndex(PyMOLGlobals * G, int n, const unsigned int *key, int *x);
+
 int UtilShouldWePrintQuantity(int quantity);
 
 #endif
@@ -28,6 +28,7 @@ Z* -------------------------------------------------------------------
 #include"Util.h"
 #include"MemoryCache.h"
 #include"Character.h"
+#include"TaskPool.h"
 
 static const float kR_SMALL4 = 0.0001F;
 static const float kR_SMALL5 = 0.0001F;
@@ -1239,6 +1240,261 @@ static int LineClipPoint(float *base, float *ray,
 
   return 0;
 }
+/*========================================================================*/
+/* Batched sphere clipping
+ *
+ * Before a voxel's element list is walked, the sphere primitives found in
+ * the next stretch of the list are copied into a small structure-of-arrays
+ * block and clipped against the ray several at a time.  The results are
+ * indexed by list position and consumed in list order by the regular loop,
+ * so hit selection (including ties) is exactly that of ZLineClipPoint and
+ * LineClipPoint.  Only the clip arithmetic is batched: the final distance
+ * (which needs sqrt1f in double precision) stays on the scalar path.
+ *
+ * Packed SSE2 and AVX2 kernels are chosen at run time from the CPU's
+ * capabilities; the scalar kernels are always available and perform the
+ * same single-precision operations in the same order.
+ */
+
+#define BASIS_SPHERE_BATCH 64
+
+typedef struct {
+  int n;                        /* list positions covered by this block */
+  int n_sph;                    /* staged spheres (padded to kernel width) */
+  int pos[BASIS_SPHERE_BATCH];  /* list position of each staged sphere */
+  float x[BASIS_SPHERE_BATCH], y[BASIS_SPHERE_BATCH], z[BASIS_SPHERE_BATCH];
+  float r[BASIS_SPHERE_BATCH];
+  float opp[BASIS_SPHERE_BATCH];        /* per staged sphere */
+  float along[BASIS_SPHERE_BATCH];
+  float oppSq[BASIS_SPHERE_BATCH];      /* per list position */
+  float alongSq[BASIS_SPHERE_BATCH];    /* (proj for perspective rays) */
+} BasisSphereBatch;
+
+typedef void BasisSphereKernelFn(BasisSphereBatch * sb, const float *base,
+                                 const float *ray);
+
+static void BasisSphereKernelZScalar(BasisSphereBatch * sb, const float *base,
+                                     const float *ray)
+{
+  int k;
+  for(k = 0; k < sb->n_sph; k++) {
+    float hyp0 = sb->x[k] - base[0];
+    float hyp1 = sb->y[k] - base[1];
+    float hyp2 = sb->z[k] - base[2];
+    float cutoff = sb->r[k];
+    if((fabs(hyp0) > cutoff) || (fabs(hyp1) > cutoff) || !(hyp2 < 0.0F)) {
+      sb->opp[k] = MAXFLOAT;
+    } else {
+      sb->opp[k] = (hyp0 * hyp0) + (hyp1 * hyp1);
+      sb->along[k] = (hyp2 * hyp2);
+    }
+  }
+}
+
+static void BasisSphereKernelScalar(BasisSphereBatch * sb, const float *base,
+                                    const float *ray)
+{
+  int k;
+  float ray0 = ray[0], ray1 = ray[1], ray2 = ray[2];
+  for(k = 0; k < sb->n_sph; k++) {
+    float hyp0 = sb->x[k] - base[0];
+    float hyp1 = sb->y[k] - base[1];
+    float hyp2 = sb->z[k] - base[2];
+    float cutoff = sb->r[k];
+    float proj = (ray0 * hyp0) + (ray1 * hyp1) + (ray2 * hyp2);
+    float opp0 = hyp0 - ray0 * proj;
+    float opp1 = hyp1 - ray1 * proj;
+    float opp2 = hyp2 - ray2 * proj;
+    if((fabs(opp0) > cutoff) || (fabs(opp1) > cutoff) || (fabs(opp2) > cutoff)) {
+      sb->opp[k] = MAXFLOAT;
+    } else {
+      sb->opp[k] = (opp0 * opp0) + (opp1 * opp1) + (opp2 * opp2);
+      sb->along[k] = proj;
+    }
+  }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(_PYMOL_NO_SIMD)
+#define BASIS_SIMD_X86
+#include <immintrin.h>
+
+/* no fma in the target list: products must be rounded exactly as in the
+   scalar kernels */
+
+__attribute__ ((target("sse2")))
+static void BasisSphereKernelZSSE2(BasisSphereBatch * sb, const float *base,
+                                   const float *ray)
+{
+  int k;
+  const __m128 b0 = _mm_set1_ps(base[0]), b1 = _mm_set1_ps(base[1]);
+  const __m128 b2 = _mm_set1_ps(base[2]);
+  const __m128 zero = _mm_setzero_ps(), big = _mm_set1_ps(MAXFLOAT);
+  const __m128 sign = _mm_set1_ps(-0.0F);
+  for(k = 0; k < sb->n_sph; k += 4) {
+    __m128 h0 = _mm_sub_ps(_mm_loadu_ps(sb->x + k), b0);
+    __m128 h1 = _mm_sub_ps(_mm_loadu_ps(sb->y + k), b1);
+    __m128 h2 = _mm_sub_ps(_mm_loadu_ps(sb->z + k), b2);
+    __m128 cut = _mm_loadu_ps(sb->r + k);
+    __m128 miss = _mm_or_ps(_mm_cmpgt_ps(_mm_andnot_ps(sign, h0), cut),
+                            _mm_cmpgt_ps(_mm_andnot_ps(sign, h1), cut));
+    __m128 opp = _mm_add_ps(_mm_mul_ps(h0, h0), _mm_mul_ps(h1, h1));
+    miss = _mm_or_ps(miss, _mm_andnot_ps(_mm_cmplt_ps(h2, zero), _mm_castsi128_ps(_mm_set1_epi32(-1))));
+    _mm_storeu_ps(sb->opp + k, _mm_or_ps(_mm_and_ps(miss, big), _mm_andnot_ps(miss, opp)));
+    _mm_storeu_ps(sb->along + k, _mm_mul_ps(h2, h2));
+  }
+}
+
+__attribute__ ((target("sse2")))
+static void BasisSphereKernelSSE2(BasisSphereBatch * sb, const float *base,
+                                  const float *ray)
+{
+  int k;
+  const __m128 b0 = _mm_set1_ps(base[0]), b1 = _mm_set1_ps(base[1]);
+  const __m128 b2 = _mm_set1_ps(base[2]);
+  const __m128 r0 = _mm_set1_ps(ray[0]), r1 = _mm_set1_ps(ray[1]);
+  const __m128 r2 = _mm_set1_ps(ray[2]);
+  const __m128 big = _mm_set1_ps(MAXFLOAT), sign = _mm_set1_ps(-0.0F);
+  for(k = 0; k < sb->n_sph; k += 4) {
+    __m128 h0 = _mm_sub_ps(_mm_loadu_ps(sb->x + k), b0);
+    __m128 h1 = _mm_sub_ps(_mm_loadu_ps(sb->y + k), b1);
+    __m128 h2 = _mm_sub_ps(_mm_loadu_ps(sb->z + k), b2);
+    __m128 cut = _mm_loadu_ps(sb->r + k);
+    __m128 proj = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, h0), _mm_mul_ps(r1, h1)),
+                             _mm_mul_ps(r2, h2));
+    __m128 o0 = _mm_sub_ps(h0, _mm_mul_ps(r0, proj));
+    __m128 o1 = _mm_sub_ps(h1, _mm_mul_ps(r1, proj));
+    __m128 o2 = _mm_sub_ps(h2, _mm_mul_ps(r2, proj));
+    __m128 miss = _mm_or_ps(_mm_cmpgt_ps(_mm_andnot_ps(sign, o0), cut),
+                            _mm_cmpgt_ps(_mm_andnot_ps(sign, o1), cut));
+    __m128 opp = _mm_add_ps(_mm_add_ps(_mm_mul_ps(o0, o0), _mm_mul_ps(o1, o1)),
+                            _mm_mul_ps(o2, o2));
+    miss = _mm_or_ps(miss, _mm_cmpgt_ps(_mm_andnot_ps(sign, o2), cut));
+    _mm_storeu_ps(sb->opp + k, _mm_or_ps(_mm_and_ps(miss, big), _mm_andnot_ps(miss, opp)));
+    _mm_storeu_ps(sb->along + k, proj);
+  }
+}
+
+__attribute__ ((target("avx2")))
+static void BasisSphereKernelZAVX2(BasisSphereBatch * sb, const float *base,
+                                   const float *ray)
+{
+  int k;
+  const __m256 b0 = _mm256_set1_ps(base[0]), b1 = _mm256_set1_ps(base[1]);
+  const __m256 b2 = _mm256_set1_ps(base[2]);
+  const __m256 zero = _mm256_setzero_ps(), big = _mm256_set1_ps(MAXFLOAT);
+  const __m256 sign = _mm256_set1_ps(-0.0F);
+  for(k = 0; k < sb->n_sph; k += 8) {
+    __m256 h0 = _mm256_sub_ps(_mm256_loadu_ps(sb->x + k), b0);
+    __m256 h1 = _mm256_sub_ps(_mm256_loadu_ps(sb->y + k), b1);
+    __m256 h2 = _mm256_sub_ps(_mm256_loadu_ps(sb->z + k), b2);
+    __m256 cut = _mm256_loadu_ps(sb->r + k);
+    __m256 miss = _mm256_or_ps(_mm256_cmp_ps(_mm256_andnot_ps(sign, h0), cut, _CMP_GT_OQ),
+                               _mm256_cmp_ps(_mm256_andnot_ps(sign, h1), cut, _CMP_GT_OQ));
+    __m256 opp = _mm256_add_ps(_mm256_mul_ps(h0, h0), _mm256_mul_ps(h1, h1));
+    miss = _mm256_or_ps(miss, _mm256_cmp_ps(h2, zero, _CMP_NLT_UQ));
+    _mm256_storeu_ps(sb->opp + k, _mm256_blendv_ps(opp, big, miss));
+    _mm256_storeu_ps(sb->along + k, _mm256_mul_ps(h2, h2));
+  }
+}
+
+__attribute__ ((target("avx2")))
+static void BasisSphereKernelAVX2(BasisSphereBatch * sb, const float *base,
+                                  const float *ray)
+{
+  int k;
+  const __m256 b0 = _mm256_set1_ps(base[0]), b1 = _mm256_set1_ps(base[1]);
+  const __m256 b2 = _mm256_set1_ps(base[2]);
+  const __m256 r0 = _mm256_set1_ps(ray[0]), r1 = _mm256_set1_ps(ray[1]);
+  const __m256 r2 = _mm256_set1_ps(ray[2]);
+  const __m256 big = _mm256_set1_ps(MAXFLOAT), sign = _mm256_set1_ps(-0.0F);
+  for(k = 0; k < sb->n_sph; k += 8) {
+    __m256 h0 = _mm256_sub_ps(_mm256_loadu_ps(sb->x + k), b0);
+    __m256 h1 = _mm256_sub_ps(_mm256_loadu_ps(sb->y + k), b1);
+    __m256 h2 = _mm256_sub_ps(_mm256_loadu_ps(sb->z + k), b2);
+    __m256 cut = _mm256_loadu_ps(sb->r + k);
+    __m256 proj = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r0, h0), _mm256_mul_ps(r1, h1)),
+                                _mm256_mul_ps(r2, h2));
+    __m256 o0 = _mm256_sub_ps(h0, _mm256_mul_ps(r0, proj));
+    __m256 o1 = _mm256_sub_ps(h1, _mm256_mul_ps(r1, proj));
+    __m256 o2 = _mm256_sub_ps(h2, _mm256_mul_ps(r2, proj));
+    __m256 miss = _mm256_or_ps(_mm256_cmp_ps(_mm256_andnot_ps(sign, o0), cut, _CMP_GT_OQ),
+                               _mm256_cmp_ps(_mm256_andnot_ps(sign, o1), cut, _CMP_GT_OQ));
+    __m256 opp = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(o0, o0), _mm256_mul_ps(o1, o1)),
+                               _mm256_mul_ps(o2, o2));
+    miss = _mm256_or_ps(miss, _mm256_cmp_ps(_mm256_andnot_ps(sign, o2), cut, _CMP_GT_OQ));
+    _mm256_storeu_ps(sb->opp + k, _mm256_blendv_ps(opp, big, miss));
+    _mm256_storeu_ps(sb->along + k, proj);
+  }
+}
+#endif
+
+static BasisSphereKernelFn *BasisSphereKernelZ = BasisSphereKernelZScalar;
+static BasisSphereKernelFn *BasisSphereKernel = BasisSphereKernelScalar;
+static int BasisSphereWidth = 1;
+
+static void BasisSphereKernelSelect(void)
+{
+#ifdef BASIS_SIMD_X86
+  static int selected = false;
+  if(selected)
+    return;
+  selected = true;
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")) {
+    BasisSphereKernelZ = BasisSphereKernelZAVX2;
+    BasisSphereKernel = BasisSphereKernelAVX2;
+    BasisSphereWidth = 8;
+  } else if(__builtin_cpu_supports("sse2")) {
+    BasisSphereKernelZ = BasisSphereKernelZSSE2;
+    BasisSphereKernel = BasisSphereKernelSSE2;
+    BasisSphereWidth = 4;
+  }
+#endif
+}
+
+/* stage the spheres in the next stretch of a voxel list (starting at the
+   element "ip" points to) and clip them against the ray */
+
+static void BasisSphereBatchClip(BasisSphereBatch * sb, BasisSphereKernelFn * kernel,
+                                 const CBasis * BI, const int *vert2prim,
+                                 const CPrimitive * prim, const int *ip,
+                                 const float *base, const float *ray)
+{
+  const int n_vert = BI->NVertex;
+  const float *vertex = BI->Vertex, *radius = BI->Radius;
+  int n = 0, n_sph = 0, k;
+  int i = *ip;
+  while((n < BASIS_SPHERE_BATCH) && (i >= 0) && (i < n_vert)) {
+    if(prim[vert2prim[i]].type == cPrimSphere) {
+      const float *v = vertex + i * 3;
+      sb->pos[n_sph] = n;
+      sb->x[n_sph] = v[0];
+      sb->y[n_sph] = v[1];
+      sb->z[n_sph] = v[2];
+      sb->r[n_sph] = radius[i];
+      n_sph++;
+    }
+    n++;
+    i = *(++ip);
+  }
+  sb->n = n;
+  if(n_sph) {
+    k = n_sph;
+    while(k % BasisSphereWidth) {     /* padding always misses */
+      sb->x[k] = sb->y[k] = sb->z[k] = 0.0F;
+      sb->r[k] = -1.0F;
+      k++;
+    }
+    sb->n_sph = k;
+    kernel(sb, base, ray);
+    for(k = 0; k < n_sph; k++) {
+      int p = sb->pos[k];
+      sb->oppSq[p] = sb->opp[k];
+      sb->alongSq[p] = sb->along[k];
+    }
+  }
+}
+
 
 static int LineClipEllipsoidPoint(float *base, float *ray,
                                   float *point, float *dist,
@@ -1513,6 +1769,457 @@ void BasisGetTriangleNormal(CBasis * I, RayInfo * r, int i, float *fc, int persp
 }
 
 
+/*========================================================================*/
+/* Bounding volume hierarchy
+ *
+ * An alternative to the uniform voxel map for scenes where primitive sizes
+ * vary widely or where primitives are sparsely distributed.  The tree is
+ * built with a binned surface area heuristic; each primitive is entered
+ * once (through its representative vertex prm->vert), and leaves store
+ * -1 terminated vertex lists in the same format as a voxel's element
+ * list, so the BasisHit routines use the same per-primitive code for both
+ * structures.  Leaves are visited nearest first and skipped once they lie
+ * beyond the closest accepted hit.
+ *
+ * A range of m primitives owns 2m-1 consecutive nodes and 2m list entries
+ * (offset by one so that list offsets are always positive), which lets
+ * sub-trees be built independently and in parallel with a deterministic
+ * result.
+ */
+
+#define BASIS_BVH_BINS 16
+#define BASIS_BVH_LEAF 4
+#define BASIS_BVH_MAX_LEAF 16
+#define BASIS_BVH_DEPTH 48      /* also bounds the traversal stack */
+#define BASIS_BVH_PAD 0.0001F
+
+typedef struct {
+  CBasis *basis;
+  float *box;                   /* 6 per item: min[3], max[3] */
+  float *cent;                  /* 3 per item */
+  int *vert;                    /* representative vertex per item */
+  int *idx;                     /* item permutation being partitioned */
+  int task_depth;
+  int n_job;
+  int *job;                     /* 5 per job: node, lo, mid, hi, depth */
+} BasisBVHBuildRec;
+
+static float BasisBVHArea(const float *mn, const float *mx)
+{
+  float d0 = mx[0] - mn[0], d1 = mx[1] - mn[1], d2 = mx[2] - mn[2];
+  return d0 * d1 + d1 * d2 + d2 * d0;
+}
+
+static void BasisBVHBuildNode(BasisBVHBuildRec * B, int node, int lo, int hi, int depth)
+{
+  CBasis *I = B->basis;
+  BasisBVHNode *nd = I->BVHNode + node;
+  const int m = hi - lo;
+  float cmin[3], cmax[3];
+  int a, d, axis = 0, mid = lo;
+
+  {
+    const float *bx = B->box + B->idx[lo] * 6;
+    const float *cn = B->cent + B->idx[lo] * 3;
+    copy3f(bx, nd->min);
+    copy3f(bx + 3, nd->max);
+    copy3f(cn, cmin);
+    copy3f(cn, cmax);
+  }
+  for(a = lo + 1; a < hi; a++) {
+    const float *bx = B->box + B->idx[a] * 6;
+    const float *cn = B->cent + B->idx[a] * 3;
+    for(d = 0; d < 3; d++) {
+      if(nd->min[d] > bx[d])
+        nd->min[d] = bx[d];
+      if(nd->max[d] < bx[d + 3])
+        nd->max[d] = bx[d + 3];
+      if(cmin[d] > cn[d])
+        cmin[d] = cn[d];
+      if(cmax[d] < cn[d])
+        cmax[d] = cn[d];
+    }
+  }
+
+  if((m > BASIS_BVH_LEAF) && (depth < BASIS_BVH_DEPTH - 2)) {
+    for(d = 1; d < 3; d++)
+      if((cmax[d] - cmin[d]) > (cmax[axis] - cmin[axis]))
+        axis = d;
+    if(cmax[axis] > cmin[axis]) {
+      int cnt[BASIS_BVH_BINS];
+      float bmin[BASIS_BVH_BINS][3], bmax[BASIS_BVH_BINS][3];
+      float rmin[3], rmax[3], right_cost[BASIS_BVH_BINS];
+      float scale = BASIS_BVH_BINS / (cmax[axis] - cmin[axis]);
+      float best_cost = MAXFLOAT;
+      int best = -1, n_right;
+
+      UtilZeroMem(cnt, sizeof(cnt));
+      for(a = lo; a < hi; a++) {
+        const float *bx = B->box + B->idx[a] * 6;
+        int k = (int) ((B->cent[B->idx[a] * 3 + axis] - cmin[axis]) * scale);
+        if(k > BASIS_BVH_BINS - 1)
+          k = BASIS_BVH_BINS - 1;
+        if(!cnt[k]) {
+          copy3f(bx, bmin[k]);
+          copy3f(bx + 3, bmax[k]);
+        } else {
+          for(d = 0; d < 3; d++) {
+            if(bmin[k][d] > bx[d])
+              bmin[k][d] = bx[d];
+            if(bmax[k][d] < bx[d + 3])
+              bmax[k][d] = bx[d + 3];
+          }
+        }
+        cnt[k]++;
+      }
+
+      /* sweep from the right, then from the left */
+      n_right = 0;
+      for(a = BASIS_BVH_BINS - 1; a > 0; a--) {
+        if(cnt[a]) {
+          if(!n_right) {
+            copy3f(bmin[a], rmin);
+            copy3f(bmax[a], rmax);
+          } else {
+            for(d = 0; d < 3; d++) {
+              if(rmin[d] > bmin[a][d])
+                rmin[d] = bmin[a][d];
+              if(rmax[d] < bmax[a][d])
+                rmax[d] = bmax[a][d];
+            }
+          }
+          n_right += cnt[a];
+        }
+        right_cost[a] = n_right ? n_right * BasisBVHArea(rmin, rmax) : 0.0F;
+      }
+      {
+        float lmin[3], lmax[3];
+        int n_left = 0;
+        for(a = 0; a < BASIS_BVH_BINS - 1; a++) {
+          if(cnt[a]) {
+            if(!n_left) {
+              copy3f(bmin[a], lmin);
+              copy3f(bmax[a], lmax);
+            } else {
+              for(d = 0; d < 3; d++) {
+                if(lmin[d] > bmin[a][d])
+                  lmin[d] = bmin[a][d];
+                if(lmax[d] < bmax[a][d])
+                  lmax[d] = bmax[a][d];
+              }
+            }
+            n_left += cnt[a];
+          }
+          if(n_left && (n_left < m)) {
+            float cost = n_left * BasisBVHArea(lmin, lmax) + right_cost[a + 1];
+            if(cost < best_cost) {
+              best_cost = cost;
+              best = a;
+            }
+          }
+        }
+      }
+
+      /* leaf when splitting doesn't pay (unit traversal and test costs) */
+      if((best >= 0) &&
+         ((m > BASIS_BVH_MAX_LEAF) ||
+          ((1.0F + best_cost / BasisBVHArea(nd->min, nd->max)) < m))) {
+        int *ia = B->idx + lo, *ib = B->idx + hi - 1;
+        while(ia <= ib) {
+          int k = (int) ((B->cent[*ia * 3 + axis] - cmin[axis]) * scale);
+          if(k > BASIS_BVH_BINS - 1)
+            k = BASIS_BVH_BINS - 1;
+          if(k <= best) {
+            ia++;
+          } else {
+            int t = *ia;
+            *ia = *ib;
+            *(ib--) = t;
+          }
+        }
+        mid = (int) (ia - B->idx);
+      }
+    } else if(m > BASIS_BVH_MAX_LEAF) {
+      mid = lo + m / 2;         /* coincident centers */
+    }
+  }
+
+  if((mid > lo) && (mid < hi)) {
+    nd->count = 0;
+    nd->first = node + 2 * (mid - lo);
+    if(depth == B->task_depth) {
+      int *job = B->job + 5 * B->n_job;
+      job[0] = node;
+      job[1] = lo;
+      job[2] = mid;
+      job[3] = hi;
+      job[4] = depth;
+      B->n_job++;
+    } else {
+      BasisBVHBuildNode(B, node + 1, lo, mid, depth + 1);
+      BasisBVHBuildNode(B, nd->first, mid, hi, depth + 1);
+    }
+  } else {
+    int *list = I->BVHVert + 1 + 2 * lo;
+    nd->count = m;
+    nd->first = 1 + 2 * lo;
+    for(a = lo; a < hi; a++)
+      *(list++) = B->vert[B->idx[a]];
+    *list = -1;
+  }
+}
+
+static void BasisBVHBuildTask(void *ctx, int index)
+{
+  /* builds both children of a node split by the serial pass */
+  BasisBVHBuildRec *B = (BasisBVHBuildRec *) ctx;
+  const int *job = B->job + 5 * index;
+  BasisBVHBuildRec rec = *B;
+  rec.task_depth = -1;
+  BasisBVHBuildNode(&rec, job[0] + 1, job[1], job[2], job[4] + 1);
+  BasisBVHBuildNode(&rec, B->basis->BVHNode[job[0]].first, job[2], job[3], job[4] + 1);
+}
+
+int BasisMakeBVH(CBasis * I, CPrimitive * prim, int n_prim)
+{
+  PyMOLGlobals *G = I->G;
+  BasisBVHBuildRec B;
+  int ok = true;
+  int a, n = 0, n_thread;
+  float *box, *cent;
+
+  UtilZeroMem(&B, sizeof(B));
+  B.basis = I;
+  B.box = Alloc(float, 6 * (n_prim + 1));
+  B.cent = Alloc(float, 3 * (n_prim + 1));
+  B.vert = Alloc(int, n_prim + 1);
+  B.idx = Alloc(int, n_prim + 1);
+  ok = B.box && B.cent && B.vert && B.idx;
+
+  /* primitive bounds in this basis (cf. RayComputeBox) */
+  box = B.box;
+  cent = B.cent;
+  for(a = 0; ok && a < n_prim; a++) {
+    CPrimitive *prm = prim + a;
+    float *v = I->Vertex + prm->vert * 3;
+    float r = prm->r1, pad = BASIS_BVH_PAD;
+    int d, n_pt = 1;
+    const float *pt[3];
+    float end[3];
+
+    pt[0] = v;
+    switch (prm->type) {
+    case cPrimTriangle:
+    case cPrimCharacter:
+      r = 0.0F;
+      pt[1] = v + 3;
+      pt[2] = v + 6;
+      n_pt = 3;
+      /* room for the triangle edge fudge */
+      pad += 0.001F * (float) sqrt1f(diffsq3f(v, v + 3) + diffsq3f(v, v + 6));
+      break;
+    case cPrimSphere:
+    case cPrimEllipsoid:
+      break;
+    case cPrimCone:
+    case cPrimCylinder:
+    case cPrimSausage:
+      if(r < prm->r2)
+        r = prm->r2;
+      scale3f(I->Normal + I->Vert2Normal[prm->vert] * 3, prm->l1, end);
+      add3f(v, end, end);
+      pt[1] = end;
+      n_pt = 2;
+      break;
+    default:
+      continue;
+    }
+    r += pad;
+    copy3f(v, box);
+    copy3f(v, box + 3);
+    while(--n_pt > 0) {
+      const float *p = pt[n_pt];
+      for(d = 0; d < 3; d++) {
+        if(box[d] > p[d])
+          box[d] = p[d];
+        if(box[d + 3] < p[d])
+          box[d + 3] = p[d];
+      }
+    }
+    for(d = 0; d < 3; d++) {
+      box[d] -= r;
+      box[d + 3] += r;
+      cent[d] = (box[d] + box[d + 3]) * 0.5F;
+    }
+    B.vert[n] = prm->vert;
+    B.idx[n] = n;
+    box += 6;
+    cent += 3;
+    n++;
+  }
+
+  FreeP(I->BVHNode);
+  FreeP(I->BVHVert);
+  I->NBVHNode = 0;
+  I->NBVHVert = 0;
+  if(ok && n) {
+    I->BVHNode = Alloc(BasisBVHNode, 2 * n - 1);
+    I->BVHVert = Alloc(int, 2 * n + 1);
+    ok = I->BVHNode && I->BVHVert;
+  }
+  if(ok && n) {
+    I->NBVHNode = 2 * n - 1;
+    I->NBVHVert = 2 * n + 1;
+    I->BVHVert[0] = -1;
+
+    /* split the upper levels serially, then build the sub-trees in parallel */
+    n_thread = TaskPoolGetNThread(G);
+    B.task_depth = -1;
+    if((n_thread > 1) && (n > 1024)) {
+      B.task_depth = 2;
+      while((B.task_depth < 8) && ((1 << B.task_depth) < 4 * n_thread))
+        B.task_depth++;
+      B.job = Alloc(int, 5 << B.task_depth);
+      if(!B.job)
+        B.task_depth = -1;
+    }
+    BasisBVHBuildNode(&B, 0, 0, n, 0);
+    if(B.n_job)
+      TaskPoolRun(G, n_thread, B.n_job, BasisBVHBuildTask, &B);
+    FreeP(B.job);
+  }
+  PRINTFB(G, FB_Ray, FB_Blather)
+    " BasisMakeBVH: %d primitives, %d nodes.\n", n, I->NBVHNode ENDFB(G);
+
+  FreeP(B.box);
+  FreeP(B.cent);
+  FreeP(B.vert);
+  FreeP(B.idx);
+  return ok;
+}
+
+/* nearest-first traversal state */
+
+typedef struct {
+  int node[BASIS_BVH_DEPTH + 2];
+  float t_near[BASIS_BVH_DEPTH + 2];
+  int depth;
+  int z_only;                   /* ray heads along -Z (orthoscopic & shadow) */
+  float base[3], inv[3];
+  float t_lo;
+} BasisBVHWalk;
+
+/* where does the ray enter the node's box?  (returns false on a miss
+   or when the box lies entirely before t_lo) */
+
+static int BasisBVHEnter(const BasisBVHWalk * W, const BasisBVHNode * nd, float *t_near)
+{
+  float t0, t1;
+  if(W->z_only) {
+    if((W->base[0] < nd->min[0]) || (W->base[0] > nd->max[0]) ||
+       (W->base[1] < nd->min[1]) || (W->base[1] > nd->max[1]))
+      return false;
+    t0 = W->base[2] - nd->max[2];
+    t1 = W->base[2] - nd->min[2];
+  } else {
+    int d;
+    t0 = -MAXFLOAT;
+    t1 = MAXFLOAT;
+    for(d = 0; d < 3; d++) {
+      if(W->inv[d] == 0.0F) {   /* ray parallel to the slab */
+        if((W->base[d] < nd->min[d]) || (W->base[d] > nd->max[d]))
+          return false;
+      } else {
+        float ta = (nd->min[d] - W->base[d]) * W->inv[d];
+        float tb = (nd->max[d] - W->base[d]) * W->inv[d];
+        if(ta > tb) {
+          float t = ta;
+          ta = tb;
+          tb = t;
+        }
+        if(t0 < ta)
+          t0 = ta;
+        if(t1 > tb)
+          t1 = tb;
+      }
+    }
+    if(t0 > t1)
+      return false;
+  }
+  if(t1 < W->t_lo)
+    return false;
+  *t_near = t0;
+  return true;
+}
+
+static int BasisBVHWalkInit(BasisBVHWalk * W, const CBasis * BI, const float *base,
+                            const float *dir, float t_lo)
+{
+  int d;
+  copy3f(base, W->base);
+  W->z_only = !dir;
+  if(dir) {
+    for(d = 0; d < 3; d++)
+      W->inv[d] = (dir[d] != 0.0F) ? 1.0F / dir[d] : 0.0F;
+  }
+  W->t_lo = t_lo;
+  W->depth = 0;
+  if(BI->NBVHNode && BasisBVHEnter(W, BI->BVHNode, W->t_near)) {
+    W->node[0] = 0;
+    W->depth = 1;
+  }
+  return W->depth;
+}
+
+/* returns the list offset of the next leaf entered before t_max, or 0 */
+
+static int BasisBVHNextLeaf(BasisBVHWalk * W, const CBasis * BI, float t_max)
+{
+  const BasisBVHNode *node = BI->BVHNode;
+  while(W->depth) {
+    int n;
+    W->depth--;
+    n = W->node[W->depth];
+    if(W->t_near[W->depth] > t_max)
+      continue;
+    while(!node[n].count) {
+      int c0 = n + 1, c1 = node[n].first;
+      float t0, t1;
+      int hit0 = BasisBVHEnter(W, node + c0, &t0);
+      int hit1 = BasisBVHEnter(W, node + c1, &t1);
+      if(hit0 && (t0 > t_max))
+        hit0 = false;
+      if(hit1 && (t1 > t_max))
+        hit1 = false;
+      if(hit0 && hit1) {
+        if(t1 < t0) {
+          int c = c0;
+          float t = t0;
+          c0 = c1;
+          t0 = t1;
+          c1 = c;
+          t1 = t;
+        }
+        W->node[W->depth] = c1; /* farther child waits */
+        W->t_near[W->depth] = t1;
+        W->depth++;
+        n = c0;
+      } else if(hit0) {
+        n = c0;
+      } else if(hit1) {
+        n = c1;
+      } else {
+        n = -1;
+        break;
+      }
+    }
+    if(n >= 0)
+      return node[n].first;
+  }
+  return 0;
+}
+
+
 /*========================================================================*/
 
 #ifdef PROFILE_BASIS
@@ -1532,20 +2239,15 @@ int BasisHitPerspective(BasisCallRec * BC)
 {
   CBasis *BI = BC->Basis;
   MapType *map = BI->Map;
-  int iMin0 = map->iMin[0];
-  int iMin1 = map->iMin[1];
-  int iMin2 = map->iMin[2];
-  int iMax0 = map->iMax[0];
-  int iMax1 = map->iMax[1];
-  int iMax2 = map->iMax[2];
+  const int bvh = (BI->BVHNode != NULL);
+  BasisBVHWalk walk;
+  int iMin0 = 0, iMin1 = 0, iMin2 = 0;
+  int iMax0 = 0, iMax1 = 0, iMax2 = 0;
   int a, b, c;
 
-  float iDiv = map->recipDiv;
-  float base0, base1, base2;
-
-  float min0 = map->Min[0] * iDiv;
-  float min1 = map->Min[1] * iDiv;
-  float min2 = map->Min[2] * iDiv;
+  float iDiv = 0.0F;
+  float base0 = 0.0F, base1 = 0.0F, base2 = 0.0F;
+  float min0 = 0.0F, min1 = 0.0F, min2 = 0.0F;
 
   int new_ray = !BC->pass;
   RayInfo *r = BC->rr;
@@ -1556,7 +2258,20 @@ int BasisHitPerspective(BasisCallRec * BC)
 
   CPrimitive *r_prim = NULL;
 
-  if(new_ray) {                 /* see if we can eliminate this ray right away using the mask */
+  if(!bvh) {
+    iMin0 = map->iMin[0];
+    iMin1 = map->iMin[1];
+    iMin2 = map->iMin[2];
+    iMax0 = map->iMax[0];
+    iMax1 = map->iMax[1];
+    iMax2 = map->iMax[2];
+    iDiv = map->recipDiv;
+    min0 = map->Min[0] * iDiv;
+    min1 = map->Min[1] * iDiv;
+    min2 = map->Min[2] * iDiv;
+  }
+
+  if(new_ray && !bvh) {                 /* see if we can eliminate this ray right away using the mask */
 
     base0 = (r->base[0] * iDiv) - min0;
     base1 = (r->base[1] * iDiv) - min1;
@@ -1583,7 +2298,7 @@ int BasisHitPerspective(BasisCallRec * BC)
     int allow_break;
     int minIndex = -1;
 
-    float step0, step1, step2;
+    float step0 = 0.0F, step1 = 0.0F, step2 = 0.0F;
     float back_dist = BC->back_dist;
 
     const float _0 = 0.0F, _1 = 1.0F;
@@ -1593,16 +2308,16 @@ int BasisHitPerspective(BasisCallRec * BC)
     int excl_trans_flag;
     int *elist, local_iflag = false;
     int terminal = -1;
-    int *ehead = map->EHead;
-    int d1d2 = map->D1D2;
-    int d2 = map->Dim[2];
+    int *ehead = bvh ? NULL : map->EHead;
+    int d1d2 = bvh ? 0 : map->D1D2;
+    int d2 = bvh ? 0 : map->Dim[2];
     const int *vert2prim = BC->vert2prim;
     const float excl_trans = BC->excl_trans;
     const float BasisFudge0 = BC->fudge0;
     const float BasisFudge1 = BC->fudge1;
     int v2p;
     int i, ii;
-    int n_vert = BI->NVertex, n_eElem = map->NEElem;
+    int n_vert = BI->NVertex, n_eElem = bvh ? BI->NBVHVert : map->NEElem;
     int except1 = BC->except1;
     int except2 = BC->except2;
     int check_interior_flag = BC->check_interior && !BC->pass;
@@ -1614,9 +2329,11 @@ int BasisHitPerspective(BasisCallRec * BC)
     float *BI_Normal = BI->Normal;
     float *BI_Radius = BI->Radius;
     float *BI_Radius2 = BI->Radius2;
+    BasisSphereBatch sb;
+    int sb_pos = 0;
     copy3f(r->base, vt);
 
-    elist = map->EList;
+    elist = bvh ? BI->BVHVert : map->EList;
 
     r_dist = MAXFLOAT;
 
@@ -1629,82 +2346,95 @@ int BasisHitPerspective(BasisCallRec * BC)
 
     MapCacheReset(cache);
 
-    {                           /* take steps with a Z-size equil to the grid spacing */
+    if(bvh) {
+      BasisBVHWalkInit(&walk, BI, r->base, r->dir, -BASIS_BVH_PAD);
+    } else {                    /* take steps with a Z-size equil to the grid spacing */
       float div = iDiv * (-MapGetDiv(BI->Map) / r->dir[2]);
       step0 = r->dir[0] * div;
       step1 = r->dir[1] * div;
       step2 = r->dir[2] * div;
-    }
 
-    base0 = (r->skip[0] * iDiv) - min0;
-    base1 = (r->skip[1] * iDiv) - min1;
-    base2 = (r->skip[2] * iDiv) - min2;
+      base0 = (r->skip[0] * iDiv) - min0;
+      base1 = (r->skip[1] * iDiv) - min1;
+      base2 = (r->skip[2] * iDiv) - min2;
+    }
 
     allow_break = false;
     while(1) {
       int inside_code;
       int clamped;
 
-      a = ((int) base0);
-      b = ((int) base1);
-      c = ((int) base2);
+      if(bvh) {                 /* next leaf, nearest first */
+        h = BasisBVHNextLeaf(&walk, BI, (r_dist < back_dist) ? r_dist : back_dist);
+        if(!h)
+          break;
+        inside_code = 1;
+        clamped = false;
+        a = b = 0;
+        c = h;                  /* distinct for each leaf */
+      } else {
+        a = ((int) base0);
+        b = ((int) base1);
+        c = ((int) base2);
 
-      inside_code = 1;
-      clamped = false;
+        inside_code = 1;
+        clamped = false;
 
-      a += MapBorder;
-      b += MapBorder;
-      c += MapBorder;
+        a += MapBorder;
+        b += MapBorder;
+        c += MapBorder;
 #define EDGE_ALLOWANCE 1
 
-      if(a < iMin0) {
-        if(((iMin0 - a) > EDGE_ALLOWANCE) && allow_break)
-          break;
-        else {
-          a = iMin0;
-          clamped = true;
-        }
-      } else if(a > iMax0) {
-        if(((a - iMax0) > EDGE_ALLOWANCE) && allow_break)
-          break;
-        else {
-          a = iMax0;
-          clamped = true;
-        }
-      }
-      if(b < iMin1) {
-        if(((iMin1 - b) > EDGE_ALLOWANCE) && allow_break)
-          break;
-        else {
-          b = iMin1;
-          clamped = true;
-        }
-      } else if(b > iMax1) {
-        if(((b - iMax1) > EDGE_ALLOWANCE) && allow_break)
-          break;
-        else {
-          b = iMax1;
-          clamped = true;
+        if(a < iMin0) {
+          if(((iMin0 - a) > EDGE_ALLOWANCE) && allow_break)
+            break;
+          else {
+            a = iMin0;
+            clamped = true;
+          }
+        } else if(a > iMax0) {
+          if(((a - iMax0) > EDGE_ALLOWANCE) && allow_break)
+            break;
+          else {
+            a = iMax0;
+            clamped = true;
+          }
         }
-      }
-      if(c < iMin2) {
-        if((iMin2 - c) > EDGE_ALLOWANCE)
-          break;
-        else {
-          c = iMin2;
-          clamped = true;
+        if(b < iMin1) {
+          if(((iMin1 - b) > EDGE_ALLOWANCE) && allow_break)
+            break;
+          else {
+            b = iMin1;
+            clamped = true;
+          }
+        } else if(b > iMax1) {
+          if(((b - iMax1) > EDGE_ALLOWANCE) && allow_break)
+            break;
+          else {
+            b = iMax1;
+            clamped = true;
+          }
         }
-      } else if(c > iMax2) {
-        if((c - iMax2) > EDGE_ALLOWANCE)
-          inside_code = 0;
-        else {
-          c = iMax2;
-          clamped = true;
+        if(c < iMin2) {
+          if((iMin2 - c) > EDGE_ALLOWANCE)
+            break;
+          else {
+            c = iMin2;
+            clamped = true;
+          }
+        } else if(c > iMax2) {
+          if((c - iMax2) > EDGE_ALLOWANCE)
+            inside_code = 0;
+          else {
+            c = iMax2;
+            clamped = true;
+          }
         }
       }
       if(inside_code && (((a != last_a) || (b != last_b) || (c != last_c)))) {
         int new_min_index;
-        h = *(ehead + (d1d2 * a) + (d2 * b) + c);
+        if(!bvh)
+          h = *(ehead + (d1d2 * a) + (d2 * b) + c);
 
         new_min_index = -1;
 
@@ -1724,9 +2454,17 @@ int BasisHitPerspective(BasisCallRec * BC)
           last_b = b;
           do_loop = ((i >= 0) && (i < n_vert));
           last_c = c;
+          sb.n = 0;
+          sb_pos = 0;
 
           while(do_loop) {      /* n_vert checking is a bug workaround */
             CPrimitive *prm;
+            if(sb_pos == sb.n) {
+              BasisSphereBatchClip(&sb, BasisSphereKernel, BI, vert2prim, BC_prim,
+                                   ip - 1, r->base, r->dir);
+              sb_pos = 0;
+            }
+            sb_pos++;
             v2p = vert2prim[i];
             ii = *(ip++);
             prm = BC_prim + v2p;
@@ -1810,9 +2548,10 @@ int BasisHitPerspective(BasisCallRec * BC)
                 break;
               case cPrimSphere:
                 {
-                  if(LineClipPoint(r->base, r->dir,
-                                   BI_Vertex + i * 3, &dist,
-                                   BI_Radius[i], BI_Radius2[i])) {
+                  /* LineClipPoint, batched */
+                  float oppSq = sb.oppSq[sb_pos - 1];
+                  if(oppSq <= BI_Radius2[i]) {
+                    dist = sb.alongSq[sb_pos - 1] - (float) sqrt1f(BI_Radius2[i] - oppSq);
                     if((dist < r_dist) && (prm->trans != _1)) {
                       if((dist >= _0) && (dist <= back_dist)) {
                         new_min_index = prm->vert;
@@ -2006,6 +2745,9 @@ int BasisHitPerspective(BasisCallRec * BC)
         }                       /* if -- h valid */
       }
       /* end of if */
+      if(bvh)
+        continue;
+
       if(minIndex > -1) {
         if(terminal < 0)
           terminal = EDGE_ALLOWANCE + 1;
@@ -2037,8 +2779,12 @@ int BasisHitOrthoscopic(BasisCallRec * BC)
 
   CBasis *BI = BC->Basis;
   RayInfo *r = BC->rr;
+  BasisBVHWalk walk;
+  const int bvh = (BI->BVHNode != NULL);
 
-  if(MapInsideXY(BI->Map, r->base, &a, &b, &c)) {
+  if(bvh ? BasisBVHWalkInit(&walk, BI, r->base, NULL,
+                            ((BC->front < _0) ? BC->front : _0) - BASIS_BVH_PAD) :
+     MapInsideXY(BI->Map, r->base, &a, &b, &c)) {
     int minIndex = -1;
     int v2p;
     int i, ii;
@@ -2046,7 +2792,7 @@ int BasisHitOrthoscopic(BasisCallRec * BC)
     int do_loop;
     int except1 = BC->except1;
     int except2 = BC->except2;
-    int n_vert = BI->NVertex, n_eElem = BI->Map->NEElem;
+    int n_vert = BI->NVertex, n_eElem = bvh ? BI->NBVHVert : BI->Map->NEElem;
     const int *vert2prim = BC->vert2prim;
     const float front = BC->front;
     const float back = BC->back;
@@ -2055,6 +2801,8 @@ int BasisHitOrthoscopic(BasisCallRec * BC)
     const float BasisFudge1 = BC->fudge1;
 
     MapCache *cache = &BC->cache;
+    BasisSphereBatch sb;
+    int sb_pos;
 
     float r_tri1 = _0, r_tri2 = _0, r_dist = _0;        /* zero inits to suppress compiler warnings */
     float r_sphere0 = _0, r_sphere1 = _0, r_sphere2 = _0;
@@ -2076,19 +2824,35 @@ int BasisHitOrthoscopic(BasisCallRec * BC)
 
     r_dist = MAXFLOAT;
 
-    xxtmp = BI->Map->EHead + (a * BI->Map->D1D2) + (b * BI->Map->Dim[2]) + c;
+    if(!bvh)
+      xxtmp = BI->Map->EHead + (a * BI->Map->D1D2) + (b * BI->Map->Dim[2]) + c;
 
     MapCacheReset(cache);
 
-    elist = BI->Map->EList;
+    elist = bvh ? BI->BVHVert : BI->Map->EList;
 
-    while(c >= MapBorder) {
-      h = *xxtmp;
+    while(1) {
+      if(bvh) {                 /* next leaf, nearest first */
+        if(!(h = BasisBVHNextLeaf(&walk, BI, r_dist)))
+          break;
+      } else {
+        if(c < MapBorder)
+          break;
+        h = *xxtmp;
+      }
       if((h > 0) && (h < n_eElem)) {
         ip = elist + h;
         i = *(ip++);
         do_loop = ((i >= 0) && (i < n_vert));
+        sb.n = 0;
+        sb_pos = 0;
         while(do_loop) {
+          if(sb_pos == sb.n) {
+            BasisSphereBatchClip(&sb, BasisSphereKernelZ, BI, vert2prim, BC->prim,
+                                 ip - 1, r->base, NULL);
+            sb_pos = 0;
+          }
+          sb_pos++;
           ii = *(ip++);
           v2p = vert2prim[i];
           do_loop = ((ii >= 0) && (ii < n_vert));
@@ -2129,8 +2893,9 @@ int BasisHitOrthoscopic(BasisCallRec * BC)
               break;
 
             case cPrimSphere:
-              oppSq = ZLineClipPoint(r->base, BI->Vertex + i * 3, &dist, BI->Radius[i]);
+              oppSq = sb.oppSq[sb_pos - 1];     /* ZLineClipPoint, batched */
               if(oppSq <= BI->Radius2[i]) {
+                dist = sb.alongSq[sb_pos - 1];
                 dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
 
                 if((dist < r_dist) && (prm->trans != _1)) {
@@ -2305,6 +3070,9 @@ int BasisHitOrthoscopic(BasisCallRec * BC)
          so if an intersection has been found which occurs in front of
          the next voxel, then we can stop */
 
+      if(bvh)
+        continue;
+
       if(minIndex > -1) {
         int aa, bb, cc;
 
@@ -2365,14 +3133,17 @@ int BasisHitShadow(BasisCallRec * BC)
 
   CBasis *BI = BC->Basis;
   RayInfo *r = BC->rr;
+  BasisBVHWalk walk;
+  const int bvh = (BI->BVHNode != NULL);
 
-  if(MapInsideXY(BI->Map, r->base, &a, &b, &c)) {
+  if(bvh ? BasisBVHWalkInit(&walk, BI, r->base, NULL, -kR_SMALL4 - BASIS_BVH_PAD) :
+     MapInsideXY(BI->Map, r->base, &a, &b, &c)) {
     int minIndex = -1;
     int v2p;
     int i, ii;
     int *xxtmp;
 
-    int n_vert = BI->NVertex, n_eElem = BI->Map->NEElem;
+    int n_vert = BI->NVertex, n_eElem = bvh ? BI->NBVHVert : BI->Map->NEElem;
     int except1 = BC->except1;
     int except2 = BC->except2;
     const int *vert2prim = BC->vert2prim;
@@ -2386,6 +3157,7 @@ int BasisHitShadow(BasisCallRec * BC)
     int *cache_cache = cache->Cache;
     int *cache_CacheLink = cache->CacheLink;
     CPrimitive *BC_prim = BC->prim;
+    BasisSphereBatch sb;
 
     float r_tri1 = _0, r_tri2 = _0, r_dist;    /* zero inits to suppress compiler warnings */
     float r_sphere0 = _0, r_sphere1 = _0, r_sphere2 = _0;
@@ -2408,20 +3180,36 @@ int BasisHitShadow(BasisCallRec * BC)
     r_trans = _1;
     r_dist = MAXFLOAT;
 
-    xxtmp = BI->Map->EHead + (a * BI->Map->D1D2) + (b * BI->Map->Dim[2]) + c;
+    if(!bvh)
+      xxtmp = BI->Map->EHead + (a * BI->Map->D1D2) + (b * BI->Map->Dim[2]) + c;
 
     MapCacheReset(cache);
 
-    elist = BI->Map->EList;
+    elist = bvh ? BI->BVHVert : BI->Map->EList;
 
-    while(c >= MapBorder) {
-      h = *xxtmp;
+    while(1) {
+      if(bvh) {                 /* (no distance cut-off: transparency) */
+        if(!(h = BasisBVHNextLeaf(&walk, BI, MAXFLOAT)))
+          break;
+      } else {
+        if(c < MapBorder)
+          break;
+        h = *xxtmp;
+      }
       if((h > 0) && (h < n_eElem)) {
         int do_loop;
+        int sb_pos = 0;
         ip = elist + h;
         i = *(ip++);
         do_loop = ((i >= 0) && (i < n_vert));
+        sb.n = 0;
         while(do_loop) {
+          if(sb_pos == sb.n) {
+            BasisSphereBatchClip(&sb, BasisSphereKernelZ, BI, vert2prim, BC_prim,
+                                 ip - 1, r->base, NULL);
+            sb_pos = 0;
+          }
+          sb_pos++;
           ii = *(ip++);
           v2p = vert2prim[i];
           do_loop = ((ii >= 0) && (ii < n_vert));
@@ -2574,8 +3362,9 @@ int BasisHitShadow(BasisCallRec * BC)
 
             case cPrimSphere:
 
-              oppSq = ZLineClipPoint(r->base, BI->Vertex + i * 3, &dist, BI->Radius[i]);
+              oppSq = sb.oppSq[sb_pos - 1];     /* ZLineClipPoint, batched */
               if(oppSq <= BI->Radius2[i]) {
+                dist = sb.alongSq[sb_pos - 1];
                 dist = (float) (sqrt1f(dist) - sqrt1f((BI->Radius2[i] - oppSq)));
 
                 if(prm->trans == _0) {
@@ -2827,8 +3616,10 @@ int BasisHitShadow(BasisCallRec * BC)
          }
        */
 
-      c--;
-      xxtmp--;
+      if(!bvh) {
+        c--;
+        xxtmp--;
+      }
 
     }                           /* end of while */
 
@@ -3611,6 +4402,7 @@ int BasisMakeMap(CBasis * I, int *vert2prim, CPrimitive * prim, int n_prim,
 int BasisInit(PyMOLGlobals * G, CBasis * I, int group_id)
 {
   int ok = true;
+  BasisSphereKernelSelect();
   I->G = G;
   I->Radius = NULL;
   I->Radius2 = NULL;
@@ -3635,12 +4427,25 @@ int BasisInit(PyMOLGlobals * G, CBasis * I, int group_id)
     I->Precomp = VLACacheAlloc(I->G, float, 1, group_id, cCache_basis_precomp);
   CHECKOK(ok, I->Precomp);
   I->Map = NULL;
+  I->BVHNode = NULL;
+  I->BVHVert = NULL;
+  I->NBVHNode = 0;
+  I->NBVHVert = 0;
   I->NVertex = 0;
   I->NNormal = 0;
   return ok;
 }
 
 
+/*========================================================================*/
+int BasisCacheInit(CBasis * I, MapCache * M, int group_id, int block_base)
+{
+  if(I->Map)
+    return MapCacheInit(M, I->Map, group_id, block_base);
+  return MapCacheInitSize(I->G, M, I->NVertex, group_id, block_base);
+}
+
+
 /*========================================================================*/
 void BasisFinish(CBasis * I, int group_id)
 {
@@ -3648,6 +4453,8 @@ void BasisFinish(CBasis * I, int group_id)
     MapFree(I->Map);
     I->Map = NULL;
   }
+  FreeP(I->BVHNode);
+  FreeP(I->BVHVert);
   VLACacheFreeP(I->G, I->Radius2, group_id, cCache_basis_radius2, false);
   VLACacheFreeP(I->G, I->Radius, group_id, cCache_basis_radius, false);
   VLACacheFreeP(I->G, I->Vertex, group_id, cCache_basis_vertex, false);
@@ -55,9 +55,23 @@ typedef struct {
   /* float wobble_param[3] eliminated to save space */
 } CPrimitive;                   /* currently 172 bytes -> appoximately 6.5 million primitives per gigabyte */
 
+/* bounding volume hierarchy node: inner nodes are followed by their
+   left child and point to their right child; leaves point to a -1
+   terminated list of primitive vertices (in the same format as a
+   voxel's element list) */
+
+typedef struct {
+  float min[3], max[3];
+  int first;                    /* leaf: offset into BVHVert, inner: right child */
+  int count;                    /* leaf: number of primitives, inner: 0 */
+} BasisBVHNode;
+
 typedef struct {
   PyMOLGlobals *G;
   MapType *Map;
+  BasisBVHNode *BVHNode;        /* when present, used instead of Map */
+  int *BVHVert;
+  int NBVHNode, NBVHVert;
   float *Vertex, *Normal, *Precomp;
   float *Radius, *Radius2, MaxRadius, MinVoxel;
   int *Vert2Normal;
@@ -108,10 +122,12 @@ typedef struct {
 
 int BasisInit(PyMOLGlobals * G, CBasis * I, int group_id);
 void BasisFinish(CBasis * I, int group_id);
+int BasisCacheInit(CBasis * I, MapCache * M, int group_id, int block_base);
 int BasisMakeMap(CBasis * I, int *vert2prim, CPrimitive * prim, int n_prim,
 		 float *volume,
 		 int group_id, int block_base,
 		 int perspective, float front, float size_hint);
+int BasisMakeBVH(CBasis * I, CPrimitive * prim, int n_prim);
 
 void BasisSetupMatrix(CBasis * I);
 void BasisGetTriangleNormal(CBasis * I, RayInfo * r, int i, float *fc, int perspective);
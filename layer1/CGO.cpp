@@ -39,6 +39,8 @@ Z* -------------------------------------------------------------------
 #include"CoordSet.h"
 #include"Rep.h"
 
+#include <string>
+
 #define VAR_FOR_NORMAL  pl
 #define VERTEX_NORMAL_SIZE 3
 #define VAR_FOR_NORMAL_CNT_PLUS   
@@ -360,6 +362,49 @@ CGO *CGONewFromPyList(PyMOLGlobals * G, PyObject * list, int version)
   }
 }
 
+PyObject *CGOAsPyString(CGO * I)
+{
+#ifdef _PYMOL_NOPY
+  return NULL;
+#else
+  std::string data;
+  int has_begin_end = I->has_begin_end;
+  if(I->has_draw_buffers || I->has_draw_cylinder_buffers || I->has_draw_sphere_buffers)
+    return NULL;                /* GL buffer ids are meaningless outside this context */
+  data.append((const char *) &I->c, sizeof(int));
+  data.append((const char *) &has_begin_end, sizeof(int));
+  data.append((const char *) I->op, sizeof(float) * I->c);
+  return PyString_FromStringAndSize(data.data(), data.size());
+#endif
+}
+
+CGO *CGONewFromPyString(PyMOLGlobals * G, PyObject * str)
+{
+#ifdef _PYMOL_NOPY
+  return NULL;
+#else
+  CGO *I = NULL;
+  if(str && PyString_Check(str)) {
+    const char *data = PyString_AsString(str);
+    int size = PyString_Size(str);
+    int c, has_begin_end;
+    if(size >= (int) (2 * sizeof(int))) {
+      memcpy(&c, data, sizeof(int));
+      memcpy(&has_begin_end, data + sizeof(int), sizeof(int));
+      if((c >= 0) && (size == (int) (2 * sizeof(int) + sizeof(float) * c))) {
+        I = CGONewSized(G, c);
+        if(I) {
+          memcpy(I->op, data + 2 * sizeof(int), sizeof(float) * c);
+          I->c = c;
+          I->has_begin_end = has_begin_end;
+        }
+      }
+    }
+  }
+  return I;
+#endif
+}
+
 CGO *CGONew(PyMOLGlobals * G)
 {
   OOCalloc(G, CGO);
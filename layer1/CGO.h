@@ -347,6 +347,12 @@ void CGOSetUseShader(CGO *I, int use_shader);
 
 PyObject *CGOAsPyList(CGO * I);
 CGO *CGONewFromPyList(PyMOLGlobals * G, PyObject * list, int version);
+
+/* raw copy of the operation buffer, only to be read back by the same
+   build (e.g. for the representation cache); NULL if the CGO refers to
+   GL buffers */
+PyObject *CGOAsPyString(CGO * I);
+CGO *CGONewFromPyString(PyMOLGlobals * G, PyObject * str);
 void SetCGOPickColor(float *colorVals, int nverts, int pl, int index, int bond);
 int CGOPickColor(CGO * I, int index, int bond);
 float *CGO_add_GLfloat(CGO * I, int c);
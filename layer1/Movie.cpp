@@ -42,6 +42,15 @@ Z* -------------------------------------------------------------------
 #include"CGO.h"
 #include"MovieScene.h"
 
+#ifndef _PYMOL_NO_CXX11
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <string>
+#endif
+
 #define cMovieDragModeMoveKey   1
 #define cMovieDragModeInsDel    2
 #define cMovieDragModeCopyKey   3
@@ -66,12 +75,25 @@ typedef struct {
   int format;
   int quiet;
   OrthoLineType fname;
+  struct CMovieEncoder *encoder;        /* NULL: write synchronously */
 
 } CMovieModal;
 
+/* per-image frame cache bookkeeping, parallel to CMovie::Image */
+typedef struct {
+  unsigned char *packed;        /* compressed image data, or NULL */
+  int packed_size;
+  ImageType header;             /* geometry of the packed image (no data) */
+  unsigned int used;            /* LRU stamp */
+} CMovieFrame;
+
 struct _CMovie {
   ::Block *Block;
   ImageType **Image;
+  CMovieFrame *Frame;
+  unsigned int CacheClock;
+  int CacheHot;                 /* image last handed to the scene, never evicted */
+  CMovieCacheStats CacheStats;
   int *Sequence;
   MovieCmdType *Cmd;
   int NImage, NFrame;
@@ -282,6 +304,8 @@ void MovieCopyPrepare(PyMOLGlobals * G, int *width, int *height, int *length)
     /* make sure all the movie frames match the screen size or are pre-rendered and are already the same size */
     for(a = 0; a < nFrame; a++) {
       image = I->Image[a];
+      if(!image && (a < (int) VLAGetSize(I->Frame)) && I->Frame[a].packed)
+        image = &I->Frame[a].header;
       if(image) {
         if((image->height != *height) || (image->width != *width)) {
           scene_match = false;
@@ -309,6 +333,285 @@ void MovieCopyPrepare(PyMOLGlobals * G, int *width, int *height, int *length)
   *length = nFrame;
 }
 
+/*========================================================================*/
+/* Frame cache: with cache_frames, rendered images are kept per movie image
+   index. movie_cache_max bounds the memory used (in MB, 0 = unlimited):
+   least recently used images get compressed (movie_cache_compress) or
+   dropped. Compressed images are unpacked again on access.
+
+   The codec is a fast lossless scheme for 32-bit pixels. Each op is a
+   header byte (op << 6 | n - 1) over n pixels; n - 1 == 63 is followed by
+   a varint of n - 64.
+     literal: n raw pixels follow
+     run:     repeat the previous pixel n times
+     above:   copy n pixels from one row up */
+
+#define cMoviePackLiteral 0
+#define cMoviePackRun     1
+#define cMoviePackAbove   2
+
+static unsigned char *MoviePackOp(unsigned char *q, int op, int n)
+{
+  n--;
+  if(n < 63) {
+    *(q++) = (unsigned char) ((op << 6) | n);
+  } else {
+    *(q++) = (unsigned char) ((op << 6) | 63);
+    for(n -= 63; n >= 0x80; n >>= 7)
+      *(q++) = (unsigned char) ((n & 0x7F) | 0x80);
+    *(q++) = (unsigned char) n;
+  }
+  return q;
+}
+
+/* dst must hold 4 * n + 16 bytes, returns the packed size */
+static int MoviePackPixels(const unsigned int *src, int n, int width, unsigned char *dst)
+{
+  unsigned char *q = dst;
+  int i = 0, lit = 0;
+  while(i < n) {
+    int run = 0, above = 0;
+    unsigned int prev = i ? src[i - 1] : 0;
+    while((i + run < n) && (src[i + run] == prev))
+      run++;
+    if(i >= width)
+      while((i + above < n) && (src[i + above] == src[i + above - width]))
+        above++;
+    if(!(run || above)) {
+      lit++;
+      i++;
+      continue;
+    }
+    if(lit) {
+      q = MoviePackOp(q, cMoviePackLiteral, lit);
+      memcpy(q, src + i - lit, 4 * lit);
+      q += 4 * lit;
+      lit = 0;
+    }
+    if(run >= above) {
+      q = MoviePackOp(q, cMoviePackRun, run);
+      i += run;
+    } else {
+      q = MoviePackOp(q, cMoviePackAbove, above);
+      i += above;
+    }
+  }
+  if(lit) {
+    q = MoviePackOp(q, cMoviePackLiteral, lit);
+    memcpy(q, src + i - lit, 4 * lit);
+    q += 4 * lit;
+  }
+  return (int) (q - dst);
+}
+
+static void MovieUnpackPixels(const unsigned char *p, int n, int width, unsigned int *dst)
+{
+  int i = 0;
+  while(i < n) {
+    int op = p[0] >> 6;
+    int cnt = (p[0] & 63) + 1;
+    p++;
+    if(cnt == 64) {
+      int shift = 0;
+      do {
+        cnt += (p[0] & 0x7F) << shift;
+        shift += 7;
+      } while(*(p++) & 0x80);
+    }
+    switch (op) {
+    case cMoviePackLiteral:
+      memcpy(dst + i, p, 4 * cnt);
+      p += 4 * cnt;
+      i += cnt;
+      break;
+    case cMoviePackRun:
+      {
+        unsigned int prev = i ? dst[i - 1] : 0;
+        while(cnt--)
+          dst[i++] = prev;
+      }
+      break;
+    default:
+      while(cnt--) {
+        dst[i] = dst[i - width];
+        i++;
+      }
+      break;
+    }
+  }
+}
+
+static int MovieImageBytes(const ImageType * image)
+{
+  return image->stereo ? 2 * image->size : image->size;
+}
+
+static CMovieFrame *MovieGetFrame(CMovie * I, int index)
+{
+  VLACheck(I->Frame, CMovieFrame, index);
+  return I->Frame + index;
+}
+
+static void MovieFreeImage(CMovie * I, int index)
+{
+  if(I->Image[index]) {
+    FreeP(I->Image[index]->data);
+    FreeP(I->Image[index]);
+  }
+}
+
+/* forget the compressed copy, e.g. because the image was replaced */
+static void MovieDropPacked(CMovie * I, int index)
+{
+  if(index < (int) VLAGetSize(I->Frame))
+    FreeP(I->Frame[index].packed);
+}
+
+/* make sure the image has a compressed copy, returns false if the image
+   doesn't compress */
+static int MoviePackImage(CMovie * I, int index)
+{
+  ImageType *image = I->Image[index];
+  CMovieFrame *frame = MovieGetFrame(I, index);
+  int bytes = MovieImageBytes(image);
+  int n_pixel = bytes / 4;
+  if(frame->packed)
+    return true;
+  if(!image->data || (bytes % 4) || (n_pixel < image->width))
+    return false;
+  frame->packed = Alloc(unsigned char, bytes + 16);
+  if(!frame->packed)
+    return false;
+  frame->packed_size = MoviePackPixels((unsigned int *) image->data, n_pixel,
+                                       image->width, frame->packed);
+  if(frame->packed_size >= bytes) {
+    FreeP(frame->packed);
+    return false;
+  }
+  frame->packed = Realloc(frame->packed, unsigned char, frame->packed_size);
+  frame->header = *image;
+  frame->header.data = NULL;
+  return true;
+}
+
+static int MovieUnpackImage(CMovie * I, int index)
+{
+  CMovieFrame *frame = MovieGetFrame(I, index);
+  ImageType *image;
+  int bytes = MovieImageBytes(&frame->header);
+  if(!(image = Alloc(ImageType, 1)))
+    return false;
+  *image = frame->header;
+  if(!(image->data = Alloc(unsigned char, bytes))) {
+    FreeP(image);
+    return false;
+  }
+  MovieUnpackPixels(frame->packed, bytes / 4, image->width, (unsigned int *) image->data);
+  I->Image[index] = image;
+  return true;
+}
+
+/* least recently used image (uncompressed or compressed) other than the
+   scene's and keep, or -1 */
+static int MovieCacheVictim(CMovie * I, int packed, int keep)
+{
+  int a, best = -1;
+  for(a = 0; a < I->NImage; a++) {
+    if((a == I->CacheHot) || (a == keep) ||
+       (packed ? !I->Frame[a].packed : !I->Image[a]))
+      continue;
+    if((best < 0) || (I->Frame[a].used < I->Frame[best].used))
+      best = a;
+  }
+  return best;
+}
+
+/* keep: an image the caller is about to use (or -1) */
+static void MovieCacheTrim(PyMOLGlobals * G, int keep)
+{
+  CMovie *I = G->Movie;
+  size_t limit = ((size_t) SettingGetGlobal_i(G, cSetting_movie_cache_max)) << 20;
+  int compress = SettingGetGlobal_b(G, cSetting_movie_cache_compress);
+  CMovieCacheStats stats;
+  int a;
+
+  if(!limit && !compress)
+    return;
+
+  VLACheck(I->Frame, CMovieFrame, I->NImage);
+
+  if(!limit) {
+    /* unbounded: keep everything except the current image compressed */
+    for(a = 0; a < I->NImage; a++)
+      if(I->Image[a] && (a != I->CacheHot) && (a != keep) && MoviePackImage(I, a))
+        MovieFreeImage(I, a);
+    return;
+  }
+
+  MovieGetCacheStats(G, &stats);
+  while(stats.image_bytes + stats.packed_bytes > limit) {
+    if((a = MovieCacheVictim(I, false, keep)) >= 0) {
+      int had_packed = (I->Frame[a].packed != NULL);
+      stats.image_bytes -= MovieImageBytes(I->Image[a]);
+      if(compress && !had_packed && MoviePackImage(I, a)) {
+        stats.packed_bytes += I->Frame[a].packed_size;
+      } else if(!had_packed) {
+        I->CacheStats.evictions++;
+      }
+      MovieFreeImage(I, a);
+    } else if((a = MovieCacheVictim(I, true, keep)) >= 0) {
+      stats.packed_bytes -= I->Frame[a].packed_size;
+      MovieDropPacked(I, a);
+      I->CacheStats.evictions++;
+    } else {
+      break;
+    }
+  }
+}
+
+/* uncompressed image for the given index (unpacking it if necessary), or
+   NULL if it needs to be rendered.  The image is only safe from eviction
+   until the next cache operation, unless the scene takes it (see
+   MovieGetImage). */
+static ImageType *MovieCacheFetch(PyMOLGlobals * G, int index)
+{
+  CMovie *I = G->Movie;
+  CMovieFrame *frame;
+  if((index < 0) || (index >= I->NImage))
+    return NULL;
+  frame = MovieGetFrame(I, index);
+  if(I->Image[index]) {
+    I->CacheStats.hits++;
+  } else if(frame->packed && MovieUnpackImage(I, index)) {
+    I->CacheStats.unpacks++;
+  } else {
+    I->CacheStats.misses++;
+    return NULL;
+  }
+  frame->used = ++I->CacheClock;
+  MovieCacheTrim(G, index);
+  return I->Image[index];
+}
+
+void MovieGetCacheStats(PyMOLGlobals * G, CMovieCacheStats * stats)
+{
+  CMovie *I = G->Movie;
+  int a, n_frame = VLAGetSize(I->Frame);
+  *stats = I->CacheStats;
+  stats->n_image = stats->n_packed = 0;
+  stats->image_bytes = stats->packed_bytes = 0;
+  for(a = 0; a < I->NImage; a++) {
+    if(I->Image[a] && I->Image[a]->data) {
+      stats->n_image++;
+      stats->image_bytes += MovieImageBytes(I->Image[a]);
+    }
+    if((a < n_frame) && I->Frame[a].packed) {
+      stats->n_packed++;
+      stats->packed_bytes += I->Frame[a].packed_size;
+    }
+  }
+}
+
 void MovieFlushCommands(PyMOLGlobals * G)
 {
   CMovie *I = G->Movie;
@@ -336,7 +639,7 @@ int MovieCopyFrame(PyMOLGlobals * G, int frame, int width, int height, int rowby
     MovieFlushCommands(G);
     i = MovieFrameToImage(G, a);
     VLACheck(I->Image, ImageType *, i);
-    if(!I->Image[i]) {
+    if(!MovieCacheFetch(G, i)) {
       SceneUpdate(G, false);
       SceneMakeMovieImage(G, false, false, cSceneImage_Default);
     }
@@ -368,6 +671,7 @@ int MovieCopyFrame(PyMOLGlobals * G, int frame, int width, int height, int rowby
         PyMOL_SwapBuffers(G->PyMOL);
     }
     if(!I->CacheSave) {
+      MovieDropPacked(I, i);
       if(I->Image[i]) {
         FreeP(I->Image[i]->data);
         FreeP(I->Image[i]);
@@ -392,6 +696,7 @@ int MoviePurgeFrame(PyMOLGlobals * G, int frame)
       int a = frame;
       i = MovieFrameToImage(G, a);
       VLACheck(I->Image, ImageType *, i);
+      MovieDropPacked(I, i);
       if(I->Image[i]) {
         FreeP(I->Image[i]->data);
         FreeP(I->Image[i]);
@@ -692,6 +997,141 @@ void MovieSetSize(PyMOLGlobals * G, unsigned int width, unsigned int height)
 }
 
 
+/*========================================================================*/
+/* Movie export pipeline: finished frames are handed to background
+   threads for PNG/PPM encoding and writing while the next frame is being
+   rendered. At most two frames per thread are in flight; beyond that,
+   MovieEncoderSubmit blocks until a slot frees up. */
+
+#ifndef _PYMOL_NO_CXX11
+
+typedef struct {
+  ImageType *image;
+  std::string fname;
+  float dpi;
+  int format, quiet;
+} CMovieEncodeJob;
+
+struct CMovieEncoder {
+  PyMOLGlobals *G;
+  std::mutex Lock;
+  std::condition_variable Ready;        /* job queued or stopping */
+  std::condition_variable Space;        /* job finished */
+  std::deque<CMovieEncodeJob> Queue;
+  std::vector<std::thread> Thread;
+  std::vector<std::string> Failed;      /* reported by the main thread */
+  int NInFlight, MaxInFlight;
+  int Stop;
+};
+
+static void MovieEncoderThread(CMovieEncoder * I)
+{
+  std::unique_lock<std::mutex> guard(I->Lock);
+  while(true) {
+    while(!I->Stop && I->Queue.empty())
+      I->Ready.wait(guard);
+    if(I->Queue.empty())
+      break;
+    CMovieEncodeJob job = I->Queue.front();
+    I->Queue.pop_front();
+    guard.unlock();
+
+    int ok = MyPNGWrite(I->G, (char *) job.fname.c_str(), job.image->data,
+                        job.image->width, job.image->height,
+                        job.dpi, job.format, job.quiet);
+    FreeP(job.image->data);
+    FreeP(job.image);
+
+    guard.lock();
+    if(!ok)
+      I->Failed.push_back(job.fname);
+    I->NInFlight--;
+    I->Space.notify_one();
+  }
+}
+
+#else
+
+struct CMovieEncoder {
+  int dummy;
+};
+
+#endif
+
+static CMovieEncoder *MovieEncoderNew(PyMOLGlobals * G, int n_thread)
+{
+#ifndef _PYMOL_NO_CXX11
+  if(n_thread > 0) {
+    CMovieEncoder *I = new CMovieEncoder;
+    I->G = G;
+    I->NInFlight = 0;
+    I->MaxInFlight = 2 * n_thread;
+    I->Stop = false;
+    for(int a = 0; a < n_thread; a++)
+      I->Thread.push_back(std::thread(MovieEncoderThread, I));
+    return I;
+  }
+#endif
+  return NULL;
+}
+
+/* print errors for frames which failed to write (main thread only) */
+static void MovieEncoderReport(PyMOLGlobals * G, CMovieEncoder * I)
+{
+#ifndef _PYMOL_NO_CXX11
+  std::vector<std::string> failed;
+  {
+    std::lock_guard<std::mutex> guard(I->Lock);
+    failed.swap(I->Failed);
+  }
+  for(size_t a = 0; a < failed.size(); a++) {
+    PRINTFB(G, FB_Movie, FB_Errors)
+      " MoviePNG-Error: unable to write '%s'\n", failed[a].c_str() ENDFB(G);
+  }
+#endif
+}
+
+/* takes ownership of image */
+static void MovieEncoderSubmit(PyMOLGlobals * G, CMovieEncoder * I, ImageType * image,
+                               const char *fname, float dpi, int format, int quiet)
+{
+#ifndef _PYMOL_NO_CXX11
+  CMovieEncodeJob job;
+  job.image = image;
+  job.fname = fname;
+  job.dpi = dpi;
+  job.format = format;
+  job.quiet = quiet;
+  {
+    std::unique_lock<std::mutex> guard(I->Lock);
+    while(I->NInFlight >= I->MaxInFlight)
+      I->Space.wait(guard);
+    I->NInFlight++;
+    I->Queue.push_back(job);
+  }
+  I->Ready.notify_one();
+#endif
+  MovieEncoderReport(G, I);
+}
+
+/* writes all pending frames, then stops the threads */
+static void MovieEncoderFree(PyMOLGlobals * G, CMovieEncoder * I)
+{
+#ifndef _PYMOL_NO_CXX11
+  if(!I)
+    return;
+  {
+    std::lock_guard<std::mutex> guard(I->Lock);
+    I->Stop = true;
+  }
+  I->Ready.notify_all();
+  for(size_t a = 0; a < I->Thread.size(); a++)
+    I->Thread[a].join();
+  MovieEncoderReport(G, I);
+  delete I;
+#endif
+}
+
 /*========================================================================*/
 static void MovieModalPNG(PyMOLGlobals * G, CMovie * I, CMovieModal * M)
 {
@@ -703,6 +1143,7 @@ static void MovieModalPNG(PyMOLGlobals * G, CMovie * I, CMovieModal * M)
       MovieClearImages(G);
     SettingSetGlobal_b(G, cSetting_cache_frames, 1);
     OrthoBusyPrime(G);
+    M->encoder = MovieEncoderNew(G, SettingGetGlobal_i(G, cSetting_movie_png_threads));
     M->nFrame = I->NFrame;
     if(!M->nFrame) {
       M->nFrame = SceneGetNFrame(G, NULL);
@@ -778,7 +1219,7 @@ static void MovieModalPNG(PyMOLGlobals * G, CMovie * I, CMovieModal * M)
     VLACheck(I->Image, ImageType *, M->image);
     if((M->frame >= M->start) &&        /* only render frames in the specified interval... */
        (M->frame <= M->stop) && (M->file_missing)) {    /* ...that don't already exist */
-      if(!I->Image[M->image]) {
+      if(!MovieCacheFetch(G, M->image)) {
         SceneUpdate(G, false);
         if(SceneMakeMovieImage(G, false, M->modal, M->mode) || (!M->modal)) {
           M->stage = 3;
@@ -806,11 +1247,12 @@ static void MovieModalPNG(PyMOLGlobals * G, CMovie * I, CMovieModal * M)
       PRINTFB(G, FB_Movie, FB_Errors)
         "MoviePNG-Error: Missing rendered image.\n" ENDFB(G);
     } else {
-      if(!MyPNGWrite(G, M->fname, I->Image[M->image]->data,
+      float dpi = SettingGetGlobal_f(G, cSetting_image_dots_per_inch);
+      if(!M->encoder &&
+         !MyPNGWrite(G, M->fname, I->Image[M->image]->data,
                      I->Image[M->image]->width,
                      I->Image[M->image]->height,
-                     SettingGetGlobal_f(G, cSetting_image_dots_per_inch),
-                     M->format, M->quiet)) {
+                     dpi, M->format, M->quiet)) {
         PRINTFB(G, FB_Movie, FB_Errors)
           " MoviePNG-Error: unable to write '%s'\n", M->fname ENDFB(G);
       }
@@ -818,10 +1260,19 @@ static void MovieModalPNG(PyMOLGlobals * G, CMovie * I, CMovieModal * M)
       OrthoBusySlow(G, M->frame, M->nFrame);
       if(G->HaveGUI)
         PyMOL_SwapBuffers(G->PyMOL);
-      PRINTFB(G, FB_Movie, FB_Debugging)
-        " MoviePNG-DEBUG: i = %d, I->Image[image] = %p\n", M->image,
-        I->Image[M->image]->data ENDFB(G);
+      if(I->Image[M->image]) {
+        PRINTFB(G, FB_Movie, FB_Debugging)
+          " MoviePNG-DEBUG: i = %d, I->Image[image] = %p\n", M->image,
+          I->Image[M->image]->data ENDFB(G);
+        if(M->encoder) {
+          /* written in the background while the next frame renders */
+          MovieEncoderSubmit(G, M->encoder, I->Image[M->image], M->fname,
+                             dpi, M->format, M->quiet);
+          I->Image[M->image] = NULL;
+        }
+      }
     }
+    MovieDropPacked(I, M->image);
     if(I->Image[M->image]) {
       FreeP(I->Image[M->image]->data);
       FreeP(I->Image[M->image]);
@@ -865,6 +1316,8 @@ static void MovieModalPNG(PyMOLGlobals * G, CMovie * I, CMovieModal * M)
   switch (M->stage) {
   case 5:                      /* finish up */
 
+    MovieEncoderFree(G, M->encoder);
+    M->encoder = NULL;
     SceneInvalidate(G);         /* important */
     PRINTFB(G, FB_Movie, FB_Debugging)
       " MoviePNG-DEBUG: done.\n" ENDFB(G);
@@ -899,6 +1352,7 @@ int MoviePNG(PyMOLGlobals * G, char *prefix, int save, int start,
 
   CMovieModal *M = &I->Modal;
 
+  MovieEncoderFree(G, M->encoder);      /* from an unfinished export */
   UtilZeroMem(M, sizeof(CMovieModal));
 
   UtilNCopy(M->prefix, prefix, sizeof(OrthoLineType));
@@ -1058,11 +1512,16 @@ void MovieSetImage(PyMOLGlobals * G, int index, ImageType * image)
     " MovieSetImage: setting movie image %d\n", index + 1 ENDFB(G);
 
   VLACheck(I->Image, ImageType *, index);
-  if(I->Image[index])
+  if(I->Image[index] && (I->Image[index] != image))
     FreeP(I->Image[index]);
   I->Image[index] = image;
   if(I->NImage < (index + 1))
     I->NImage = index + 1;
+
+  MovieDropPacked(I, index);
+  MovieGetFrame(I, index)->used = ++I->CacheClock;
+  I->CacheHot = index;          /* the scene owns it */
+  MovieCacheTrim(G, -1);
 }
 
 int MovieSeekScene(PyMOLGlobals * G, int loop)
@@ -1465,13 +1924,14 @@ void MovieAppendCommand(PyMOLGlobals * G, int frame, char *command)
 
 
 /*========================================================================*/
+/* for the scene, which keeps the image (MovieOwnsImageFlag), so it is
+   pinned in the cache until the scene takes another one */
 ImageType *MovieGetImage(PyMOLGlobals * G, int index)
 {
-  CMovie *I = G->Movie;
-  if((index >= 0) && (index < I->NImage))
-    return (I->Image[index]);
-  else
-    return (NULL);
+  ImageType *image = MovieCacheFetch(G, index);
+  if(image)
+    G->Movie->CacheHot = index;
+  return image;
 }
 
 
@@ -1513,6 +1973,10 @@ void MovieClearImages(PyMOLGlobals * G)
       }
     }
   }
+  for(a = 0; a < (int) VLAGetSize(I->Frame); a++)
+    FreeP(I->Frame[a].packed);
+  UtilZeroMem(&I->CacheStats, sizeof(CMovieCacheStats));
+  I->CacheHot = -1;
   I->NImage = 0;
   SceneInvalidate(G);
   SceneSuppressMovieFrame(G);
@@ -1540,8 +2004,10 @@ void MovieReset(PyMOLGlobals * G)
 void MovieFree(PyMOLGlobals * G)
 {
   CMovie *I = G->Movie;
+  MovieEncoderFree(G, I->Modal.encoder);
   MovieClearImages(G);
   VLAFree(I->Image);
+  VLAFreeP(I->Frame);
   VLAFreeP(I->ViewElem);
   VLAFreeP(I->Cmd);
   VLAFreeP(I->Sequence);
@@ -1988,6 +2454,8 @@ int MovieInit(PyMOLGlobals * G)
 
     I->Playing = false;
     I->Image = VLACalloc(ImageType *, 10);       /* auto-zero */
+    I->Frame = VLACalloc(CMovieFrame, 10);
+    I->CacheHot = -1;
     I->Sequence = NULL;
     I->Cmd = NULL;
     I->ViewElem = NULL;
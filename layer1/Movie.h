@@ -63,6 +63,19 @@ void MovieClearImages(PyMOLGlobals * G);
 ImageType *MovieGetImage(PyMOLGlobals * G, int image);
 void MovieSetImage(PyMOLGlobals * G, int index, ImageType * image);
 
+/* frame cache statistics (see movie_cache_max and movie_cache_compress) */
+typedef struct {
+  int n_image;                  /* uncompressed frames in memory */
+  int n_packed;                 /* compressed frames in memory */
+  size_t image_bytes, packed_bytes;
+  int hits;                     /* frame found uncompressed */
+  int unpacks;                  /* frame found compressed */
+  int misses;                   /* frame had to be rendered */
+  int evictions;
+} CMovieCacheStats;
+
+void MovieGetCacheStats(PyMOLGlobals * G, CMovieCacheStats * stats);
+
 int MovieGetLength(PyMOLGlobals * G);
 int MovieGetPanelHeight(PyMOLGlobals * G);
 int MovieFrameToImage(PyMOLGlobals * G, int frame);
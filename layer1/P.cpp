@@ -958,6 +958,8 @@ OV_STATIC ov_status CacheCreateEntry(PyObject ** result, PyObject * input)
         PyTuple_SetItem(hash_code, i, PyInt_FromLong(hash_long));
         if(PyTuple_Check(item)) {
           tot_size += PyTuple_Size(item);
+        } else if(PyString_Check(item)) {
+          tot_size += PyString_Size(item) / sizeof(float);
         }
       }
       PyList_SetItem(entry, 0, PyInt_FromLong(tot_size));
@@ -992,14 +994,16 @@ ov_status PCacheSet(PyMOLGlobals * G, PyObject * entry, PyObject * output)
         PyObject *item = PyTuple_GetItem(output, i);
         if(PyTuple_Check(item)) {
           tot_size += PyTuple_Size(item);
+        } else if(PyString_Check(item)) {
+          tot_size += PyString_Size(item) / sizeof(float);
         }
       }
     }
     PyList_SetItem(entry, 0, PyInt_FromLong(tot_size)); /* update total size */
     PyList_SetItem(entry, 3, PXIncRef(output));
     PXDecRef(PYOBJECT_CALLMETHOD(G->P_inst->cmd, "_cache_set",
-                                 "OiO", entry, SettingGetGlobal_i(G, cSetting_cache_max),
-                                 G->P_inst->cmd));
+                                 "OiOs", entry, SettingGetGlobal_i(G, cSetting_cache_max),
+                                 G->P_inst->cmd, SettingGetGlobal_s(G, cSetting_cache_dir)));
     /* compute the hash codes */
   }
   if(PyErr_Occurred())
@@ -1017,7 +1021,9 @@ ov_status PCacheGet(PyMOLGlobals * G,
 
     if(OV_OK(CacheCreateEntry(&entry, input))) {
       output = PYOBJECT_CALLMETHOD(G->P_inst->cmd, "_cache_get",
-                                   "OOO", entry, Py_None, G->P_inst->cmd);
+                                   "OOOsi", entry, Py_None, G->P_inst->cmd,
+                                   SettingGetGlobal_s(G, cSetting_cache_dir),
+                                   SettingGetGlobal_i(G, cSetting_cache_max));
       if(output == Py_None) {
         Py_DECREF(output);
         output = NULL;
@@ -227,7 +227,7 @@ void WrapperObjectReset(WrapperObject *);
 
 /* instance-specific Python object, containers, closures, and threads */
 
-#define MAX_SAVED_THREAD ((PYMOL_MAX_THREADS)+3)
+#define MAX_SAVED_THREAD ((PYMOL_MAX_THREADS)*2+3)
 
 struct _CP_inst {
   /* instance-specific storage */
@@ -259,6 +259,7 @@ struct _CP_inst {
   PyObject *unlock_glut;
 
   int glut_thread_keep_out;
+  int coord_view_released;      /* see CoordSetViewSync */
   SavedThreadRec savedThread[MAX_SAVED_THREAD];
 
   WrapperObject *wrapperObject;
@@ -515,6 +515,13 @@ int PConvPyListToFloatArray(PyObject * obj, float **f)
   if(!obj) {
     *f = NULL;
     ok = false;
+  } else if (PyString_Check(obj)){
+    // binary_dump
+    Py_ssize_t slen = PyString_Size(obj);
+    l = (int) (slen / sizeof(float));
+    (*f) = Alloc(float, l);
+    memcpy(*f, PyString_AsString(obj), (size_t) l * sizeof(float));
+    ok = l ? l : -1;
   } else if(!PyList_Check(obj)) {
     *f = NULL;
     ok = false;
@@ -642,6 +649,13 @@ int PConvPyListToIntArray(PyObject * obj, int **f)
   if(!obj) {
     *f = NULL;
     l = 0;
+  } else if (PyString_Check(obj)){
+    // binary_dump
+    Py_ssize_t slen = PyString_Size(obj);
+    l = (int) (slen / sizeof(int));
+    (*f) = Alloc(int, l);
+    memcpy(*f, PyString_AsString(obj), (size_t) l * sizeof(int));
+    ok = l ? l : -1;
   } else if(!PyList_Check(obj)) {
     *f = NULL;
     ok = false;
@@ -39,6 +39,7 @@ Z* -------------------------------------------------------------------
 #include"Scene.h"
 #include"PConv.h"
 #include"MyPNG.h"
+#include"TaskPool.h"
 
 #define SettingGetfv SettingGetGlobal_3fv
 
@@ -67,6 +68,49 @@ Z* -------------------------------------------------------------------
 typedef float float3[3];
 typedef float float4[4];
 
+/* image rectangle split into square tiles which the render threads
+   pull from a shared counter, so that threads which happen to get
+   cheap regions simply take more tiles */
+typedef struct {
+  int x_start, x_stop;
+  int y_start, y_stop;
+  int size;
+  int n_x, n_tile;
+  TaskPoolCounter next;
+} CRayTiles;
+
+static void RayTilesInit(CRayTiles * tiles, int x_start, int x_stop,
+                         int y_start, int y_stop, int size)
+{
+  if(size < 1)
+    size = 1;
+  tiles->x_start = x_start;
+  tiles->x_stop = x_stop;
+  tiles->y_start = y_start;
+  tiles->y_stop = y_stop;
+  tiles->size = size;
+  tiles->n_x = (x_stop > x_start) ? (x_stop - x_start + size - 1) / size : 0;
+  tiles->n_tile = tiles->n_x * ((y_stop > y_start) ? (y_stop - y_start + size - 1) / size : 0);
+  tiles->next = 0;
+}
+
+/* claims the next tile; returns its index or -1 when none are left */
+static int RayTilesNext(CRayTiles * tiles, int *x0, int *x1, int *y0, int *y1)
+{
+  int tile = tiles->next++;
+  if(tile >= tiles->n_tile)
+    return -1;
+  *x0 = tiles->x_start + (tile % tiles->n_x) * tiles->size;
+  *y0 = tiles->y_start + (tile / tiles->n_x) * tiles->size;
+  *x1 = *x0 + tiles->size;
+  *y1 = *y0 + tiles->size;
+  if(*x1 > tiles->x_stop)
+    *x1 = tiles->x_stop;
+  if(*y1 > tiles->y_stop)
+    *y1 = tiles->y_stop;
+  return tile;
+}
+
 struct _CRayThreadInfo {
   CRay *ray;
   int width, height;
@@ -81,6 +125,7 @@ struct _CRayThreadInfo {
   int phase, n_thread;
   int x_start, x_stop;
   int y_start, y_stop;
+  CRayTiles *tiles;
   unsigned int *edging;
   unsigned int edging_cutoff;
   int perspective;
@@ -101,6 +146,7 @@ struct _CRayHashThreadInfo {
   float front;
   int phase;
   float size_hint;
+  int bvh;                      /* build a BVH instead of the voxel map */
   CRay *ray;
   float *bkrd_top, *bkrd_bottom;
   short bkrd_is_gradient; /* if not gradient, use bkrd_top as bkrd */
@@ -114,6 +160,7 @@ struct _CRayAntiThreadInfo {
   unsigned int width, height;
   int mag;
   int phase, n_thread;
+  CRayTiles *tiles;
   CRay *ray;
 };
 
@@ -150,6 +197,7 @@ static float RayGetScreenVertexScale(CRay * I, float *v1)
 
   float vt[3];
   float ratio;
+  I->ViewDependent = true;
   RayApplyMatrix33(1, (float3 *) vt, I->ModelView, (float3 *) v1);
 
   if(I->Ortho) {
@@ -171,6 +219,7 @@ void RayApplyContextToVertex(CRay * I, float *v)
       float tw;
       float th;
 
+      I->ViewDependent = true;
       if(I->AspRatio > 1.0F) {
         tw = I->AspRatio;
         th = 1.0F;
@@ -210,6 +259,7 @@ void RayApplyContextToNormal(CRay * I, float *v)
 {
   switch (I->Context) {
   case 1:
+    I->ViewDependent = true;
     RayTransformInverseNormals33(1, (float3 *) v, I->ModelView, (float3 *) v);
     break;
   }
@@ -2775,66 +2825,41 @@ void RayProjectTriangle(CRay * I, RayInfo * r, float *light, float *v0, float *n
   }
 }
 
-#ifndef _PYMOL_NOPY
+static void RayHashTask(void *ctx, int index)
+{
+  RayHashThread(((CRayHashThreadInfo *) ctx) + index);
+}
+
 static void RayHashSpawn(CRayHashThreadInfo * Thread, int n_thread, int n_total)
 {
-  int blocked;
-  PyObject *info_list;
-  int a, c, n = 0;
   CRay *I = Thread->ray;
-  PyMOLGlobals *G = I->G;
-
-  blocked = PAutoBlock(G);
 
   PRINTFB(I->G, FB_Ray, FB_Blather)
     " Ray: filling voxels with %d threads...\n", n_thread ENDFB(I->G);
-  while(n < n_total) {
-    c = n;
-    info_list = PyList_New(n_thread);
-    for(a = 0; a < n_thread; a++) {
-      if((c + a) < n_total) {
-        PyList_SetItem(info_list, a, PyCObject_FromVoidPtr(Thread + c + a, NULL));
-      } else {
-        PyList_SetItem(info_list, a, PConvAutoNone(NULL));
-      }
-      n++;
-    }
-    PXDecRef(PYOBJECT_CALLMETHOD
-             (G->P_inst->cmd, "_ray_hash_spawn", "OO", info_list, G->P_inst->cmd));
-    Py_DECREF(info_list);
-  }
-  PAutoUnblock(G, blocked);
+  TaskPoolRun(I->G, n_thread, n_total, RayHashTask, Thread);
+}
+
+static void RayAntiTask(void *ctx, int index)
+{
+  RayAntiThread(((CRayAntiThreadInfo *) ctx) + index);
 }
-#endif
 
-#ifndef _PYMOL_NOPY
 static void RayAntiSpawn(CRayAntiThreadInfo * Thread, int n_thread)
 {
-  int blocked;
-  PyObject *info_list;
-  int a;
   CRay *I = Thread->ray;
-  PyMOLGlobals *G = I->G;
-
-  blocked = PAutoBlock(G);
 
   PRINTFB(I->G, FB_Ray, FB_Blather)
     " Ray: antialiasing with %d threads...\n", n_thread ENDFB(I->G);
-  info_list = PyList_New(n_thread);
-  for(a = 0; a < n_thread; a++) {
-    PyList_SetItem(info_list, a, PyCObject_FromVoidPtr(Thread + a, NULL));
-  }
-  PXDecRef(PYOBJECT_CALLMETHOD
-           (G->P_inst->cmd, "_ray_anti_spawn", "OO", info_list, G->P_inst->cmd));
-  Py_DECREF(info_list);
-  PAutoUnblock(G, blocked);
+  TaskPoolRun(I->G, n_thread, n_thread, RayAntiTask, Thread);
 }
-#endif
 
 int RayHashThread(CRayHashThreadInfo * T)
 {
-  BasisMakeMap(T->basis, T->vert2prim, T->prim, T->n_prim, T->clipBox, T->phase,
-               cCache_ray_map, T->perspective, T->front, T->size_hint);
+  if(T->bvh)
+    BasisMakeBVH(T->basis, T->prim, T->n_prim);
+  else
+    BasisMakeMap(T->basis, T->vert2prim, T->prim, T->n_prim, T->clipBox, T->phase,
+                 cCache_ray_map, T->perspective, T->front, T->size_hint);
 
   /* utilize a little extra wasted CPU time in thread 0 which computes the smaller map... */
   if(!T->phase) {
@@ -2848,30 +2873,19 @@ int RayHashThread(CRayHashThreadInfo * T)
   return 1;
 }
 
-#ifndef _PYMOL_NOPY
+static void RayTraceTask(void *ctx, int index)
+{
+  RayTraceThread(((CRayThreadInfo *) ctx) + index);
+}
+
 static void RayTraceSpawn(CRayThreadInfo * Thread, int n_thread)
 {
-  int blocked;
-  PyObject *info_list;
-  int a;
   CRay *I = Thread->ray;
-  PyMOLGlobals *G = I->G;
-
-  blocked = PAutoBlock(G);
 
   PRINTFB(I->G, FB_Ray, FB_Blather)
     " Ray: rendering with %d threads...\n", n_thread ENDFB(I->G);
-  info_list = PyList_New(n_thread);
-  for(a = 0; a < n_thread; a++) {
-    PyList_SetItem(info_list, a, PyCObject_FromVoidPtr(Thread + a, NULL));
-  }
-  PXDecRef(PYOBJECT_CALLMETHOD
-           (G->P_inst->cmd, "_ray_spawn", "OO", info_list, G->P_inst->cmd));
-  Py_DECREF(info_list);
-  PAutoUnblock(G, blocked);
-
+  TaskPoolRun(I->G, n_thread, n_thread, RayTraceTask, Thread);
 }
-#endif
 
 static int find_edge(unsigned int *ptr, float *depth, unsigned int width,
                      int threshold, int back)
@@ -3064,7 +3078,8 @@ static void RayPrimGetColorRamped(PyMOLGlobals * G, float *matrix, RayInfo * r,
 int RayTraceThread(CRayThreadInfo * T)
 {
   CRay *I = T->ray;
-  int x, y, yy;
+  int x, y;
+  int tile, tile_x0, tile_x1, tile_y0, tile_y1;
   float excess = 0.0F;
   float dotgle;
   float bright, direct_cmp, reflect_cmp, fc[4];
@@ -3112,8 +3127,6 @@ int RayTraceThread(CRayThreadInfo * T)
   float invWdthRange, vol0;
   float vol2;
   CBasis *bp1, *bp2;
-  int render_height;
-  int offset = 0;
   BasisCallRec BasisCall[MAX_BASIS];
   float border_offset;
   int edge_sampling = false;
@@ -3356,12 +3369,6 @@ int RayTraceThread(CRayThreadInfo * T)
   else
     bp2 = NULL;
 
-  render_height = T->y_stop - T->y_start;
-
-  if(render_height) {
-    offset = (T->phase * render_height / T->n_thread);
-    offset = offset - (offset % T->n_thread) + T->phase;
-  }
   if((interior_color != -1) || I->CheckInterior) {
 
     if(interior_color != -1)
@@ -3392,7 +3399,7 @@ int RayTraceThread(CRayThreadInfo * T)
   BasisCall[0].fudge0 = BasisFudge0;
   BasisCall[0].fudge1 = BasisFudge1;
 
-  MapCacheInit(&BasisCall[0].cache, I->Basis[1].Map, T->phase, cCache_map_scene_cache);
+  BasisCacheInit(I->Basis + 1, &BasisCall[0].cache, T->phase, cCache_map_scene_cache);
 
   if(shadows && (n_basis > 2)) {
     int bc;
@@ -3411,8 +3418,8 @@ int RayTraceThread(CRayThreadInfo * T)
       BasisCall[bc].fudge0 = BasisFudge0;
       BasisCall[bc].fudge1 = BasisFudge1;
       BasisCall[bc].label_shadow_mode = label_shadow_mode;
-      MapCacheInit(&BasisCall[bc].cache, I->Basis[bc].Map, T->phase,
-                   cCache_map_shadow_cache);
+      BasisCacheInit(I->Basis + bc, &BasisCall[bc].cache, T->phase,
+                     cCache_map_shadow_cache);
     }
   }
 
@@ -3431,44 +3438,13 @@ int RayTraceThread(CRayThreadInfo * T)
       back_mask = 0x00000000;
     }
   }
-  for(yy = T->y_start; (yy < T->y_stop); yy++) {
-    float perc, bkrd[4];
-    unsigned int bkrd_value;
+  while((tile = RayTilesNext(T->tiles, &tile_x0, &tile_x1, &tile_y0, &tile_y1)) >= 0) {
 
     if(I->G->Interrupt)
       break;
 
-    y = T->y_start + ((yy - T->y_start) + offset) % (render_height);    /* make sure threads write to different pages */
-    if (T->bkrd_is_gradient){
-      /* for RayTraceThread, y is from bottom to top */
-      perc = y/(float)T->height;
-      bkrd[0] = T->bkrd_bottom[0] + perc * (T->bkrd_top[0] - T->bkrd_bottom[0]);
-      bkrd[1] = T->bkrd_bottom[1] + perc * (T->bkrd_top[1] - T->bkrd_bottom[1]);
-      bkrd[2] = T->bkrd_bottom[2] + perc * (T->bkrd_top[2] - T->bkrd_bottom[2]);
-      bkrd[3] = 1.f;
-      if(T->ray->BigEndian){
-	bkrd_value = back_mask | 
-	  ((0xFF & ((unsigned int) (bkrd[0] * 255 + _p499))) << 24) |
-	  ((0xFF & ((unsigned int) (bkrd[1] * 255 + _p499))) << 16) |
-	  ((0xFF & ((unsigned int) (bkrd[2] * 255 + _p499))) << 8);
-      } else {
-	bkrd_value = back_mask | 
-	  ((0xFF & ((unsigned int) (bkrd[2] * 255 + _p499))) << 16) |
-	  ((0xFF & ((unsigned int) (bkrd[1] * 255 + _p499))) << 8) |
-	  ((0xFF & ((unsigned int) (bkrd[0] * 255 + _p499))));
-      }
-    } else {
-      bkrd_value = T->background;
-      bkrd[0] = T->bkrd_top[0];
-      bkrd[1] = T->bkrd_top[1];
-      bkrd[2] = T->bkrd_top[2];
-      if (orig_opaque_back){
-	bkrd[3] = 1.f;
-      } else {
-	bkrd[3] = 0.f;
-      }
-    }
-    if((!T->phase) && !(yy & 0xF)) {    /* don't slow down rendering too much */
+    if(!T->phase) {             /* tiles are claimed in order, so the tile index is our progress */
+      y = (int) ((tile * (double) T->height) / T->tiles->n_tile);
       if(T->edging_cutoff) {
         if(T->edging) {
           OrthoBusyFast(I->G, (int) (2.5F * T->height / 3 + 0.5F * y), 4 * T->height / 3);
@@ -3479,12 +3455,45 @@ int RayTraceThread(CRayThreadInfo * T)
         OrthoBusyFast(I->G, T->height / 3 + y, 4 * T->height / 3);
       }
     }
-    pixel = T->image + (T->width * y) + T->x_start;
 
-    if((y % T->n_thread) == T->phase) { /* this is my scan line */
+    for(y = tile_y0; y < tile_y1; y++) {
+      float perc, bkrd[4];
+      unsigned int bkrd_value;
+
+      if (T->bkrd_is_gradient){
+        /* for RayTraceThread, y is from bottom to top */
+        perc = y/(float)T->height;
+        bkrd[0] = T->bkrd_bottom[0] + perc * (T->bkrd_top[0] - T->bkrd_bottom[0]);
+        bkrd[1] = T->bkrd_bottom[1] + perc * (T->bkrd_top[1] - T->bkrd_bottom[1]);
+        bkrd[2] = T->bkrd_bottom[2] + perc * (T->bkrd_top[2] - T->bkrd_bottom[2]);
+        bkrd[3] = 1.f;
+        if(T->ray->BigEndian){
+	  bkrd_value = back_mask | 
+	    ((0xFF & ((unsigned int) (bkrd[0] * 255 + _p499))) << 24) |
+	    ((0xFF & ((unsigned int) (bkrd[1] * 255 + _p499))) << 16) |
+	    ((0xFF & ((unsigned int) (bkrd[2] * 255 + _p499))) << 8);
+        } else {
+	  bkrd_value = back_mask | 
+	    ((0xFF & ((unsigned int) (bkrd[2] * 255 + _p499))) << 16) |
+	    ((0xFF & ((unsigned int) (bkrd[1] * 255 + _p499))) << 8) |
+	    ((0xFF & ((unsigned int) (bkrd[0] * 255 + _p499))));
+        }
+      } else {
+        bkrd_value = T->background;
+        bkrd[0] = T->bkrd_top[0];
+        bkrd[1] = T->bkrd_top[1];
+        bkrd[2] = T->bkrd_top[2];
+        if (orig_opaque_back){
+	  bkrd[3] = 1.f;
+        } else {
+	  bkrd[3] = 0.f;
+        }
+      }
+      pixel = T->image + (T->width * y) + tile_x0;
+
       pixel_base[1] = ((y + 0.5F + border_offset) * invHgtRange) + vol2;
 
-      for(x = T->x_start; (x < T->x_stop); x++) {
+      for(x = tile_x0; (x < tile_x1); x++) {
         pixel_base[0] = (((x + 0.5F + border_offset)) * invWdthRange) + vol0;
 
         while(1) {
@@ -4335,8 +4344,7 @@ int RayTraceThread(CRayThreadInfo * T)
       }                         /* end of for */
 
     }
-    /* end of if */
-  }                             /* end of for */
+  }                             /* end of tiles */
   /*  if(T->n_thread>1) 
      printf(" Ray: Thread %d: Complete.\n",T->phase+1); */
   MapCacheFree(&BasisCall[0].cache, T->phase, cCache_map_scene_cache);
@@ -4459,34 +4467,28 @@ int RayAntiThread(CRayAntiThreadInfo * T)
   unsigned int *pDst;
   /*   unsigned int m00FF=0x00FF,mFF00=0xFF00,mFFFF=0xFFFF; */
   int width;
-  int height;
-  int x, y, yy;
+  int x, y;
+  int tile_x0, tile_x1, tile_y0, tile_y1;
   unsigned int *p;
-  int offset = 0;
   CRay *I = T->ray;
 
   OrthoBusyFast(I->G, 9, 10);
   width = (T->width / T->mag) - 2;
-  height = (T->height / T->mag) - 2;
 
   src_row_pixels = T->width;
 
-  offset = (T->phase * height) / T->n_thread;
-  offset = offset - (offset % T->n_thread) + T->phase;
+  while(RayTilesNext(T->tiles, &tile_x0, &tile_x1, &tile_y0, &tile_y1) >= 0) {
 
-  for(yy = 0; yy < height; yy++) {
-    y = (yy + offset) % height; /* make sure threads write to different pages */
-
-    if((y % T->n_thread) == T->phase) { /* this is my scan line */
+    for(y = tile_y0; y < tile_y1; y++) {
       unsigned long c1, c2, c3, c4, a;
       unsigned char *c;
 
       pSrc = T->image + src_row_pixels * (y * T->mag);
-      pDst = T->image_copy + width * y;
+      pDst = T->image_copy + width * y + tile_x0;
       switch (T->mag) {
       case 2:
         {
-          for(x = 0; x < width; x++) {
+          for(x = tile_x0; x < tile_x1; x++) {
 
             c = (unsigned char *) (p = pSrc + (x * T->mag));
             c1 = c2 = c3 = c4 = a = 0;
@@ -4680,7 +4682,7 @@ int RayAntiThread(CRayAntiThreadInfo * T)
         break;
       case 3:
         {
-          for(x = 0; x < width; x++) {
+          for(x = tile_x0; x < tile_x1; x++) {
 
             c = (unsigned char *) (p = pSrc + (x * T->mag));
             c1 = c2 = c3 = c4 = a = 0;
@@ -4957,7 +4959,7 @@ int RayAntiThread(CRayAntiThreadInfo * T)
         break;
       case 4:
         {
-          for(x = 0; x < width; x++) {
+          for(x = tile_x0; x < tile_x1; x++) {
 
             c = (unsigned char *) (p = pSrc + (x * T->mag));
             c1 = c2 = c3 = c4 = a = 0;
@@ -5595,16 +5597,26 @@ void RayRender(CRay * I, unsigned int *image, double timing,
     }
   } else {
 
-    if(I->PrimSizeCnt) {
-      float factor = SettingGetGlobal_f(I->G, cSetting_ray_hint_camera);
-      I->PrimSize = I->PrimSize / (I->PrimSizeCnt * factor);
-      /*      printf("avg dist %8.7f\n",I->PrimSize); */
+    if(I->Expanded) {
+      /* retained primitives: the world-space basis is still valid, only
+         the camera and light space bases need to be rebuilt */
+      for(a = 1; a < I->NBasis; a++)
+        BasisFinish(I->Basis + a, a);
+      I->NBasis = 2;
+      ok &= BasisInit(I->G, I->Basis + 1, 1);
     } else {
-      I->PrimSize = 0.0F;
+      if(I->PrimSizeCnt) {
+        float factor = SettingGetGlobal_f(I->G, cSetting_ray_hint_camera);
+        I->PrimSize = I->PrimSize / (I->PrimSizeCnt * factor);
+        /*      printf("avg dist %8.7f\n",I->PrimSize); */
+      } else {
+        I->PrimSize = 0.0F;
+      }
+      ok &= !I->G->Interrupt;
+      if (ok)
+        ok &= RayExpandPrimitives(I);
+      I->Expanded = ok;
     }
-    ok &= !I->G->Interrupt;
-    if (ok)
-      ok &= RayExpandPrimitives(I);
     if (ok)
       ok &= RayTransformFirst(I, perspective, false);
 
@@ -5692,10 +5704,10 @@ void RayRender(CRay * I, unsigned int *image, double timing,
     }
 
     OrthoBusyFast(I->G, 4, 20);
-#ifndef _PYMOL_NOPY
     if(shadows && (n_thread > 1)) {     /* parallel execution */
 
       CRayHashThreadInfo *thread_info = Calloc(CRayHashThreadInfo, I->NBasis);
+      int bvh = SettingGetGlobal_b(I->G, cSetting_ray_bvh);
 
       /* rendering map */
 
@@ -5722,6 +5734,7 @@ void RayRender(CRay * I, unsigned int *image, double timing,
       thread_info[0].bytes = width * (unsigned int) height;
       thread_info[0].ray = I;   /* for compute box */
       thread_info[0].size_hint = I->PrimSize;
+      thread_info[0].bvh = bvh;
       /* shadow map */
 
       {
@@ -5738,6 +5751,7 @@ void RayRender(CRay * I, unsigned int *image, double timing,
           thread_info[bc - 1].front = _0;
           /* allowing these maps to be more fine helps performance */
           thread_info[bc - 1].size_hint = I->PrimSize * factor;
+          thread_info[bc - 1].bvh = bvh;
         }
       }
 
@@ -5747,19 +5761,23 @@ void RayRender(CRay * I, unsigned int *image, double timing,
 
       FreeP(thread_info);
     } else
-#endif
     if (ok){ 
-#ifdef _PYMOL_NOPY
-      n_thread = 1;          /* serial execution */
-#endif
-      ok &= BasisMakeMap(I->Basis + 1, I->Vert2Prim, I->Primitive, I->NPrimitive,
-			 I->Volume, 0, cCache_ray_map, perspective, front, I->PrimSize);
+      int bvh = SettingGetGlobal_b(I->G, cSetting_ray_bvh);
+      if(bvh)
+        ok &= BasisMakeBVH(I->Basis + 1, I->Primitive, I->NPrimitive);
+      else
+        ok &= BasisMakeMap(I->Basis + 1, I->Vert2Prim, I->Primitive, I->NPrimitive,
+                           I->Volume, 0, cCache_ray_map, perspective, front, I->PrimSize);
       if(ok && shadows) {
         int bc;
         float factor = SettingGetGlobal_f(I->G, cSetting_ray_hint_shadow);
         for(bc = 2; ok && bc < I->NBasis; bc++) {
-          ok &= BasisMakeMap(I->Basis + bc, I->Vert2Prim, I->Primitive, I->NPrimitive,
-			     NULL, bc - 1, cCache_ray_map, false, _0, I->PrimSize * factor);
+          if(bvh)
+            ok &= BasisMakeBVH(I->Basis + bc, I->Primitive, I->NPrimitive);
+          else
+            ok &= BasisMakeMap(I->Basis + bc, I->Vert2Prim, I->Primitive, I->NPrimitive,
+                               NULL, bc - 1, cCache_ray_map, false, _0,
+                               I->PrimSize * factor);
         }
       }
 
@@ -5779,7 +5797,10 @@ void RayRender(CRay * I, unsigned int *image, double timing,
     OrthoBusyFast(I->G, 5, 20);
     now = UtilGetSeconds(I->G) - timing;
 
-    if (ok){
+    if (ok && !I->Basis[1].Map) {
+      PRINTFB(I->G, FB_Ray, FB_Blather)
+        " Ray: bvh: %d nodes, %4.2f sec.\n", I->Basis[1].NBVHNode, now ENDFB(I->G);
+    } else if (ok){
       if(shadows) {
 	PRINTFB(I->G, FB_Ray, FB_Blather)
 	  " Ray: voxels: [%4.2f:%dx%dx%d], [%4.2f:%dx%dx%d], %4.2f sec.\n",
@@ -5799,6 +5820,7 @@ void RayRender(CRay * I, unsigned int *image, double timing,
     if (ok){
       /* now spawn threads as needed */
       CRayThreadInfo *rt = Calloc(CRayThreadInfo, n_thread);
+      CRayTiles tiles;
 
       int x_start = 0, y_start = 0;
       int x_stop = 0, y_stop = 0;
@@ -5884,6 +5906,9 @@ void RayRender(CRay * I, unsigned int *image, double timing,
       if(y_stop > height)
         y_stop = height;
 
+      RayTilesInit(&tiles, x_start, x_stop, y_start, y_stop,
+                   SettingGetGlobal_i(I->G, cSetting_ray_tile_size));
+
       for(a = 0; a < n_thread; a++) {
         rt[a].ray = I;
         rt[a].width = width;
@@ -5892,6 +5917,7 @@ void RayRender(CRay * I, unsigned int *image, double timing,
         rt[a].x_stop = x_stop;
         rt[a].y_start = y_start;
         rt[a].y_stop = y_stop;
+        rt[a].tiles = &tiles;
         rt[a].image = image;
         rt[a].border = mag - 1;
         rt[a].front = front;
@@ -5917,11 +5943,9 @@ void RayRender(CRay * I, unsigned int *image, double timing,
         rt[a].depth = depth;
       }
 
-#ifndef _PYMOL_NOPY
       if(n_thread > 1)
         RayTraceSpawn(rt, n_thread);
       else
-#endif
         RayTraceThread(rt);
 
       if(oversample_cutoff) {   /* perform edge oversampling, if requested */
@@ -5934,12 +5958,11 @@ void RayRender(CRay * I, unsigned int *image, double timing,
         for(a = 0; a < n_thread; a++) {
           rt[a].edging = edging;
         }
+        tiles.next = 0;
 
-#ifndef _PYMOL_NOPY
         if(n_thread > 1)
           RayTraceSpawn(rt, n_thread);
         else
-#endif
           RayTraceThread(rt);
 
         CacheFreeP(I->G, edging, 0, cCache_ray_edging_buffer, false);
@@ -6317,6 +6340,11 @@ void RayRender(CRay * I, unsigned int *image, double timing,
   if(ok && antialias > 1) {
     /* now spawn threads as needed */
     CRayAntiThreadInfo *rt = Calloc(CRayAntiThreadInfo, n_thread);
+    CRayTiles tiles;
+
+    /* tiles cover the downsampled image (see RayAntiThread) */
+    RayTilesInit(&tiles, 0, (width / mag) - 2, 0, (height / mag) - 2,
+                 SettingGetGlobal_i(I->G, cSetting_ray_tile_size));
 
     for(a = 0; a < n_thread; a++) {
       rt[a].width = width;
@@ -6326,14 +6354,13 @@ void RayRender(CRay * I, unsigned int *image, double timing,
       rt[a].phase = a;
       rt[a].mag = mag;          /* fold magnification */
       rt[a].n_thread = n_thread;
+      rt[a].tiles = &tiles;
       rt[a].ray = I;
     }
 
-#ifndef _PYMOL_NOPY
     if(n_thread > 1)
       RayAntiSpawn(rt, n_thread);
     else
-#endif
       RayAntiThread(rt);
     FreeP(rt);
     CacheFreeP(I->G, image, 0, cCache_ray_antialias_buffer, false);
@@ -7311,6 +7338,8 @@ CRay *RayNew(PyMOLGlobals * G, int antialias)
   I->TTTStackVLA = NULL;
   I->TTTStackDepth = 0;
   I->CheckInterior = false;
+  I->Expanded = false;
+  I->ViewDependent = false;
   if(antialias < 0)
     antialias = SettingGetGlobal_i(I->G, cSetting_antialias);
   I->Sampling = antialias;
@@ -7390,8 +7419,10 @@ void RayPrepare(CRay * I, float v0, float v1, float v2,
   I->PixelRatio = pixel_ratio;
   I->Magnified = magnified;
   I->FrontBackRatio = front_back_ratio;
-  I->PrimSizeCnt = 0;
-  I->PrimSize = 0.0;
+  if(!I->Expanded) {            /* retained primitives keep their size hint */
+    I->PrimSizeCnt = 0;
+    I->PrimSize = 0.0;
+  }
   I->Fov = fov;
   copy3f(pos, I->Pos);
 
@@ -154,6 +154,8 @@ struct _CRay {
   float Fov, Pos[3];
   unsigned char *bkgrd_data;
   int bkgrd_width, bkgrd_height;
+  int Expanded;                 /* Basis[0] holds the primitives, RayRender only redoes the view */
+  int ViewDependent;            /* primitives were emitted using the camera, can't be retained */
 };
 
 #endif
@@ -56,6 +56,7 @@ Z* -------------------------------------------------------------------
 #include"PConv.h"
 #include"ScrollBar.h"
 #include "ShaderMgr.h"
+#include "TaskPool.h"
 
 #include <string>
 #include <vector>
@@ -162,6 +163,21 @@ typedef struct {
 } SceneElem;
 
 
+/* what the primitives of a retained ray (ray_retain_scene) were built from */
+
+typedef struct {
+  CObject *obj;
+  int state, color, context, ttt_flag;
+  float ttt[16];
+} SceneRetainedObj;
+
+typedef struct {
+  int change_count;
+  int width, height, antialias, ortho;
+  int scene_width, scene_height;
+  float fov, pos_z, front, back, front_safe, back_safe;
+} SceneRetainedKey;
+
 /* allow up to 10 seconds at 30 FPS */
 
 #define TRN_BKG 0x30
@@ -255,8 +271,22 @@ class CScene {
   int orig_x_rotation, orig_y_rotation;
   GridInfo grid;
   int last_grid_size;
+
+  /* retained ray tracing scene */
+  CRay *RetainedRay;
+  SceneRetainedKey RetainedKey;
+  SceneRetainedObj *RetainedObjVLA;
+  int ChangeCount;              /* bumped whenever emitted geometry may differ */
+  int RetainEmitting, RetainViewDependent;
 };
 
+/* primitives emitted while the camera is read can't be retained */
+static void SceneRetainReadsView(CScene * I)
+{
+  if(I->RetainEmitting)
+    I->RetainViewDependent = true;
+}
+
 /* EXPERIMENTAL VOLUME RAYTRACING DATA */
 extern float *rayDepthPixels;
 extern int rayVolume;
@@ -270,6 +300,7 @@ static void SceneDoRoving(PyMOLGlobals * G, float old_front,
 #define SceneGetExactScreenVertexScale SceneGetScreenVertexScale
 
 static void SceneRestartPerfTimer(PyMOLGlobals * G);
+static void SceneRetainedRayFree(PyMOLGlobals * G);
 static void SceneRotateWithDirty(PyMOLGlobals * G, float angle, float x, float y, float z,
                                  int dirty);
 static void SceneClipSetWithDirty(PyMOLGlobals * G, float front, float back, int dirty);
@@ -1057,6 +1088,8 @@ void SceneGetCenter(PyMOLGlobals * G, float *pos)
 {
   CScene *I = G->Scene;
 
+  SceneRetainReadsView(I);
+
   MatrixTransformC44fAs33f3f(I->RotMatrix, I->Origin, pos);
 
   pos[0] -= I->Pos[0];
@@ -1116,6 +1149,7 @@ void SceneGetView(PyMOLGlobals * G, SceneViewType view)
   float *p;
   int a;
   CScene *I = G->Scene;
+  SceneRetainReadsView(I);
   p = view;
   for(a = 0; a < 16; a++)
     *(p++) = I->RotMatrix[a];
@@ -1540,6 +1574,7 @@ void SceneSetMatrix(PyMOLGlobals * G, float *m)
 void SceneGetViewNormal(PyMOLGlobals * G, float *v)
 {
   CScene *I = G->Scene;
+  SceneRetainReadsView(I);
   copy3f(I->ViewNormal, v);
 }
 
@@ -1555,6 +1590,7 @@ int SceneGetState(PyMOLGlobals * G)
 float *SceneGetMatrix(PyMOLGlobals * G)
 {
   CScene *I = G->Scene;
+  SceneRetainReadsView(I);
   return (I->RotMatrix);
 }
 
@@ -2348,6 +2384,7 @@ void SceneChanged(PyMOLGlobals * G)
 {
   CScene *I = G->Scene;
   I->ChangedFlag = true;
+  I->ChangeCount++;
   SceneInvalidateCopy(G, false);
   SceneDirty(G);
   SeqChanged(G);
@@ -4851,6 +4888,7 @@ float SceneGetScreenVertexScale(PyMOLGlobals * G, float *v1)
 /* does not require OpenGL-provided matrices */
 {
   float depth = SceneGetRawDepth(G, v1);
+  SceneRetainReadsView(G->Scene);
   float ratio = depth * GetFovWidth(G) / G->Scene->Height;
 
   if(!v1 && ratio < R_SMALL4)
@@ -6184,6 +6222,7 @@ void SceneFree(PyMOLGlobals * G)
   ListFree(I->Obj, next, ObjRec);
 
   ScenePurgeImage(G);
+  SceneRetainedRayFree(G);
   CGOFree(G->DebugCGO);
   delete G->Scene;
 }
@@ -6257,6 +6296,8 @@ int SceneInit(PyMOLGlobals * G)
     I->ReinterpolateFlag = false;
     I->ReinterpolateObj = NULL;
     I->MotionGrabbedObj = NULL;
+    I->RetainedRay = NULL;
+    I->RetainedObjVLA = NULL;
 
     G->DebugCGO = CGONew(G);
 
@@ -6687,6 +6728,71 @@ int SceneGetDrawFlagGrid(PyMOLGlobals * G, GridInfo * grid, int slot)
   return SceneGetDrawFlag(grid, I->SlotVLA, slot);
 }
 
+/*========================================================================*/
+void SceneInvalidateRetainedRay(PyMOLGlobals * G)
+{
+  G->Scene->ChangeCount++;
+}
+
+static void SceneRetainedRayFree(PyMOLGlobals * G)
+{
+  CScene *I = G->Scene;
+  if(I->RetainedRay) {
+    RayFree(I->RetainedRay);
+    I->RetainedRay = NULL;
+  }
+  VLAFreeP(I->RetainedObjVLA);
+}
+
+
+/*========================================================================*/
+static SceneRetainedObj *SceneRetainedObjects(PyMOLGlobals * G)
+
+/* returns NULL if some object can't be retained */
+{
+  CScene *I = G->Scene;
+  ObjRec *rec = NULL;
+  int n = 0;
+  SceneRetainedObj *vla = VLACalloc(SceneRetainedObj, 10);
+
+  while(vla && ListIterate(I->Obj, rec, next)) {
+    CObject *obj = rec->obj;
+    if(obj->fRender) {
+      SceneRetainedObj *ro;
+      if((obj->type == cObjectCallback) || (obj->type == cObjectVolume)) {
+        VLAFreeP(vla);          /* contents aren't tracked by the scene */
+        break;
+      }
+      VLACheck(vla, SceneRetainedObj, n);
+      ro = vla + n++;
+      ro->obj = obj;
+      ro->state = ObjectGetCurrentState(obj, false);
+      ro->color = obj->Color;
+      ro->context = obj->Context;
+      ro->ttt_flag = obj->TTTFlag;
+      copy44f(obj->TTT, ro->ttt);
+    }
+  }
+  if(vla)
+    VLASize(vla, SceneRetainedObj, n);
+  return vla;
+}
+
+
+/*========================================================================*/
+static int SceneRetainedRayMatch(PyMOLGlobals * G, SceneRetainedKey * key,
+                                 SceneRetainedObj * obj_vla)
+{
+  CScene *I = G->Scene;
+  unsigned int n = VLAGetSize(obj_vla);
+  return (I->RetainedRay && I->RetainedObjVLA &&
+          !memcmp(&I->RetainedKey, key, sizeof(SceneRetainedKey)) &&
+          (VLAGetSize(I->RetainedObjVLA) == n) &&
+          !memcmp(I->RetainedObjVLA, obj_vla, sizeof(SceneRetainedObj) * n));
+}
+
+
+/*========================================================================*/
 void SceneRay(PyMOLGlobals * G,
               int ray_width, int ray_height, int mode,
               char **headerVLA_ptr,
@@ -6712,6 +6818,12 @@ void SceneRay(PyMOLGlobals * G,
   int ortho = SettingGetGlobal_i(G, cSetting_ray_orthoscopic);
   int last_grid_active = I->grid.active;
   int grid_size = 0;
+  SceneRetainedObj *retain_obj = NULL;
+  SceneRetainedKey retain_key;
+  int retain = (mode == 0) && SettingGetGlobal_b(G, cSetting_ray_retain_scene);
+
+  if(!retain)
+    SceneRetainedRayFree(G);
 
   if(SettingGetGlobal_b(G, cSetting_defer_builds_mode) == 5)
     SceneUpdate(G, true);
@@ -6811,9 +6923,38 @@ void SceneRay(PyMOLGlobals * G,
       /* start afresh, looking in the negative Z direction (0,0,-1) from (0,0,0) */
       identity44f(rayView);
 
-      ray = RayNew(G, antialias);
-      if(!ray)
+      /* only the camera moved? then reuse the primitives of the last ray */
+      retain_obj = NULL;
+      if(retain && !I->grid.active && !stereo_hand) {
+        UtilZeroMem(&retain_key, sizeof(SceneRetainedKey));
+        retain_key.change_count = I->ChangeCount;
+        retain_key.width = ray_width;
+        retain_key.height = ray_height;
+        retain_key.antialias = antialias;
+        retain_key.ortho = ortho;
+        retain_key.scene_width = I->Width;
+        retain_key.scene_height = I->Height;
+        retain_key.fov = fov;
+        retain_key.pos_z = I->Pos[2];
+        retain_key.front = I->Front;
+        retain_key.back = I->Back;
+        retain_key.front_safe = I->FrontSafe;
+        retain_key.back_safe = I->BackSafe;
+        retain_obj = SceneRetainedObjects(G);
+      }
+      if(retain_obj && SceneRetainedRayMatch(G, &retain_key, retain_obj)) {
+        ray = I->RetainedRay;
+        I->RetainedRay = NULL;
+        PRINTFB(G, FB_Ray, FB_Blather)
+          " SceneRay: reusing %d retained primitives.\n", ray->NPrimitive ENDFB(G);
+      } else {
+        SceneRetainedRayFree(G);
+        ray = RayNew(G, antialias);
+      }
+      if(!ray) {
+        VLAFreeP(retain_obj);
         break;
+      }
 
       if(stereo_hand) {
         /* stereo */
@@ -6931,7 +7072,7 @@ void SceneRay(PyMOLGlobals * G,
                      I->FrontSafe / I->BackSafe, ((float) ray_height) / I->Height);
         }
       }
-      {
+      if(!ray->Expanded) {
         int *slot_vla = I->SlotVLA;
         int state = SceneGetState(G);
         RenderInfo info;
@@ -6948,6 +7089,8 @@ void SceneRay(PyMOLGlobals * G,
           info.dynamic_width_max = SettingGetGlobal_f(G, cSetting_dynamic_width_max);
         }
 
+        I->RetainEmitting = (retain_obj != NULL);
+        I->RetainViewDependent = false;
         while(ListIterate(I->Obj, rec, next)) {
           if(rec->obj->fRender) {
             if(SceneGetDrawFlag(&I->grid, slot_vla, rec->obj->grid_slot)) {
@@ -6984,6 +7127,9 @@ void SceneRay(PyMOLGlobals * G,
             }
           }
         }
+        I->RetainEmitting = false;
+        if(I->RetainViewDependent || ray->ViewDependent)
+          VLAFreeP(retain_obj);
       }
 
       OrthoBusyFast(G, 1, 20);
@@ -7159,7 +7305,14 @@ void SceneRay(PyMOLGlobals * G,
         break;
 
       }
-      RayFree(ray);
+      if(retain_obj && ray->Expanded && !G->Interrupt) {
+        I->RetainedRay = ray;
+        I->RetainedKey = retain_key;
+        I->RetainedObjVLA = retain_obj;
+      } else {
+        VLAFreeP(retain_obj);
+        RayFree(ray);
+      }
     }
     if(I->grid.active)
       GridSetRayViewport(&I->grid, -1, &ray_x, &ray_y, &ray_width, &ray_height);
@@ -7479,32 +7632,22 @@ void SceneObjectUpdateThread(CObjectUpdateThreadInfo * T)
   }
 }
 
-#ifndef _PYMOL_NOPY
+static void SceneObjectUpdateTask(void *ctx, int index)
+{
+  SceneObjectUpdateThread(((CObjectUpdateThreadInfo *) ctx) + index);
+}
+
 static void SceneObjectUpdateSpawn(PyMOLGlobals * G, CObjectUpdateThreadInfo * Thread,
                                    int n_thread, int n_total)
 {
   if(n_total == 1) {
     SceneObjectUpdateThread(Thread);
   } else if(n_total) {
-    int blocked;
-    PyObject *info_list;
-    int a, n = 0;
-    blocked = PAutoBlock(G);
-
     PRINTFB(G, FB_Scene, FB_Blather)
       " Scene: updating objects with %d threads...\n", n_thread ENDFB(G);
-    info_list = PyList_New(n_total);
-    for(a = 0; a < n_total; a++) {
-      PyList_SetItem(info_list, a, PyCObject_FromVoidPtr(Thread + a, NULL));
-      n++;
-    }
-    PXDecRef(PyObject_CallMethod
-             (G->P_inst->cmd, "_object_update_spawn", "Oi", info_list, n_thread));
-    Py_DECREF(info_list);
-    PAutoUnblock(G, blocked);
+    TaskPoolRun(G, n_thread, n_total, SceneObjectUpdateTask, Thread);
   }
 }
-#endif
 
 static void SceneStencilCheck(PyMOLGlobals *G) 
 {
@@ -7549,11 +7692,29 @@ void SceneUpdate(PyMOLGlobals * G, int force)
   EditorUpdate(G);
   SceneStencilCheck(G);
 
+#ifdef _PYMOL_NUMPY
+  /* coordinates may have been modified through released numpy views */
+  if(G->P_inst->coord_view_released)
+    CoordSetViewSync(G);
+#endif
+
   if(defer_builds_mode == 0) {
     if(SettingGetGlobal_i(G, cSetting_draw_mode) == -2) {
       defer_builds_mode = 1;
     }
   }
+  if((defer_builds_mode == 0) && (cur_state != I->LastStateBuilt)) {
+    /* streamed trajectories only have some states decoded, so they need
+       an update whenever the state changes */
+    while(ListIterate(I->Obj, rec, next)) {
+      if((rec->obj->type == cObjectMolecule) &&
+         ((ObjectMolecule *) rec->obj)->TrajStream) {
+        defer_builds_mode = 1;
+        break;
+      }
+    }
+    rec = NULL;
+  }
   /*
   if(defer_builds_mode) {
     rec = NULL;
@@ -7569,6 +7730,7 @@ void SceneUpdate(PyMOLGlobals * G, int force)
   if(force || I->ChangedFlag || ((cur_state != I->LastStateBuilt) &&
                                  (defer_builds_mode > 0))) {
 
+    I->ChangeCount++;
     SceneCountFrames(G);
 
     if(force || (defer_builds_mode != 5)) {     /* mode 5 == immediate mode */
@@ -7585,7 +7747,6 @@ void SceneUpdate(PyMOLGlobals * G, int force)
       }
 
       {
-#ifndef _PYMOL_NOPY
         int n_thread = SettingGetGlobal_i(G, cSetting_max_threads);
         int multithread = SettingGetGlobal_i(G, cSetting_async_builds);
         if(multithread && (n_thread > 1)) {
@@ -7653,7 +7814,6 @@ void SceneUpdate(PyMOLGlobals * G, int force)
             }
           }
         } else
-#endif
         {
           /* single-threaded update */
           rec = NULL;
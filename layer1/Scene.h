@@ -94,6 +94,7 @@ int SceneGetButtonMargin(PyMOLGlobals * G);
 
 void SceneDirty(PyMOLGlobals * G);      /* scene dirty, but leave the overlay if one exists */
 void SceneInvalidate(PyMOLGlobals * G); /* scene dirty and remove the overlay */
+void SceneInvalidateRetainedRay(PyMOLGlobals * G);
 void SceneChanged(PyMOLGlobals * G);    /* update 3D objects */
 
 void SceneCountFrames(PyMOLGlobals * G);
@@ -2217,6 +2217,9 @@ void SettingGenerateSideEffects(PyMOLGlobals * G, int index, const char *sele, i
     return;
   }
 
+  // any setting may change the geometry of a retained ray tracing scene
+  SceneInvalidateRetainedRay(G);
+
   // range check for int (global only)
   if (rec.type == cSetting_int && rec.hasMinMax() && !(sele && sele[0])) {
     int value = SettingGetGlobal_i(G, index);
@@ -854,7 +854,20 @@ enum {
   REC_b( 746, cif_use_auth                            , global    , 1 ),
   REC_s( 747, assembly                                , global    , "" ),
   REC_b( 748, cif_keepinmemory                        , global    , 0 ),
-  REC_b( 749, pse_binary_dump                         , unused    , 0 ), // not fully supported in Open-Source PyMOL
+  REC_b( 749, pse_binary_dump                         , global    , 0 ), // sessions store atoms, bonds, coordinates and maps as binary blocks
+  REC_i( 750, ray_tile_size                           , global    , 32, 1, 4096 ), // edge length (pixels) of dynamically scheduled ray tracing tiles
+  REC_i( 751, traj_stream_states                      , global    , 0, 0, 1000000 ), // > 0: load_traj decodes states on demand, keeping at most this many in memory
+  REC_s( 752, cache_dir                               , global    , "" ), // directory for persistent cache entries (see cache_mode)
+  REC_b( 753, ray_bvh                                 , global    , 0 ), // ray trace with a bounding volume hierarchy instead of the voxel map
+  REC_b( 754, connect_incremental                     , global    , 1 ), // merging atoms only searches for bonds around new or moved atoms
+  REC_f( 755, sculpt_nb_skin                          , ostate    , 0.5F ), // extra radius (A) of the sculpting pair list, which is rebuilt once atoms move half this far
+  REC_b( 756, align_linear_memory                     , global    , 1 ), // align keeps a band of score columns and recomputes traceback blocks (no window, max_gap >= 0)
+  REC_i( 757, movie_png_threads                       , global    , 2, 0, 64 ), // background threads writing frames during movie export (0: write synchronously)
+  REC_i( 758, movie_cache_max                         , global    , 0, 0, 1000000 ), // MB of cached movie frames (0: unlimited), least recently used frames get compressed or dropped
+  REC_b( 759, movie_cache_compress                    , global    , 0 ), // keep cached movie frames compressed, except the one on screen
+  REC_b( 760, ray_retain_scene                        , global    , 0 ), // keep ray primitives between renders and only rebuild the camera-space maps when just the view changed
+  REC_b( 761, sort_radix                              , global    , 1 ), // sort atoms by radix sorting packed integer keys instead of pairwise comparisons
+  REC_b( 762, alter_native                            , global    , 1 ), // evaluate simple alter/iterate expressions natively instead of once per atom in Python
 
 #ifdef SETTINGINFO_IMPLEMENTATION
 #undef SETTINGINFO_IMPLEMENTATION
@@ -0,0 +1,1467 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+#include"os_python.h"
+#include"os_predef.h"
+#include"os_std.h"
+
+#include"AtomExpr.h"
+
+#ifndef _PYMOL_NOPY
+
+#include<limits.h>
+#include<errno.h>
+
+#include"MemoryDebug.h"
+#include"Util.h"
+#include"TaskPool.h"
+#include"P.h"
+#include"PyMOL.h"
+
+#define cExprMaxStack 32
+#define cExprMaxLocal 16
+#define cExprMaxProp  16
+#define cExprMaxTarget 8
+
+#define cExprMinChunk 4096
+
+/* value types (and, as bit masks, the static kinds of expressions) */
+#define cExprInt   1
+#define cExprFloat 2
+#define cExprStr   4
+
+typedef struct {
+  int type;
+  union {
+    long i;
+    double f;
+    const char *s;
+  };
+} ExprValue;
+
+enum {
+  cOpConst,                     /* arg: constant */
+  cOpLoadProp,                  /* arg: property slot */
+  cOpLoadWritten,               /* same, property assigned earlier on */
+  cOpLoadLocal,                 /* arg: local slot */
+  cOpStoreProp,
+  cOpStoreLocal,
+  cOpDup,
+  cOpAdd, cOpSub, cOpMul, cOpDiv, cOpFloorDiv, cOpMod,
+  cOpBitAnd, cOpBitOr, cOpBitXor, cOpShl, cOpShr,
+  cOpLt, cOpLe, cOpGt, cOpGe, cOpEq, cOpNe,
+  cOpNeg, cOpPos, cOpInvert, cOpNot,
+  cOpAbs, cOpInt, cOpFloat,
+  cOpMin, cOpMax,               /* arg: number of arguments */
+  cOpJump,                      /* arg: offset from this instruction */
+  cOpJumpIfFalse,               /* pops the condition */
+  cOpJumpIfFalseOrPop,          /* and */
+  cOpJumpIfTrueOrPop            /* or */
+};
+
+typedef struct {
+  int op, arg;
+} ExprInstr;
+
+typedef struct {
+  int id;                       /* ATOM_PROP_* */
+  short ptype;                  /* cPType_* */
+  int offset, maxlen;
+} ExprProp;
+
+struct _CAtomExpr {
+  int Mode;
+  ExprInstr *Code;              /* VLA */
+  int NCode;
+  ExprValue *Const;             /* VLA */
+  int NConst;
+  ExprProp Prop[cExprMaxProp];
+  int NProp;
+  int MayFail;                  /* some atom might raise in Python */
+  int Writes;                   /* assigns atom properties */
+  char *Strings;                /* storage for string literals */
+};
+
+
+/*========================================================================*/
+/* tokens */
+
+enum {
+  cTokEnd, cTokName, cTokNumber, cTokString, cTokOp, cTokBad
+};
+
+typedef struct {
+  const char *p;
+  int paren;
+  int tok;
+  char text[4];                 /* operator */
+  WordType name;
+  ExprValue value;              /* number or string literal */
+  char *strings;                /* next free byte of CAtomExpr::Strings */
+} ExprLexer;
+
+static int ExprLexNumber(ExprLexer * L)
+{
+  const char *start = L->p, *p = L->p;
+  char buf[64], *end;
+  int n, is_float = false, base = 10, skip = 0;
+
+  while(isalnum((unsigned char) *p) || (*p == '.') || (*p == '_')) {
+    if(((*p == 'e') || (*p == 'E')) && ((p[1] == '+') || (p[1] == '-')))
+      p++;
+    p++;
+  }
+  n = (int) (p - start);
+  if(n >= (int) sizeof(buf))
+    return false;
+  memcpy(buf, start, n);
+  buf[n] = 0;
+  L->p = p;
+
+  if(buf[0] == '0' && (buf[1] == 'x' || buf[1] == 'X')) {
+    base = 16;
+    skip = 2;
+  } else if(buf[0] == '0' && (buf[1] == 'o' || buf[1] == 'O')) {
+    base = 8;
+    skip = 2;
+  } else if(buf[0] == '0' && (buf[1] == 'b' || buf[1] == 'B')) {
+    base = 2;
+    skip = 2;
+  } else if(strpbrk(buf, ".eE")) {
+    is_float = true;
+  } else if(buf[0] == '0' && buf[1]) {
+    base = 8;                   /* Python 2 octal literal */
+    skip = 1;
+  }
+
+  errno = 0;
+  if(is_float) {
+    L->value.type = cExprFloat;
+    L->value.f = strtod(buf, &end);
+  } else {
+    /* no sign allowed after the prefix; overflow means a Python long */
+    if(!isalnum((unsigned char) buf[skip]))
+      return false;
+    L->value.type = cExprInt;
+    L->value.i = strtol(buf + skip, &end, base);
+  }
+  if(*end || errno)
+    return false;               /* long, imaginary or malformed */
+  return true;
+}
+
+static int ExprLexString(ExprLexer * L)
+{
+  char quote = *(L->p++);
+  char *dst = L->strings;
+  if(L->p[0] == quote && L->p[1] == quote)
+    return false;               /* triple quoted */
+  while(*L->p != quote) {
+    if(!*L->p || *L->p == '\\' || *L->p == '\n' || *L->p == '\r')
+      return false;
+    *(dst++) = *(L->p++);
+  }
+  L->p++;
+  *(dst++) = 0;
+  L->value.type = cExprStr;
+  L->value.s = L->strings;
+  L->strings = dst;
+  return true;
+}
+
+static void ExprLexNext(ExprLexer * L)
+{
+  static const char *ops[] = {
+    "<<=", ">>=", "//=", "**=",
+    "**", "//", "<<", ">>", "<=", ">=", "==", "!=", "<>",
+    "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=",
+    NULL
+  };
+  const char *p;
+  int a;
+
+  for(;;) {
+    p = L->p;
+    while(*p == ' ' || *p == '\t' || *p == '\f')
+      p++;
+    L->p = p;
+    if(*p == '\n' || *p == '\r') {
+      /* single_input only compiles the first line, so anything after
+         a line break outside of parentheses must be whitespace */
+      const char *q = p;
+      while(isspace((unsigned char) *q))
+        q++;
+      L->p = q;
+      if(L->paren || !*q)
+        continue;
+      L->tok = cTokBad;
+      return;
+    }
+    break;
+  }
+
+  if(!*p) {
+    L->tok = cTokEnd;
+  } else if(isalpha((unsigned char) *p) || *p == '_') {
+    int n = 0;
+    while(isalnum((unsigned char) *p) || *p == '_') {
+      if(n == sizeof(WordType) - 1) {
+        L->tok = cTokBad;
+        return;
+      }
+      L->name[n++] = *(p++);
+    }
+    L->name[n] = 0;
+    L->p = p;
+    L->tok = (*p == '\'' || *p == '"') ? cTokBad : cTokName;   /* u'', r'' */
+  } else if(isdigit((unsigned char) *p) || (*p == '.' && isdigit((unsigned char) p[1]))) {
+    L->tok = ExprLexNumber(L) ? cTokNumber : cTokBad;
+  } else if(*p == '\'' || *p == '"') {
+    L->tok = ExprLexString(L) ? cTokString : cTokBad;
+  } else {
+    L->tok = cTokOp;
+    for(a = 0; ops[a]; a++) {
+      int n = (int) strlen(ops[a]);
+      if(!strncmp(p, ops[a], n)) {
+        strcpy(L->text, ops[a]);
+        L->p += n;
+        return;
+      }
+    }
+    if(strchr("+-*/%&|^~<>=(),;", *p)) {
+      L->text[0] = *p;
+      L->text[1] = 0;
+      L->p++;
+      if(*p == '(')
+        L->paren++;
+      else if(*p == ')')
+        L->paren--;
+    } else {
+      L->tok = cTokBad;         /* attributes, subscripts, comments... */
+    }
+  }
+}
+
+static int ExprLexIs(ExprLexer * L, const char *op)
+{
+  return (L->tok == cTokOp) && !strcmp(L->text, op);
+}
+
+static int ExprLexIsName(ExprLexer * L, const char *name)
+{
+  return (L->tok == cTokName) && !strcmp(L->name, name);
+}
+
+
+/*========================================================================*/
+/* compiler */
+
+typedef struct {
+  PyMOLGlobals *G;
+  CAtomExpr *I;
+  ExprLexer L;
+  PyObject *space;
+  int depth;
+  WordType local[cExprMaxLocal];
+  int local_kind[cExprMaxLocal];
+  int n_local;
+  int written[cExprMaxProp];
+} ExprCompiler;
+
+static int ExprEmit(ExprCompiler * C, int op, int arg)
+{
+  CAtomExpr *I = C->I;
+  switch (op) {
+  case cOpConst:
+  case cOpLoadProp:
+  case cOpLoadWritten:
+  case cOpLoadLocal:
+  case cOpDup:
+    C->depth++;
+    break;
+  case cOpStoreProp:
+  case cOpStoreLocal:
+  case cOpJumpIfFalse:
+  case cOpJumpIfFalseOrPop:
+  case cOpJumpIfTrueOrPop:
+  case cOpAdd: case cOpSub: case cOpMul: case cOpDiv: case cOpFloorDiv: case cOpMod:
+  case cOpBitAnd: case cOpBitOr: case cOpBitXor: case cOpShl: case cOpShr:
+  case cOpLt: case cOpLe: case cOpGt: case cOpGe: case cOpEq: case cOpNe:
+    C->depth--;
+    break;
+  case cOpMin:
+  case cOpMax:
+    C->depth -= arg - 1;
+    break;
+  }
+  if(C->depth > cExprMaxStack)
+    return false;
+  VLACheck(I->Code, ExprInstr, I->NCode);
+  I->Code[I->NCode].op = op;
+  I->Code[I->NCode].arg = arg;
+  return ++I->NCode;
+}
+
+static int ExprEmitConst(ExprCompiler * C, const ExprValue * value)
+{
+  CAtomExpr *I = C->I;
+  VLACheck(I->Const, ExprValue, I->NConst);
+  I->Const[I->NConst] = *value;
+  return ExprEmit(C, cOpConst, I->NConst++);
+}
+
+/* supported properties: returns the slot, or -1 */
+static int ExprPropSlot(ExprCompiler * C, const char *name, int store)
+{
+  CAtomExpr *I = C->I;
+  AtomPropertyInfo *ap = PyMOL_GetAtomPropertyInfo(C->G->PyMOL, name);
+  int state_mode = (I->Mode & cAtomExprState);
+  int a, atomic = true, ok = true;
+
+  if(!ap)
+    return -1;
+  switch (ap->Ptype) {
+  case cPType_float:
+  case cPType_int:
+  case cPType_schar:
+    /* alter_state may only assign flags */
+    ok = !store || !state_mode || ap->id == ATOM_PROP_FLAGS;
+    break;
+  case cPType_string:
+    ok = !store || (!state_mode && ap->id != ATOM_PROP_ELEM);
+    break;
+  case cPType_char_as_type:
+    ok = !store;
+    break;
+  case cPType_index:
+  case cPType_model:
+    ok = !store;
+    atomic = false;
+    break;
+  case cPType_state:
+    ok = !store && state_mode;
+    atomic = false;
+    break;
+  case cPType_xyz_float:
+    ok = state_mode;
+    atomic = false;
+    break;
+  default:                     /* lexicon strings, stereo, settings, ... */
+    ok = false;
+  }
+  if(!ok || (atomic && (I->Mode & cAtomExprNoAtom)))
+    return -1;
+  if(store && (I->Mode & cAtomExprReadOnly))
+    return -1;
+
+  for(a = 0; a < I->NProp; a++)
+    if(I->Prop[a].id == ap->id)
+      return a;
+  if(I->NProp == cExprMaxProp)
+    return -1;
+  I->Prop[a].id = ap->id;
+  I->Prop[a].ptype = ap->Ptype;
+  I->Prop[a].offset = ap->offset;
+  I->Prop[a].maxlen = ap->maxlen;
+  C->written[a] = false;
+  I->NProp++;
+  return a;
+}
+
+static int ExprPropKind(const ExprProp * prop)
+{
+  switch (prop->ptype) {
+  case cPType_float:
+  case cPType_xyz_float:
+    return cExprFloat;
+  case cPType_string:
+  case cPType_char_as_type:
+  case cPType_model:
+    return cExprStr;
+  }
+  return cExprInt;
+}
+
+static int ExprWritten(ExprCompiler * C, int id)
+{
+  int a;
+  for(a = 0; a < C->I->NProp; a++)
+    if(C->written[a] && C->I->Prop[a].id == id)
+      return true;
+  return false;
+}
+
+static int ExprFindLocal(ExprCompiler * C, const char *name)
+{
+  int a;
+  for(a = 0; a < C->n_local; a++)
+    if(!strcmp(C->local[a], name))
+      return a;
+  return -1;
+}
+
+/* whether Python would find the standard builtin name, which needs
+   __builtins__ in the namespace (module namespaces like the default one
+   have it, plain dicts passed as space usually don't) */
+static int ExprIsBuiltin(ExprCompiler * C, const char *name)
+{
+  PyObject *builtins, *item, *std_module;
+  if(!(C->space && PyDict_Check(C->space)))
+    return false;
+  if(!(builtins = PyDict_GetItemString(C->space, "__builtins__")))
+    return false;
+  if(PyModule_Check(builtins))
+    builtins = PyModule_GetDict(builtins);
+  if(!PyDict_Check(builtins))
+    return false;
+  if(!(item = PyDict_GetItemString(builtins, name)))
+    return false;
+  if(!(std_module = PyImport_AddModule("__builtin__")))
+    return false;
+  return item == PyDict_GetItemString(PyModule_GetDict(std_module), name);
+}
+
+/* names which are neither properties nor assigned locals come from the
+   namespace (or the builtins), and must be numbers that don't change */
+static int ExprLoadName(ExprCompiler * C, const char *name)
+{
+  ExprValue value;
+  PyObject *item = NULL;
+  int slot;
+
+  if((slot = ExprPropSlot(C, name, false)) >= 0) {
+    ExprProp *prop = C->I->Prop + slot;
+    int kind = ExprPropKind(prop);
+    /* reading back assigned strings, or residue numbers once resi or
+       resv (which update each other) are assigned, isn't supported */
+    if(C->written[slot] && kind == cExprStr)
+      return 0;
+    if((prop->id == ATOM_PROP_RESI || prop->id == ATOM_PROP_RESV) &&
+       (ExprWritten(C, ATOM_PROP_RESI) ||
+        (prop->id == ATOM_PROP_RESI && ExprWritten(C, ATOM_PROP_RESV))))
+      return 0;
+    return ExprEmit(C, C->written[slot] ? cOpLoadWritten : cOpLoadProp, slot) ? kind : 0;
+  }
+  if(PyMOL_GetAtomPropertyInfo(C->G->PyMOL, name))
+    return 0;
+  if((slot = ExprFindLocal(C, name)) >= 0)
+    return ExprEmit(C, cOpLoadLocal, slot) ? C->local_kind[slot] : 0;
+
+  if(C->space && PyDict_Check(C->space))
+    item = PyDict_GetItemString(C->space, name);
+  if(item) {
+    if(PyInt_Check(item)) {
+      value.type = cExprInt;
+      value.i = PyInt_AsLong(item);
+    } else if(PyFloat_Check(item)) {
+      value.type = cExprFloat;
+      value.f = PyFloat_AsDouble(item);
+    } else {
+      return 0;
+    }
+  } else if((!strcmp(name, "True") || !strcmp(name, "False")) &&
+            ExprIsBuiltin(C, name)) {
+    value.type = cExprInt;
+    value.i = (name[0] == 'T');
+  } else {
+    return 0;
+  }
+  return ExprEmitConst(C, &value) ? value.type : 0;
+}
+
+static int ExprStoreName(ExprCompiler * C, const char *name, int kind)
+{
+  int slot = ExprPropSlot(C, name, true);
+  if(slot >= 0) {
+    CAtomExpr *I = C->I;
+    int prop_kind = ExprPropKind(I->Prop + slot);
+    if(prop_kind == cExprStr ? (kind != cExprStr) : (kind & cExprStr))
+      return false;
+    /* float to integer conversion fails for inf, nan and huge values */
+    if(prop_kind == cExprInt && (kind & cExprFloat))
+      I->MayFail = true;
+    C->written[slot] = true;
+    I->Writes = true;
+    return ExprEmit(C, cOpStoreProp, slot);
+  }
+  if(PyMOL_GetAtomPropertyInfo(C->G->PyMOL, name))
+    return false;
+  if((slot = ExprFindLocal(C, name)) < 0) {
+    if(C->n_local == cExprMaxLocal)
+      return false;
+    slot = C->n_local++;
+    UtilNCopy(C->local[slot], name, sizeof(WordType));
+  }
+  C->local_kind[slot] = kind;
+  return ExprEmit(C, cOpStoreLocal, slot);
+}
+
+static int ExprTest(ExprCompiler * C);
+
+static int ExprCall(ExprCompiler * C, const char *name)
+{
+  int kind = 0, arg_kind, n_arg = 0;
+  static const char *builtins[] = { "min", "max", "abs", "int", "float", NULL };
+  int a;
+
+  for(a = 0; builtins[a]; a++)
+    if(!strcmp(name, builtins[a]))
+      break;
+  if(!builtins[a] || ExprFindLocal(C, name) >= 0 ||
+     PyMOL_GetAtomPropertyInfo(C->G->PyMOL, name) ||
+     (C->space && PyDict_Check(C->space) && PyDict_GetItemString(C->space, name)) ||
+     !ExprIsBuiltin(C, name))
+    return 0;
+
+  ExprLexNext(&C->L);
+  while(!ExprLexIs(&C->L, ")")) {
+    if(!(arg_kind = ExprTest(C)) || (arg_kind & cExprStr))
+      return 0;
+    kind |= arg_kind;
+    n_arg++;
+    if(ExprLexIs(&C->L, ","))
+      ExprLexNext(&C->L);
+    else if(!ExprLexIs(&C->L, ")"))
+      return 0;
+  }
+  ExprLexNext(&C->L);
+
+  switch (a) {
+  case 0:
+  case 1:
+    /* a single argument would be an iterable */
+    if(n_arg < 2)
+      return 0;
+    return ExprEmit(C, a ? cOpMax : cOpMin, n_arg) ? kind : 0;
+  case 2:
+    if(n_arg != 1)
+      return 0;
+    if(kind & cExprInt)
+      C->I->MayFail = true;
+    return ExprEmit(C, cOpAbs, 0) ? kind : 0;
+  case 3:
+    if(n_arg != 1)
+      return 0;
+    if(kind & cExprFloat)
+      C->I->MayFail = true;
+    return ExprEmit(C, cOpInt, 0) ? cExprInt : 0;
+  case 4:
+    if(n_arg != 1)
+      return 0;
+    return ExprEmit(C, cOpFloat, 0) ? cExprFloat : 0;
+  }
+  return 0;
+}
+
+static int ExprAtom(ExprCompiler * C)
+{
+  ExprLexer *L = &C->L;
+  int kind = 0;
+  switch (L->tok) {
+  case cTokNumber:
+  case cTokString:
+    if(ExprEmitConst(C, &L->value))
+      kind = L->value.type;
+    ExprLexNext(L);
+    break;
+  case cTokName:
+    {
+      WordType name;
+      UtilNCopy(name, L->name, sizeof(WordType));
+      ExprLexNext(L);
+      if(ExprLexIs(L, "("))
+        kind = ExprCall(C, name);
+      else
+        kind = ExprLoadName(C, name);
+    }
+    break;
+  case cTokOp:
+    if(ExprLexIs(L, "(")) {
+      ExprLexNext(L);
+      kind = ExprTest(C);
+      if(!ExprLexIs(L, ")"))
+        return 0;               /* tuple */
+      ExprLexNext(L);
+    }
+    break;
+  }
+  /* attributes and subscripts are rejected by the lexer, calls here */
+  if(ExprLexIs(L, "(") || ExprLexIs(L, "**"))
+    return 0;
+  return kind;
+}
+
+static int ExprFactor(ExprCompiler * C)
+{
+  ExprLexer *L = &C->L;
+  int op, kind;
+  if(ExprLexIs(L, "-"))
+    op = cOpNeg;
+  else if(ExprLexIs(L, "+"))
+    op = cOpPos;
+  else if(ExprLexIs(L, "~"))
+    op = cOpInvert;
+  else
+    return ExprAtom(C);
+  ExprLexNext(L);
+  if(!(kind = ExprFactor(C)) || (kind & cExprStr))
+    return 0;
+  switch (op) {
+  case cOpNeg:
+    if(kind & cExprInt)
+      C->I->MayFail = true;
+    break;
+  case cOpInvert:
+    if(kind & cExprFloat)
+      C->I->MayFail = true;
+    kind = cExprInt;
+    break;
+  }
+  return ExprEmit(C, op, 0) ? kind : 0;
+}
+
+/* kinds of a binary arithmetic (op < cOpLt) or comparison result */
+static int ExprBinaryKind(ExprCompiler * C, int op, int k1, int k2)
+{
+  if(op >= cOpLt) {
+    /* Python 2 compares strings and numbers without raising, but
+       not in any useful way */
+    if((k1 == cExprStr) != (k2 == cExprStr))
+      return 0;
+    return cExprInt;
+  }
+  if((k1 | k2) & cExprStr)
+    return 0;
+  switch (op) {
+  case cOpBitAnd:
+  case cOpBitOr:
+  case cOpBitXor:
+    if((k1 | k2) & cExprFloat)
+      C->I->MayFail = true;
+    return cExprInt;
+  case cOpShl:
+  case cOpShr:
+    C->I->MayFail = true;
+    return cExprInt;
+  case cOpDiv:
+  case cOpFloorDiv:
+  case cOpMod:
+    C->I->MayFail = true;
+    break;
+  default:
+    /* integer overflow */
+    if(k1 & k2 & cExprInt)
+      C->I->MayFail = true;
+  }
+  return (k1 & k2 & cExprInt) | ((k1 | k2) & cExprFloat);
+}
+
+typedef int ExprParseFn(ExprCompiler * C);
+
+typedef struct {
+  const char *text;
+  int op;
+} ExprBinaryOp;
+
+static int ExprBinary(ExprCompiler * C, ExprParseFn * operand, const ExprBinaryOp * ops)
+{
+  int kind = operand(C), kind2, a;
+  while(kind) {
+    for(a = 0; ops[a].text; a++)
+      if(ExprLexIs(&C->L, ops[a].text))
+        break;
+    if(!ops[a].text)
+      break;
+    ExprLexNext(&C->L);
+    if(!(kind2 = operand(C)))
+      return 0;
+    kind = ExprBinaryKind(C, ops[a].op, kind, kind2);
+    if(kind && !ExprEmit(C, ops[a].op, 0))
+      return 0;
+  }
+  return kind;
+}
+
+static int ExprTerm(ExprCompiler * C)
+{
+  static const ExprBinaryOp ops[] = {
+    {"*", cOpMul}, {"/", cOpDiv}, {"//", cOpFloorDiv}, {"%", cOpMod}, {NULL, 0}
+  };
+  return ExprBinary(C, ExprFactor, ops);
+}
+
+static int ExprArith(ExprCompiler * C)
+{
+  static const ExprBinaryOp ops[] = { {"+", cOpAdd}, {"-", cOpSub}, {NULL, 0} };
+  return ExprBinary(C, ExprTerm, ops);
+}
+
+static int ExprShift(ExprCompiler * C)
+{
+  static const ExprBinaryOp ops[] = { {"<<", cOpShl}, {">>", cOpShr}, {NULL, 0} };
+  return ExprBinary(C, ExprArith, ops);
+}
+
+static int ExprBitAnd(ExprCompiler * C)
+{
+  static const ExprBinaryOp ops[] = { {"&", cOpBitAnd}, {NULL, 0} };
+  return ExprBinary(C, ExprShift, ops);
+}
+
+static int ExprBitXor(ExprCompiler * C)
+{
+  static const ExprBinaryOp ops[] = { {"^", cOpBitXor}, {NULL, 0} };
+  return ExprBinary(C, ExprBitAnd, ops);
+}
+
+static int ExprBitOr(ExprCompiler * C)
+{
+  static const ExprBinaryOp ops[] = { {"|", cOpBitOr}, {NULL, 0} };
+  return ExprBinary(C, ExprBitXor, ops);
+}
+
+static int ExprComparison(ExprCompiler * C)
+{
+  static const ExprBinaryOp ops[] = {
+    {"<", cOpLt}, {"<=", cOpLe}, {">", cOpGt}, {">=", cOpGe},
+    {"==", cOpEq}, {"!=", cOpNe}, {"<>", cOpNe}, {NULL, 0}
+  };
+  int kind = ExprBitOr(C), kind2, a;
+  if(!kind)
+    return 0;
+  for(a = 0; ops[a].text; a++)
+    if(ExprLexIs(&C->L, ops[a].text))
+      break;
+  if(ops[a].text) {
+    ExprLexNext(&C->L);
+    if(!(kind2 = ExprBitOr(C)))
+      return 0;
+    kind = ExprBinaryKind(C, ops[a].op, kind, kind2);
+    if(!kind || !ExprEmit(C, ops[a].op, 0))
+      return 0;
+    /* chained comparisons (a < b < c) aren't pairwise */
+    for(a = 0; ops[a].text; a++)
+      if(ExprLexIs(&C->L, ops[a].text))
+        return 0;
+  }
+  /* in, not in, is */
+  if(ExprLexIsName(&C->L, "in") || ExprLexIsName(&C->L, "is") ||
+     ExprLexIsName(&C->L, "not"))
+    return 0;
+  return kind;
+}
+
+static int ExprNotTest(ExprCompiler * C)
+{
+  int kind;
+  if(!ExprLexIsName(&C->L, "not"))
+    return ExprComparison(C);
+  ExprLexNext(&C->L);
+  if(!(kind = ExprNotTest(C)))
+    return 0;
+  return ExprEmit(C, cOpNot, 0) ? cExprInt : 0;
+}
+
+/* and/or: the result is one of the operands */
+static int ExprLogic(ExprCompiler * C, ExprParseFn * operand, const char *word, int op)
+{
+  int kind = operand(C), kind2, jump;
+  while(kind && ExprLexIsName(&C->L, word)) {
+    ExprLexNext(&C->L);
+    if(!(jump = ExprEmit(C, op, 0)))
+      return 0;
+    if(!(kind2 = operand(C)))
+      return 0;
+    if((kind == cExprStr) != (kind2 == cExprStr))
+      return 0;
+    kind |= kind2;
+    C->I->Code[jump - 1].arg = C->I->NCode - (jump - 1);
+  }
+  return kind;
+}
+
+static int ExprAndTest(ExprCompiler * C)
+{
+  return ExprLogic(C, ExprNotTest, "and", cOpJumpIfFalseOrPop);
+}
+
+static int ExprOrTest(ExprCompiler * C)
+{
+  return ExprLogic(C, ExprAndTest, "or", cOpJumpIfTrueOrPop);
+}
+
+/* "a if c else b": the condition is evaluated first, so the code for a
+   is moved behind it (jumps are relative, so code can be moved) */
+static int ExprTest(ExprCompiler * C)
+{
+  CAtomExpr *I = C->I;
+  int start = I->NCode, depth = C->depth;
+  int kind = ExprOrTest(C), kind2, n_body, jump1 = 0, jump2 = 0, ok = true;
+  ExprInstr *body;
+
+  if(!kind || !ExprLexIsName(&C->L, "if"))
+    return kind;
+  ExprLexNext(&C->L);
+
+  n_body = I->NCode - start;
+  body = Alloc(ExprInstr, n_body + 1);
+  if(!body)
+    return 0;
+  memcpy(body, I->Code + start, sizeof(ExprInstr) * n_body);
+  I->NCode = start;
+  C->depth = depth;
+
+  ok = ExprOrTest(C) && (jump1 = ExprEmit(C, cOpJumpIfFalse, 0));
+  if(ok) {
+    VLACheck(I->Code, ExprInstr, I->NCode + n_body);
+    memcpy(I->Code + I->NCode, body, sizeof(ExprInstr) * n_body);
+    I->NCode += n_body;
+    C->depth++;
+    ok = (jump2 = ExprEmit(C, cOpJump, 0)) && ExprLexIsName(&C->L, "else");
+  }
+  FreeP(body);
+  if(!ok)
+    return 0;
+  ExprLexNext(&C->L);
+  C->depth = depth;
+  I->Code[jump1 - 1].arg = I->NCode - (jump1 - 1);
+  if(!(kind2 = ExprTest(C)) || (kind == cExprStr) != (kind2 == cExprStr))
+    return 0;
+  I->Code[jump2 - 1].arg = I->NCode - (jump2 - 1);
+  return kind | kind2;
+}
+
+/* NAME = [NAME = ...] test | NAME op= test */
+static int ExprStatement(ExprCompiler * C)
+{
+  static const ExprBinaryOp aug[] = {
+    {"+=", cOpAdd}, {"-=", cOpSub}, {"*=", cOpMul}, {"/=", cOpDiv},
+    {"//=", cOpFloorDiv}, {"%=", cOpMod}, {"&=", cOpBitAnd}, {"|=", cOpBitOr},
+    {"^=", cOpBitXor}, {"<<=", cOpShl}, {">>=", cOpShr}, {NULL, 0}
+  };
+  ExprLexer *L = &C->L;
+  WordType target[cExprMaxTarget];
+  int n_target = 0, kind, a;
+
+  while(L->tok == cTokName) {
+    ExprLexer save = *L;
+    ExprLexNext(L);
+    if(!ExprLexIs(L, "=")) {
+      *L = save;
+      break;
+    }
+    if(n_target == cExprMaxTarget)
+      return false;
+    UtilNCopy(target[n_target++], save.name, sizeof(WordType));
+    ExprLexNext(L);
+  }
+
+  if(!n_target) {
+    /* augmented assignment (anything else would be an expression
+       statement, whose value single_input prints) */
+    if(L->tok != cTokName)
+      return false;
+    UtilNCopy(target[0], L->name, sizeof(WordType));
+    ExprLexNext(L);
+    for(a = 0; aug[a].text; a++)
+      if(ExprLexIs(L, aug[a].text))
+        break;
+    if(!aug[a].text)
+      return false;
+    ExprLexNext(L);
+    if(!(kind = ExprLoadName(C, target[0])))
+      return false;
+    {
+      int kind2 = ExprTest(C);
+      if(!kind2)
+        return false;
+      kind = ExprBinaryKind(C, aug[a].op, kind, kind2);
+      if(!kind || !ExprEmit(C, aug[a].op, 0))
+        return false;
+    }
+    return ExprStoreName(C, target[0], kind);
+  }
+
+  if(!(kind = ExprTest(C)))
+    return false;
+  for(a = 0; a < n_target; a++) {
+    if(a < n_target - 1 && !ExprEmit(C, cOpDup, 0))
+      return false;
+    if(!ExprStoreName(C, target[a], kind))
+      return false;
+  }
+  return true;
+}
+
+void AtomExprFree(CAtomExpr * I)
+{
+  if(I) {
+    VLAFreeP(I->Code);
+    VLAFreeP(I->Const);
+    FreeP(I->Strings);
+    FreeP(I);
+  }
+}
+
+CAtomExpr *AtomExprCompile(PyMOLGlobals * G, const char *expr, int mode, PyObject * space)
+{
+  ExprCompiler compiler, *C = &compiler;
+  CAtomExpr *I = Calloc(CAtomExpr, 1);
+  int ok = (I != NULL), n_statement = 0;
+
+  if(ok) {
+    I->Mode = mode;
+    I->Code = VLAlloc(ExprInstr, 32);
+    I->Const = VLAlloc(ExprValue, 8);
+    I->Strings = Alloc(char, strlen(expr) + 1);
+    ok = I->Code && I->Const && I->Strings;
+  }
+  if(ok) {
+    UtilZeroMem(C, sizeof(ExprCompiler));
+    C->G = G;
+    C->I = I;
+    C->space = space;
+    C->L.p = expr;
+    C->L.strings = I->Strings;
+    ExprLexNext(&C->L);
+    while(ok && C->L.tok != cTokEnd) {
+      ok = ExprStatement(C);
+      n_statement++;
+      if(ok && ExprLexIs(&C->L, ";"))
+        ExprLexNext(&C->L);
+      else if(ok)
+        ok = (C->L.tok == cTokEnd);
+    }
+    ok = ok && n_statement && !C->depth;
+  }
+  if(!ok) {
+    AtomExprFree(I);
+    return NULL;
+  }
+  return I;
+}
+
+
+/*========================================================================*/
+/* evaluation, with the semantics of Python 2 int and float objects */
+
+static double ExprAsFloat(const ExprValue * v)
+{
+  return (v->type == cExprInt) ? (double) v->i : v->f;
+}
+
+static int ExprTruth(const ExprValue * v)
+{
+  switch (v->type) {
+  case cExprInt:
+    return v->i != 0;
+  case cExprFloat:
+    return v->f != 0.0;
+  }
+  return v->s[0] != 0;
+}
+
+/* float to int, as int() does; fails where Python would need a long */
+static int ExprFloatToInt(double f, long *result)
+{
+  double whole;
+  modf(f, &whole);
+  if(!((double) LONG_MIN < whole && whole < (double) LONG_MAX))
+    return false;
+  *result = (long) whole;
+  return true;
+}
+
+static int ExprCompare(int op, const ExprValue * a, const ExprValue * b)
+{
+  int c;
+  if(a->type == cExprStr) {
+    c = strcmp(a->s, b->s);
+  } else if(a->type == cExprInt && b->type == cExprInt) {
+    c = (a->i > b->i) - (a->i < b->i);
+  } else {
+    double fa = ExprAsFloat(a), fb = ExprAsFloat(b);
+    switch (op) {               /* NaN compares false */
+    case cOpLt:
+      return fa < fb;
+    case cOpLe:
+      return fa <= fb;
+    case cOpGt:
+      return fa > fb;
+    case cOpGe:
+      return fa >= fb;
+    case cOpEq:
+      return fa == fb;
+    }
+    return fa != fb;
+  }
+  switch (op) {
+  case cOpLt:
+    return c < 0;
+  case cOpLe:
+    return c <= 0;
+  case cOpGt:
+    return c > 0;
+  case cOpGe:
+    return c >= 0;
+  case cOpEq:
+    return c == 0;
+  }
+  return c != 0;
+}
+
+static int ExprIntBinary(int op, long x, long y, long *result)
+{
+  long r;
+  switch (op) {
+  case cOpAdd:
+    if((y > 0 && x > LONG_MAX - y) || (y < 0 && x < LONG_MIN - y))
+      return false;
+    r = x + y;
+    break;
+  case cOpSub:
+    if((y < 0 && x > LONG_MAX + y) || (y > 0 && x < LONG_MIN + y))
+      return false;
+    r = x - y;
+    break;
+  case cOpMul:
+    if(x > 0) {
+      if(y > 0 ? (x > LONG_MAX / y) : (y < LONG_MIN / x))
+        return false;
+    } else if(x < 0) {
+      if(y > 0 ? (x < LONG_MIN / y) : (y && x < LONG_MAX / y))
+        return false;
+    }
+    r = x * y;
+    break;
+  case cOpDiv:
+  case cOpFloorDiv:
+  case cOpMod:
+    if(!y || (y == -1 && x == LONG_MIN))
+      return false;
+    r = x % y;
+    if(r && ((r < 0) != (y < 0))) {
+      if(op == cOpMod)
+        r += y;
+      else
+        r = x / y - 1;
+    } else if(op != cOpMod) {
+      r = x / y;
+    }
+    break;
+  case cOpBitAnd:
+    r = x & y;
+    break;
+  case cOpBitOr:
+    r = x | y;
+    break;
+  case cOpBitXor:
+    r = x ^ y;
+    break;
+  case cOpShl:
+    if(y < 0)
+      return false;
+    if(!x) {
+      r = 0;
+      break;
+    }
+    if(y >= (long) (sizeof(long) * 8))
+      return false;
+    r = (long) ((unsigned long) x << y);
+    if((r >> y) != x)
+      return false;
+    break;
+  case cOpShr:
+    if(y < 0)
+      return false;
+    if(y >= (long) (sizeof(long) * 8))
+      r = (x < 0) ? -1 : 0;
+    else
+      r = x >> y;
+    break;
+  default:
+    return false;
+  }
+  *result = r;
+  return true;
+}
+
+static int ExprFloatBinary(int op, double x, double y, double *result)
+{
+  double mod, div;
+  switch (op) {
+  case cOpAdd:
+    *result = x + y;
+    return true;
+  case cOpSub:
+    *result = x - y;
+    return true;
+  case cOpMul:
+    *result = x * y;
+    return true;
+  case cOpDiv:
+    if(y == 0.0)
+      return false;
+    *result = x / y;
+    return true;
+  case cOpFloorDiv:
+  case cOpMod:
+    if(y == 0.0)
+      return false;
+    /* as float_divmod */
+    mod = fmod(x, y);
+    div = (x - mod) / y;
+    if(mod) {
+      if((y < 0) != (mod < 0)) {
+        mod += y;
+        div -= 1.0;
+      }
+    } else {
+      mod *= mod;
+      if(y < 0.0)
+        mod = -mod;
+    }
+    if(op == cOpMod) {
+      *result = mod;
+    } else if(div) {
+      double floordiv = floor(div);
+      if(div - floordiv > 0.5)
+        floordiv += 1.0;
+      *result = floordiv;
+    } else {
+      div *= div;
+      *result = div * x / y;
+    }
+    return true;
+  }
+  return false;                 /* bitwise operators on floats */
+}
+
+typedef struct {
+  const CAtomExpr *I;
+  const char *model;
+  int state;
+  int commit;
+  ExprValue *shadow;            /* dry run: values assigned to properties */
+} ExprContext;
+
+static void ExprReadProp(const ExprContext * E, const ExprProp * prop,
+                        const AtomExprTarget * t, ExprValue * v)
+{
+  const char *field = ((const char *) t->ai) + prop->offset;
+  switch (prop->ptype) {
+  case cPType_float:
+    v->type = cExprFloat;
+    v->f = *(const float *) field;
+    break;
+  case cPType_int:
+    v->type = cExprInt;
+    v->i = *(const int *) field;
+    break;
+  case cPType_schar:
+    v->type = cExprInt;
+    v->i = *(const signed char *) field;
+    break;
+  case cPType_string:
+    v->type = cExprStr;
+    v->s = field;
+    break;
+  case cPType_char_as_type:
+    v->type = cExprStr;
+    v->s = t->ai->hetatm ? "HETATM" : "ATOM";
+    break;
+  case cPType_index:
+    v->type = cExprInt;
+    v->i = t->index + 1;
+    break;
+  case cPType_model:
+    v->type = cExprStr;
+    v->s = E->model;
+    break;
+  case cPType_state:
+    v->type = cExprInt;
+    v->i = E->state + 1;
+    break;
+  case cPType_xyz_float:
+    v->type = cExprFloat;
+    v->f = t->v[prop->offset];
+    break;
+  }
+}
+
+/* converts v to what the property holds, as WrapperObjectAssignSubScript */
+static int ExprConvertProp(const ExprProp * prop, ExprValue * v)
+{
+  long i;
+  switch (prop->ptype) {
+  case cPType_float:
+  case cPType_xyz_float:
+    v->f = (v->type == cExprInt) ? (float) v->i : (float) v->f;
+    v->type = cExprFloat;
+    break;
+  case cPType_int:
+  case cPType_schar:
+    if(v->type == cExprFloat) {
+      if(!ExprFloatToInt(v->f, &i))
+        return false;
+    } else {
+      i = v->i;
+    }
+    v->type = cExprInt;
+    v->i = (prop->ptype == cPType_int) ? (int) i : (signed char) (int) i;
+    break;
+  }
+  return true;
+}
+
+static void ExprWriteProp(const ExprProp * prop, const AtomExprTarget * t, const ExprValue * v)
+{
+  AtomInfoType *ai = t->ai;
+  char *field = ((char *) ai) + prop->offset;
+  switch (prop->ptype) {
+  case cPType_float:
+    *(float *) field = (float) v->f;
+    break;
+  case cPType_xyz_float:
+    t->v[prop->offset] = (float) v->f;
+    return;
+  case cPType_int:
+    *(int *) field = (int) v->i;
+    break;
+  case cPType_schar:
+    *(signed char *) field = (signed char) v->i;
+    break;
+  case cPType_string:
+    if(v->s == field) {
+      /* assigned to itself */
+    } else if(strlen(v->s) > (size_t) prop->maxlen) {
+      strncpy(field, v->s, prop->maxlen);
+    } else {
+      strcpy(field, v->s);
+    }
+    break;
+  }
+  switch (prop->id) {
+  case ATOM_PROP_RESI:
+    ai->resv = AtomResvFromResi(ai->resi);
+    break;
+  case ATOM_PROP_RESV:
+    {
+      WordType buf;
+      sprintf(buf, "%d", ai->resv);
+      buf[sizeof(ResIdent) - 1] = 0;
+      strcpy(ai->resi, buf);
+    }
+    break;
+  case ATOM_PROP_SS:
+    ai->ssType[0] = toupper(ai->ssType[0]);
+    break;
+  case ATOM_PROP_FORMAL_CHARGE:
+    ai->chemFlag = false;
+    break;
+  }
+}
+
+static int ExprRun(const ExprContext * E, const AtomExprTarget * t)
+{
+  const CAtomExpr *I = E->I;
+  const ExprInstr *code = I->Code;
+  ExprValue stack[cExprMaxStack + 1], local[cExprMaxLocal];
+  ExprValue *top = stack - 1;   /* top of the stack */
+  int pc, a;
+
+  for(pc = 0; pc < I->NCode; pc++) {
+    int op = code[pc].op, arg = code[pc].arg;
+    switch (op) {
+    case cOpConst:
+      *(++top) = I->Const[arg];
+      break;
+    case cOpLoadWritten:
+      if(!E->commit) {
+        *(++top) = E->shadow[arg];
+        break;
+      }
+    case cOpLoadProp:
+      ExprReadProp(E, I->Prop + arg, t, ++top);
+      break;
+    case cOpLoadLocal:
+      *(++top) = local[arg];
+      break;
+    case cOpStoreProp:
+      if(!ExprConvertProp(I->Prop + arg, top))
+        return false;
+      if(E->commit)
+        ExprWriteProp(I->Prop + arg, t, top);
+      else
+        E->shadow[arg] = *top;
+      top--;
+      break;
+    case cOpStoreLocal:
+      local[arg] = *(top--);
+      break;
+    case cOpDup:
+      top[1] = top[0];
+      top++;
+      break;
+    case cOpLt:
+    case cOpLe:
+    case cOpGt:
+    case cOpGe:
+    case cOpEq:
+    case cOpNe:
+      top--;
+      top->i = ExprCompare(op, top, top + 1);
+      top->type = cExprInt;
+      break;
+    case cOpNeg:
+    case cOpAbs:
+      if(top->type == cExprFloat) {
+        top->f = (op == cOpNeg) ? -top->f : fabs(top->f);
+      } else if(top->i == LONG_MIN) {
+        return false;
+      } else if(op == cOpNeg || top->i < 0) {
+        top->i = -top->i;
+      }
+      break;
+    case cOpPos:
+      break;
+    case cOpInvert:
+      if(top->type != cExprInt)
+        return false;
+      top->i = ~top->i;
+      break;
+    case cOpNot:
+      top->i = !ExprTruth(top);
+      top->type = cExprInt;
+      break;
+    case cOpInt:
+      if(top->type == cExprFloat) {
+        if(!ExprFloatToInt(top->f, &top->i))
+          return false;
+        top->type = cExprInt;
+      }
+      break;
+    case cOpFloat:
+      top->f = ExprAsFloat(top);
+      top->type = cExprFloat;
+      break;
+    case cOpMin:
+    case cOpMax:
+      /* the first extreme argument wins, as in the builtins */
+      top -= arg - 1;
+      for(a = 1; a < arg; a++)
+        if(ExprCompare(op == cOpMin ? cOpLt : cOpGt, top + a, top))
+          *top = top[a];
+      break;
+    case cOpJump:
+      pc += arg - 1;
+      break;
+    case cOpJumpIfFalse:
+      if(!ExprTruth(top--))
+        pc += arg - 1;
+      break;
+    case cOpJumpIfFalseOrPop:
+      if(!ExprTruth(top))
+        pc += arg - 1;
+      else
+        top--;
+      break;
+    case cOpJumpIfTrueOrPop:
+      if(ExprTruth(top))
+        pc += arg - 1;
+      else
+        top--;
+      break;
+    default:                   /* binary arithmetic */
+      top--;
+      if(top[0].type == cExprInt && top[1].type == cExprInt) {
+        if(!ExprIntBinary(op, top[0].i, top[1].i, &top->i))
+          return false;
+      } else {
+        if(!ExprFloatBinary(op, ExprAsFloat(top), ExprAsFloat(top + 1), &top->f))
+          return false;
+        top->type = cExprFloat;
+      }
+    }
+  }
+  return true;
+}
+
+typedef struct {
+  ExprContext E;
+  int n, n_chunk;
+  const AtomExprTarget *target;
+  TaskPoolCounter failed;
+} ExprTask;
+
+static void AtomExprEvalTask(void *ctx, int c)
+{
+  ExprTask *T = (ExprTask *) ctx;
+  ExprValue shadow[cExprMaxProp];
+  ExprContext E = T->E;
+  int a = (int) (((ov_size) T->n * c) / T->n_chunk);
+  int a1 = (int) (((ov_size) T->n * (c + 1)) / T->n_chunk);
+  E.shadow = shadow;
+  for(; a < a1; a++) {
+    if(!ExprRun(&E, T->target + a)) {
+      T->failed++;
+      break;
+    }
+    if(!(a & 0xFFF) && T->failed)
+      break;
+  }
+}
+
+static int AtomExprEvalAll(PyMOLGlobals * G, ExprTask * T)
+{
+  T->failed = 0;
+  if(T->n_chunk > 1)
+    TaskPoolRun(G, T->n_chunk, T->n_chunk, AtomExprEvalTask, T);
+  else
+    AtomExprEvalTask(T, 0);
+  return !T->failed;
+}
+
+int AtomExprEval(PyMOLGlobals * G, CAtomExpr * I, const char *model, int state,
+                 int n_target, AtomExprTarget * target)
+{
+  ExprTask T;
+  T.E.I = I;
+  T.E.model = model;
+  T.E.state = state;
+  T.E.shadow = NULL;
+  T.n = n_target;
+  T.target = target;
+  T.n_chunk = TaskPoolGetNThread(G);
+  if(T.n_chunk > n_target / cExprMinChunk)
+    T.n_chunk = n_target / cExprMinChunk;
+  if(T.n_chunk < 1)
+    T.n_chunk = 1;
+
+  /* nothing is written unless every atom succeeds, so that Python can
+     take over (and raise) from the unmodified state */
+  if(I->MayFail) {
+    T.E.commit = false;
+    if(!AtomExprEvalAll(G, &T))
+      return false;
+  }
+  if(I->Writes) {
+    T.E.commit = true;
+    AtomExprEvalAll(G, &T);
+  }
+  return true;
+}
+
+#endif
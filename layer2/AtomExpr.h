@@ -0,0 +1,65 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+#ifndef _H_AtomExpr
+#define _H_AtomExpr
+
+#include"os_python.h"
+#include"PyMOLGlobals.h"
+#include"AtomInfo.h"
+
+/* native evaluation of simple alter, iterate and alter_state expressions
+   (alter_native).
+
+   The supported subset is one or more ';' separated assignments to atom
+   properties or local names, where the right hand side uses numeric and
+   string literals, numeric variables from the namespace, atom
+   properties, arithmetic, bitwise and comparison operators, and/or/not,
+   "a if c else b" and the builtins min, max, abs, int and float (and
+   True/False), as long as the namespace provides __builtins__.  Values
+   follow Python 2 semantics (e.g. integer division floors).
+
+   AtomExprCompile returns NULL for anything outside that subset, and
+   AtomExprEval returns false without touching any atom if Python would
+   have raised for some atom (division by zero, overflow, ...).  In both
+   cases the caller simply runs the expression through Python. */
+
+#ifndef _PYMOL_NOPY
+
+#define cAtomExprReadOnly 0x1   /* iterate: no property may be assigned */
+#define cAtomExprState    0x2   /* alter_state: x, y, z and state */
+#define cAtomExprNoAtom   0x4   /* alter_state without atomic properties */
+
+typedef struct _CAtomExpr CAtomExpr;
+
+typedef struct {
+  AtomInfoType *ai;             /* NULL with cAtomExprNoAtom */
+  float *v;                     /* coordinate, cAtomExprState only */
+  int index;                    /* atom index within the object */
+} AtomExprTarget;
+
+/* assumes a blocked interpreter, since names not assigned by the
+   expression are looked up in space */
+CAtomExpr *AtomExprCompile(PyMOLGlobals * G, const char *expr, int mode, PyObject * space);
+void AtomExprFree(CAtomExpr * I);
+
+/* evaluates the expression for each target (in parallel when there are
+   enough of them); state is the zero-based state for alter_state */
+int AtomExprEval(PyMOLGlobals * G, CAtomExpr * I, const char *model, int state,
+                 int n_target, AtomExprTarget * target);
+
+#endif
+
+#endif
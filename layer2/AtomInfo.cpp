@@ -2521,6 +2521,393 @@ int AtomInfoCompareIgnoreHet(PyMOLGlobals * G, AtomInfoType * at1, AtomInfoType
   return (result);
 }
 
+/*========================================================================*/
+/* Key-encoded sorting: the comparisons of AtomInfoCompare and
+   AtomInfoCompareIgnoreHet are packed into a sequence of integer fields,
+   which are radix sorted from the least to the most significant one.
+   NOTE: don't forget to synchronize with the comparison functions above */
+
+/* up to 5 characters at 9 bits each, 0 marking the end, so that packed
+   words order like WordCompare */
+static uint64_t AtomInfoPackWord(const char *p, int len, int ignCase)
+{
+  uint64_t word = 0;
+  int a;
+  for(a = 0; a < len; a++) {
+    char c = *p;
+    word <<= 9;
+    if(c) {
+      if(ignCase)
+        c = (char) tolower((unsigned char) c);
+      word |= (uint64_t) ((int) c - CHAR_MIN + 1);
+      p++;
+    }
+  }
+  return word;
+}
+
+/* assigns dense ids to packed keys in order of first appearance */
+typedef struct {
+  uint64_t *slot_key;           /* two words per slot */
+  int *slot_id;                 /* -1: empty */
+  uint64_t *key;                /* VLA, two words per id */
+  int mask, n_id;
+} AtomSortTable;
+
+static int AtomSortTableInit(AtomSortTable * T, int size)
+{
+  int a;
+  T->mask = size - 1;
+  T->n_id = 0;
+  T->slot_key = Alloc(uint64_t, 2 * size);
+  T->slot_id = Alloc(int, size);
+  T->key = VLAlloc(uint64_t, 2 * 1024);
+  if(!(T->slot_key && T->slot_id && T->key))
+    return false;
+  for(a = 0; a < size; a++)
+    T->slot_id[a] = -1;
+  return true;
+}
+
+static void AtomSortTableFree(AtomSortTable * T)
+{
+  FreeP(T->slot_key);
+  FreeP(T->slot_id);
+  VLAFreeP(T->key);
+}
+
+static int AtomSortTableGetID(AtomSortTable * T, uint64_t k0, uint64_t k1)
+{
+  uint64_t h = (k0 * 0x9E3779B97F4A7C15ULL) ^ (k1 * 0xC2B2AE3D27D4EB4FULL);
+  int a = (int) (h >> 40) & T->mask;
+  int id;
+
+  while((id = T->slot_id[a]) >= 0) {
+    if(T->slot_key[2 * a] == k0 && T->slot_key[2 * a + 1] == k1)
+      return id;
+    a = (a + 1) & T->mask;
+  }
+
+  if(2 * (T->n_id + 1) > T->mask + 1) {       /* keep the table half empty */
+    AtomSortTable U;
+    int b;
+    if(!AtomSortTableInit(&U, 2 * (T->mask + 1))) {
+      AtomSortTableFree(&U);
+      return -1;
+    }
+    VLAFreeP(U.key);
+    U.key = T->key;
+    U.n_id = T->n_id;
+    T->key = NULL;
+    for(b = 0; b < U.n_id; b++) {
+      uint64_t *k = U.key + 2 * b;
+      uint64_t g = (k[0] * 0x9E3779B97F4A7C15ULL) ^ (k[1] * 0xC2B2AE3D27D4EB4FULL);
+      int c = (int) (g >> 40) & U.mask;
+      while(U.slot_id[c] >= 0)
+        c = (c + 1) & U.mask;
+      U.slot_key[2 * c] = k[0];
+      U.slot_key[2 * c + 1] = k[1];
+      U.slot_id[c] = b;
+    }
+    AtomSortTableFree(T);
+    *T = U;
+    return AtomSortTableGetID(T, k0, k1);
+  }
+
+  id = T->n_id++;
+  VLACheck(T->key, uint64_t, 2 * id + 1);
+  if(!T->key)
+    return -1;
+  T->key[2 * id] = k0;
+  T->key[2 * id + 1] = k1;
+  T->slot_key[2 * a] = k0;
+  T->slot_key[2 * a + 1] = k1;
+  T->slot_id[a] = id;
+  return id;
+}
+
+struct AtomSortKeyLess {
+  const uint64_t *key;
+  bool operator()(int id1, int id2) const {
+    const uint64_t *k1 = key + 2 * id1, *k2 = key + 2 * id2;
+    return (k1[0] < k2[0]) || ((k1[0] == k2[0]) && (k1[1] < k2[1]));
+  }
+};
+
+/* replaces the ids in col with the rank of their keys */
+static int AtomSortTableRank(AtomSortTable * T, int n, unsigned int *col)
+{
+  int a, rank = 0;
+  int *order = Alloc(int, T->n_id);
+  int *id_rank = Alloc(int, T->n_id);
+  int ok = (order && id_rank);
+
+  if(ok) {
+    AtomSortKeyLess less;
+    less.key = T->key;
+    for(a = 0; a < T->n_id; a++)
+      order[a] = a;
+    std::sort(order, order + T->n_id, less);
+    for(a = 0; a < T->n_id; a++) {
+      if(a && less(order[a - 1], order[a]))
+        rank++;
+      id_rank[order[a]] = rank;
+    }
+    for(a = 0; a < n; a++)
+      col[a] = id_rank[col[a]];
+  }
+  FreeP(order);
+  FreeP(id_rank);
+  return ok;
+}
+
+enum {
+  cAtomSortSegi, cAtomSortChain, cAtomSortHet, cAtomSortResv,
+  cAtomSortResiLen, cAtomSortResiRank, cAtomSortResi, cAtomSortResn,
+  cAtomSortState, cAtomSortPriority, cAtomSortAlt, cAtomSortNameBase,
+  cAtomSortName, cAtomSortRank
+};
+
+#define AtomSortSigned(v) (((unsigned int) (v)) ^ 0x80000000U)
+
+/* packed key of a word field */
+static uint64_t AtomInfoGetSortWord(AtomInfoType * at, int field)
+{
+  switch (field) {
+  case cAtomSortSegi:
+    return AtomInfoPackWord(at->segi, cSegiLen, false);
+  case cAtomSortResi:
+    return AtomInfoPackWord(at->resi, cResiLen, true);
+  case cAtomSortResn:
+    return AtomInfoPackWord(at->resn, cResnLen, true);
+  case cAtomSortNameBase:      /* see AtomInfoNameCompare */
+    if((at->name[0] >= '0') && (at->name[0] <= '9'))
+      return AtomInfoPackWord(at->name + 1, cAtomNameLen, true);
+    return AtomInfoPackWord(at->name, cAtomNameLen, true);
+  case cAtomSortName:
+    return AtomInfoPackWord(at->name, cAtomNameLen, true);
+  }
+  return 0;
+}
+
+/* dense ids of a word field, in order of first appearance */
+static int AtomInfoGetSortWordIDs(AtomInfoType * ai, int n, int field,
+                                  unsigned int *col, AtomSortTable * T)
+{
+  int a, id = -1, ok = AtomSortTableInit(T, 1024);
+  uint64_t word, last = 0;
+  for(a = 0; ok && a < n; a++) {
+    word = AtomInfoGetSortWord(ai + a, field);
+    if(id < 0 || word != last) {   /* neighbors usually share residue fields */
+      ok = ((id = AtomSortTableGetID(T, word, 0)) >= 0);
+      last = word;
+    }
+    col[a] = id;
+  }
+  return ok;
+}
+
+/* residues with the same resv but different resi are ordered by the
+   lowest atom rank of each residue (see rank_assisted_sorts) */
+static int AtomInfoGetSortResiRank(AtomInfoType * ai, int n, int het,
+                                   unsigned int *col)
+{
+  AtomSortTable T, S, R;
+  unsigned int *resi = Alloc(unsigned int, n);
+  int *min_rank = NULL;
+  int a, id, ok = (resi != NULL);
+
+  T.slot_key = S.slot_key = R.slot_key = NULL;
+  T.slot_id = S.slot_id = R.slot_id = NULL;
+  T.key = S.key = R.key = NULL;
+
+  ok = ok && AtomInfoGetSortWordIDs(ai, n, cAtomSortSegi, col, &S);
+  ok = ok && AtomInfoGetSortWordIDs(ai, n, cAtomSortResi, resi, &R);
+  ok = ok && AtomSortTableInit(&T, 1024);
+  for(a = 0; ok && a < n; a++) {
+    AtomInfoType *at = ai + a;
+    uint64_t k0 = ((uint64_t) col[a] << 32) | (unsigned int) at->chain;
+    uint64_t k1 = ((uint64_t) (unsigned int) at->resv << 32) |
+      ((uint64_t) resi[a] << 1) | (het && at->hetatm);
+    ok = ((id = AtomSortTableGetID(&T, k0, k1)) >= 0);
+    col[a] = id;
+  }
+  if(ok)
+    ok = ((min_rank = Alloc(int, T.n_id)) != NULL);
+  if(ok) {
+    for(a = 0; a < T.n_id; a++)
+      min_rank[a] = INT_MAX;
+    for(a = 0; a < n; a++)
+      if(ai[a].rank < min_rank[col[a]])
+        min_rank[col[a]] = ai[a].rank;
+    for(a = 0; a < n; a++)
+      col[a] = AtomSortSigned(min_rank[col[a]]);
+  }
+  FreeP(min_rank);
+  FreeP(resi);
+  AtomSortTableFree(&T);
+  AtomSortTableFree(&S);
+  AtomSortTableFree(&R);
+  return ok;
+}
+
+/* fills col with the (order preserving) key of one field for every atom */
+static int AtomInfoGetSortField(PyMOLGlobals * G, AtomInfoType * ai, int n,
+                                int field, int het, unsigned int *col)
+{
+  AtomSortTable T;
+  int a, ok;
+
+  switch (field) {
+  case cAtomSortChain:
+    for(a = 0; a < n; a++)
+      col[a] = AtomSortSigned(ai[a].chain);
+    return true;
+  case cAtomSortHet:
+    for(a = 0; a < n; a++)
+      col[a] = ai[a].hetatm;
+    return true;
+  case cAtomSortResv:
+    for(a = 0; a < n; a++)
+      col[a] = AtomSortSigned(ai[a].resv);
+    return true;
+  case cAtomSortResiLen:       /* residue 188A before 188, etc. */
+    for(a = 0; a < n; a++)
+      col[a] = cResiLen - strlen(ai[a].resi);
+    return true;
+  case cAtomSortState:
+    for(a = 0; a < n; a++)
+      col[a] = AtomSortSigned(ai[a].discrete_state);
+    return true;
+  case cAtomSortPriority:
+    for(a = 0; a < n; a++)
+      col[a] = AtomSortSigned(ai[a].priority);
+    return true;
+  case cAtomSortAlt:           /* blank alt goes last */
+    for(a = 0; a < n; a++)
+      col[a] = ai[a].alt[0] ? ((int) ai[a].alt[0] - CHAR_MIN) : 256;
+    return true;
+  case cAtomSortRank:
+    for(a = 0; a < n; a++)
+      col[a] = AtomSortSigned(ai[a].rank);
+    return true;
+  case cAtomSortResiRank:
+    return AtomInfoGetSortResiRank(ai, n, het, col);
+  }
+
+  T.slot_key = NULL;
+  T.slot_id = NULL;
+  T.key = NULL;
+  ok = AtomInfoGetSortWordIDs(ai, n, field, col, &T) &&
+    AtomSortTableRank(&T, n, col);
+  AtomSortTableFree(&T);
+  return ok;
+}
+
+/* true if resi is just resv written out, without an insertion code */
+static int AtomInfoResiIsResv(AtomInfoType * at)
+{
+  const char *p = at->resi;
+  int v = 0, neg = false;
+  if(*p == '-') {
+    neg = true;
+    p++;
+  }
+  if(!*p || (p[0] == '0' && (p[1] || neg)))
+    return false;
+  for(; *p; p++) {
+    if(*p < '0' || *p > '9')
+      return false;
+    v = v * 10 + (*p - '0');
+  }
+  return (neg ? -v : v) == at->resv;
+}
+
+int AtomInfoSortIndex(PyMOLGlobals * G, AtomInfoType * ai, int n, int order, int *index)
+{
+  int field[16];
+  int n_field = 0;
+  int a, b, ok = true;
+  int plain_resi = true;
+  int rank_assisted = false;
+  unsigned int *col;
+
+  /* without insertion codes, resi never breaks a tie of resv */
+  for(a = 0; plain_resi && a < n; a++)
+    plain_resi = AtomInfoResiIsResv(ai + a);
+
+  /* from the most to the least significant field */
+  if(order == cAtomInfoOrder_Rank)
+    field[n_field++] = cAtomSortRank;
+  field[n_field++] = cAtomSortSegi;
+  field[n_field++] = cAtomSortChain;
+  if(order != cAtomInfoOrder_IgnoreHet)
+    field[n_field++] = cAtomSortHet;
+  field[n_field++] = cAtomSortResv;
+  if(!plain_resi) {
+    if(SettingGetGlobal_b(G, cSetting_pdb_insertions_go_first))
+      field[n_field++] = cAtomSortResiLen;
+    else if((order != cAtomInfoOrder_Rank) &&   /* equal ranks can't assist */
+            SettingGetGlobal_b(G, cSetting_rank_assisted_sorts)) {
+      field[n_field++] = cAtomSortResiRank;
+      rank_assisted = true;
+    }
+    field[n_field++] = cAtomSortResi;
+  }
+  field[n_field++] = cAtomSortResn;
+  field[n_field++] = cAtomSortState;
+  field[n_field++] = cAtomSortPriority;
+  field[n_field++] = cAtomSortAlt;
+  field[n_field++] = cAtomSortNameBase;
+  field[n_field++] = cAtomSortName;
+  field[n_field++] = cAtomSortRank;
+
+  ok_assert(1, col = Alloc(unsigned int, n));
+
+  for(a = 0; a < n; a++)
+    index[a] = a;
+
+  for(a = n_field - 1; ok && a >= 0; a--) {
+    ok = AtomInfoGetSortField(G, ai, n, field[a], order != cAtomInfoOrder_IgnoreHet, col) &&
+      UtilRadixSortIndex(G, n, col, index);
+  }
+
+  /* rank_assisted_sorts compares atoms of residues which share resv but
+     not resi by their own ranks.  That's the same as ordering the
+     residues by their lowest rank only if the ranks of such residues
+     don't interleave, otherwise leave it to the comparison sort.  These
+     residues are neighbors here, each one a contiguous run of atoms */
+  for(a = 0; ok && rank_assisted && a < n; a = b) {
+    AtomInfoType *at0 = ai + index[a];
+    int prev_max = INT_MIN, res_max = INT_MIN;
+    for(b = a; b < n; b++) {
+      AtomInfoType *at = ai + index[b];
+      if(at->resv != at0->resv || at->chain != at0->chain ||
+         (order != cAtomInfoOrder_IgnoreHet && at->hetatm != at0->hetatm) ||
+         WordCompare(G, at->segi, at0->segi, false))
+        break;
+      if(b > a && WordCompare(G, at->resi, ai[index[b - 1]].resi, true)) {
+        /* next residue: all of its ranks must exceed the earlier ones */
+        if(res_max > prev_max)
+          prev_max = res_max;
+        res_max = INT_MIN;
+      }
+      if(at->rank <= prev_max) {
+        ok = false;
+        break;
+      }
+      if(at->rank > res_max)
+        res_max = at->rank;
+    }
+  }
+
+  FreeP(col);
+  return ok;
+
+ok_except1:
+  return false;
+}
+
 int AtomInfoNameOrder(PyMOLGlobals * G, AtomInfoType * at1, AtomInfoType * at2)
 {
   int result;
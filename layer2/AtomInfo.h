@@ -355,6 +355,14 @@ int AtomInfoCompareIgnoreRank(PyMOLGlobals * G, AtomInfoType * at1, AtomInfoType
 int AtomInfoCompareIgnoreHet(PyMOLGlobals * G, AtomInfoType * at1, AtomInfoType * at2);
 int AtomInfoCompareIgnoreRankHet(PyMOLGlobals * G, AtomInfoType * at1,
                                  AtomInfoType * at2);
+
+/* AtomInfoSortIndex orders */
+#define cAtomInfoOrder_IgnoreHet 0      /* AtomInfoCompareIgnoreHet */
+#define cAtomInfoOrder_Het       1      /* AtomInfoCompare */
+#define cAtomInfoOrder_Rank      2      /* rank first, then AtomInfoCompare */
+
+/* same order as the comparison functions, but radix sorted on packed keys */
+int AtomInfoSortIndex(PyMOLGlobals * G, AtomInfoType * ai, int n, int order, int *index);
 float AtomInfoGetBondLength(PyMOLGlobals * G, AtomInfoType * ai1, AtomInfoType * ai2);
 int AtomInfoSameResidue(PyMOLGlobals * G, AtomInfoType * at1, AtomInfoType * at2);
 int AtomInfoSameResidueP(PyMOLGlobals * G, AtomInfoType * at1, AtomInfoType * at2);
@@ -17,6 +17,7 @@
 #include "CifFile.h"
 #include "File.h"
 #include "MemoryDebug.h"
+#include "TaskPool.h"
 
 // basic IO and string handling
 
@@ -171,7 +172,7 @@ const cif_array * cif_data::get_opt(const char * key, const char * alias1, const
 }
 
 // constructor
-cif_file::cif_file(const char* filename, const char* contents_) {
+cif_file::cif_file(const char* filename, const char* contents_, PyMOLGlobals * G) {
   if (contents_) {
     contents = mstrdup(contents_);
   } else {
@@ -181,7 +182,7 @@ cif_file::cif_file(const char* filename, const char* contents_) {
   }
 
   if (contents)
-    parse();
+    parse(G);
 }
 
 // destructor
@@ -205,20 +206,30 @@ cif_data::~cif_data() {
     delete *it;
 }
 
-// parse CIF contents
-bool cif_file::parse() {
-  char *p = contents;
-  char quote;
-  char prev = '\0';
+// tokenizer output: token start, position of the terminating null which
+// still needs to be written (NULL if none) and token code ('Q' or 'R')
+struct cif_token_t {
+  const char * start;
+  const char * nul;
+  char code;
+};
 
-  std::vector<char> codes;
+/*
+ * Tokenize from p (with prev being the previously consumed character)
+ * until the first token which starts at or after stop. Tokens may extend
+ * beyond stop. Doesn't modify the buffer. Returns where it stopped and
+ * updates prev.
+ */
+static const char * cif_scan(const char * p, const char * stop, char &prev,
+    std::vector<cif_token_t> &tokens) {
+  char quote;
+  cif_token_t token;
 
-  // tokenize
   while (true) {
-    while (iswhitespace(*p))
+    while (p < stop && iswhitespace(*p))
       prev = *(p++);
 
-    if (!*p)
+    if (!*p || p >= stop)
       break;
 
     if (*p == '#') {
@@ -226,29 +237,126 @@ bool cif_file::parse() {
       prev = *p;
     } else if (isquote(*p)) { // will NULL the closing quote
       quote = *p;
-      codes.push_back('Q');
-      tokens.push_back(p + 1);
+      token.code = 'Q';
+      token.start = p + 1;
       while (*++p && !(*p == quote && iswhitespace0(p[1])));
+      token.nul = NULL;
       if (*p)
-        *(p++) = 0;
+        token.nul = p++;
       prev = *p;
+      tokens.push_back(token);
     } else if (*p == ';' && islinefeed(prev)) { // will NULL the line feed before the closing semicolon
-      codes.push_back('Q');
-      tokens.push_back(p + 1);
+      token.code = 'Q';
+      token.start = p + 1;
       while (*++p && !(islinefeed(*p) && p[1] == ';'));
+      token.nul = NULL;
       if (*p) {
-        *p = 0;
+        token.nul = p;
         p += 2;
       }
       prev = ';';
+      tokens.push_back(token);
     } else { // will null the whitespace
-      codes.push_back('R');
-      tokens.push_back(p);
+      token.code = 'R';
+      token.start = p;
       while (!iswhitespace0(*p)) ++p;
       prev = *p;
+      token.nul = NULL;
       if (*p)
-        *(p++) = 0;
+        token.nul = p++;
+      tokens.push_back(token);
+    }
+  }
+
+  return p;
+}
+
+// minimum chunk size for parallel tokenization
+#define CIF_CHUNK_MIN (1 << 20)
+
+/*
+ * Line aligned piece of the file which gets tokenized speculatively,
+ * assuming that it doesn't start inside of a multi-line token.
+ */
+struct cif_chunk_t {
+  const char * begin;
+  const char * end;
+  const char * stop;    // where the scan stopped (>= end)
+  char prev;            // prev at stop
+  std::vector<cif_token_t> tokens;
+};
+
+static void cif_scan_task(void * ctx, int index) {
+  cif_chunk_t * chunk = ((cif_chunk_t *) ctx) + index;
+  chunk->prev = index ? '\n' : '\0';
+  chunk->stop = cif_scan(chunk->begin, chunk->end, chunk->prev, chunk->tokens);
+}
+
+// parse CIF contents
+bool cif_file::parse(PyMOLGlobals * G) {
+  const char *p = contents;
+  char prev = '\0';
+  size_t len = strlen(contents);
+  int n_chunk = 1;
+
+  std::vector<char> codes;
+
+  if (G && len >= 2 * CIF_CHUNK_MIN) {
+    n_chunk = 4 * TaskPoolGetNThread(G);
+    if (n_chunk > (int) (len / CIF_CHUNK_MIN))
+      n_chunk = (int) (len / CIF_CHUNK_MIN);
+  }
+
+  // split into chunks at line boundaries
+  std::vector<cif_chunk_t> chunks(n_chunk);
+  for (int i = 0; i < n_chunk; i++) {
+    const char * begin = contents + len;
+    if (i == 0) {
+      begin = contents;
+    } else if ((begin = strchr(contents + (len / n_chunk) * i, '\n'))) {
+      begin++;
+      if (begin < chunks[i - 1].begin)
+        begin = chunks[i - 1].begin;
+    } else {
+      begin = contents + len;
     }
+    chunks[i].begin = begin;
+    if (i)
+      chunks[i - 1].end = begin;
+  }
+  chunks[n_chunk - 1].end = contents + len;
+
+  // tokenize (phase 1): all chunks in parallel
+  if (n_chunk > 1)
+    TaskPoolRun(G, 0, n_chunk, cif_scan_task, &chunks[0]);
+
+  // tokenize (phase 2): in order, re-scan chunks whose speculative start
+  // state was wrong (e.g. a text field spanning the chunk boundary), then
+  // null-terminate the tokens. Output is identical to a serial scan.
+  for (int i = 0; i < n_chunk; i++) {
+    cif_chunk_t &chunk = chunks[i];
+
+    if (n_chunk == 1 || p != chunk.begin || prev != (i ? '\n' : '\0')) {
+      chunk.tokens.clear();
+      p = cif_scan(p, chunk.end, prev, chunk.tokens);
+    } else {
+      p = chunk.stop;
+      prev = chunk.prev;
+    }
+
+    tokens.reserve(tokens.size() + chunk.tokens.size());
+    codes.reserve(tokens.capacity());
+
+    for (std::vector<cif_token_t>::iterator it = chunk.tokens.begin(),
+        it_end = chunk.tokens.end(); it != it_end; ++it) {
+      codes.push_back(it->code);
+      tokens.push_back((char *) it->start);
+      if (it->nul)
+        *((char *) it->nul) = 0;
+    }
+
+    // free memory early
+    std::vector<cif_token_t>().swap(chunk.tokens);
   }
 
   cif_data *current_data = NULL, *current_frame = NULL, *global_block = NULL;
@@ -13,6 +13,8 @@
 
 #include <string.h>
 
+#include "PyMOLGlobals.h"
+
 #ifdef WIN32
   #define strcasecmp(s1, s2) _stricmp(s1, s2)
   #define strncasecmp(s1, s2, n) _strnicmp(s1, s2, n)
@@ -47,7 +49,8 @@ public:
   m_str_cifdatap_t datablocks;
 
   // constructors & destructor
-  cif_file(const char* filename, const char* contents=NULL);
+  // (with G, large files are tokenized in parallel on the task pool)
+  cif_file(const char* filename, const char* contents=NULL, PyMOLGlobals * G=NULL);
   ~cif_file();
 
 private:
@@ -56,7 +59,7 @@ private:
   std::vector<char*> tokens;
 
   // methods
-  bool parse();
+  bool parse(PyMOLGlobals * G);
 };
 
 /*
@@ -32,6 +32,7 @@
 #include "CifBondDict.h"
 #include "Util2.h"
 #include "Vector.h"
+#include "TaskPool.h"
 
 // dictionary content types
 enum CifDataType {
@@ -906,6 +907,60 @@ public:
   }
 };
 
+/*
+ * Numeric loop column, converted up front: out[i] = arr->as_d(i, d) * scale
+ * (or arr->as_i(i, d) for integer columns)
+ */
+struct cif_column_t {
+  const cif_array * arr;
+  double d;
+  double scale;
+  float * out_f;
+  int * out_i;
+};
+
+#define CIF_CONVERT_BLOCK 16384
+
+struct cif_convert_t {
+  std::vector<cif_column_t> columns;
+  int nrows;
+  int nblocks;
+
+  cif_convert_t(int nrows_) : nrows(nrows_) {
+    nblocks = (nrows + CIF_CONVERT_BLOCK - 1) / CIF_CONVERT_BLOCK;
+  }
+
+  void add(const cif_array * arr, float * out, double d = 0.0, double scale = 1.0) {
+    cif_column_t col = {arr, d, scale, out, NULL};
+    columns.push_back(col);
+  }
+
+  void add(const cif_array * arr, int * out, int d = 0) {
+    cif_column_t col = {arr, (double) d, 1.0, NULL, out};
+    columns.push_back(col);
+  }
+
+  // one task per column block
+  static void task(void * ctx, int index) {
+    const cif_convert_t * I = (const cif_convert_t *) ctx;
+    const cif_column_t &col = I->columns[index / I->nblocks];
+    int start = (index % I->nblocks) * CIF_CONVERT_BLOCK;
+    int stop = std::min(start + CIF_CONVERT_BLOCK, I->nrows);
+
+    if (col.out_i) {
+      for (int i = start; i < stop; ++i)
+        col.out_i[i] = col.arr->as_i(i, (int) col.d);
+    } else {
+      for (int i = start; i < stop; ++i)
+        col.out_f[i] = col.arr->as_d(i, col.d) * col.scale;
+    }
+  }
+
+  void run(PyMOLGlobals * G) {
+    TaskPoolRun(G, 0, columns.size() * nblocks, task, this);
+  }
+};
+
 /*
  * Read ATOM_SITE
  *
@@ -989,10 +1044,28 @@ static CoordSet ** read_atom_site(PyMOLGlobals * G, cif_data * data,
   CoordSet * cset;
   int mod_num, ncsets = 0;
 
+  // convert the numeric columns (multithreaded)
+  std::vector<float> col_x(nrows), col_y(nrows), col_z(nrows), col_b(nrows), col_q(nrows);
+  std::vector<int> col_id(nrows), col_mod_num(nrows);
+  if (nrows > 0) {
+    cif_convert_t convert(nrows);
+    convert.add(arr_x, &col_x[0]);
+    convert.add(arr_y, &col_y[0]);
+    convert.add(arr_z, &col_z[0]);
+    if (arr_u != NULL)
+      convert.add(arr_u, &col_b[0], 0.0, 78.95683520871486); // B = U * 8 * pi^2
+    else
+      convert.add(arr_b, &col_b[0]);
+    convert.add(arr_q, &col_q[0], 1.0);
+    convert.add(arr_ID, &col_id[0]);
+    convert.add(arr_mod_num, &col_mod_num[0], 1);
+    convert.run(G);
+  }
+
   // collect number of atoms per model and number of coord sets
   std::map<int, int> atoms_per_model;
   for (int i = 0, n = nrows; i < n; i++) {
-    mod_num = model_to_state(arr_mod_num->as_i(i, 1));
+    mod_num = model_to_state(col_mod_num[i]);
 
     if (mod_num < 1) {
       PRINTFB(G, FB_ObjectMolecule, FB_Errors)
@@ -1023,15 +1096,15 @@ static CoordSet ** read_atom_site(PyMOLGlobals * G, cif_data * data,
     if (info.is_excluded_chain(segi))
       continue;
 
-    mod_num = model_to_state(arr_mod_num->as_i(i, 1));
+    mod_num = model_to_state(col_mod_num[i]);
 
     // copy coordinates into coord set
     cset = csets[mod_num - 1];
     int idx = cset->NIndex++;
     float * coord = cset->coordPtr(idx);
-    coord[0] = arr_x->as_d(i);
-    coord[1] = arr_y->as_d(i);
-    coord[2] = arr_z->as_d(i);
+    coord[0] = col_x[i];
+    coord[1] = col_y[i];
+    coord[2] = col_z[i];
 
     if (!discrete && ncsets > 1) {
       // mm_atom_site_label aggregate
@@ -1063,11 +1136,9 @@ static CoordSet ** read_atom_site(PyMOLGlobals * G, cif_data * data,
     ai->rank = atomCount;
     ai->alt[0] = arr_alt->as_s(i)[0];
 
-    ai->id = arr_ID->as_i(i);
-    ai->b = (arr_u != NULL) ?
-             arr_u->as_d(i) * 78.95683520871486 : // B = U * 8 * pi^2
-             arr_b->as_d(i);
-    ai->q = arr_q->as_d(i, 1.0);
+    ai->id = col_id[i];
+    ai->b = col_b[i];
+    ai->q = col_q[i];
 
     strncpy(ai->name, arr_name->as_s(i), cAtomNameLen);
     strncpy(ai->resn, arr_resn->as_s(i), cResnLen);
@@ -2107,9 +2178,9 @@ ObjectMolecule *ObjectMoleculeReadCifStr(PyMOLGlobals * G, ObjectMolecule * I,
 
   const char * filename = NULL;
 #ifndef _PYMOL_NO_CXX11
-  auto cif = std::make_shared<cif_file>(filename, st);
+  auto cif = std::make_shared<cif_file>(filename, st, G);
 #else
-  cif_file _cif_stack(filename, st);
+  cif_file _cif_stack(filename, st, G);
   auto cif = &_cif_stack;
 #endif
 
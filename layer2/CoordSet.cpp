@@ -49,6 +49,8 @@ Z* -------------------------------------------------------------------
 
 #include"PyMOLGlobals.h"
 #include"PyMOLObject.h"
+#include"Executive.h"
+#include"PyMOL.h"
 
 
 /*========================================================================*/
@@ -175,6 +177,142 @@ int CoordSetFromPyList(PyMOLGlobals * G, PyObject * list, CoordSet ** cs)
 #endif
 }
 
+#ifdef _PYMOL_NUMPY
+/*
+ * Shared between a coordinate set and the NumPy arrays which alias its
+ * Coord VLA. All fields are guarded by the GIL, since the arrays may be
+ * released from any Python thread while the API lock is held elsewhere.
+ */
+struct CoordSetView {
+  PyMOLGlobals *G;
+  CoordSet *cs;                 /* NULL once detached */
+  float *orphan;                /* Coord VLA handed over on detach */
+  int n_array;                  /* live arrays */
+  int released;                 /* an array went away since the last sync */
+};
+
+/*
+ * PyCObject destructor, runs with the GIL held
+ */
+static void CoordSetViewRelease(void *ptr)
+{
+  CoordSetView *view = (CoordSetView *) ptr;
+  view->n_array--;
+  if(view->cs) {
+    /* reps get invalidated on the next scene update (needs the API lock) */
+    view->released = true;
+    view->G->P_inst->coord_view_released = true;
+    PyMOL_NeedRedisplay(view->G->PyMOL);
+  } else if(!view->n_array) {
+    VLAFreeP(view->orphan);
+    FreeP(view);
+  }
+}
+#endif
+
+/*
+ * Called before Coord gets freed (keep=false), or reallocated or compacted
+ * (keep=true). Live arrays take ownership of the current buffer, so they
+ * stay valid but no longer alias the coordinate set.
+ */
+void CoordSetViewDetach(CoordSet * I, bool keep)
+{
+#ifdef _PYMOL_NUMPY
+  CoordSetView *view = I->View;
+  if(view) {
+    PyMOLGlobals *G = I->State.G;
+    int blocked = PAutoBlock(G);
+    I->View = NULL;
+    if(view->n_array) {
+      view->cs = NULL;
+      view->orphan = I->Coord;
+      I->Coord = keep ? VLACopy2(view->orphan) : NULL;
+    } else {
+      FreeP(view);
+    }
+    PAutoUnblock(G, blocked);
+  }
+#endif
+}
+
+/*
+ * Invalidate the representations of all coordinate sets which had a view
+ * released since the last call. Requires the API lock.
+ */
+void CoordSetViewSync(PyMOLGlobals * G)
+{
+#ifdef _PYMOL_NUMPY
+  ObjectMolecule *obj = NULL;
+  void *hidden = NULL;
+  int blocked = PAutoBlock(G);
+  G->P_inst->coord_view_released = false;
+  while(ExecutiveIterateObjectMolecule(G, &obj, &hidden)) {
+    for(int a = 0; a < obj->NCSet; a++) {
+      CoordSet *cs = obj->CSet[a];
+      if(!cs || !cs->View || !cs->View->released)
+        continue;
+      cs->View->released = false;
+      if(!cs->View->n_array)
+        FreeP(cs->View);
+      cs->invalidateRep(cRepAll, cRepInvRep);
+    }
+  }
+  PAutoUnblock(G, blocked);
+#endif
+}
+
+/*
+ * Writable numpy array of count coordinates starting at index offset,
+ * aliasing I->Coord. The array pins the coordinate set memory: if the
+ * coordinate set gets resized or freed first, the array keeps the old
+ * buffer. Releasing the array invalidates the representations.
+ */
+PyObject *CoordSetAsNumPyView(CoordSet * I, int offset, int count)
+{
+#ifndef _PYMOL_NUMPY
+  PRINTFB(I->State.G, FB_CoordSet, FB_Errors)
+    "No numpy support\n" ENDFB(I->State.G);
+  return NULL;
+#else
+
+  PyMOLGlobals *G = I->State.G;
+  PyObject *result, *base;
+  npy_intp dims[2] = {count, 3};
+
+  import_array1(NULL);
+
+  if(offset < 0 || count < 0 || offset + count > I->NIndex)
+    return NULL;
+
+  if(!I->View) {
+    CoordSetView *view = Calloc(CoordSetView, 1);
+    if(!view)
+      return NULL;
+    view->G = G;
+    view->cs = I;
+    I->View = view;
+  }
+
+  result = PyArray_SimpleNewFromData(2, dims, NPY_FLOAT32, I->Coord + offset * 3);
+  if(!result)
+    return NULL;
+
+  if(!(base = PyCObject_FromVoidPtr(I->View, CoordSetViewRelease))) {
+    Py_DECREF(result);
+    return NULL;
+  }
+
+  /* steals the reference to base */
+  if(PyArray_SetBaseObject((PyArrayObject *) result, base) < 0) {
+    Py_DECREF(result);
+    return NULL;
+  }
+
+  I->View->n_array++;
+  return result;
+#endif
+}
+
 /*
  * Coord set as numpy array
  */
@@ -209,7 +347,7 @@ PyObject *CoordSetAsNumPyArray(CoordSet * cs, short copy)
     if((result = PyArray_SimpleNew(2, dims, typenum)))
       memcpy(PyArray_DATA((PyArrayObject *)result), cs->Coord, cs->NIndex * 3 * base_size);
   } else {
-    result = PyArray_SimpleNewFromData(2, dims, typenum, cs->Coord);
+    result = CoordSetAsNumPyView(cs, 0, cs->NIndex);
   }
 
   return result;
@@ -283,6 +421,17 @@ void CoordSetAdjustAtmIdx(CoordSet * I, int *lookup, int nAtom)
 }
 
 
+/*========================================================================*/
+static unsigned int CoordSetGenerationCounter = 0;
+
+static void CoordSetNewGeneration(CoordSet * I)
+{
+  if(!++CoordSetGenerationCounter)
+    ++CoordSetGenerationCounter;        /* 0 means no coordinate set */
+  I->Generation = CoordSetGenerationCounter;
+}
+
+
 /*========================================================================*/
 int CoordSetMerge(ObjectMolecule *OM, CoordSet * I, CoordSet * cs)
 {                               /* must be non-overlapping */
@@ -293,8 +442,10 @@ int CoordSetMerge(ObjectMolecule *OM, CoordSet * I, CoordSet * cs)
   nIndex = I->NIndex + cs->NIndex;
   VLASize(I->IdxToAtm, int, nIndex);
   CHECKOK(ok, I->IdxToAtm);
-  if (ok)
+  if (ok) {
+    CoordSetViewDetach(I, true);
     VLACheck(I->Coord, float, nIndex * 3);
+  }
   CHECKOK(ok, I->Coord);
   if (ok){
     for(a = 0; a < cs->NIndex; a++) {
@@ -338,6 +489,7 @@ int CoordSetMerge(ObjectMolecule *OM, CoordSet * I, CoordSet * cs)
     I->invalidateRep(cRepAll, cRepInvAll);
   }
   I->NIndex = nIndex;
+  CoordSetNewGeneration(I);
 
   return ok;
 }
@@ -360,6 +512,17 @@ void CoordSetPurge(CoordSet * I)
   PRINTFD(I->State.G, FB_CoordSet)
     " CoordSetPurge-Debug: entering..." ENDFD;
 
+  if(I->View) {
+    /* arrays keep the coordinates they were given, so hand them the
+       buffer before it gets compacted */
+    for(a = 0; a < I->NIndex; a++) {
+      if(obj->AtomInfo[I->IdxToAtm[a]].deleteFlag) {
+        CoordSetViewDetach(I, true);
+        break;
+      }
+    }
+  }
+
   c0 = c1 = I->Coord;
   r0 = r1 = I->RefPos;
   l0 = l1 = I->LabPos;
@@ -422,6 +585,7 @@ void CoordSetPurge(CoordSet * I)
     PRINTFD(I->State.G, FB_CoordSet)
       " CoordSetPurge-Debug: I->IdxToAtm shrunk to %d\n", I->NIndex ENDFD;
     I->invalidateRep(cRepAll, cRepInvAtoms);      /* this will free Color */
+    CoordSetNewGeneration(I);
   }
   PRINTFD(I->State.G, FB_CoordSet)
     " CoordSetPurge-Debug: leaving NAtIndex %d NIndex %d...\n",
@@ -1561,6 +1725,7 @@ CoordSet *CoordSetNew(PyMOLGlobals * G)
   I->SpheroidSphereSize = I->State.G->Sphere->Sphere[1]->nDot;  /* does this make any sense? */
 
   I->noInvalidateMMStereoAndTextType = 0;
+  CoordSetNewGeneration(I);
   return (I);
 }
 
@@ -1591,6 +1756,7 @@ CoordSet *CoordSetCopy(const CoordSet * cs)
   I->RefPos     = VLACopy2(cs->RefPos);
   I->AtmToIdx   = VLACopy2(cs->AtmToIdx);
   I->IdxToAtm   = VLACopy2(cs->IdxToAtm);
+  I->View       = NULL;
 
   UtilZeroMem(I->Rep, sizeof(::Rep *) * cRepCnt);
 
@@ -1598,6 +1764,7 @@ CoordSet *CoordSetCopy(const CoordSet * cs)
   I->Spheroid = NULL;
   I->SpheroidNormal = NULL;
   I->Coord2Idx = NULL;
+  CoordSetNewGeneration(I);
   return (I);
 }
 
@@ -1643,6 +1810,7 @@ int CoordSet::extendIndices(int nAtom)
       }
     }
   }
+  CoordSetNewGeneration(I);
   return ok;
 }
 
@@ -1679,6 +1847,7 @@ void CoordSet::appendIndices(int offset)
     }
   }
   I->NAtIndex = I->NIndex + offset;
+  CoordSetNewGeneration(I);
 }
 
 
@@ -1699,6 +1868,7 @@ void CoordSet::enumIndices()
     }
   }
   I->NAtIndex = I->NIndex;
+  CoordSetNewGeneration(I);
 }
 
 
@@ -1722,6 +1892,7 @@ void CoordSet::fFree()
     VLAFreeP(I->AtmToIdx);
     VLAFreeP(I->IdxToAtm);
     MapFree(I->Coord2Idx);
+    CoordSetViewDetach(I, false);
     VLAFreeP(I->Coord);
     VLAFreeP(I->TmpBond);
     if(I->Symmetry)
@@ -105,6 +105,14 @@ typedef struct CoordSet {
   MapType *Coord2Idx;
   float Coord2IdxReq, Coord2IdxDiv;
 
+  /* not saved, NumPy arrays aliasing Coord (see CoordSetAsNumPyView) */
+  struct CoordSetView *View;
+
+  /* not saved, unique to this coordinate set and renewed whenever its
+     atom indices change, so that caches can tell it from a set which
+     merely reuses its address */
+  unsigned int Generation;
+
   /* temporary / optimization */
 
   int objMolOpInvalidated;
@@ -121,6 +129,9 @@ int BondInOrder(BondType * a, int b1, int b2);
 int BondCompare(BondType * a, BondType * b);
 
 PyObject *CoordSetAsNumPyArray(CoordSet * cs, short copy);
+PyObject *CoordSetAsNumPyView(CoordSet * cs, int offset, int count);
+void CoordSetViewDetach(CoordSet * I, bool keep);
+void CoordSetViewSync(PyMOLGlobals * G);
 PyObject *CoordSetAsPyList(CoordSet * I);
 int CoordSetFromPyList(PyMOLGlobals * G, PyObject * list, CoordSet ** cs);
 
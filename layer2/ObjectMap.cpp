@@ -1025,6 +1025,7 @@ int ObjectMapDouble(ObjectMap * I, int state)
       " ObjectMap-Error: invalidate state.\n" ENDFB(I->Obj.G);
     result = false;
   }
+  ObjectMapUpdateExtents(I);
   return (result);
 }
 
@@ -1357,7 +1358,7 @@ static PyObject *ObjectMapStateAsPyList(ObjectMapState * I)
   PyList_SetItem(result, 12, PConvIntArrayToPyList(I->Max, 3));
   PyList_SetItem(result, 13, PConvIntArrayToPyList(I->FDim, 4));
 
-  PyList_SetItem(result, 14, IsosurfAsPyList(I->Field));
+  PyList_SetItem(result, 14, IsosurfAsPyList(I->State.G, I->Field));
   PyList_SetItem(result, 15, ObjectStateAsPyList(&I->State));
   return (PConvAutoNone(result));
 }
@@ -1701,6 +1702,8 @@ void ObjectMapUpdateExtents(ObjectMap * I)
   for(a = 0; a < I->NState; a++) {
     ObjectMapState *ms = I->State + a;
     if(ms->Active) {
+      if(ms->Field)
+        IsofieldUpdateBlocks(I->Obj.G, ms->Field);
       if(I->State[a].State.Matrix) {
         transform44d3f(ms->State.Matrix, ms->ExtentMin, tr_min);
         transform44d3f(ms->State.Matrix, ms->ExtentMax, tr_max);
@@ -1761,6 +1764,7 @@ void ObjectMapStateClamp(ObjectMapState * I, float clamp_floor, float clamp_ceil
         else if(*fp > clamp_ceiling)
           *fp = clamp_ceiling;
       }
+  IsofieldInvalidate(I->Field);
 }
 
 int ObjectMapStateSetBorder(ObjectMapState * I, float level)
@@ -1788,6 +1792,7 @@ int ObjectMapStateSetBorder(ObjectMapState * I, float level)
       F3(I->Field->data, a, 0, c) = level;
       F3(I->Field->data, a, b, c) = level;
     }
+  IsofieldInvalidate(I->Field);
   return (result);
 }
 
@@ -5372,6 +5377,7 @@ int ObjectMapSetBorder(ObjectMap * I, float level, int state)
         result = result && ObjectMapStateSetBorder(&I->State[a], level);
     }
   }
+  ObjectMapUpdateExtents(I);
   return (result);
 }
 
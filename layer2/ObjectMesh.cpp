@@ -76,7 +76,7 @@ static PyObject *ObjectMeshStateAsPyList(ObjectMeshState * I)
   PyList_SetItem(result, 14, PyFloat_FromDouble(I->AltLevel));
   PyList_SetItem(result, 15, PyInt_FromLong(I->quiet));
   if(I->Field) {
-    PyList_SetItem(result, 16, IsosurfAsPyList(I->Field));
+    PyList_SetItem(result, 16, IsosurfAsPyList(I->State.G, I->Field));
   } else {
     PyList_SetItem(result, 16, PConvAutoNone(NULL));
   }
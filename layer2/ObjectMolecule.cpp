@@ -47,6 +47,7 @@ Z* -------------------------------------------------------------------
 #include"P.h"
 #include"PConv.h"
 #include"Executive.h"
+#include"PlugIOManager.h"
 #include"Setting.h"
 #include"Sphere.h"
 #include"main.h"
@@ -60,6 +61,8 @@ Z* -------------------------------------------------------------------
 #include"OVLexicon.h"
 #include"ListMacros.h"
 #include"File.h"
+#include"TaskPool.h"
+#include"AtomExpr.h"
 
 #define cMaxNegResi 100
 
@@ -401,11 +404,12 @@ int ObjectMoleculeSetMatrix(ObjectMolecule * I, int state, double *matrix)
     /* nonsensical  -- or should set the TTT if state<0 */
     ok = false;
   } else {
-    CoordSet *cs = I->CSet[state];
+    CoordSet *cs = ObjectMoleculeGetCoordSet(I, state);
     if(!cs)
       ok = false;
     else {
       ObjectStateSetMatrix(&cs->State, matrix);
+      PlugIOManagerTrajStreamSetDirty(I, state);
     }
   }
   return ok;
@@ -714,10 +718,13 @@ void ObjectMoleculeTransformState44f(ObjectMolecule * I, int state, float *matri
         if(cs)
           ObjectStateLeftCombineMatrixR44d(&cs->State, dbl_matrix);
       }
+      PlugIOManagerTrajStreamSetDirty(I, -1);
     } else if(state < I->NCSet) {       /* single state */
-      cs = I->CSet[(I->CurCSet = state % I->NCSet)];
-      if(cs)
+      cs = ObjectMoleculeGetCoordSet(I, (I->CurCSet = state % I->NCSet));
+      if(cs) {
         ObjectStateLeftCombineMatrixR44d(&cs->State, dbl_matrix);
+        PlugIOManagerTrajStreamSetDirty(I, I->CurCSet);
+      }
     } else if(I->NCSet == 1) {  /* static singleton state */
       cs = I->CSet[0];
       if(cs && SettingGet_b(I->Obj.G, I->Obj.Setting, NULL, cSetting_static_singletons)) {
@@ -972,6 +979,7 @@ ObjectMolecule *ObjectMoleculeLoadTRJFile(PyMOLGlobals * G, ObjectMolecule * I,
 
       cs->NIndex = c;
       VLASize(cs->IdxToAtm, int, cs->NIndex + 1);
+      CoordSetViewDetach(cs, true);
       VLASize(cs->Coord, float, cs->NIndex * 3);
     }
     PRINTFB(G, FB_ObjectMolecule, FB_Blather)
@@ -2468,6 +2476,8 @@ float ObjectMoleculeSculptIterate(ObjectMolecule * I, int state, int n_cycle,
   PRINTFD(I->Obj.G, FB_ObjectMolecule)
     " ObjectMoleculeIterateSculpt: entered.\n" ENDFD;
   if(I->Sculpt) {
+    if(I->TrajStream && n_cycle)
+      PlugIOManagerTrajStreamSetDirty(I, state);
     return SculptIterateObject(I->Sculpt, I, state, n_cycle, center);
   } else
     return 0.0F;
@@ -5087,6 +5097,7 @@ void ObjectMoleculeUndo(ObjectMolecule * I, int dir)
     if(cs) {
       if(cs->NIndex == I->UndoNIndex[I->UndoIter]) {
         memcpy(cs->Coord, I->UndoCoord[I->UndoIter], sizeof(float) * cs->NIndex * 3);
+        PlugIOManagerTrajStreamSetDirty(I, state);
         I->UndoState[I->UndoIter] = -1;
         FreeP(I->UndoCoord[I->UndoIter]);
         cs->invalidateRep(cRepAll, cRepInvCoord);
@@ -7116,7 +7127,7 @@ int ObjectMoleculeTransformSelection(ObjectMolecule * I, int state,
         break;
     }
     if(state < I->NCSet) {
-      cs = I->CSet[state];
+      cs = ObjectMoleculeGetCoordSet(I, state);
       if(cs) {
         int use_matrices = SettingGet_i(G, I->Obj.Setting,
                                         NULL, cSetting_matrix_mode);
@@ -7200,6 +7211,7 @@ int ObjectMoleculeTransformSelection(ObjectMolecule * I, int state,
           }
         }
         if(flag) {
+          PlugIOManagerTrajStreamSetDirty(I, state);
           cs->invalidateRep(cRepAll, cRepInvCoord);
           ExecutiveUpdateCoordDepends(G, I);
         }
@@ -9570,6 +9582,63 @@ ObjectMolecule *ObjectMoleculeReadStr(PyMOLGlobals * G, ObjectMolecule * I,
 
 
 /*========================================================================*/
+/*
+ * Flags the indices of cs whose atoms are new to the object (>= oldNAtom)
+ * or differ in position from the first existing coordinate set.  Returns
+ * NULL when no reference is available or every atom would be flagged.
+ */
+static char *ObjectMoleculeGetConnectSearch(ObjectMolecule * I, CoordSet * cs,
+                                            int oldNAtom)
+{
+  CoordSet *ref = NULL;
+  char *search;
+  int a, n_search = 0;
+
+  for(a = 0; a < I->NCSet; a++) {
+    if(I->CSet[a] && (I->CSet[a] != cs)) {
+      ref = I->CSet[a];
+      break;
+    }
+  }
+  if(!ref || !ref->AtmToIdx)
+    return NULL;
+  search = Alloc(char, cs->NIndex);
+  if(!search)
+    return NULL;
+  for(a = 0; a < cs->NIndex; a++) {
+    int atm = cs->IdxToAtm[a];
+    int idx = -1;
+    if((atm < oldNAtom) && (atm < ref->NAtIndex))
+      idx = ref->AtmToIdx[atm];
+    search[a] = (idx < 0) ||
+      (diffsq3f(cs->Coord + 3 * a, ref->Coord + 3 * idx) > R_SMALL8);
+    if(search[a])
+      n_search++;
+  }
+  if(n_search == cs->NIndex)
+    FreeP(search);
+  return search;
+}
+
+/* bisects a list of bonds sorted by BondInOrder, returns -1 if not present */
+static int ObjectMoleculeFindSortedBond(const BondType * bond, int n_bond,
+                                        int index0, int index1)
+{
+  int lo = 0, hi = n_bond;
+  while(lo < hi) {
+    int mid = (lo + hi) >> 1;
+    const BondType *bd = bond + mid;
+    if(bd->index[0] == index0 && bd->index[1] == index1)
+      return mid;
+    if((bd->index[0] < index0) ||
+       ((bd->index[0] == index0) && (bd->index[1] < index1)))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return -1;
+}
+
 typedef int CompareFn(PyMOLGlobals *, AtomInfoType *, AtomInfoType *);
 int ObjectMoleculeMerge(ObjectMolecule * I, AtomInfoType * ai,
 			CoordSet * cs, int bondSearchFlag, int aic_mask, int invalidate)
@@ -9770,14 +9839,20 @@ int ObjectMoleculeMerge(ObjectMolecule * I, AtomInfoType * ai,
 
   /* now find and integrate and any new bonds */
   if(ok && expansionFlag) {           /* expansion flag means we have introduced at least 1 new atom */
-    ok &= ObjectMoleculeConnect(I, &nBond, &bond, I->AtomInfo, cs, bondSearchFlag, -1);
+    char *search = NULL;
+    /* existing atoms which haven't moved keep the bonds they already have */
+    if(bondSearchFlag && oldNAtom && !I->DiscreteFlag &&
+       SettingGetGlobal_b(G, cSetting_connect_incremental))
+      search = ObjectMoleculeGetConnectSearch(I, cs, oldNAtom);
+    ok &= ObjectMoleculeConnect(I, &nBond, &bond, I->AtomInfo, cs, bondSearchFlag, -1,
+                                search);
     if(nBond) {
       index = Alloc(int, nBond);
       CHECKOK(ok, index);
       c = 0;
       b = 0;
       nb = 0;
-      if (ok){
+      if(ok && !search) {
 	for(a = 0; a < nBond; a++) {      /* iterate over new bonds */
 	  found = false;
 	  if(!I->DiscreteFlag) {  /* don't even try matching for discrete objects */
@@ -9815,6 +9890,24 @@ int ObjectMoleculeMerge(ObjectMolecule * I, AtomInfoType * ai,
 	  }
 	}
       }
+      if(ok && search) {
+        /* only a few new bonds: make one pass over the existing bonds,
+           bisecting the sorted list of new ones (I->Bond needn't be sorted) */
+        for(a = 0; a < nBond; a++)
+          index[a] = -1;
+        for(b = 0; b < I->NBond; b++) {
+          a = ObjectMoleculeFindSortedBond(bond, nBond,
+                                           I->Bond[b].index[0], I->Bond[b].index[1]);
+          if(a < 0)
+            a = ObjectMoleculeFindSortedBond(bond, nBond,
+                                             I->Bond[b].index[1], I->Bond[b].index[0]);
+          if((a >= 0) && (index[a] < 0))
+            index[a] = b;
+        }
+        for(a = 0; a < nBond; a++)
+          if(index[a] < 0)
+            index[a] = I->NBond + (c++);
+      }
       /* first, reassign atom info for matched atoms */
       if(c) {
         /* allocate additional space */
@@ -9837,6 +9930,7 @@ int ObjectMoleculeMerge(ObjectMolecule * I, AtomInfoType * ai,
       FreeP(index);
     }
     VLAFreeP(bond);
+    FreeP(search);
   }
   if(invalidate) {
     if(oldNAtom) {
@@ -9898,9 +9992,11 @@ void ObjectMoleculeAppendAtoms(ObjectMolecule * I, AtomInfoType * atInfo, CoordS
 /*========================================================================*/
 CoordSet *ObjectMoleculeGetCoordSet(ObjectMolecule * I, int setIndex)
 {
-  if((setIndex >= 0) && (setIndex < I->NCSet))
+  if((setIndex >= 0) && (setIndex < I->NCSet)) {
+    if(!I->CSet[setIndex] && I->TrajStream)
+      return PlugIOManagerTrajStreamGet(I, setIndex);
     return (I->CSet[setIndex]);
-  else
+  } else
     return (NULL);
 }
 
@@ -9914,6 +10010,7 @@ void ObjectMoleculeTransformTTTf(ObjectMolecule * I, float *ttt, int frame)
     if((frame < 0) || (frame == b)) {
       cs = I->CSet[b];
       if(cs) {
+        PlugIOManagerTrajStreamSetDirty(I, b);
         cs->invalidateRep(cRepAll, cRepInvCoord);
         MatrixTransformTTTfN3f(cs->NIndex, cs->Coord, ttt, cs->Coord);
         CoordSetRecordTxfApplied(cs, ttt, false);
@@ -9923,6 +10020,77 @@ void ObjectMoleculeTransformTTTf(ObjectMolecule * I, float *ttt, int frame)
 }
 
 
+#ifndef _PYMOL_NOPY
+/*========================================================================*/
+static CAtomExpr *ObjectMoleculeCompileNative(ObjectMolecule * I, ObjectMoleculeOpRec * op)
+{
+  int mode = 0;
+  if(op->code == OMOP_AlterState) {
+    mode = cAtomExprState;
+    if(op->i3)
+      mode |= cAtomExprReadOnly;
+    if(!op->i4)
+      mode |= cAtomExprNoAtom;
+  } else if(op->i2) {
+    mode = cAtomExprReadOnly;
+  }
+  return AtomExprCompile(I->Obj.G, op->s1, mode, op->py_ob1);
+}
+
+
+/*========================================================================*/
+/* alter, iterate or alter_state with a natively compiled expression.
+   Returns false (nothing evaluated) if the expression has to be run
+   through Python after all. */
+static int ObjectMoleculeAlterNative(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op,
+                                     CAtomExpr * expr, int *hit_flag)
+{
+  PyMOLGlobals *G = I->Obj.G;
+  AtomExprTarget *target;
+  AtomInfoType *ai = I->AtomInfo;
+  CoordSet *cs = NULL;
+  int a, a1, n = 0, state = 0, ok = true;
+
+  if(op->code == OMOP_AlterState) {
+    state = op->i2;
+    if(!(cs = ObjectMoleculeGetCoordSet(I, state)))
+      return true;
+  }
+  target = Alloc(AtomExprTarget, I->NAtom + 1);
+  if(!target)
+    return false;
+  for(a = 0; a < I->NAtom; a++, ai++) {
+    if(!SelectorIsMember(G, ai->selEntry, sele))
+      continue;
+    target[n].ai = ai;
+    target[n].v = NULL;
+    target[n].index = a;
+    if(cs) {
+      if(I->DiscreteFlag)
+        a1 = (cs == I->DiscreteCSet[a]) ? I->DiscreteAtmToIdx[a] : -1;
+      else
+        a1 = cs->AtmToIdx[a];
+      if(a1 < 0)
+        continue;
+      if(!op->i4)
+        target[n].ai = NULL;
+      target[n].v = cs->Coord + 3 * a1;
+    }
+    n++;
+  }
+  if(n)
+    ok = AtomExprEval(G, expr, I->Obj.Name, state, n, target);
+  if(ok) {
+    op->i1 += n;
+    if(cs && n)
+      *hit_flag = true;
+  }
+  FreeP(target);
+  return ok;
+}
+#endif
+
+
 /*========================================================================*/
 void ObjectMoleculeSeleOp(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op)
 {
@@ -9945,6 +10113,7 @@ void ObjectMoleculeSeleOp(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op
   PyMOLGlobals *G = I->Obj.G;
 #ifndef _PYMOL_NOPY
   PyCodeObject *expr_co = NULL;
+  CAtomExpr *native_expr = NULL;
   int compileType = Py_single_input;
 #endif
   PRINTFD(G, FB_ObjectMolecule)
@@ -9971,7 +10140,10 @@ void ObjectMoleculeSeleOp(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op
 	  if(PyErr_Occurred())
 	    PyErr_Print();
 	  ok = ErrMessage(G, errstr, "failed to compile expression");
-	}
+	} else if(op->code != OMOP_LABL &&
+                  SettingGetGlobal_b(G, cSetting_alter_native)) {
+          native_expr = ObjectMoleculeCompileNative(I, op);
+        }
 #else
 	  ok = ErrMessage(G, errstr, "failed to compile expression");
 #endif
@@ -10250,7 +10422,7 @@ void ObjectMoleculeSeleOp(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op
           vt1 = vt;             /* reset target vertex pointers */
           vt2 = op->vv2;
           t_i = 0;              /* original target vertex index */
-          if(I->CSet[b] && (b != op->i2)) {
+          if((b != op->i2) && ObjectMoleculeGetCoordSet(I, b)) {
             op->nvv1 = 0;
             for(a = 0; a < I->NAtom; a++) {
               s = I->AtomInfo[a].selEntry;
@@ -10303,6 +10475,7 @@ void ObjectMoleculeSeleOp(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op
                 rms = MatrixGetRMS(G, op->nvv1, op->vv1, vt, NULL);
               if(op->i1 == 2) {
                 ObjectMoleculeTransformTTTf(I, op->ttt, b);
+                PlugIOManagerTrajStreamSetDirty(I, b);
 
                 if(op->i3) {
                   const float divisor = (float) op->i3;
@@ -10355,6 +10528,9 @@ void ObjectMoleculeSeleOp(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op
           }
           VLACheck(op->f1VLA, float, b);
           op->f1VLA[b] = rms;
+          /* done with state b (the target was copied), so streamed
+             states may be dropped again */
+          PlugIOManagerTrajStreamTrim(I, -1);
         }
         VLASize(op->f1VLA, float, I->NCSet);    /* NOTE this action is object-specific! */
       }
@@ -10853,6 +11029,13 @@ void ObjectMoleculeSeleOp(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op
         op->i1 = op_i1;
       }
       break;
+    case OMOP_ALTR:
+    case OMOP_AlterState:
+#ifndef _PYMOL_NOPY
+      if(ok && native_expr && ObjectMoleculeAlterNative(I, sele, op, native_expr, &hit_flag))
+        break;
+#endif
+      /* otherwise evaluate the expression atom by atom in Python */
     default:
       {
         int inv_flag;
@@ -11033,7 +11216,7 @@ void ObjectMoleculeSeleOp(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op
               case OMOP_AlterState:
                 if(ok) {
                   if(op->i2 < I->NCSet) {
-                    cs = I->CSet[op->i2];
+                    cs = ObjectMoleculeGetCoordSet(I, op->i2);
                     if(cs) {
                       if(I->DiscreteFlag) {
                         if(cs == I->DiscreteCSet[a])
@@ -11280,6 +11463,8 @@ void ObjectMoleculeSeleOp(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op
             for(b = 0; b < I->NCSet; b++) {
               if(I->DiscreteFlag) {
                 cs = I->DiscreteCSet[a];
+              } else if(op->code == OMOP_SVRT && b == op->i1) {
+                cs = ObjectMoleculeGetCoordSet(I, b);
               } else {
                 cs = I->CSet[b];
               }
@@ -11499,11 +11684,15 @@ void ObjectMoleculeSeleOp(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op
         break;
       case OMOP_AlterState:    /* overly coarse - doing all states, could do just 1 */
         if(!op->i3) {           /* not read_only? */
+          PlugIOManagerTrajStreamSetDirty(I, op->i2);
           ObjectMoleculeInvalidate(I, -1, cRepInvRep, -1);
           SceneChanged(G);
         }
         break;
       case OMOP_CSetIdxSetFlagged:
+        if(I->TrajStream)
+          for(b = op->cs1; b <= op->cs2; b++)
+            PlugIOManagerTrajStreamSetDirty(I, b);
         ObjectMoleculeInvalidate(I, -1, cRepInvRep, -1);
         SceneChanged(G);
         break;
@@ -11560,7 +11749,12 @@ void ObjectMoleculeSeleOp(ObjectMolecule * I, int sele, ObjectMoleculeOpRec * op
     case OMOP_ALTR:
     case OMOP_AlterState:
       Py_XDECREF(expr_co);
+#ifndef _PYMOL_NOPY
+      AtomExprFree(native_expr);
+#endif
       PUnblock(G);
+      if(op->code == OMOP_AlterState)
+        PlugIOManagerTrajStreamTrim(I, -1);     /* done with state op->i2 */
       break;
     }
     /* */
@@ -11665,7 +11859,11 @@ void CoordSetUpdateThread(CCoordSetUpdateThreadInfo * T)
   }
 }
 
-#ifndef _PYMOL_NOPY
+static void ObjMolCoordSetUpdateTask(void *ctx, int index)
+{
+  CoordSetUpdateThread(((CCoordSetUpdateThreadInfo *) ctx) + index);
+}
+
 static void ObjMolCoordSetUpdateSpawn(PyMOLGlobals * G,
                                       CCoordSetUpdateThreadInfo * Thread, int n_thread,
                                       int n_total)
@@ -11673,25 +11871,11 @@ static void ObjMolCoordSetUpdateSpawn(PyMOLGlobals * G,
   if(n_total == 1) {
     CoordSetUpdateThread(Thread);
   } else if(n_total) {
-    int blocked;
-    PyObject *info_list;
-    int a, n = 0;
-    blocked = PAutoBlock(G);
-
     PRINTFB(G, FB_Scene, FB_Blather)
       " Scene: updating coordinate sets with %d threads...\n", n_thread ENDFB(G);
-    info_list = PyList_New(n_total);
-    for(a = 0; a < n_total; a++) {
-      PyList_SetItem(info_list, a, PyCObject_FromVoidPtr(Thread + a, NULL));
-      n++;
-    }
-    PXDecRef(PYOBJECT_CALLMETHOD
-             (G->P_inst->cmd, "_coordset_update_spawn", "Oi", info_list, n_thread));
-    Py_DECREF(info_list);
-    PAutoUnblock(G, blocked);
+    TaskPoolRun(G, n_thread, n_total, ObjMolCoordSetUpdateTask, Thread);
   }
 }
-#endif
 
 
 /*========================================================================*/
@@ -11719,6 +11903,13 @@ static void ObjectMoleculeUpdate(ObjectMolecule * I)
     }
     I->RepVisCacheValid = true;
   }
+  if(I->TrajStream) {
+    /* streamed trajectory: only keep a bounded number of states decoded,
+       and make sure the current one is */
+    int state = ObjectGetCurrentState(&I->Obj, false);
+    PlugIOManagerTrajStreamTrim(I, state);
+    ObjectMoleculeGetCoordSet(I, state);
+  }
   {
     /* determine the start/stop states */
     int start = 0;
@@ -11735,7 +11926,6 @@ static void ObjectMoleculeUpdate(ObjectMolecule * I)
 
     /* single and multithreaded coord set updates */
     {
-#ifndef _PYMOL_NOPY
       int n_thread = SettingGetGlobal_i(G, cSetting_max_threads);
       int multithread = SettingGetGlobal_i(G, cSetting_async_builds);
 
@@ -11767,7 +11957,6 @@ static void ObjectMoleculeUpdate(ObjectMolecule * I)
         }
 
       } else
-#endif
       {                         /* single thread */
         for(a = start; a < stop; a++) {
           if((a<I->NCSet) && I->CSet[a] && (!G->Interrupt)) {
@@ -11925,11 +12114,13 @@ int ObjectMoleculeMoveAtom(ObjectMolecule * I, int state, int index, float *v, i
     if(I->NCSet == 1)
       state = 0;
     state = state % I->NCSet;
-    if((!I->CSet[state]) && (SettingGet_b(G, I->Obj.Setting, NULL, cSetting_all_states)))
+    if((!ObjectMoleculeGetCoordSet(I, state))
+       && (SettingGet_b(G, I->Obj.Setting, NULL, cSetting_all_states)))
       state = 0;
     cs = I->CSet[state];
     if(cs) {
       result = CoordSetMoveAtom(I->CSet[state], index, v, mode);
+      PlugIOManagerTrajStreamSetDirty(I, state);
       cs->invalidateRep(cRepAll, cRepInvCoord);
       ExecutiveUpdateCoordDepends(G, I);
     }
@@ -11959,12 +12150,13 @@ int ObjectMoleculeMoveAtomLabel(ObjectMolecule * I, int state, int index, float
     if(I->NCSet == 1)
       state = 0;
     state = state % I->NCSet;
-    if((!I->CSet[state])
+    if((!ObjectMoleculeGetCoordSet(I, state))
        && (SettingGet_b(I->Obj.G, I->Obj.Setting, NULL, cSetting_all_states)))
       state = 0;
     cs = I->CSet[state];
     if(cs) {
       result = CoordSetMoveAtomLabel(I->CSet[state], index, v, mode);
+      PlugIOManagerTrajStreamSetDirty(I, state);
       cs->invalidateRep(cRepLabel, cRepInvCoord);
     }
   }
@@ -12229,11 +12421,13 @@ int ObjectMoleculeSetAtomVertex(ObjectMolecule * I, int state, int index, float
   if(I->NCSet == 1)
     state = 0;
   state = state % I->NCSet;
-  if((!I->CSet[state])
+  if((!ObjectMoleculeGetCoordSet(I, state))
      && (SettingGet_b(I->Obj.G, I->Obj.Setting, NULL, cSetting_all_states)))
     state = 0;
-  if(I->CSet[state])
+  if(I->CSet[state]) {
     result = CoordSetSetAtomVertex(I->CSet[state], index, v);
+    PlugIOManagerTrajStreamSetDirty(I, state);
+  }
   return (result);
 }
 
@@ -12599,6 +12793,7 @@ void ObjectMoleculeFree(ObjectMolecule * I)
     SculptFree(I->Sculpt);
   if(I->CSTmpl)
     I->CSTmpl->fFree();
+  PlugIOManagerTrajStreamFree(I);
   ObjectPurge(&I->Obj);
   OOFreeP(I);
 }
@@ -13162,15 +13357,25 @@ int *AtomInfoGetSortedIndex(PyMOLGlobals * G, ObjectMolecule * obj,
     for(a = 0; a < n; a++)
       index[a] = a;
   } else {
+    int order;
+
     if(obj)
       setting = obj->Obj.Setting;
 
-    UtilSortIndexGlobals(G, n, rec, index, (UtilOrderFnGlobals *) (
-        SettingGet_b(G, setting, NULL, cSetting_retain_order) ?
-          AtomInfoInOrigOrder :
-        SettingGet_b(G, setting, NULL, cSetting_pdb_hetatm_sort) ?
-          AtomInfoInOrder :
-          AtomInfoInOrderIgnoreHet));
+    order = SettingGet_b(G, setting, NULL, cSetting_retain_order) ?
+      cAtomInfoOrder_Rank :
+      SettingGet_b(G, setting, NULL, cSetting_pdb_hetatm_sort) ?
+      cAtomInfoOrder_Het : cAtomInfoOrder_IgnoreHet;
+
+    if(!SettingGetGlobal_b(G, cSetting_sort_radix) ||
+       !AtomInfoSortIndex(G, rec, n, order, index)) {
+      UtilSortIndexGlobals(G, n, rec, index, (UtilOrderFnGlobals *) (
+          (order == cAtomInfoOrder_Rank) ?
+            AtomInfoInOrigOrder :
+          (order == cAtomInfoOrder_Het) ?
+            AtomInfoInOrder :
+            AtomInfoInOrderIgnoreHet));
+    }
   }
 
   for(a = 0; a < n; a++)
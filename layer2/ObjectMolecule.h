@@ -56,6 +56,7 @@ typedef struct ObjectMolecule {
 	/* number of coordinate sets */
   int NCSet;
   struct CoordSet *CSTmpl;      /* template for trajectories, etc. */
+  struct _CTrajStream *TrajStream;      /* states decoded on demand from a trajectory file */
 	/* array of bonds */
   BondType *Bond;
 	/* array of atoms (infos) */
@@ -475,7 +476,8 @@ int ***ObjectMoleculeGetBondPrint(ObjectMolecule * I, int max_bond, int max_type
                                   int *dim);
 
 int ObjectMoleculeConnect(ObjectMolecule * I, int *nbond, BondType ** bond, AtomInfoType * ai,
-                          struct CoordSet *cs, int searchFlag, int connectModeOverride);
+                          struct CoordSet *cs, int searchFlag, int connectModeOverride,
+                          const char *search = NULL);
 int ObjectMoleculeSetDiscrete(PyMOLGlobals * G, ObjectMolecule * I, int discrete);
 
 float ObjectMoleculeGetMaxVDW(ObjectMolecule * I);
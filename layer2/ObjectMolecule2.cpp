@@ -36,9 +36,11 @@
 #include"Selector.h"
 #include"ObjectDist.h"
 #include"Executive.h"
+#include"PlugIOManager.h"
 #include"P.h"
 #include"ObjectCGO.h"
 #include"Scene.h"
+#include"ColumnBlock.h"
 
 #ifdef _PYMOL_IP_EXTRAS
 #include"AtomInfoHistory.h"
@@ -47,6 +49,8 @@
 
 #include <iostream>
 #include <map>
+#include <set>
+#include <vector>
 
 #ifdef _PYMOL_NO_CXX11
 #define STD_MOVE(x) (x)
@@ -3469,8 +3473,9 @@ static PyObject *ObjectMoleculeCSetAsPyList(ObjectMolecule * I)
   int a;
   result = PyList_New(I->NCSet);
   for(a = 0; a < I->NCSet; a++) {
-    if(I->CSet[a]) {
+    if(ObjectMoleculeGetCoordSet(I, a)) {
       PyList_SetItem(result, a, CoordSetAsPyList(I->CSet[a]));
+      PlugIOManagerTrajStreamTrim(I, -1);
     } else {
       PyList_SetItem(result, a, PConvAutoNone(Py_None));
     }
@@ -3507,6 +3512,311 @@ static int ObjectMoleculeCSetFromPyList(ObjectMolecule * I, PyObject * list)
   return (ok);
 }
 
+#ifndef _PYMOL_IP_EXTRAS
+
+/*
+ * Binary session data (pse_binary_dump): atoms and bonds are stored as
+ * one column block (see ColumnBlock.h) per object instead of as nested
+ * lists, with one column per field.
+ */
+static bool ObjectMoleculeDumpColumns(PyMOLGlobals * G)
+{
+  int pse_export_version = SettingGetGlobal_f(G, cSetting_pse_export_version) * 1000;
+  return SettingGetGlobal_b(G, cSetting_pse_binary_dump) &&
+    (!pse_export_version || pse_export_version >= 1800);
+}
+
+/* gather expr (with rec pointing to the current record) into a column */
+#define COLUMN_PUT(block, name, type, T, n, rec, base, expr) {          \
+    std::vector<T> col_(n ? n : 1);                                     \
+    for(int a_ = 0; a_ < n; a_++) {                                     \
+      rec = base + a_;                                                  \
+      col_[a_] = (T) (expr);                                            \
+    }                                                                   \
+    block.add(name, type, sizeof(T), n, &col_[0]);                      \
+  }
+
+/* gather a fixed width string field into a column */
+#define COLUMN_PUT_STR(block, name, n, rec, base, field) {              \
+    std::vector<char> col_((n ? n : 1) * sizeof(rec->field));           \
+    for(int a_ = 0; a_ < n; a_++) {                                     \
+      rec = base + a_;                                                  \
+      memcpy(&col_[a_ * sizeof(rec->field)], rec->field, sizeof(rec->field)); \
+    }                                                                   \
+    block.add(name, cColumnStr, sizeof(rec->field), n, &col_[0]);       \
+  }
+
+/* scatter a column (if present) into lvalue */
+#define COLUMN_GET(reader, name, type, T, n, rec, base, lvalue) {       \
+    const char *col_ = reader.get(name, type, sizeof(T), n);            \
+    if(col_) {                                                          \
+      T val_;                                                           \
+      for(int a_ = 0; a_ < n; a_++) {                                   \
+        rec = base + a_;                                                \
+        memcpy(&val_, col_ + a_ * sizeof(T), sizeof(T));                \
+        lvalue = val_;                                                  \
+      }                                                                 \
+    }                                                                   \
+  }
+
+/* scatter a fixed width string column (if present) into field */
+#define COLUMN_GET_STR(reader, name, n, rec, base, field) {             \
+    const char *col_ = reader.get(name, cColumnStr, sizeof(rec->field), n); \
+    if(col_) {                                                          \
+      for(int a_ = 0; a_ < n; a_++) {                                   \
+        rec = base + a_;                                                \
+        memcpy(rec->field, col_ + a_ * sizeof(rec->field), sizeof(rec->field)); \
+        rec->field[sizeof(rec->field) - 1] = 0;                         \
+      }                                                                 \
+    }                                                                   \
+  }
+
+static PyObject *ObjectMoleculeBondAsColumns(ObjectMolecule * I)
+{
+  ColumnBlockWriter block;
+  BondType *bond, *base = I->Bond;
+  int n = I->NBond;
+
+  COLUMN_PUT(block, "index0", cColumnInt, int, n, bond, base, bond->index[0]);
+  COLUMN_PUT(block, "index1", cColumnInt, int, n, bond, base, bond->index[1]);
+  COLUMN_PUT(block, "order", cColumnInt, signed char, n, bond, base, bond->order);
+  COLUMN_PUT(block, "id", cColumnInt, int, n, bond, base, bond->id);
+  COLUMN_PUT(block, "stereo", cColumnInt, signed char, n, bond, base, bond->stereo);
+  COLUMN_PUT(block, "unique_id", cColumnInt, int, n, bond, base, bond->unique_id);
+  COLUMN_PUT(block, "has_setting", cColumnUInt, unsigned char, n, bond, base, bond->has_setting);
+
+  return PyString_FromStringAndSize(block.str().data(), block.str().size());
+}
+
+static int ObjectMoleculeBondFromColumns(ObjectMolecule * I, PyObject * str)
+{
+  PyMOLGlobals *G = I->Obj.G;
+  ColumnBlockReader reader;
+  BondType *bond, *base;
+  int a, n = I->NBond;
+
+  if(!reader.init(PyString_AsString(str), PyString_Size(str)) ||
+     !reader.get("index0", cColumnInt, sizeof(int), n) ||
+     !reader.get("index1", cColumnInt, sizeof(int), n)) {
+    PRINTFB(G, FB_ObjectMolecule, FB_Errors)
+      " Error: invalid binary bond data\n" ENDFB(G);
+    return false;
+  }
+  if(!(I->Bond = VLACalloc(BondType, n)))
+    return false;
+  base = I->Bond;
+
+  COLUMN_GET(reader, "index0", cColumnInt, int, n, bond, base, bond->index[0]);
+  COLUMN_GET(reader, "index1", cColumnInt, int, n, bond, base, bond->index[1]);
+  COLUMN_GET(reader, "order", cColumnInt, signed char, n, bond, base, bond->order);
+  COLUMN_GET(reader, "id", cColumnInt, int, n, bond, base, bond->id);
+  COLUMN_GET(reader, "stereo", cColumnInt, signed char, n, bond, base, bond->stereo);
+  COLUMN_GET(reader, "unique_id", cColumnInt, int, n, bond, base, bond->unique_id);
+  COLUMN_GET(reader, "has_setting", cColumnUInt, unsigned char, n, bond, base, bond->has_setting);
+
+  for(a = 0; a < n; a++) {
+    bond = base + a;
+    if(bond->unique_id)         /* reserve existing IDs */
+      bond->unique_id = SettingUniqueConvertOldSessionID(G, bond->unique_id);
+  }
+  return true;
+}
+
+static PyObject *ObjectMoleculeAtomAsColumns(ObjectMolecule * I)
+{
+  PyMOLGlobals *G = I->Obj.G;
+  ColumnBlockWriter block;
+  AtomInfoType *ai, *base = I->AtomInfo;
+  int a, n = I->NAtom;
+  bool has_anisou = false;
+
+  COLUMN_PUT(block, "resv", cColumnInt, int, n, ai, base, ai->resv);
+  COLUMN_PUT(block, "chain", cColumnInt, int, n, ai, base, ai->chain);
+  COLUMN_PUT_STR(block, "alt", n, ai, base, alt);
+  COLUMN_PUT_STR(block, "resi", n, ai, base, resi);
+  COLUMN_PUT_STR(block, "segi", n, ai, base, segi);
+  COLUMN_PUT_STR(block, "resn", n, ai, base, resn);
+  COLUMN_PUT_STR(block, "name", n, ai, base, name);
+  COLUMN_PUT_STR(block, "elem", n, ai, base, elem);
+  COLUMN_PUT(block, "text_type", cColumnInt, int, n, ai, base, ai->textType);
+  COLUMN_PUT(block, "label", cColumnInt, int, n, ai, base, ai->label);
+  COLUMN_PUT_STR(block, "ss", n, ai, base, ssType);
+  COLUMN_PUT(block, "custom_type", cColumnInt, int, n, ai, base, ai->customType);
+  COLUMN_PUT(block, "priority", cColumnInt, int, n, ai, base, ai->priority);
+  COLUMN_PUT(block, "b", cColumnFloat, float, n, ai, base, ai->b);
+  COLUMN_PUT(block, "q", cColumnFloat, float, n, ai, base, ai->q);
+  COLUMN_PUT(block, "vdw", cColumnFloat, float, n, ai, base, ai->vdw);
+  COLUMN_PUT(block, "partial_charge", cColumnFloat, float, n, ai, base, ai->partialCharge);
+  COLUMN_PUT(block, "formal_charge", cColumnInt, signed char, n, ai, base, ai->formalCharge);
+  COLUMN_PUT(block, "hetatm", cColumnUInt, unsigned char, n, ai, base, ai->hetatm);
+  COLUMN_PUT(block, "vis_rep", cColumnInt, int, n, ai, base, ai->visRep);
+  COLUMN_PUT(block, "color", cColumnInt, int, n, ai, base, ai->color);
+  COLUMN_PUT(block, "id", cColumnInt, int, n, ai, base, ai->id);
+  COLUMN_PUT(block, "cartoon", cColumnInt, signed char, n, ai, base, ai->cartoon);
+  COLUMN_PUT(block, "flags", cColumnUInt, unsigned int, n, ai, base, ai->flags);
+  COLUMN_PUT(block, "bonded", cColumnUInt, unsigned char, n, ai, base, ai->bonded);
+  COLUMN_PUT(block, "chem_flag", cColumnUInt, unsigned char, n, ai, base, ai->chemFlag);
+  COLUMN_PUT(block, "geom", cColumnInt, signed char, n, ai, base, ai->geom);
+  COLUMN_PUT(block, "valence", cColumnInt, signed char, n, ai, base, ai->valence);
+  COLUMN_PUT(block, "masked", cColumnUInt, unsigned char, n, ai, base, ai->masked);
+  COLUMN_PUT(block, "protekted", cColumnUInt, unsigned char, n, ai, base, ai->protekted);
+  COLUMN_PUT(block, "protons", cColumnInt, signed char, n, ai, base, ai->protons);
+  COLUMN_PUT(block, "unique_id", cColumnInt, int, n, ai, base, ai->unique_id);
+  COLUMN_PUT(block, "stereo", cColumnUInt, unsigned char, n, ai, base, ai->stereo);
+  COLUMN_PUT(block, "discrete_state", cColumnInt, int, n, ai, base, ai->discrete_state);
+  COLUMN_PUT(block, "elec_radius", cColumnFloat, float, n, ai, base, ai->elec_radius);
+  COLUMN_PUT(block, "rank", cColumnInt, int, n, ai, base, ai->rank);
+  COLUMN_PUT(block, "hb_donor", cColumnUInt, unsigned char, n, ai, base, ai->hb_donor);
+  COLUMN_PUT(block, "hb_acceptor", cColumnUInt, unsigned char, n, ai, base, ai->hb_acceptor);
+  COLUMN_PUT(block, "has_setting", cColumnUInt, unsigned char, n, ai, base, ai->has_setting);
+  COLUMN_PUT(block, "custom", cColumnInt, int, n, ai, base, ai->custom);
+
+  /* anisotropic temperature factors, six values per atom, only if any */
+  for(a = 0; a < n && !has_anisou; a++)
+    has_anisou = base[a].has_anisou();
+  if(has_anisou) {
+    std::vector<float> col(n * 6, 0.0F);
+    for(a = 0; a < n; a++)
+      if(base[a].has_anisou())
+        memcpy(&col[a * 6], base[a].get_anisou(), 6 * sizeof(float));
+    block.add("anisou", cColumnFloat, sizeof(float), n * 6, &col[0]);
+  }
+
+  /* lexicon strings referenced by chain, text_type, label and custom */
+  {
+    std::set<int> lexIDs;
+    std::vector<int> ids;
+    std::string strs;
+    for(a = 0; a < n; a++) {
+      ai = base + a;
+      if (ai->textType) lexIDs.insert(ai->textType);
+      if (ai->chain) lexIDs.insert(ai->chain);
+      if (ai->label) lexIDs.insert(ai->label);
+      if (ai->custom) lexIDs.insert(ai->custom);
+    }
+    for (std::set<int>::iterator it = lexIDs.begin(); it != lexIDs.end(); ++it) {
+      const char *lexstr = LexStr(G, *it);
+      ids.push_back(*it);
+      strs.append(lexstr, strlen(lexstr) + 1);
+    }
+    block.add("lex_id", cColumnInt, sizeof(int), ids.size(), ids.empty() ? NULL : &ids[0]);
+    block.add("lex_str", cColumnBytes, 1, strs.size(), strs.data());
+  }
+
+  return PyString_FromStringAndSize(block.str().data(), block.str().size());
+}
+
+static int ObjectMoleculeAtomFromColumns(ObjectMolecule * I, PyObject * str)
+{
+  PyMOLGlobals *G = I->Obj.G;
+  ColumnBlockReader reader;
+  AtomInfoType *ai, *base;
+  int a, n = I->NAtom;
+  std::map<int, int> oldIDtoLexID;
+
+  if(!reader.init(PyString_AsString(str), PyString_Size(str))) {
+    PRINTFB(G, FB_ObjectMolecule, FB_Errors)
+      " Error: invalid binary atom data\n" ENDFB(G);
+    return false;
+  }
+
+  VLACheck(I->AtomInfo, AtomInfoType, n + 1);
+  if(!I->AtomInfo)
+    return false;
+  base = I->AtomInfo;
+  memset(base, 0, sizeof(AtomInfoType) * n);
+
+  COLUMN_GET(reader, "resv", cColumnInt, int, n, ai, base, ai->resv);
+  COLUMN_GET(reader, "chain", cColumnInt, int, n, ai, base, ai->chain);
+  COLUMN_GET_STR(reader, "alt", n, ai, base, alt);
+  COLUMN_GET_STR(reader, "resi", n, ai, base, resi);
+  COLUMN_GET_STR(reader, "segi", n, ai, base, segi);
+  COLUMN_GET_STR(reader, "resn", n, ai, base, resn);
+  COLUMN_GET_STR(reader, "name", n, ai, base, name);
+  COLUMN_GET_STR(reader, "elem", n, ai, base, elem);
+  COLUMN_GET(reader, "text_type", cColumnInt, int, n, ai, base, ai->textType);
+  COLUMN_GET(reader, "label", cColumnInt, int, n, ai, base, ai->label);
+  COLUMN_GET_STR(reader, "ss", n, ai, base, ssType);
+  COLUMN_GET(reader, "custom_type", cColumnInt, int, n, ai, base, ai->customType);
+  COLUMN_GET(reader, "priority", cColumnInt, int, n, ai, base, ai->priority);
+  COLUMN_GET(reader, "b", cColumnFloat, float, n, ai, base, ai->b);
+  COLUMN_GET(reader, "q", cColumnFloat, float, n, ai, base, ai->q);
+  COLUMN_GET(reader, "vdw", cColumnFloat, float, n, ai, base, ai->vdw);
+  COLUMN_GET(reader, "partial_charge", cColumnFloat, float, n, ai, base, ai->partialCharge);
+  COLUMN_GET(reader, "formal_charge", cColumnInt, signed char, n, ai, base, ai->formalCharge);
+  COLUMN_GET(reader, "hetatm", cColumnUInt, unsigned char, n, ai, base, ai->hetatm);
+  COLUMN_GET(reader, "vis_rep", cColumnInt, int, n, ai, base, ai->visRep);
+  COLUMN_GET(reader, "color", cColumnInt, int, n, ai, base, ai->color);
+  COLUMN_GET(reader, "id", cColumnInt, int, n, ai, base, ai->id);
+  COLUMN_GET(reader, "cartoon", cColumnInt, signed char, n, ai, base, ai->cartoon);
+  COLUMN_GET(reader, "flags", cColumnUInt, unsigned int, n, ai, base, ai->flags);
+  COLUMN_GET(reader, "bonded", cColumnUInt, unsigned char, n, ai, base, ai->bonded);
+  COLUMN_GET(reader, "chem_flag", cColumnUInt, unsigned char, n, ai, base, ai->chemFlag);
+  COLUMN_GET(reader, "geom", cColumnInt, signed char, n, ai, base, ai->geom);
+  COLUMN_GET(reader, "valence", cColumnInt, signed char, n, ai, base, ai->valence);
+  COLUMN_GET(reader, "masked", cColumnUInt, unsigned char, n, ai, base, ai->masked);
+  COLUMN_GET(reader, "protekted", cColumnUInt, unsigned char, n, ai, base, ai->protekted);
+  COLUMN_GET(reader, "protons", cColumnInt, signed char, n, ai, base, ai->protons);
+  COLUMN_GET(reader, "unique_id", cColumnInt, int, n, ai, base, ai->unique_id);
+  COLUMN_GET(reader, "stereo", cColumnUInt, unsigned char, n, ai, base, ai->stereo);
+  COLUMN_GET(reader, "discrete_state", cColumnInt, int, n, ai, base, ai->discrete_state);
+  COLUMN_GET(reader, "elec_radius", cColumnFloat, float, n, ai, base, ai->elec_radius);
+  COLUMN_GET(reader, "rank", cColumnInt, int, n, ai, base, ai->rank);
+  COLUMN_GET(reader, "hb_donor", cColumnUInt, unsigned char, n, ai, base, ai->hb_donor);
+  COLUMN_GET(reader, "hb_acceptor", cColumnUInt, unsigned char, n, ai, base, ai->hb_acceptor);
+  COLUMN_GET(reader, "has_setting", cColumnUInt, unsigned char, n, ai, base, ai->has_setting);
+  COLUMN_GET(reader, "custom", cColumnInt, int, n, ai, base, ai->custom);
+
+  {
+    const char *col = reader.get("anisou", cColumnFloat, sizeof(float), n * 6);
+    float u[6];
+    for(a = 0; col && a < n; a++) {
+      memcpy(u, col + a * 6 * sizeof(float), 6 * sizeof(float));
+      if(u[0] || u[1] || u[2] || u[3] || u[4] || u[5])
+        memcpy(base[a].get_anisou(), u, 6 * sizeof(float));
+    }
+  }
+
+  /* map session lexicon ids to ours */
+  {
+    size_t n_lex = 0, len = 0;
+    const char *ids = reader.get("lex_id", cColumnInt, sizeof(int), 0, &n_lex);
+    const char *strpl = reader.get("lex_str", cColumnBytes, 1, 0, &len);
+    const char *strend = strpl + len;
+    int oldidx;
+    for(size_t i = 0; ids && strpl && i < n_lex && strpl < strend; i++) {
+      memcpy(&oldidx, ids + i * sizeof(int), sizeof(int));
+      oldIDtoLexID[oldidx] = LexIdx(G, strpl); // increments ref count
+      strpl += strnlen(strpl, strend - strpl) + 1;
+    }
+  }
+
+  /* everything else that AtomInfoFromPyList does */
+  for(a = 0; a < n; a++) {
+    ai = base + a;
+    int *lexval[] = { &ai->chain, &ai->textType, &ai->label, &ai->custom };
+    for(int i = 0; i < 4; i++) {
+      if(*lexval[i]) {
+        *lexval[i] = oldIDtoLexID[*lexval[i]];
+        if(*lexval[i])
+          LexInc(G, *lexval[i]);
+      }
+    }
+    ai->color = ColorConvertOldSessionIndex(G, ai->color);
+    if(ai->unique_id)           /* reserve existing IDs */
+      ai->unique_id = SettingUniqueConvertOldSessionID(G, ai->unique_id);
+  }
+
+  // need to decrement since we call LexIdx() above on each
+  for (std::map<int, int>::iterator it = oldIDtoLexID.begin(); it != oldIDtoLexID.end(); ++it){
+    if (it->second)
+      LexDec(G, it->second);
+  }
+  return true;
+}
+
+#endif
+
 static PyObject *ObjectMoleculeBondAsPyList(ObjectMolecule * I)
 {
   PyObject *result = NULL;
@@ -3534,6 +3844,9 @@ static PyObject *ObjectMoleculeBondAsPyList(ObjectMolecule * I)
     }
     return result;
   }
+#else
+  if (ObjectMoleculeDumpColumns(I->Obj.G))
+    return ObjectMoleculeBondAsColumns(I);
 #endif
   result = PyList_New(I->NBond);
   bond = I->Bond;
@@ -3562,6 +3875,11 @@ static int ObjectMoleculeBondFromPyList(ObjectMolecule * I, PyObject * list)
   PyObject *bond_list = NULL;
   BondType *bond;
 
+#ifndef _PYMOL_IP_EXTRAS
+  if(list && PyString_Check(list))
+    return ObjectMoleculeBondFromColumns(I, list);
+#endif
+
   if(ok)
     ok = PyList_Check(list);
   if(ok)
@@ -3703,6 +4021,9 @@ static PyObject *ObjectMoleculeAtomAsPyList(ObjectMolecule * I)
     FreeP(strinfo);
     return result;
   }
+#else
+  if (ObjectMoleculeDumpColumns(G))
+    return ObjectMoleculeAtomAsColumns(I);
 #endif
   result = PyList_New(I->NAtom);
   ai = I->AtomInfo;
@@ -3726,6 +4047,11 @@ static int ObjectMoleculeAtomFromPyList(ObjectMolecule * I, PyObject * list)
   int a, ll;
   AtomInfoType *ai;
 
+#ifndef _PYMOL_IP_EXTRAS
+  if(list && PyString_Check(list))
+    return ObjectMoleculeAtomFromColumns(I, list);
+#endif
+
   if(ok)
     ok = PyList_Check(list);
   if (ok)
@@ -3961,17 +4287,24 @@ PyObject *ObjectMoleculeAsPyList(ObjectMolecule * I)
 
 
 /*========================================================================*/
+/*
+ * search: optional per-index flags (cs index space).  When provided,
+ * only pairs involving at least one flagged coordinate are examined,
+ * using the coordinate set's persistent Coord2Idx map.  Bonds are
+ * oriented exactly as a full search would orient them, so the result
+ * can be merged against bonds found previously.
+ */
 int ObjectMoleculeConnect(ObjectMolecule * I, int *nbond, BondType ** bond, AtomInfoType * ai,
                           struct CoordSet *cs, int bondSearchMode,
-                          int connectModeOverride)
+                          int connectModeOverride, const char *search)
 {
 #define cMULT 1
   PyMOLGlobals *G = I->Obj.G;
   int a, b, c, d, e, f, i, j;
   int a1, a2;
-  float *v1, *v2, dst;
+  float *v0, *v1, *v2, dst;
   int maxBond;
-  MapType *map;
+  MapType *map = NULL;
   int nBond;
   BondType *ii1, *ii2;
   int flag;
@@ -4011,7 +4344,14 @@ int ObjectMoleculeConnect(ObjectMolecule * I, int *nbond, BondType ** bond, Atom
 
   /*  FeedbackMask[FB_ObjectMolecule]=0xFF; */
   nBond = 0;
-  maxBond = cs->NIndex * 8;
+  if(search) {
+    int n_search = 0;
+    for(i = 0; i < cs->NIndex; i++)
+      if(search[i])
+        n_search++;
+    maxBond = n_search * 8;
+  } else
+    maxBond = cs->NIndex * 8;
   (*bond) = VLACalloc(BondType, maxBond);
   CHECKOK(ok, (*bond));
   while(ok && repeat) {
@@ -4055,8 +4395,13 @@ int ObjectMoleculeConnect(ObjectMolecule * I, int *nbond, BondType ** bond, Atom
 	    }
 	  }
 
-	  /* make a map of the local neighborhood in space */
-	  if (ok)
+	  /* make a map of the local neighborhood in space (incremental
+	     searches reuse the coordinate set's own map) */
+	  if (ok && search) {
+	    CoordSetUpdateCoord2IdxMap(cs, max_cutoff + MAX_VDW);
+	    map = cs->Coord2Idx;
+	  }
+	  if (ok && !map)
 	    map = MapNew(G, max_cutoff + MAX_VDW, cs->Coord, cs->NIndex, NULL);
 	  CHECKOK(ok, map);
           if(ok) {
@@ -4066,13 +4411,12 @@ int ObjectMoleculeConnect(ObjectMolecule * I, int *nbond, BondType ** bond, Atom
             for(i = 0; ok && i < cs->NIndex; i++) {
               if(nBond > maxBond)
                 break;
+              if(search && !search[i])
+                continue;
 	      /* atom i's position in space */
-              v1 = cs->Coord + (3 * i);
-
-              a1 = cs->IdxToAtm[i];
-              ai1 = ai + a1;
+              v0 = cs->Coord + (3 * i);
 
-              MapLocus(map, v1, &a, &b, &c);
+              MapLocus(map, v0, &a, &b, &c);
 	      /* d = [a-1, a, a+1] */
               for(d = a - 1; ok && d <= a + 1; d++) {
                 int *j_ptr1 = map->Head + d * dim12 + (b - 1) * dim2;
@@ -4085,12 +4429,20 @@ int ObjectMoleculeConnect(ObjectMolecule * I, int *nbond, BondType ** bond, Atom
                     j = *(j_ptr2++);    /*  *MapFirst(map,d,e,f)); */
                     while(ok && j >= 0) {
 
-                      if(i < j) {
+                      if((i < j) || (search && !search[j])) {
+                        /* lower index first, regardless of which one we searched from */
+                        int k1 = (i < j) ? i : j;
+                        int k2 = (i < j) ? j : i;
+
+                        v1 = cs->Coord + (3 * k1);
+                        a1 = cs->IdxToAtm[k1];
+                        ai1 = ai + a1;
+
 			/* position in space for atom 2 */
-                        v2 = cs->Coord + (3 * j);
+                        v2 = cs->Coord + (3 * k2);
                         dst = (float) diff3f(v1, v2);
 
-                        a2 = cs->IdxToAtm[j];
+                        a2 = cs->IdxToAtm[k2];
                         ai2 = ai + a2;
 
                         dst -= ((ai1->vdw + ai2->vdw) / 2);
@@ -4257,7 +4609,9 @@ int ObjectMoleculeConnect(ObjectMolecule * I, int *nbond, BondType ** bond, Atom
               }
             }
           do_it_again:
-            MapFree(map);
+            if(map != cs->Coord2Idx)
+              MapFree(map);
+            map = NULL;
             FreeP(cnt);
           }
         }
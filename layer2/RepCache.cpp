@@ -0,0 +1,158 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+
+#include"os_python.h"
+#include"os_predef.h"
+#include"os_std.h"
+
+#include"RepCache.h"
+#include"ObjectMolecule.h"
+#include"Setting.h"
+#include"Color.h"
+
+#include <string>
+
+#ifndef _PYMOL_NOPY
+
+#define KEY_PUT(key, value) (key).append((const char *) &(value), sizeof(value))
+
+static void RepCacheKeyPutStr(std::string & key, const char *str)
+{
+  if(!str)
+    str = "";
+  key.append(str, strlen(str) + 1);
+}
+
+/* returns false for ramps, whose colors depend on the ramp object (and
+   on the coordinates) rather than on the index */
+static int RepCacheKeyPutColor(PyMOLGlobals * G, std::string & key, int color)
+{
+  if(ColorCheckRamped(G, color))
+    return false;
+  KEY_PUT(key, color);
+  if(color >= 0 || color == cColorFront || color == cColorBack) {
+    /* custom colors may be redefined under the same index, and front and
+       back follow the background */
+    float *rgb = ColorGet(G, color);
+    key.append((const char *) rgb, sizeof(float) * 3);
+  }
+  return true;
+}
+
+PyObject *RepCacheInputAsTuple(CoordSet * cs, const char *name, int version,
+                               const int *setting)
+{
+  PyMOLGlobals *G = cs->State.G;
+  ObjectMolecule *obj = cs->Obj;
+  PyObject *result = NULL;
+  std::string key;
+  int a;
+
+  /* object */
+  KEY_PUT(key, obj->NAtom);
+  KEY_PUT(key, obj->NBond);
+  KEY_PUT(key, obj->NCSet);
+  KEY_PUT(key, obj->DiscreteFlag);
+
+  /* coordinates */
+  KEY_PUT(key, cs->NIndex);
+  key.append((const char *) cs->Coord, sizeof(float) * 3 * cs->NIndex);
+  key.append((const char *) cs->IdxToAtm, sizeof(int) * cs->NIndex);
+
+  /* atoms */
+  for(a = 0; a < obj->NAtom; a++) {
+    AtomInfoType *ai = obj->AtomInfo + a;
+    int hetatm = ai->hetatm;
+    if(ai->has_setting)
+      return NULL;
+    KEY_PUT(key, ai->visRep);
+    if(!RepCacheKeyPutColor(G, key, ai->color))
+      return NULL;
+    KEY_PUT(key, ai->flags);
+    KEY_PUT(key, ai->resv);
+    KEY_PUT(key, ai->b);
+    KEY_PUT(key, ai->q);
+    KEY_PUT(key, ai->vdw);
+    KEY_PUT(key, ai->elec_radius);
+    KEY_PUT(key, ai->partialCharge);
+    KEY_PUT(key, ai->formalCharge);
+    KEY_PUT(key, ai->protons);
+    KEY_PUT(key, ai->cartoon);
+    KEY_PUT(key, ai->geom);
+    KEY_PUT(key, ai->valence);
+    KEY_PUT(key, hetatm);
+    RepCacheKeyPutStr(key, LexStr(G, ai->chain));
+    RepCacheKeyPutStr(key, ai->segi);
+    RepCacheKeyPutStr(key, ai->name);
+    RepCacheKeyPutStr(key, ai->elem);
+    RepCacheKeyPutStr(key, ai->resi);
+    RepCacheKeyPutStr(key, ai->ssType);
+    RepCacheKeyPutStr(key, ai->alt);
+    RepCacheKeyPutStr(key, ai->resn);
+  }
+
+  /* bonds */
+  for(a = 0; a < obj->NBond; a++) {
+    BondType *bd = obj->Bond + a;
+    int order = bd->order;
+    KEY_PUT(key, bd->index[0]);
+    KEY_PUT(key, bd->index[1]);
+    KEY_PUT(key, order);
+  }
+
+  /* settings, as seen from this state */
+  for(; *setting >= 0; setting++) {
+    int index = *setting;
+    KEY_PUT(key, index);
+    switch (SettingGetType(G, index)) {
+    case cSetting_boolean:
+    case cSetting_int:
+      {
+        int value = SettingGet_i(G, cs->Setting, obj->Obj.Setting, index);
+        KEY_PUT(key, value);
+      }
+      break;
+    case cSetting_color:
+      if(!RepCacheKeyPutColor(G, key,
+                              SettingGet_color(G, cs->Setting, obj->Obj.Setting, index)))
+        return NULL;
+      break;
+    case cSetting_float:
+      {
+        float value = SettingGet_f(G, cs->Setting, obj->Obj.Setting, index);
+        KEY_PUT(key, value);
+      }
+      break;
+    case cSetting_float3:
+      key.append((const char *) SettingGet_3fv(G, cs->Setting, obj->Obj.Setting, index),
+                 sizeof(float) * 3);
+      break;
+    case cSetting_string:
+      RepCacheKeyPutStr(key, SettingGet_s(G, cs->Setting, obj->Obj.Setting, index));
+      break;
+    }
+  }
+
+  result = PyTuple_New(3);
+  if(result) {
+    PyTuple_SetItem(result, 0, PyString_FromString(name));
+    PyTuple_SetItem(result, 1, PyInt_FromLong(version));
+    PyTuple_SetItem(result, 2, PyString_FromStringAndSize(key.data(), key.size()));
+  }
+  return result;
+}
+
+#endif
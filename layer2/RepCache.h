@@ -0,0 +1,43 @@
+/*
+A* -------------------------------------------------------------------
+B* This file contains source code for the PyMOL computer program
+C* Copyright (c) Schrodinger, LLC.
+D* -------------------------------------------------------------------
+E* It is unlawful to modify or remove this copyright notice.
+F* -------------------------------------------------------------------
+G* Please see the accompanying LICENSE file for further information.
+H* -------------------------------------------------------------------
+I* Additional authors of this source file include:
+-*
+-*
+-*
+Z* -------------------------------------------------------------------
+*/
+#ifndef _H_RepCache
+#define _H_RepCache
+
+#include"os_python.h"
+#include"PyMOLGlobals.h"
+#include"CoordSet.h"
+
+/* content keys for the representation cache (cache_mode > 0).
+
+   Representations which can be cached describe their inputs as
+   (name, version, key), where key is a binary string covering the
+   coordinates and mapping of the coordinate set, the atom properties
+   and bonds of the object, and the effective values of the settings the
+   representation reads.  Lookups and stores go through PCacheGet and
+   PCacheSet, so cached results end up in the same memory cache as
+   surfaces and, if cache_dir is set, on disk. */
+
+#ifndef _PYMOL_NOPY
+
+/* setting is a list of setting indices terminated by -1.  Returns NULL
+   if the coordinate set can't be cached (atom-level settings, which
+   aren't part of the key, or ramp colors).  Requires the interpreter. */
+PyObject *RepCacheInputAsTuple(CoordSet * cs, const char *name, int version,
+                               const int *setting);
+
+#endif
+
+#endif
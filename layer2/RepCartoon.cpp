@@ -33,6 +33,8 @@ Z* -------------------------------------------------------------------
 #include"CGO.h"
 #include"Extrude.h"
 #include"ShaderMgr.h"
+#include"RepCache.h"
+#include"P.h"
 
 #include "AtomIterators.h"
 
@@ -2737,6 +2739,105 @@ void RepCartoonInvalidate(struct Rep *I, struct CoordSet *cs, int level)
   RepInvalidate(I, cs, level);
 }
 
+#ifndef _PYMOL_NOPY
+
+/* everything RepCartoonNew and GenerateRepCartoonCGO read */
+static const int RepCartoonCacheSetting[] = {
+  cSetting_cartoon_color, cSetting_cartoon_cylindrical_helices,
+  cSetting_cartoon_debug, cSetting_cartoon_discrete_colors,
+  cSetting_cartoon_dumbbell_length, cSetting_cartoon_dumbbell_radius,
+  cSetting_cartoon_dumbbell_width, cSetting_cartoon_fancy_helices,
+  cSetting_cartoon_fancy_sheets, cSetting_cartoon_flat_cycles,
+  cSetting_cartoon_flat_sheets, cSetting_cartoon_helix_radius,
+  cSetting_cartoon_highlight_color, cSetting_cartoon_ladder_color,
+  cSetting_cartoon_ladder_mode, cSetting_cartoon_ladder_radius,
+  cSetting_cartoon_loop_cap, cSetting_cartoon_loop_quality,
+  cSetting_cartoon_loop_radius, cSetting_cartoon_nucleic_acid_as_cylinders,
+  cSetting_cartoon_nucleic_acid_color, cSetting_cartoon_nucleic_acid_mode,
+  cSetting_cartoon_oval_length, cSetting_cartoon_oval_quality,
+  cSetting_cartoon_oval_width, cSetting_cartoon_power, cSetting_cartoon_power_b,
+  cSetting_cartoon_putty_quality, cSetting_cartoon_putty_radius,
+  cSetting_cartoon_putty_range, cSetting_cartoon_putty_scale_max,
+  cSetting_cartoon_putty_scale_min, cSetting_cartoon_putty_scale_power,
+  cSetting_cartoon_putty_transform, cSetting_cartoon_rect_length,
+  cSetting_cartoon_rect_width, cSetting_cartoon_refine,
+  cSetting_cartoon_refine_normals, cSetting_cartoon_refine_tips,
+  cSetting_cartoon_ring_color, cSetting_cartoon_ring_finder,
+  cSetting_cartoon_ring_mode, cSetting_cartoon_ring_radius,
+  cSetting_cartoon_ring_transparency, cSetting_cartoon_ring_width,
+  cSetting_cartoon_round_helices, cSetting_cartoon_sampling,
+  cSetting_cartoon_side_chain_helper, cSetting_cartoon_smooth_cycles,
+  cSetting_cartoon_smooth_first, cSetting_cartoon_smooth_last,
+  cSetting_cartoon_smooth_loops, cSetting_cartoon_throw,
+  cSetting_cartoon_trace_atoms, cSetting_cartoon_transparency,
+  cSetting_cartoon_tube_cap, cSetting_cartoon_tube_quality,
+  cSetting_cartoon_tube_radius, cSetting_cartoon_use_shader,
+  cSetting_ray_trace_mode, cSetting_render_as_cylinders, cSetting_stick_radius,
+  cSetting_trace_atoms_mode, cSetting_use_shaders,
+  -1
+};
+
+/* restores the geometry from the representation cache.  On a miss,
+   *entry receives the cache entry for RepCartoonCacheSet (if any) */
+static int RepCartoonCacheGet(RepCartoon * I, CoordSet * cs, PyObject ** entry)
+{
+  PyMOLGlobals *G = cs->State.G;
+  int found = false;
+  int blocked = PAutoBlock(G);
+  PyObject *input = RepCacheInputAsTuple(cs, "RepCartoon", 1, RepCartoonCacheSetting);
+  PyObject *output = NULL;
+
+  if(input && (PCacheGet(G, &output, entry, input) == OV_STATUS_YES)) {
+    if(PyTuple_Check(output) && (PyTuple_Size(output) >= 2)) {
+      I->ray = CGONewFromPyString(G, PyTuple_GetItem(output, 0));
+      I->pickingCGO = CGONewFromPyString(G, PyTuple_GetItem(output, 1));
+      if(I->ray && I->pickingCGO) {
+        I->preshader = I->ray;
+        found = true;
+      } else {
+        CGOFree(I->ray);
+        CGOFree(I->pickingCGO);
+        I->ray = NULL;
+        I->pickingCGO = NULL;
+      }
+    }
+    PXDecRef(output);
+    if(found) {
+      PXDecRef(*entry);
+      *entry = NULL;
+    }
+  }
+  PXDecRef(input);
+  if(PyErr_Occurred())
+    PyErr_Print();
+  PAutoUnblock(G, blocked);
+  return found;
+}
+
+/* stores the geometry (if store) and releases the entry */
+static void RepCartoonCacheSet(RepCartoon * I, PyObject * entry, int store)
+{
+  PyMOLGlobals *G = I->R.G;
+  int blocked = PAutoBlock(G);
+  if(store && I->ray && I->pickingCGO) {
+    PyObject *ray = CGOAsPyString(I->ray);
+    PyObject *picking = CGOAsPyString(I->pickingCGO);
+    if(ray && picking) {
+      PyObject *output = Py_BuildValue("(OO)", ray, picking);
+      PCacheSet(G, entry, output);
+      PXDecRef(output);
+    }
+    PXDecRef(ray);
+    PXDecRef(picking);
+  }
+  PXDecRef(entry);
+  if(PyErr_Occurred())
+    PyErr_Print();
+  PAutoUnblock(G, blocked);
+}
+
+#endif
+
 Rep *RepCartoonNew(CoordSet * cs, int state)
 {
   PyMOLGlobals *G = cs->State.G;
@@ -2795,6 +2896,10 @@ Rep *RepCartoonNew(CoordSet * cs, int state)
   short na_strands_as_cylinders = SettingGetGlobal_b(G, cSetting_use_shaders) && 
     (SettingGetGlobal_i(G, cSetting_cartoon_nucleic_acid_as_cylinders) & 2) && 
     SettingGetGlobal_b(G, cSetting_render_as_cylinders);
+  int cache_mode;
+#ifndef _PYMOL_NOPY
+  PyObject *cache_entry = NULL;
+#endif
 
   // skip if not visible
   if(!cs->hasRep(cRepCartoonBit))
@@ -2874,6 +2979,18 @@ Rep *RepCartoonNew(CoordSet * cs, int state)
   I->R.context.object = (void *) obj;
   I->R.context.state = state;
 
+  cache_mode = SettingGet_i(G, cs->Setting, obj->Obj.Setting, cSetting_cache_mode);
+#ifndef _PYMOL_NOPY
+  if((cache_mode > 0) && RepCartoonCacheGet(I, cs, &cache_entry)) {
+    lv = I->LastVisib = Calloc(char, cs->NAtIndex);
+    for(a1 = 0; a1 < cs->NAtIndex; a1++) {
+      if(cs->atmToIdx(a1) >= 0)
+        *(lv++) = GET_BIT(obj->AtomInfo[a1].visRep, cRepCartoon);
+    }
+    return (Rep *) I;
+  }
+#endif
+
   /* find all of the CA points */
 
   at = Alloc(int, cs->NAtIndex);        /* cs index pointers */
@@ -3842,6 +3959,10 @@ Rep *RepCartoonNew(CoordSet * cs, int state)
   }
 
   ok &= !G->Interrupt;
+#ifndef _PYMOL_NOPY
+  if(cache_entry)
+    RepCartoonCacheSet(I, cache_entry, ok && (cache_mode > 1));
+#endif
   if (!ok){
     /* cannot generate RepCartoon */
     RepCartoonFree(I);
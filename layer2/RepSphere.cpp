@@ -33,6 +33,8 @@
 #include "Scene.h"
 #include"CGO.h"
 #include"ObjectMolecule.h"
+#include"RepCache.h"
+#include"P.h"
 
 #include "ShaderText.h"
 
@@ -1848,6 +1850,180 @@ static int RepSphereGenerateGeometryForSphere(RepSphere *I, ObjectMolecule *obj,
 }
 
 
+/* remember per-atom visibility and color for RepSphereSameVis */
+static int RepSphereStoreLastVis(RepSphere * I, CoordSet * cs, int *marked, int sphere_color)
+{
+  int ok = true;
+  int a;
+  int *lv, *lc;
+  AtomInfoType *ai2;
+  if(!I->LastVisib)
+    I->LastVisib = Alloc(int, cs->NIndex);
+  CHECKOK(ok, I->LastVisib);
+  if(ok && !I->LastColor)
+    I->LastColor = Alloc(int, cs->NIndex);
+  CHECKOK(ok, I->LastColor);
+  if (ok){
+    lv = I->LastVisib;
+    lc = I->LastColor;
+    ai2 = cs->Obj->AtomInfo;
+    if(sphere_color == -1){
+      for(a = 0; a < cs->NIndex; a++) {
+        int at = cs->IdxToAtm[a];
+        *(lv++) = marked[at];
+        *(lc++) = (ai2 + at)->color;
+      }
+    } else {
+      for(a = 0; a < cs->NIndex; a++) {
+        *(lv++) = marked[cs->IdxToAtm[a]];
+        *(lc++) = sphere_color;
+      }
+    }
+  }
+  return ok;
+}
+
+#ifndef _PYMOL_NOPY
+
+/* everything RepSphereNew reads */
+static const int RepSphereCacheSetting[] = {
+  cSetting_cartoon_side_chain_helper, cSetting_cull_spheres, cSetting_draw_mode,
+  cSetting_pickable, cSetting_ribbon_side_chain_helper, cSetting_roving_spheres,
+  cSetting_sculpting, cSetting_solvent_radius, cSetting_sphere_color,
+  cSetting_sphere_mode, cSetting_sphere_quality, cSetting_sphere_scale,
+  cSetting_sphere_solvent, cSetting_sphere_transparency,
+  cSetting_sphere_use_shader, cSetting_spheroid_scale, cSetting_use_shaders,
+  -1
+};
+
+static int RepSphereRecIndex(PyMOLGlobals * G, SphereRec * sp)
+{
+  int a;
+  for(a = 0; sp && a < NUMBER_OF_SPHERE_LEVELS; a++)
+    if(G->Sphere->Sphere[a] == sp)
+      return a;
+  return -1;
+}
+
+static PyObject *RepSphereArrayAsPyString(const void *data, int size)
+{
+  if(!data)
+    return PXIncRef(Py_None);
+  return PyString_FromStringAndSize((const char *) data, size);
+}
+
+/* copies a cached array into a new allocation of at least size bytes */
+static void *RepSphereArrayFromPyString(PyObject * str, int size, int *ok)
+{
+  void *result = NULL;
+  if(str == Py_None)
+    return NULL;
+  if(!PyString_Check(str) || (PyString_Size(str) != size)) {
+    *ok = false;
+    return NULL;
+  }
+  result = mmalloc(size ? size : 1);
+  if(!result)
+    *ok = false;
+  else
+    memcpy(result, PyString_AsString(str), size);
+  return result;
+}
+
+/* restores the primitives from the representation cache.  On a miss,
+   *entry receives the cache entry for RepSphereCacheSet (if any) */
+static int RepSphereCacheGet(RepSphere * I, CoordSet * cs, PyObject ** entry)
+{
+  PyMOLGlobals *G = cs->State.G;
+  int found = false;
+  int blocked = PAutoBlock(G);
+  PyObject *input = RepCacheInputAsTuple(cs, "RepSphere", 1, RepSphereCacheSetting);
+  PyObject *output = NULL;
+
+  if(input && (PCacheGet(G, &output, entry, input) == OV_STATUS_YES)) {
+    if(PyTuple_Check(output) && (PyTuple_Size(output) == 14)) {
+      int ok = true;
+      int sp_index, ssp_index, n_v, n_nt;
+      I->NC = PyInt_AsLong(PyTuple_GetItem(output, 0));
+      I->N = PyInt_AsLong(PyTuple_GetItem(output, 1));
+      I->NP = PyInt_AsLong(PyTuple_GetItem(output, 2));
+      I->cullFlag = PyInt_AsLong(PyTuple_GetItem(output, 3));
+      I->VariableAlphaFlag = PyInt_AsLong(PyTuple_GetItem(output, 4));
+      sp_index = PyInt_AsLong(PyTuple_GetItem(output, 5));
+      ssp_index = PyInt_AsLong(PyTuple_GetItem(output, 6));
+      n_v = PyInt_AsLong(PyTuple_GetItem(output, 7));
+      n_nt = PyInt_AsLong(PyTuple_GetItem(output, 8));
+      if((sp_index >= NUMBER_OF_SPHERE_LEVELS) || (ssp_index >= NUMBER_OF_SPHERE_LEVELS))
+        ok = false;
+      I->SP = (ok && (sp_index >= 0)) ? G->Sphere->Sphere[sp_index] : NULL;
+      I->SSP = (ok && (ssp_index >= 0)) ? G->Sphere->Sphere[ssp_index] : NULL;
+      I->VC = (float *) RepSphereArrayFromPyString(PyTuple_GetItem(output, 9),
+                                                   sizeof(float) * 8 * I->NC, &ok);
+      I->V = (float *) RepSphereArrayFromPyString(PyTuple_GetItem(output, 10),
+                                                  sizeof(float) * n_v, &ok);
+      I->VN = (float *) RepSphereArrayFromPyString(PyTuple_GetItem(output, 11),
+                                                   sizeof(float) * 3 * I->NC, &ok);
+      I->NT = (int *) RepSphereArrayFromPyString(PyTuple_GetItem(output, 12),
+                                                 sizeof(int) * n_nt, &ok);
+      I->R.P = (Pickable *) RepSphereArrayFromPyString(PyTuple_GetItem(output, 13),
+                                                       sizeof(Pickable) * (I->NP + 1), &ok);
+      if(ok && I->VC && !PyErr_Occurred()) {
+        found = true;
+      } else {
+        FreeP(I->VC);
+        FreeP(I->V);
+        FreeP(I->VN);
+        FreeP(I->NT);
+        FreeP(I->R.P);
+        I->NC = I->N = I->NP = 0;
+      }
+    }
+    PXDecRef(output);
+    if(found) {
+      PXDecRef(*entry);
+      *entry = NULL;
+    }
+  }
+  PXDecRef(input);
+  if(PyErr_Occurred())
+    PyErr_Print();
+  PAutoUnblock(G, blocked);
+  return found;
+}
+
+/* stores the primitives (if store) and releases the entry; n_v and n_nt
+   are the used lengths of I->V and I->NT */
+static void RepSphereCacheSet(RepSphere * I, PyObject * entry, int store, int n_v, int n_nt)
+{
+  PyMOLGlobals *G = I->R.G;
+  int blocked = PAutoBlock(G);
+  if(store && I->VC) {
+    PyObject *output = PyTuple_New(14);
+    PyTuple_SetItem(output, 0, PyInt_FromLong(I->NC));
+    PyTuple_SetItem(output, 1, PyInt_FromLong(I->N));
+    PyTuple_SetItem(output, 2, PyInt_FromLong(I->NP));
+    PyTuple_SetItem(output, 3, PyInt_FromLong(I->cullFlag));
+    PyTuple_SetItem(output, 4, PyInt_FromLong(I->VariableAlphaFlag));
+    PyTuple_SetItem(output, 5, PyInt_FromLong(RepSphereRecIndex(G, I->SP)));
+    PyTuple_SetItem(output, 6, PyInt_FromLong(RepSphereRecIndex(G, I->SSP)));
+    PyTuple_SetItem(output, 7, PyInt_FromLong(I->V ? n_v : 0));
+    PyTuple_SetItem(output, 8, PyInt_FromLong(I->NT ? n_nt : 0));
+    PyTuple_SetItem(output, 9, RepSphereArrayAsPyString(I->VC, sizeof(float) * 8 * I->NC));
+    PyTuple_SetItem(output, 10, RepSphereArrayAsPyString(I->V, sizeof(float) * n_v));
+    PyTuple_SetItem(output, 11, RepSphereArrayAsPyString(I->VN, sizeof(float) * 3 * I->NC));
+    PyTuple_SetItem(output, 12, RepSphereArrayAsPyString(I->NT, sizeof(int) * n_nt));
+    PyTuple_SetItem(output, 13, RepSphereArrayAsPyString(I->R.P, sizeof(Pickable) * (I->NP + 1)));
+    PCacheSet(G, entry, output);
+    PXDecRef(output);
+  }
+  PXDecRef(entry);
+  if(PyErr_Occurred())
+    PyErr_Print();
+  PAutoUnblock(G, blocked);
+}
+
+#endif
+
 Rep *RepSphereNew(CoordSet * cs, int state)
 {
   PyMOLGlobals *G = cs->State.G;
@@ -1855,12 +2031,10 @@ Rep *RepSphereNew(CoordSet * cs, int state)
   int ok = true;
   int a, a1;
   float *v;
-  int *lv, *lc;
   SphereRec *sp = G->Sphere->Sphere[0];
   int sphere_quality, *nt;
   int *visFlag = NULL;
   MapType *map = NULL;
-  AtomInfoType *ai2;
   int spheroidFlag = false;
   float spheroid_scale;
   float sphere_scale, sphere_add = 0.f;
@@ -1877,6 +2051,11 @@ Rep *RepSphereNew(CoordSet * cs, int state)
 #ifdef _this_code_is_not_used
   float vv0[3], vv1[3], vv2[3];
   float tn[3], vt1[3], vt2[3], xtn[3], *tn0, *tn1, *tn2;
+#endif
+  int n_v = 0, n_nt = 0;
+  int cache_mode;
+#ifndef _PYMOL_NOPY
+  PyObject *cache_entry = NULL;
 #endif
   int draw_mode = SettingGetGlobal_i(G, cSetting_draw_mode);
   int draw_quality = (((draw_mode == 1) || (draw_mode == -2) || (draw_mode == 2)));
@@ -1945,6 +2124,24 @@ Rep *RepSphereNew(CoordSet * cs, int state)
     I->R.context.object = (void *) obj;
     I->R.context.state = state;
   }
+  cache_mode = SettingGet_i(G, cs->Setting, obj->Obj.Setting, cSetting_cache_mode);
+#ifndef _PYMOL_NOPY
+  if(ok && (cache_mode > 0) && !spheroidFlag && RepSphereCacheGet(I, cs, &cache_entry)) {
+    for(a = 0; a < cs->NIndex; a++) {
+      a1 = cs->IdxToAtm[a];
+      ati1 = obj->AtomInfo + a1;
+      marked[a1] = RepSphereDetermineAtomVisibility(G, GET_BIT(ati1->visRep,cRepSphere), ati1, cartoon_side_chain_helper, ribbon_side_chain_helper);
+    }
+    ok &= RepSphereStoreLastVis(I, cs, marked, sphere_color);
+    FreeP(marked);
+    if(!ok) {
+      RepSphereFree(I);
+      I = NULL;
+    }
+    return (Rep *) I;
+  }
+#endif
+
   /* raytracing primitives */
 
   if (ok)
@@ -2118,39 +2315,17 @@ Rep *RepSphereNew(CoordSet * cs, int state)
       }
     }
   }
-  if(ok) {
-    if(!I->LastVisib)
-      I->LastVisib = Alloc(int, cs->NIndex);
-    CHECKOK(ok, I->LastVisib);
-    if(ok && !I->LastColor)
-      I->LastColor = Alloc(int, cs->NIndex);
-    CHECKOK(ok, I->LastColor);
-    if (ok){
-      lv = I->LastVisib;
-      lc = I->LastColor;
-      obj = cs->Obj;
-      ai2 = obj->AtomInfo;
-      if(sphere_color == -1){
-	for(a = 0; a < cs->NIndex; a++) {
-          int at = cs->IdxToAtm[a];
-	  *(lv++) = marked[at];
-	  *(lc++) = (ai2 + at)->color;
-	}
-      } else {
-	for(a = 0; a < cs->NIndex; a++) {
-	  *(lv++) = marked[cs->IdxToAtm[a]];
-	  *(lc++) = sphere_color;
-	}
-      }
-    }
-  }
+  if(ok)
+    ok &= RepSphereStoreLastVis(I, cs, marked, sphere_color);
 
   if(ok && I->V) {
     if(I->N) {
-      I->V = ReallocForSure(I->V, float, (v - I->V));
+      n_v = v - I->V;
+      I->V = ReallocForSure(I->V, float, n_v);
       CHECKOK(ok, I->V);
       if(ok && I->NT){
-        I->NT = ReallocForSure(I->NT, int, (nt - I->NT));
+        n_nt = nt - I->NT;
+        I->NT = ReallocForSure(I->NT, int, n_nt);
 	CHECKOK(ok, I->NT);
       }
     } else {
@@ -2162,6 +2337,10 @@ Rep *RepSphereNew(CoordSet * cs, int state)
       }
     }
   }
+#ifndef _PYMOL_NOPY
+  if(cache_entry)
+    RepSphereCacheSet(I, cache_entry, ok && (cache_mode > 1), n_v, n_nt);
+#endif
   FreeP(marked);
   FreeP(visFlag);
   FreeP(map_flag);
@@ -39,6 +39,7 @@ Z* -------------------------------------------------------------------
 #include"PConv.h"
 #include"Selector.h"
 #include"ShaderMgr.h"
+#include"TaskPool.h"
 
 #ifdef NT
 #undef NT
@@ -133,6 +134,14 @@ typedef struct {
   int flags;
 } SurfaceJobAtomInfo;
 
+/* points produced by one range of a parallel loop */
+typedef struct {
+  int ok;
+  int n;
+  float *v;                     /* VLA */
+  float *vn;                    /* VLA */
+} SurfaceChunk;
+
 static SolventDot *SolventDotNew(PyMOLGlobals * G,
                                  float *coord,
                                  SurfaceJobAtomInfo * atom_info,
@@ -3340,6 +3349,214 @@ static void SurfaceJobFree(PyMOLGlobals * G, SurfaceJob * I)
   OOFreeP(I);
 }
 
+/* the surface points generated around each solvent dot are computed
+   for contiguous ranges of dots in parallel and appended in dot order */
+
+#define SURFACE_DOT_CHUNK 1024
+
+typedef struct {
+  PyMOLGlobals *G;
+  SurfaceJob *job;
+  SolventDot *sol_dot;
+  MapType *map;                 /* atoms */
+  MapType *solv_map;            /* solvent dots */
+  SphereRec *sp;
+  Vector3f *dot;                /* sp scaled by the probe radius */
+  float probe_rad_more;
+  float probe_rad_less;
+  float probe_rad_less2;
+  int surface_type;
+  int n_chunk;
+  SurfaceChunk *chunk;
+  TaskPoolCounter next;
+} SurfaceDotJob;
+
+static void SurfaceDotRange(SurfaceDotJob * J, SurfaceChunk * c, int a0, int a1)
+{
+  PyMOLGlobals *G = J->G;
+  SurfaceJob *I = J->job;
+  SolventDot *sol_dot = J->sol_dot;
+  MapType *map = J->map;
+  MapType *solv_map = J->solv_map;
+  SphereRec *sp = J->sp;
+  Vector3f *dot = J->dot;
+  float probe_rad_more = J->probe_rad_more;
+  float probe_rad_less = J->probe_rad_less;
+  float dist2 = J->probe_rad_less2;
+  int surface_type = J->surface_type;
+  float *I_coord = I->coord;
+  int *present_vla = I->presentVla;
+  SurfaceJobAtomInfo *I_atom_info = I->atomInfo;
+  int *dc = sol_dot->dotCode;
+  int sp_nDot = sp->nDot;
+  int a, b;
+  float *v, *vn;
+  float *v0 = sol_dot->dot + 3 * a0;
+
+  c->v = VLAlloc(float, (sp_nDot + 1) * 3);
+  c->vn = VLAlloc(float, (sp_nDot + 1) * 3);
+  if(!(c->v && c->vn)) {
+    c->ok = false;
+    return;
+  }
+
+  for(a = a0; a < a1; a++) {
+    if(G->Interrupt) {
+      c->ok = false;
+      break;
+    }
+    if(dc[a] || (surface_type < 6)) {   /* surface type 6 is completely scribed */
+      /* room for every point around this dot */
+      VLACheck(c->v, float, (c->n + sp_nDot) * 3 + 2);
+      VLACheck(c->vn, float, (c->n + sp_nDot) * 3 + 2);
+      if(!(c->v && c->vn)) {
+        c->ok = false;
+        return;
+      }
+      v = c->v + 3 * c->n;
+      vn = c->vn + 3 * c->n;
+      for(b = 0; b < sp_nDot; b++) {
+        float *dot_b = dot[b];
+        v[0] = v0[0] + dot_b[0];
+        v[1] = v0[1] + dot_b[1];
+        v[2] = v0[2] + dot_b[2];
+        {
+          int flag = true;
+          int ii;
+          ii = *(MapLocusEStart(solv_map, v));
+          if(ii && solv_map->EList) {
+            float *i_dot = sol_dot->dot;
+            float dist = probe_rad_less;
+            int *elist_ii = solv_map->EList + ii;
+            float v_0 = v[0];
+            int jj_next, jj = *(elist_ii++);
+            float v_1 = v[1];
+            float *v1 = i_dot + 3 * jj;
+            float v_2 = v[2];
+            while(jj >= 0) {
+              /* huge bottleneck -- optimized for superscaler processors */
+              float dx = v1[0], dy, dz;
+              jj_next = *(elist_ii++);
+              dx -= v_0;
+              if(jj != a) {
+                dx = (dx < 0.0F) ? -dx : dx;
+                dy = v1[1] - v_1;
+                if(!(dx > dist)) {
+                  dy = (dy < 0.0F) ? -dy : dy;
+                  dz = v1[2] - v_2;
+                  if(!(dy > dist)) {
+                    dx = dx * dx;
+                    dz = (dz < 0.0F) ? -dz : dz;
+                    dy = dy * dy;
+                    if(!(dz > dist)) {
+                      dx = dx + dy;
+                      dz = dz * dz;
+                      if(!(dx > dist2))
+                        if((dx + dz) <= dist2) {
+                          flag = false;
+                          break;
+                        }
+                    }
+                  }
+                }
+              }
+              v1 = i_dot + 3 * jj_next;
+              jj = jj_next;
+            }
+          }
+
+          /* at this point, we have points on the interior of the solvent surface,
+             so now we need to further trim that surface to cover atoms that are present */
+
+          if(flag) {
+            int i = *(MapLocusEStart(map, v));
+            if(i && map->EList) {
+              int j = map->EList[i++];
+              while(j >= 0) {
+                SurfaceJobAtomInfo *atom_info = I_atom_info + j;
+                if((!present_vla) || present_vla[j]) {
+                  if(within3f
+                     (I_coord + 3 * j, v,
+                      atom_info->vdw + probe_rad_more)) {
+                    flag = false;
+                    break;
+                  }
+                }
+                j = map->EList[i++];
+              }
+            }
+            if(!flag) {         /* compute the normals */
+              vn[0] = -sp->dot[b][0];
+              vn[1] = -sp->dot[b][1];
+              vn[2] = -sp->dot[b][2];
+              c->n++;
+              v += 3;
+              vn += 3;
+            }
+          }
+        }
+      }
+    }
+    v0 += 3;
+  }
+}
+
+static void SurfaceDotTask(void *ctx, int index)
+{
+  SurfaceDotJob *J = (SurfaceDotJob *) ctx;
+  int n_dot = J->sol_dot->nDot;
+  int c;
+  while((c = J->next++) < J->n_chunk) {
+    int a0 = c * SURFACE_DOT_CHUNK;
+    int a1 = a0 + SURFACE_DOT_CHUNK;
+    if(a1 > n_dot)
+      a1 = n_dot;
+    if(!index)                  /* chunks are claimed in order */
+      OrthoBusyFast(J->G, a0 + n_dot * 2, n_dot * 5);   /* 2/5 to 3/5 */
+    SurfaceDotRange(J, J->chunk + c, a0, a1);
+  }
+}
+
+/* appends the points of all chunks to I->V/I->VN in dot order.  Storage
+   grows exactly as it did in the serial loop, which doubled MaxN (and
+   dropped the point at hand) whenever the arrays were full */
+static int SurfaceDotMerge(SurfaceDotJob * J, int *MaxN_ptr)
+{
+  SurfaceJob *I = J->job;
+  int ok = true;
+  int MaxN = *MaxN_ptr;
+  int c;
+  for(c = 0; c < J->n_chunk; c++) {
+    SurfaceChunk *chunk = J->chunk + c;
+    int k = 0;
+    ok &= chunk->ok;
+    while(ok && (k < chunk->n)) {
+      int cnt = chunk->n - k;
+      if(cnt > MaxN - I->N)
+        cnt = MaxN - I->N;
+      if(cnt > 0) {
+        memcpy(I->V + 3 * I->N, chunk->v + 3 * k, sizeof(float) * 3 * cnt);
+        memcpy(I->VN + 3 * I->N, chunk->vn + 3 * k, sizeof(float) * 3 * cnt);
+        I->N += cnt;
+        k += cnt;
+      }
+      if(k < chunk->n) {
+        MaxN = MaxN * 2;
+        VLASize(I->V, float, (MaxN + 1) * 3);
+        CHECKOK(ok, I->V);
+        if (ok)
+          VLASize(I->VN, float, (MaxN + 1) * 3);
+        CHECKOK(ok, I->VN);
+        k++;
+      }
+    }
+    VLAFreeP(chunk->v);
+    VLAFreeP(chunk->vn);
+  }
+  *MaxN_ptr = MaxN;
+  return ok;
+}
+
 static int SurfaceJobRun(PyMOLGlobals * G, SurfaceJob * I)
 {
   int ok = true;
@@ -3462,9 +3679,7 @@ static int SurfaceJobRun(PyMOLGlobals * G, SurfaceJob * I)
 	    ok &= !G->Interrupt;
 	    ok &= map->EList && solv_map->EList;
             if(sol_dot->nDot && ok) {
-              int *dc = sol_dot->dotCode;
               Vector3f *dot = Alloc(Vector3f, sp->nDot);
-              float *v0, *n0;
 	      CHECKOK(ok, dot);
               if (ok){
                 int b;
@@ -3472,117 +3687,35 @@ static int SurfaceJobRun(PyMOLGlobals * G, SurfaceJob * I)
                   scale3f(sp->dot[b], probe_radius, dot[b]);
                 }
               }
-              v0 = sol_dot->dot;
-              n0 = sol_dot->dotNormal;
               if (ok) {
-                int a, b;
-                float dist2 = probe_rad_less2;
-                int sp_nDot = sp->nDot;
-                for(a = 0; ok && a < sol_dot->nDot; a++) {
-                  if(dc[a] || (surface_type < 6)) {     /* surface type 6 is completely scribed */
-                    OrthoBusyFast(G, a + sol_dot->nDot * 2, sol_dot->nDot * 5); /* 2/5 to 3/5 */
-                    for(b = 0; ok && b < sp_nDot; b++) {
-                      float *dot_b = dot[b];
-                      v[0] = v0[0] + dot_b[0];
-                      v[1] = v0[1] + dot_b[1];
-                      v[2] = v0[2] + dot_b[2];
-                      {
-                        int flag = true;
-                        int ii;
-			ii = *(MapLocusEStart(solv_map, v));
-                        if(ii && solv_map->EList) {
-                          float *i_dot = sol_dot->dot;
-                          float dist = probe_rad_less;
-                          int *elist_ii = solv_map->EList + ii;
-                          float v_0 = v[0];
-                          int jj_next, jj = *(elist_ii++);
-                          float v_1 = v[1];
-                          float *v1 = i_dot + 3 * jj;
-                          float v_2 = v[2];
-                          while(jj >= 0) {
-                            /* huge bottleneck -- optimized for superscaler processors */
-                            float dx = v1[0], dy, dz;
-                            jj_next = *(elist_ii++);
-                            dx -= v_0;
-                            if(jj != a) {
-                              dx = (dx < 0.0F) ? -dx : dx;
-                              dy = v1[1] - v_1;
-                              if(!(dx > dist)) {
-                                dy = (dy < 0.0F) ? -dy : dy;
-                                dz = v1[2] - v_2;
-                                if(!(dy > dist)) {
-                                  dx = dx * dx;
-                                  dz = (dz < 0.0F) ? -dz : dz;
-                                  dy = dy * dy;
-                                  if(!(dz > dist)) {
-                                    dx = dx + dy;
-                                    dz = dz * dz;
-                                    if(!(dx > dist2))
-                                      if((dx + dz) <= dist2) {
-                                        flag = false;
-                                        break;
-                                      }
-                                  }
-                                }
-                              }
-                            }
-                            v1 = i_dot + 3 * jj_next;
-                            jj = jj_next;
-                          }
-                        }
-
-                        /* at this point, we have points on the interior of the solvent surface,
-                           so now we need to further trim that surface to cover atoms that are present */
-
-                        if(flag) {
-                          int i = *(MapLocusEStart(map, v));
-                          if(i && map->EList) {
-                            int j = map->EList[i++];
-                            while(j >= 0) {
-                              SurfaceJobAtomInfo *atom_info = I_atom_info + j;
-                              if((!present_vla) || present_vla[j]) {
-                                if(within3f
-                                   (I_coord + 3 * j, v,
-                                    atom_info->vdw + probe_rad_more)) {
-                                  flag = false;
-                                  break;
-                                }
-                              }
-                              j = map->EList[i++];
-                            }
-                          }
-                          if(!flag) {   /* compute the normals */
-                            vn[0] = -sp->dot[b][0];
-                            vn[1] = -sp->dot[b][1];
-                            vn[2] = -sp->dot[b][2];
-                            if(I->N < MaxN) {
-                              I->N++;
-                              v += 3;
-                              vn += 3;
-                            } else {
-                              int v_offset = v - I->V;
-                              int vn_offset = vn - I->VN;
-                              MaxN = MaxN * 2;
-                              VLASize(I->V, float, (MaxN + 1) * 3);
-			      CHECKOK(ok, I->V);
-			      if (ok)
-				VLASize(I->VN, float, (MaxN + 1) * 3);
-			      CHECKOK(ok, I->VN);
-			      if (ok){
-				v = I->V + v_offset;
-				vn = I->VN + vn_offset;
-			      }
-                            }
-                          }
-                        }
-                      }
-		      ok &= !G->Interrupt;
-                    }
-                  }
-                  v0 += 3;
-                  n0 += 3;
-		  ok &= !G->Interrupt;
+                SurfaceDotJob job;
+                int n_thread = TaskPoolGetNThread(G);
+                job.G = G;
+                job.job = I;
+                job.sol_dot = sol_dot;
+                job.map = map;
+                job.solv_map = solv_map;
+                job.sp = sp;
+                job.dot = dot;
+                job.probe_rad_more = probe_rad_more;
+                job.probe_rad_less = probe_rad_less;
+                job.probe_rad_less2 = probe_rad_less2;
+                job.surface_type = surface_type;
+                job.n_chunk = (sol_dot->nDot + SURFACE_DOT_CHUNK - 1) / SURFACE_DOT_CHUNK;
+                job.next = 0;
+                job.chunk = Calloc(SurfaceChunk, job.n_chunk);
+                CHECKOK(ok, job.chunk);
+                if (ok) {
+                  int c;
+                  for(c = 0; c < job.n_chunk; c++)
+                    job.chunk[c].ok = true;
+                  if(n_thread > job.n_chunk)
+                    n_thread = job.n_chunk;
+                  TaskPoolRun(G, n_thread, n_thread, SurfaceDotTask, &job);
+                  ok &= SurfaceDotMerge(&job, &MaxN);
+                  ok &= !G->Interrupt;
                 }
+                FreeP(job.chunk);
               }
               FreeP(dot);
             }
@@ -4610,6 +4743,356 @@ Rep *RepSurfaceNew(CoordSet * cs, int state)
   return (Rep *) I;
 }
 
+/* per-atom dot generation is sharded into contiguous ranges of atoms
+   which are processed in parallel; the ranges are appended in atom
+   order afterwards, so the dots come out exactly as in a serial pass */
+
+#define SOLVENT_DOT_CHUNK 256
+
+typedef struct {
+  PyMOLGlobals *G;
+  float *coord;
+  SurfaceJobAtomInfo *atom_info;
+  int *present;
+  int n_coord;
+  float probe_radius;
+  SphereRec *sp;
+  MapType *map;                 /* atoms, for burial checks */
+  MapType *map2;                /* atoms, for finding proximal pairs */
+  int circumscribe;
+  int n_chunk;
+  int chunk_size;
+  SurfaceChunk *chunk;
+  TaskPoolCounter next;
+} SolventDotJob;
+
+/* dots on the accessible sphere of each atom in [a0,a1) */
+static void SolventDotSphereRange(SolventDotJob * J, SurfaceChunk * c, int a0, int a1)
+{
+  PyMOLGlobals *G = J->G;
+  float *coord = J->coord;
+  SurfaceJobAtomInfo *atom_info = J->atom_info;
+  int *present = J->present;
+  MapType *map = J->map;
+  SphereRec *sp = J->sp;
+  Vector3f *sp_dot = sp->dot;
+  float probe_radius = J->probe_radius;
+  int a, b;
+  float *v, *n;
+
+  c->v = VLAlloc(float, ((a1 - a0) * sp->nDot + 1) * 3);
+  c->vn = VLAlloc(float, ((a1 - a0) * sp->nDot + 1) * 3);
+  if(!(c->v && c->vn)) {
+    c->ok = false;
+    return;
+  }
+  v = c->v;
+  n = c->vn;
+
+  for(a = a0; a < a1; a++) {
+    SurfaceJobAtomInfo *a_atom_info = atom_info + a;
+    if(G->Interrupt) {
+      c->ok = false;
+      break;
+    }
+    if((!present) || (present[a])) {
+      int i;
+      int skip_flag = false;
+      float *v0 = coord + 3 * a;
+      float vdw = a_atom_info->vdw + probe_radius;
+
+      i = *(MapLocusEStart(map, v0));
+      if(i && map->EList) {
+        int j = map->EList[i++];
+        while(j >= 0) {
+          SurfaceJobAtomInfo *j_atom_info = atom_info + j;
+          if(j > a)             /* only check if this is atom trails */
+            if((!present) || present[j]) {
+              if(j_atom_info->vdw == a_atom_info->vdw) {        /* handle singularities */
+                float *v1 = coord + 3 * j;
+                if((v0[0] == v1[0]) && (v0[1] == v1[1]) && (v0[2] == v1[2]))
+                  skip_flag = true;
+              }
+            }
+          j = map->EList[i++];
+        }
+      }
+      if(!skip_flag) {
+        for(b = 0; b < sp->nDot; b++) {
+          float *sp_dot_b = (float*)(sp_dot + b);
+          int flag = true;
+          v[0] = v0[0] + vdw * (n[0] = sp_dot_b[0]);
+          v[1] = v0[1] + vdw * (n[1] = sp_dot_b[1]);
+          v[2] = v0[2] + vdw * (n[2] = sp_dot_b[2]);
+          i = *(MapLocusEStart(map, v));
+          if(i) {
+            int j = map->EList[i++];
+            while(j >= 0) {
+              SurfaceJobAtomInfo *j_atom_info = atom_info + j;
+              if((!present) || present[j]) {
+                if(j != a) {
+                  skip_flag = false;
+                  if(j_atom_info->vdw == a_atom_info->vdw) {      /* handle singularities */
+                    float *v1 = coord + 3 * j;
+                    if((v0[0] == v1[0]) && (v0[1] == v1[1]) && (v0[2] == v1[2]))
+                      skip_flag = true;
+                  }
+                  if(!skip_flag)
+                    if(within3f(coord + 3 * j, v, j_atom_info->vdw + probe_radius)) {
+                      flag = false;
+                      break;
+                    }
+                }
+              }
+              j = map->EList[i++];
+            }
+          }
+          if(flag) {
+            v += 3;
+            n += 3;
+            c->n++;
+          }
+        }
+      }
+    }
+  }
+}
+
+/* for each pair of proximal atoms with the first atom in [a0,a1),
+   circumscribe a circle for their intersection */
+static void SolventDotCircumscribeRange(SolventDotJob * J, SurfaceChunk * c, int a0, int a1)
+{
+  PyMOLGlobals *G = J->G;
+  float *coord = J->coord;
+  SurfaceJobAtomInfo *atom_info = J->atom_info;
+  int *present = J->present;
+  MapType *map = J->map;
+  MapType *map2 = J->map2;
+  int circumscribe = J->circumscribe;
+  float probe_radius = J->probe_radius;
+  int a, b;
+  float *v, *n;
+
+  c->v = VLAlloc(float, (circumscribe + 1) * 3);
+  c->vn = VLAlloc(float, (circumscribe + 1) * 3);
+  if(!(c->v && c->vn)) {
+    c->ok = false;
+    return;
+  }
+
+  for(a = a0; a < a1; a++) {
+    SurfaceJobAtomInfo *a_atom_info = atom_info + a;
+    if(G->Interrupt) {
+      c->ok = false;
+      break;
+    }
+    if((!present) || present[a]) {
+      int i;
+      int skip_flag = false;
+      float *v0 = coord + 3 * a;
+      float vdw = a_atom_info->vdw + probe_radius;
+      float vdw2 = vdw * vdw;
+
+      i = *(MapLocusEStart(map2, v0));
+      if(i) {
+        int j = map2->EList[i++];
+        while(j >= 0) {
+          SurfaceJobAtomInfo *j_atom_info = atom_info + j;
+          if(j > a)             /* only check if this is atom trails */
+            if((!present) || present[j]) {
+              if(j_atom_info->vdw == a_atom_info->vdw) {        /* handle singularities */
+                float *v2 = coord + 3 * j;
+                if((v0[0] == v2[0]) && (v0[1] == v2[1]) && (v0[2] == v2[2]))
+                  skip_flag = true;
+              }
+            }
+          j = map2->EList[i++];
+        }
+      }
+
+      if(!skip_flag) {
+        int ii = *(MapLocusEStart(map2, v0));
+        if(ii) {
+          int jj = map2->EList[ii++];
+          while(jj >= 0) {
+            SurfaceJobAtomInfo *jj_atom_info = atom_info + jj;
+            float dist;
+            if(jj > a)          /* only check if this is atom trails */
+              if((!present) || present[jj]) {
+                float vdw3 = jj_atom_info->vdw + probe_radius;
+
+                float *v2 = coord + 3 * jj;
+                dist = (float) diff3f(v0, v2);
+                if((dist > R_SMALL4) && (dist < (vdw + vdw3))) {
+                  float vz[3], vx[3], vy[3], vp[3];
+                  float tri_a = vdw, tri_b = vdw3, tri_c = dist;
+                  float tri_s = (tri_a + tri_b + tri_c) * 0.5F;
+                  float area = (float) sqrt1f(tri_s * (tri_s - tri_a) *
+                                              (tri_s - tri_b) * (tri_s - tri_c));
+                  float radius = (2 * area) / dist;
+                  float adj = (float) sqrt1f(vdw2 - radius * radius);
+
+                  subtract3f(v2, v0, vz);
+                  get_system1f3f(vz, vx, vy);
+
+                  copy3f(vz, vp);
+                  scale3f(vp, adj, vp);
+                  add3f(v0, vp, vp);
+
+                  /* room for every point on this circle */
+                  VLACheck(c->v, float, (c->n + circumscribe + 1) * 3 + 2);
+                  VLACheck(c->vn, float, (c->n + circumscribe + 1) * 3 + 2);
+                  if(!(c->v && c->vn)) {
+                    c->ok = false;
+                    return;
+                  }
+                  v = c->v + 3 * c->n;
+                  n = c->vn + 3 * c->n;
+
+                  for(b = 0; b <= circumscribe; b++) {
+                    float xcos = (float) cos((b * 2 * cPI) / circumscribe);
+                    float ysin = (float) sin((b * 2 * cPI) / circumscribe);
+                    float xcosr = xcos * radius;
+                    float ysinr = ysin * radius;
+                    int flag = true;
+                    v[0] = vp[0] + vx[0] * xcosr + vy[0] * ysinr;
+                    v[1] = vp[1] + vx[1] * xcosr + vy[1] * ysinr;
+                    v[2] = vp[2] + vx[2] * xcosr + vy[2] * ysinr;
+
+                    i = *(MapLocusEStart(map, v));
+                    if(i && map->EList) {
+                      int j = map->EList[i++];
+                      while(j >= 0) {
+                        SurfaceJobAtomInfo *j_atom_info = atom_info + j;
+                        if((!present) || present[j])
+                          if((j != a) && (j != jj)) {
+                            skip_flag = false;
+                            if(a_atom_info->vdw == j_atom_info->vdw) {  /* handle singularities */
+                              float *v1 = coord + 3 * j;
+                              if((v0[0] == v1[0]) &&
+                                 (v0[1] == v1[1]) && (v0[2] == v1[2]))
+                                skip_flag = true;
+                            }
+                            if(jj_atom_info->vdw == j_atom_info->vdw) { /* handle singularities */
+                              float *v1 = coord + 3 * j;
+                              if((v2[0] == v1[0]) &&
+                                 (v2[1] == v1[1]) && (v2[2] == v1[2]))
+                                skip_flag = true;
+                            }
+                            if(!skip_flag)
+                              if(within3f
+                                 (coord + 3 * j, v,
+                                  j_atom_info->vdw + probe_radius)) {
+                                flag = false;
+                                break;
+                              }
+                          }
+                        j = map->EList[i++];
+                      }
+                    }
+                    if(flag) {
+                      float vt0[3], vt2[3];
+                      subtract3f(v0, v, vt0);
+                      subtract3f(v2, v, vt2);
+                      normalize3f(vt0);
+                      normalize3f(vt2);
+                      add3f(vt0, vt2, n);
+                      invert3f(n);
+                      normalize3f(n);
+                      v += 3;
+                      n += 3;
+                      c->n++;
+                    }
+                  }
+                }
+              }
+            jj = map2->EList[ii++];
+          }
+        }
+      }
+    }
+  }
+}
+
+static void SolventDotSphereTask(void *ctx, int index)
+{
+  SolventDotJob *J = (SolventDotJob *) ctx;
+  int c;
+  while((c = J->next++) < J->n_chunk) {
+    int a0 = c * J->chunk_size;
+    int a1 = a0 + J->chunk_size;
+    if(a1 > J->n_coord)
+      a1 = J->n_coord;
+    if(!index)                  /* chunks are claimed in order */
+      OrthoBusyFast(J->G, a0, J->n_coord * 5);
+    SolventDotSphereRange(J, J->chunk + c, a0, a1);
+  }
+}
+
+static void SolventDotCircumscribeTask(void *ctx, int index)
+{
+  SolventDotJob *J = (SolventDotJob *) ctx;
+  int c;
+  while((c = J->next++) < J->n_chunk) {
+    int a0 = c * J->chunk_size;
+    int a1 = a0 + J->chunk_size;
+    if(a1 > J->n_coord)
+      a1 = J->n_coord;
+    SolventDotCircumscribeRange(J, J->chunk + c, a0, a1);
+  }
+}
+
+/* runs one pass over all atoms and appends the results in atom order,
+   dropping dots beyond stopDot just like the serial loop did */
+static int SolventDotRun(SolventDot * I, SolventDotJob * J, TaskPoolFn * fn,
+                         int dot_code, int stopDot)
+{
+  PyMOLGlobals *G = J->G;
+  int ok = true;
+  int a, c;
+  int n_thread = TaskPoolGetNThread(G);
+
+  J->chunk_size = J->n_coord;
+  if(n_thread > 1)
+    J->chunk_size = SOLVENT_DOT_CHUNK;
+  if(J->chunk_size < 1)
+    J->chunk_size = 1;
+  J->n_chunk = (J->n_coord + J->chunk_size - 1) / J->chunk_size;
+  J->next = 0;
+  J->chunk = Calloc(SurfaceChunk, J->n_chunk + 1);
+  CHECKOK(ok, J->chunk);
+  if(!ok)
+    return false;
+  for(c = 0; c < J->n_chunk; c++)
+    J->chunk[c].ok = true;
+
+  if(n_thread > J->n_chunk)
+    n_thread = J->n_chunk;
+  TaskPoolRun(G, n_thread, n_thread, fn, J);
+
+  for(c = 0; c < J->n_chunk; c++) {
+    SurfaceChunk *chunk = J->chunk + c;
+    ok &= chunk->ok;
+    if(ok) {
+      int cnt = chunk->n;
+      if(cnt > stopDot - I->nDot)
+        cnt = stopDot - I->nDot;
+      if(cnt > 0) {
+        memcpy(I->dot + 3 * I->nDot, chunk->v, sizeof(float) * 3 * cnt);
+        memcpy(I->dotNormal + 3 * I->nDot, chunk->vn, sizeof(float) * 3 * cnt);
+        for(a = 0; a < cnt; a++)
+          I->dotCode[I->nDot + a] = dot_code;
+        I->nDot += cnt;
+      }
+    }
+    VLAFreeP(chunk->v);
+    VLAFreeP(chunk->vn);
+  }
+  FreeP(J->chunk);
+  ok &= !G->Interrupt;
+  return ok;
+}
+
 static SolventDot *SolventDotNew(PyMOLGlobals * G,
                                  float *coord,
                                  SurfaceJobAtomInfo * atom_info,
@@ -4625,7 +5108,6 @@ static SolventDot *SolventDotNew(PyMOLGlobals * G,
   int b;
   float vdw;
   float probe_radius_plus;
-  int maxDot = 0;
   int stopDot;
   int n_coord = VLAGetSize(atom_info);
   Vector3f *sp_dot = sp->dot;
@@ -4659,102 +5141,28 @@ static SolventDot *SolventDotNew(PyMOLGlobals * G,
 
   I->nDot = 0;
   if (ok) {
-    int dotCnt = 0;
+    SolventDotJob job;
     MapType *map = MapNewFlagged(G, max_vdw + probe_radius, coord, n_coord, NULL, present);
     CHECKOK(ok, map);
     ok &= !G->Interrupt;
     if(map && ok) {
-      float *v = I->dot;
-      float *n = I->dotNormal;
-      int *dc = I->dotCode;
-      int maxCnt = 0;
+      job.G = G;
+      job.coord = coord;
+      job.atom_info = atom_info;
+      job.present = present;
+      job.n_coord = n_coord;
+      job.probe_radius = probe_radius;
+      job.sp = sp;
+      job.map = map;
+      job.map2 = NULL;
+      job.circumscribe = circumscribe;
 
       ok &= MapSetupExpress(map);
-      if (ok) {
-        int a;
-        int skip_flag;
-
-        SurfaceJobAtomInfo *a_atom_info = atom_info;
-        for(a = 0; ok && a < n_coord; a++) {
-          OrthoBusyFast(G, a, n_coord * 5);
-          if((!present) || (present[a])) {
-            int i;
-            float *v0 = coord + 3 * a;
-            vdw = a_atom_info->vdw + probe_radius;
-
-            skip_flag = false;
-
-            i = *(MapLocusEStart(map, v0));
-            if(i && map->EList) {
-              int j = map->EList[i++];
-              while(ok && j >= 0) {
-                SurfaceJobAtomInfo *j_atom_info = atom_info + j;
-                if(j > a)       /* only check if this is atom trails */
-                  if((!present) || present[j]) {
-                    if(j_atom_info->vdw == a_atom_info->vdw) {        /* handle singularities */
-                      float *v1 = coord + 3 * j;
-                      if((v0[0] == v1[0]) && (v0[1] == v1[1]) && (v0[2] == v1[2]))
-                        skip_flag = true;
-                    }
-                  }
-                j = map->EList[i++];
-		ok &= !G->Interrupt;
-              }
-            }
-            if(ok && !skip_flag) {
-              for(b = 0; ok && b < sp->nDot; b++) {
-                float *sp_dot_b = (float*)(sp_dot + b);
-                int i;
-                int flag = true;
-                v[0] = v0[0] + vdw * (n[0] = sp_dot_b[0]);
-                v[1] = v0[1] + vdw * (n[1] = sp_dot_b[1]);
-                v[2] = v0[2] + vdw * (n[2] = sp_dot_b[2]);
-                i = *(MapLocusEStart(map, v));
-                if(i) {
-                  int j = map->EList[i++];
-                  while(ok && j >= 0) {
-                    SurfaceJobAtomInfo *j_atom_info = atom_info + j;
-                    if((!present) || present[j]) {
-                      if(j != a) {
-                        skip_flag = false;
-                        if(j_atom_info->vdw == a_atom_info->vdw) {      /* handle singularities */
-                          float *v1 = coord + 3 * j;
-                          if((v0[0] == v1[0]) && (v0[1] == v1[1]) && (v0[2] == v1[2]))
-                            skip_flag = true;
-                        }
-                        if(!skip_flag)
-                          if(within3f(coord + 3 * j, v, j_atom_info->vdw + probe_radius)) {
-                            flag = false;
-                            break;
-                          }
-                      }
-                    }
-                    j = map->EList[i++];
-		    ok &= !G->Interrupt;
-                  }
-                }
-                if(ok && flag && (dotCnt < stopDot)) {
-                  dotCnt++;
-                  v += 3;
-                  n += 3;
-                  dc++;
-                  I->nDot++;
-                }
-              }
-            }
-            if(dotCnt > maxCnt) {
-              maxCnt = dotCnt;
-              maxDot = I->nDot - 1;
-            }
-          }
-          a_atom_info++;
-        }
-      }
+      if (ok)
+        ok &= SolventDotRun(I, &job, SolventDotSphereTask, 0, stopDot);
 
       /* for each pair of proximal atoms, circumscribe a circle for their intersection */
 
-      /*    CGOReset(G->DebugCGO); */
-
       if (ok) {
         MapType *map2 = NULL;
         if(circumscribe && (!surface_solvent)){
@@ -4763,151 +5171,15 @@ static SolventDot *SolventDotNew(PyMOLGlobals * G,
 	}
 	ok &= !G->Interrupt;
         if(ok && map2) {
-          /*        CGOBegin(G->DebugCGO,GL_LINES); */
-          int a;
-          int skip_flag;
-
-          SurfaceJobAtomInfo *a_atom_info = atom_info;
           ok &= MapSetupExpress(map2);
-          for(a = 0; ok && a < n_coord; a++) {
-            if((!present) || present[a]) {
-              int i;
-              float vdw2;
-              float *v0 = coord + 3 * a;
-              vdw = a_atom_info->vdw + probe_radius;
-              vdw2 = vdw * vdw;
-
-              skip_flag = false;
-
-              i = *(MapLocusEStart(map2, v0));
-              if(i) {
-                int j = map2->EList[i++];
-                while(ok && j >= 0) {
-                  SurfaceJobAtomInfo *j_atom_info = atom_info + j;
-                  if(j > a)     /* only check if this is atom trails */
-                    if((!present) || present[j]) {
-                      if(j_atom_info->vdw == a_atom_info->vdw) {      /* handle singularities */
-                        float *v2 = coord + 3 * j;
-                        if((v0[0] == v2[0]) && (v0[1] == v2[1]) && (v0[2] == v2[2]))
-                          skip_flag = true;
-                      }
-                    }
-                  j = map2->EList[i++];
-		  ok &= !G->Interrupt;
-                }
-              }
-
-              if(ok && !skip_flag) {
-                int ii = *(MapLocusEStart(map2, v0));
-                if(ii) {
-                  int jj = map2->EList[ii++];
-                  while(jj >= 0) {
-                    SurfaceJobAtomInfo *jj_atom_info = atom_info + jj;
-                    float dist;
-                    if(jj > a)  /* only check if this is atom trails */
-                      if((!present) || present[jj]) {
-                        float vdw3 = jj_atom_info->vdw + probe_radius;
-
-                        float *v2 = coord + 3 * jj;
-                        dist = (float) diff3f(v0, v2);
-                        if((dist > R_SMALL4) && (dist < (vdw + vdw3))) {
-                          float vz[3], vx[3], vy[3], vp[3];
-                          float tri_a = vdw, tri_b = vdw3, tri_c = dist;
-                          float tri_s = (tri_a + tri_b + tri_c) * 0.5F;
-                          float area = (float) sqrt1f(tri_s * (tri_s - tri_a) *
-                                                      (tri_s - tri_b) * (tri_s - tri_c));
-                          float radius = (2 * area) / dist;
-                          float adj = (float) sqrt1f(vdw2 - radius * radius);
-
-                          subtract3f(v2, v0, vz);
-                          get_system1f3f(vz, vx, vy);
-
-                          copy3f(vz, vp);
-                          scale3f(vp, adj, vp);
-                          add3f(v0, vp, vp);
-
-                          for(b = 0; ok && b <= circumscribe; b++) {
-                            float xcos = (float) cos((b * 2 * cPI) / circumscribe);
-                            float ysin = (float) sin((b * 2 * cPI) / circumscribe);
-                            float xcosr = xcos * radius;
-                            float ysinr = ysin * radius;
-                            int flag = true;
-                            v[0] = vp[0] + vx[0] * xcosr + vy[0] * ysinr;
-                            v[1] = vp[1] + vx[1] * xcosr + vy[1] * ysinr;
-                            v[2] = vp[2] + vx[2] * xcosr + vy[2] * ysinr;
-
-                            i = *(MapLocusEStart(map, v));
-                            if(i && map->EList) {
-                              int j = map->EList[i++];
-                              while(ok && j >= 0) {
-                                SurfaceJobAtomInfo *j_atom_info = atom_info + j;
-                                if((!present) || present[j])
-                                  if((j != a) && (j != jj)) {
-                                    skip_flag = false;
-                                    if(a_atom_info->vdw == j_atom_info->vdw) {  /* handle singularities */
-                                      float *v1 = coord + 3 * j;
-                                      if((v0[0] == v1[0]) &&
-                                         (v0[1] == v1[1]) && (v0[2] == v1[2]))
-                                        skip_flag = true;
-                                    }
-                                    if(jj_atom_info->vdw == j_atom_info->vdw) { /* handle singularities */
-                                      float *v1 = coord + 3 * j;
-                                      if((v2[0] == v1[0]) &&
-                                         (v2[1] == v1[1]) && (v2[2] == v1[2]))
-                                        skip_flag = true;
-                                    }
-                                    if(!skip_flag)
-                                      if(within3f
-                                         (coord + 3 * j, v,
-                                          j_atom_info->vdw + probe_radius)) {
-                                        flag = false;
-                                        break;
-                                      }
-                                  }
-                                j = map->EList[i++];
-				ok &= !G->Interrupt;
-                              }
-                            }
-                            if(ok && flag && (dotCnt < stopDot)) {
-                              float vt0[3], vt2[3];
-                              subtract3f(v0, v, vt0);
-                              subtract3f(v2, v, vt2);
-                              normalize3f(vt0);
-                              normalize3f(vt2);
-                              add3f(vt0, vt2, n);
-                              invert3f(n);
-                              normalize3f(n);
-                              /*
-                                 n[0] = vx[0] * xcos + vy[0] * ysin;
-                                 n[1] = vx[1] * xcos + vy[1] * ysin;
-                                 n[2] = vx[2] * xcos + vy[2] * ysin;
-                               */
-
-                              *dc = 1;  /* mark as exempt */
-
-                              dotCnt++;
-                              v += 3;
-                              n += 3;
-                              dc++;
-                              I->nDot++;
-                            }
-                          }
-                        }
-                      }
-                    jj = map2->EList[ii++];
-                  }
-                }
-              }
-            }
-            a_atom_info++;
-	    ok &= !G->Interrupt;
-          }
+          job.map2 = map2;
+          if (ok)
+            ok &= SolventDotRun(I, &job, SolventDotCircumscribeTask, 1 /* mark as exempt */, stopDot);
         }
         MapFree(map2);
       }
     }
     MapFree(map);
-    /*    CGOEnd(G->DebugCGO); */
   }
 
   if(ok && cavity_mode) {
@@ -29,34 +29,15 @@ Z* -------------------------------------------------------------------
 #include"Editor.h"
 
 #include"CGO.h"
+#include"Map.h"
+#include"TaskPool.h"
 
 #ifndef R_SMALL8
 #define R_SMALL8 0.00000001
 #endif
 
-#define NB_HASH_SIZE 262144
 #define EX_HASH_SIZE 65536
 
-#define nb_hash(v) \
-(((((int)*(v  ))>> 2)&0x0003F)|\
- ((((int)*(v+1))<< 4)&0x00FC0)|\
- ((((int)*(v+2))<<10)&0x3F000))
-
-#define nb_hash_off_i0(v0i,d) \
-  ((((d)+v0i)>> 2)&0x0003F)
-
-#define nb_hash_off_i1(v1i,e) \
- ((((e)+v1i)<< 4)&0x00FC0)
-
-#define nb_hash_off_i2(v2i,f) \
- ((((f)+v2i)<<10)&0x3F000)
-
-#define nb_hash_off(v,d,e,f) \
-(((((d)+(int)*(v  ))>> 2)&0x0003F)|\
- ((((e)+(int)*(v+1))<< 4)&0x00FC0)|\
- ((((f)+(int)*(v+2))<<10)&0x3F000))
-
-
 /* below are empirically optimized */
 
 #define ex_hash_i0(a) \
@@ -69,11 +50,27 @@ Z* -------------------------------------------------------------------
 (((((a)^((a)>>5)))&0x00FF)|\
  (((    ((b)<<5)))&0xFF00))
 
+/* a pseudo-random unit vector which only depends on the atom pair, so
+   that coincident atoms are pushed apart the same way whichever part of
+   the terms (and thread) they fall in */
+static void SculptPairDirection(int b0, int b1, float *rd)
+{
+  unsigned int h = ((unsigned int) b0 * 73856093U) ^ ((unsigned int) b1 * 19349663U);
+  int c;
+  for(c = 0; c < 3; c++) {
+    h ^= h >> 13;
+    h *= 0x5bd1e995U;
+    h ^= h >> 15;
+    rd[c] = 0.5F - (h & 0xFFFFFF) / 16777216.0F;
+  }
+  normalize3f(rd);
+}
+
 #ifdef _PYMOL_INLINE
 __inline__
 #endif
 static float ShakerDoDist(float target, float *v0, float *v1, float *d0to1, float *d1to0,
-                          float wt)
+                          float wt, int b0, int b1)
 {
   float d[3], push[3];
   float len, dev, dev_2, sc, result;
@@ -88,9 +85,9 @@ static float ShakerDoDist(float target, float *v0, float *v1, float *d0to1, floa
       scale3f(d, sc, push);
       add3f(push, d0to1, d0to1);
       subtract3f(d1to0, push, d1to0);
-    } else {                    /* overlapping, so just push along X */
+    } else {                    /* overlapping, so push along the pair's direction */
       float rd[3];
-      get_random3f(rd);
+      SculptPairDirection(b0, b1, rd);
       d0to1[0] -= rd[0] * dev_2;
       d1to0[0] += rd[0] * dev_2;
       d0to1[1] -= rd[1] * dev_2;
@@ -220,7 +217,7 @@ static float ShakerDoDistLimit(float target, float *v0, float *v1, float *d0to1,
 __inline__
 #endif
 static float ShakerDoDistMinim(float target, float *v0, float *v1, float *d0to1,
-                               float *d1to0, float wt)
+                               float *d1to0, float wt, int b0, int b1)
 {
   float d[3], push[3];
   float len, dev, dev_2, sc;
@@ -229,10 +226,15 @@ static float ShakerDoDistMinim(float target, float *v0, float *v1, float *d0to1,
   len = (float) length3f(d);
   dev = len - target;
 
-  if(dev < 0.0F) {              /* assuming len is non-zero since it is above target */
+  if(dev < 0.0F) {
     dev_2 = -wt * dev * 0.5F;
-    sc = dev_2 / len;
-    scale3f(d, sc, push);
+    if(len > R_SMALL8) {
+      sc = dev_2 / len;
+      scale3f(d, sc, push);
+    } else {                    /* coincident atoms have no direction of their own */
+      SculptPairDirection(b0, b1, d);
+      scale3f(d, dev_2, push);
+    }
     add3f(push, d0to1, d0to1);
     subtract3f(d1to0, push, d1to0);
     return -dev;
@@ -246,8 +248,14 @@ CSculpt *SculptNew(PyMOLGlobals * G)
   OOAlloc(G, CSculpt);
   I->G = G;
   I->Shaker = ShakerNew(G);
-  I->NBList = VLAlloc(int, 150000);
-  I->NBHash = Calloc(int, NB_HASH_SIZE);
+  I->NB.cs = NULL;
+  I->NB.n_active = 0;
+  I->NB.active = VLAlloc(int, 1000);
+  I->NB.ref = VLAlloc(float, 3000);
+  I->NB.radius = 0.0F;
+  I->NB.min_ex = 0;
+  I->NB.pair = VLAlloc(int, 30000);
+  I->NB.n_pair = 0;
   I->EXList = VLAlloc(int, 100000);
   I->EXHash = Calloc(int, EX_HASH_SIZE);
   I->Don = VLAlloc(int, 1000);
@@ -416,7 +424,7 @@ void SculptMeasureObject(CSculpt * I, ObjectMolecule * obj, int state, int match
 
   ShakerReset(I->Shaker);
 
-  UtilZeroMem(I->NBHash, NB_HASH_SIZE * sizeof(int));
+  I->NB.cs = NULL;
   UtilZeroMem(I->EXHash, EX_HASH_SIZE * sizeof(int));
 
   if((state >= 0) && (state < obj->NCSet) && (obj->CSet[state])) {
@@ -1637,62 +1645,564 @@ static int SculptDoAvoid(float avoid, float range, float actual, float *d,
   return 0;
 }
 
+/* restraint sets with fewer terms than this are evaluated serially */
+#define SCULPT_PAR_MIN 4096
+
+/* larger ones are always split into this many parts, however many
+   threads run them, so that displacements are summed in the same order */
+#define SCULPT_N_PART 8
+
+/* displacement and strain accumulators for one part of the terms */
+typedef struct {
+  float *disp;
+  int *cnt;
+  float strain;
+  int count;
+} SculptPart;
+
+typedef struct {
+  CSculpt *I;
+  ObjectMolecule *obj;
+  float *cs_coord;
+  int *atm2idx;
+  int *exclude;
+  int mask;
+  int nb_flag;                  /* evaluate the non-bonded pairs this cycle */
+  CGO *cgo;                     /* bump visualization, serial cycles only */
+  float bond_wt, angl_wt, pyra_wt, pyra_inv_wt, plan_wt, line_wt;
+  float tors_wt, tors_tole, tri_wt, tri_sc, min_wt, min_sc, max_wt, max_sc;
+  float vdw, vdw14, vdw_wt, vdw_wt14, vdw_magnified;
+  float hb_overlap, hb_overlap_base;
+  float avd_wt, avd_gp, avd_rg, avd_range;
+  int avd_ex;
+  int vdw_vis_mode;
+  float vdw_vis_min, vdw_vis_mid, vdw_vis_max;
+  int n_part;
+  SculptPart *part;
+} SculptJob;
+
+static void SculptPartRange(int n, int index, int n_part, int *start, int *stop)
+{
+  *start = (int) (((size_t) n * index) / n_part);
+  *stop = (int) (((size_t) n * (index + 1)) / n_part);
+}
+
+static int SculptGetExclusion(CSculpt * I, int b0, int b1)
+{
+  int *I_EXList = I->EXList;
+  int xoffset = *(I->EXHash + (ex_hash_i0(b0) | ex_hash_i1(b1)));
+  int ex = 10;
+  int ex1;
+  int *j;
+  while(xoffset) {
+    xoffset = (*(j = I_EXList + xoffset));
+    if((*(j + 1) == b0) && (*(j + 2) == b1)) {
+      ex1 = *(j + 3);
+      if(ex1 < ex) {
+        ex = ex1;
+      }
+    }
+  }
+  return ex;
+}
+
+
+/*
+ * Brings the non-bonded pair list up to date.  The list holds every pair
+ * of active atoms (b0 < b1, exclusion above min_ex) which was within
+ * radius + skin at the time it was built, so it stays complete until
+ * some atom has moved by half the remaining skin.
+ */
+static int SculptUpdateNBList(CSculpt * I, CoordSet * cs, float *cs_coord,
+                              int *atm2idx, int *active, int n_active,
+                              float radius, float skin, int min_ex)
+{
+  PyMOLGlobals *G = I->G;
+  SculptNBList *nb = &I->NB;
+  MapType *map;
+  int ok = true;
+  int a;
+
+  if((nb->cs == cs) && (nb->n_active == n_active) && (nb->min_ex == min_ex) &&
+     !memcmp(nb->active, active, sizeof(int) * n_active)) {
+    float limit = (nb->radius - radius) / 2.0F;
+    if(limit > 0.0F) {
+      float limit2 = limit * limit;
+      for(a = 0; a < n_active; a++) {
+        if(diffsq3f(nb->ref + 3 * a, cs_coord + 3 * atm2idx[active[a]]) > limit2)
+          break;
+      }
+      if(a == n_active)
+        return true;
+    }
+  }
+
+  nb->cs = NULL;
+  nb->n_pair = 0;
+  VLACheck(nb->active, int, n_active);
+  VLACheck(nb->ref, float, 3 * n_active);
+  CHECKOK(ok, nb->active);
+  CHECKOK(ok, nb->ref);
+  if(!ok)
+    return false;
+  for(a = 0; a < n_active; a++) {
+    nb->active[a] = active[a];
+    copy3f(cs_coord + 3 * atm2idx[active[a]], nb->ref + 3 * a);
+  }
+  if(skin < 0.0F)
+    skin = 0.0F;
+  nb->radius = radius + skin;
+  nb->n_active = n_active;
+  nb->min_ex = min_ex;
+
+  if(n_active && (nb->radius > R_SMALL4)) {
+    map = MapNew(G, nb->radius, nb->ref, n_active, NULL);
+    CHECKOK(ok, map);
+    if(ok)
+      ok &= MapSetupExpress(map);
+    if(ok) {
+      int h, k, l, i, j;
+      for(a = 0; ok && (a < n_active); a++) {
+        float *v0 = nb->ref + 3 * a;
+        int b0 = active[a];
+        MapLocus(map, v0, &h, &k, &l);
+        i = *(MapEStart(map, h, k, l));
+        if(i) {
+          j = map->EList[i++];
+          while(j >= 0) {
+            /* active is in atom order, so j > a means b1 > b0 */
+            if((j > a) && within3f(v0, nb->ref + 3 * j, nb->radius)) {
+              int b1 = active[j];
+              int ex = SculptGetExclusion(I, b0, b1);
+              if(ex > min_ex) {
+                int *pr;
+                VLACheck(nb->pair, int, 3 * nb->n_pair + 2);
+                CHECKOK(ok, nb->pair);
+                if(!ok)
+                  break;
+                pr = nb->pair + 3 * nb->n_pair;
+                pr[0] = b0;
+                pr[1] = b1;
+                pr[2] = ex;
+                nb->n_pair++;
+              }
+            }
+            j = map->EList[i++];
+          }
+        }
+      }
+    }
+    if(map)
+      MapFree(map);
+  }
+  if(ok)
+    nb->cs = cs;
+  else
+    nb->n_pair = 0;
+  PRINTFD(G, FB_Sculpt)
+    " SculptUpdateNBList-Debug: %d pairs within %8.3f\n", nb->n_pair, nb->radius ENDFD;
+  return ok;
+}
+
+static void SculptEvalPairs(SculptJob * J, SculptPart * part, int start, int stop)
+{
+  CSculpt *I = J->I;
+  AtomInfoType *obj_ai = J->obj->AtomInfo;
+  float *cs_coord = J->cs_coord;
+  int *atm2idx = J->atm2idx;
+  float *disp = part->disp;
+  int *cnt = part->cnt;
+  int mask = J->mask;
+  int *pr = I->NB.pair + 3 * start;
+  float good_color[3] = { 0.2, 1.0, 0.2 };
+  float bad_color[3] = { 1.0, 0.2, 0.2 };
+  float diff[3], len, cutoff, vdw_cutoff, wt;
+  int p;
+
+  for(p = start; p < stop; p++) {
+    int b0 = pr[0], b1 = pr[1], ex = pr[2];
+    AtomInfoType *ai0 = obj_ai + b0;
+    AtomInfoType *ai1 = obj_ai + b1;
+    float *v0 = cs_coord + 3 * atm2idx[b0];
+    float *v1 = cs_coord + 3 * atm2idx[b1];
+    pr += 3;
+
+    if(((cSculptVDW | cSculptVDW14) & mask) && (ex > 3)) {
+      cutoff = ai0->vdw + ai1->vdw;
+
+      if(ex == 10) {            /* standard interaction -- no exclusion */
+        if(I->Don[b0] && I->Acc[b1]) {  /* h-bond */
+          if(ai0->protons == cAN_H) {
+            cutoff -= J->hb_overlap;
+          } else {
+            cutoff -= J->hb_overlap_base;
+          }
+        } else if(I->Acc[b0] && I->Don[b1]) {   /* h-bond */
+          if(ai1->protons == cAN_H) {
+            cutoff -= J->hb_overlap;
+          } else {
+            cutoff -= J->hb_overlap_base;
+          }
+        }
+        if(cSculptVDW & mask) {
+          vdw_cutoff = cutoff * J->vdw;
+          wt = J->vdw_wt * J->vdw_magnified;
+          if(J->cgo
+             && ((!((ai0->protekted && ai1->protekted)
+                    || (ai0->flags & ai1->flags & cAtomFlag_fix))
+                 ) || (ai0->flags & cAtomFlag_study)
+                 || (ai1->flags & cAtomFlag_study))) {
+            SculptCGOBump(v0, v1, ai0->vdw, ai1->vdw, cutoff,
+                          J->vdw_vis_min, J->vdw_vis_mid, J->vdw_vis_max,
+                          good_color, bad_color, J->vdw_vis_mode, J->cgo);
+          }
+          if(SculptCheckBump(v0, v1, diff, &len, vdw_cutoff))
+            if(SculptDoBump(vdw_cutoff, len, diff,
+                            disp + b0 * 3, disp + b1 * 3, wt, &part->strain)) {
+              cnt[b0]++;
+              cnt[b1]++;
+              part->count++;
+            }
+        }
+      } else if(ex == 4) {      /* 1-4 interation */
+        cutoff *= J->vdw14;
+        wt = J->vdw_wt14 * J->vdw_magnified;
+
+        if(cSculptVDW14 & mask) {
+          if(SculptCheckBump(v0, v1, diff, &len, cutoff)) {
+            if(SculptDoBump(cutoff, len, diff,
+                            disp + b0 * 3, disp + b1 * 3, wt, &part->strain)) {
+              cnt[b0]++;
+              cnt[b1]++;
+              part->count++;
+            }
+          }
+        }
+      }
+    }
+
+    if((cSculptAvoid & mask) && (ex > J->avd_ex)) {
+      /* tweak nb distances to avoid sitting in the surface rendition
+         danger zone for too long (vdw1+vdw2+0.75*solvent) */
+      float target = ai0->vdw + ai1->vdw + J->avd_gp;
+      if(SculptCheckAvoid(v0, v1, diff, &len, target, J->avd_rg)) {
+        if(SculptDoAvoid(target, J->avd_range, len, diff,
+                         disp + b0 * 3, disp + b1 * 3, J->avd_wt, &part->strain)) {
+          cnt[b0]++;
+          cnt[b1]++;
+          part->count++;
+        }
+      }
+    }
+  }
+}
+
+/* evaluates part "index" of every restraint list into J->part[index] */
+static void SculptEvalPart(SculptJob * J, int index)
+{
+  CShaker *shk = J->I->Shaker;
+  SculptPart *part = J->part + index;
+  float *disp = part->disp;
+  int *cnt = part->cnt;
+  float *cs_coord = J->cs_coord;
+  int *atm2idx = J->atm2idx;
+  int *exclude = J->exclude;
+  int mask = J->mask;
+  int n_part = J->n_part;
+  int a0, a1, a2, a3, b0, b1, b2, b3;
+  float *v0, *v1, *v2, *v3;
+  float strain;
+  int a, start, stop;
+
+  /* apply distance constraints */
+
+  {
+    ShakerDistCon *sdc = shk->DistCon;
+    SculptPartRange(shk->NDistCon, index, n_part, &start, &stop);
+    sdc += start;
+    for(a = start; a < stop; a++) {
+      int sdc_type = sdc->type;
+      int eval_flag;
+      float wt;
+      b1 = sdc->at0;
+      b2 = sdc->at1;
+
+      switch (sdc_type) {
+      case cShakerDistBond:
+        eval_flag = cSculptBond & mask;
+        wt = J->bond_wt;
+        break;
+      case cShakerDistAngle:
+        eval_flag = cSculptAngl & mask;
+        wt = J->angl_wt;
+        break;
+      case cShakerDistLimit:
+        eval_flag = cSculptTri & mask;
+        wt = J->tri_wt;
+        break;
+      case cShakerDistMinim:
+        eval_flag = cSculptMin & mask;
+        wt = J->min_wt * sdc->weight;
+        break;
+      case cShakerDistMaxim:
+        eval_flag = cSculptMax & mask;
+        wt = J->max_wt * sdc->weight;
+        break;
+      default:
+        eval_flag = false;
+        wt = 0.0F;
+        break;
+      }
+
+      if(eval_flag && !(exclude[b1] || exclude[b2])) {
+        a1 = atm2idx[b1];       /* coordinate set indices */
+        a2 = atm2idx[b2];
+        if((a1 >= 0) && (a2 >= 0)) {
+          v1 = cs_coord + 3 * a1;
+          v2 = cs_coord + 3 * a2;
+          switch (sdc_type) {
+          case cShakerDistLimit:
+            strain =
+              ShakerDoDistLimit(sdc->targ * J->tri_sc, v1, v2, disp + b1 * 3,
+                                disp + b2 * 3, wt);
+            if(strain > 0.0F) {
+              cnt[b1]++;
+              cnt[b2]++;
+              part->strain += strain;
+              part->count++;
+            }
+            break;
+          case cShakerDistMaxim:
+            strain =
+              ShakerDoDistLimit(sdc->targ * J->max_sc, v1, v2, disp + b1 * 3,
+                                disp + b2 * 3, wt);
+            if(strain > 0.0F) {
+              cnt[b1]++;
+              cnt[b2]++;
+              part->strain += strain;
+              part->count++;
+            }
+            break;
+          case cShakerDistMinim:
+            strain =
+              ShakerDoDistMinim(sdc->targ * J->min_sc, v1, v2, disp + b1 * 3,
+                                disp + b2 * 3, wt, b1, b2);
+            if(strain > 0.0F) {
+              cnt[b1]++;
+              cnt[b2]++;
+              part->strain += strain;
+              part->count++;
+            }
+            break;
+          default:
+            part->strain +=
+              ShakerDoDist(sdc->targ, v1, v2, disp + b1 * 3, disp + b2 * 3, wt,
+                           b1, b2);
+            cnt[b1]++;
+            cnt[b2]++;
+            part->count++;
+          }
+        }
+      }
+      sdc++;
+    }
+  }
+
+  /* apply line constraints */
+
+  if(cSculptLine & mask) {
+    ShakerLineCon *slc = shk->LineCon;
+    SculptPartRange(shk->NLineCon, index, n_part, &start, &stop);
+    slc += start;
+    for(a = start; a < stop; a++) {
+      b0 = slc->at0;
+      b1 = slc->at1;
+      b2 = slc->at2;
+      a0 = atm2idx[b0];         /* coordinate set indices */
+      a1 = atm2idx[b1];
+      a2 = atm2idx[b2];
+
+      if((a0 >= 0) && (a1 >= 0) && (a2 >= 0)
+         && !(exclude[b0] || exclude[b1] || exclude[b2])) {
+        cnt[b0]++;
+        cnt[b1]++;
+        cnt[b2]++;
+        v0 = cs_coord + 3 * a0;
+        v1 = cs_coord + 3 * a1;
+        v2 = cs_coord + 3 * a2;
+        part->strain +=
+          ShakerDoLine(v0, v1, v2, disp + b0 * 3, disp + b1 * 3, disp + b2 * 3,
+                       J->line_wt);
+        part->count++;
+      }
+      slc++;
+    }
+  }
+
+  /* apply pyramid constraints */
+
+  if(cSculptPyra & mask) {
+    ShakerPyraCon *spc = shk->PyraCon;
+    SculptPartRange(shk->NPyraCon, index, n_part, &start, &stop);
+    spc += start;
+    for(a = start; a < stop; a++) {
+
+      b0 = spc->at0;
+      b1 = spc->at1;
+      b2 = spc->at2;
+      b3 = spc->at3;
+      a0 = atm2idx[b0];
+      a1 = atm2idx[b1];
+      a2 = atm2idx[b2];
+      a3 = atm2idx[b3];
+
+      if((a0 >= 0) && (a1 >= 0) && (a2 >= 0) && (a3 >= 0)
+         && !(exclude[b0] || exclude[b1] || exclude[b2] || exclude[b3])) {
+        v0 = cs_coord + 3 * a0;
+        v1 = cs_coord + 3 * a1;
+        v2 = cs_coord + 3 * a2;
+        v3 = cs_coord + 3 * a3;
+        part->strain += ShakerDoPyra(spc->targ1,
+                                     spc->targ2,
+                                     v0, v1, v2, v3,
+                                     disp + b0 * 3,
+                                     disp + b1 * 3,
+                                     disp + b2 * 3,
+                                     disp + b3 * 3, J->pyra_wt, J->pyra_inv_wt);
+        part->count++;
+
+        cnt[b0]++;
+        cnt[b1]++;
+        cnt[b2]++;
+        cnt[b3]++;
+      }
+      spc++;
+    }
+  }
+
+  /* apply planarity constraints */
+
+  if(cSculptPlan & mask) {
+    ShakerPlanCon *snc = shk->PlanCon;
+    SculptPartRange(shk->NPlanCon, index, n_part, &start, &stop);
+    snc += start;
+    for(a = start; a < stop; a++) {
+
+      b0 = snc->at0;
+      b1 = snc->at1;
+      b2 = snc->at2;
+      b3 = snc->at3;
+      a0 = atm2idx[b0];
+      a1 = atm2idx[b1];
+      a2 = atm2idx[b2];
+      a3 = atm2idx[b3];
+
+      if((a0 >= 0) && (a1 >= 0) && (a2 >= 0) && (a3 >= 0)
+         && !(exclude[b0] || exclude[b1] || exclude[b2] || exclude[b3])) {
+        v0 = cs_coord + 3 * a0;
+        v1 = cs_coord + 3 * a1;
+        v2 = cs_coord + 3 * a2;
+        v3 = cs_coord + 3 * a3;
+        part->strain += ShakerDoPlan(v0, v1, v2, v3,
+                                     disp + b0 * 3,
+                                     disp + b1 * 3,
+                                     disp + b2 * 3,
+                                     disp + b3 * 3,
+                                     snc->target, snc->fixed, J->plan_wt);
+        part->count++;
+        cnt[b0]++;
+        cnt[b1]++;
+        cnt[b2]++;
+        cnt[b3]++;
+      }
+
+      snc++;
+    }
+  }
+
+  /* apply torsion constraints */
+
+  if(cSculptTors & mask) {
+    ShakerTorsCon *stc = shk->TorsCon;
+    SculptPartRange(shk->NTorsCon, index, n_part, &start, &stop);
+    stc += start;
+    for(a = start; a < stop; a++) {
+
+      b0 = stc->at0;
+      b1 = stc->at1;
+      b2 = stc->at2;
+      b3 = stc->at3;
+      a0 = atm2idx[b0];
+      a1 = atm2idx[b1];
+      a2 = atm2idx[b2];
+      a3 = atm2idx[b3];
+
+      if((a0 >= 0) && (a1 >= 0) && (a2 >= 0) && (a3 >= 0)
+         && !(exclude[b0] || exclude[b1] || exclude[b2] || exclude[b3])) {
+        v0 = cs_coord + 3 * a0;
+        v1 = cs_coord + 3 * a1;
+        v2 = cs_coord + 3 * a2;
+        v3 = cs_coord + 3 * a3;
+        part->strain += ShakerDoTors(stc->type,
+                                     v0, v1, v2, v3,
+                                     disp + b0 * 3,
+                                     disp + b1 * 3,
+                                     disp + b2 * 3,
+                                     disp + b3 * 3, J->tors_tole, J->tors_wt);
+        part->count++;
+        cnt[b0]++;
+        cnt[b1]++;
+        cnt[b2]++;
+        cnt[b3]++;
+      }
+      stc++;
+    }
+  }
+
+  /* apply nonbonded interactions */
+
+  if(J->nb_flag) {
+    SculptPartRange(J->I->NB.n_pair, index, n_part, &start, &stop);
+    SculptEvalPairs(J, part, start, stop);
+  }
+}
+
+static void SculptEvalTask(void *ctx, int index)
+{
+  SculptEvalPart((SculptJob *) ctx, index);
+}
+
 float SculptIterateObject(CSculpt * I, ObjectMolecule * obj,
                           int state, int n_cycle, float *center)
 {
   PyMOLGlobals *G = I->G;
   CShaker *shk;
-  int a0, a1, a2, a3, b0, b3;
+  int a1;
   int aa;
   CoordSet *cs;
   float *disp = NULL;
-  float *v, *v0, *v1, *v2, *v3;
-  float diff[3], len;
+  float *v1, *v2;
   int *atm2idx = NULL;
   int *cnt = NULL;
-  int *i;
-  int hash;
-  int nb_next;
-  int h, k, l;
-  int offset;
-  float cutoff, vdw_cutoff;
-  int ex;
-  int eval_flag;
   int mask;
-  float wt;
-  float vdw;
-  float vdw14;
-  float vdw_wt;
-  float vdw_wt14;
-  float bond_wt;
-  float angl_wt;
-  float pyra_wt, pyra_inv_wt;
-  float plan_wt;
-  float line_wt;
-  float tors_wt;
-  float tors_tole;
   int active_flag = false;
-  float hb_overlap, hb_overlap_base;
   int *active, n_active;
   int *exclude;
-  AtomInfoType *ai0, *ai1;
+  AtomInfoType *ai0;
   double task_time;
-  float vdw_magnify, vdw_magnified = 1.0F;
+  float vdw_magnify;
   int nb_skip, nb_skip_count;
-  float total_strain = 0.0F, strain;
+  float total_strain = 0.0F;
   int total_count = 1;
   CGO *cgo = NULL;
-  float good_color[3] = { 0.2, 1.0, 0.2 };
-  float bad_color[3] = { 1.0, 0.2, 0.2 };
   int vdw_vis_mode;
-  float vdw_vis_min = 0.0F, vdw_vis_mid = 0.0F, vdw_vis_max = 0.0F;
-  float tri_sc, tri_wt;
-  float min_sc, min_wt;
-  float max_sc = 1.025F, max_wt = 0.75F;
   float *cs_coord;
   float solvent_radius;
-  float avd_wt, avd_gp, avd_rg;
-  int avd_ex;
+  float nb_radius = 0.0F, nb_skin;
+  int nb_min_ex = 3;
+  int n_part_max = 1;
+  SculptJob job;
+  SculptPart *part = NULL;
 
   PRINTFD(G, FB_Sculpt)
     " SculptIterateObject-Debug: entered state=%d n_cycle=%d\n", state, n_cycle ENDFD;
@@ -1714,54 +2224,72 @@ float SculptIterateObject(CSculpt * I, ObjectMolecule * obj,
     cs = obj->CSet[state];
     cs_coord = cs->Coord;
 
-    vdw = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_vdw_scale);
-    vdw14 = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_vdw_scale14);
-    vdw_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_vdw_weight);
-    vdw_wt14 =
+    job.I = I;
+    job.obj = obj;
+    job.cs_coord = cs_coord;
+    job.atm2idx = atm2idx;
+    job.exclude = exclude;
+    job.vdw = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_vdw_scale);
+    job.vdw14 =
+      SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_vdw_scale14);
+    job.vdw_wt =
+      SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_vdw_weight);
+    job.vdw_wt14 =
       SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_vdw_weight14);
-    bond_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_bond_weight);
-    angl_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_angl_weight);
-    pyra_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_pyra_weight);
-    pyra_inv_wt =
+    job.bond_wt =
+      SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_bond_weight);
+    job.angl_wt =
+      SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_angl_weight);
+    job.pyra_wt =
+      SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_pyra_weight);
+    job.pyra_inv_wt =
       SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_pyra_inv_weight);
-    plan_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_plan_weight);
-    line_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_line_weight);
-    tri_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_tri_weight);
-    tri_sc = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_tri_scale);
-
-    min_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_min_weight);
-    min_sc = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_min_scale);
-    max_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_max_weight);
-    max_sc = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_max_scale);
+    job.plan_wt =
+      SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_plan_weight);
+    job.line_wt =
+      SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_line_weight);
+    job.tri_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_tri_weight);
+    job.tri_sc = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_tri_scale);
+
+    job.min_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_min_weight);
+    job.min_sc = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_min_scale);
+    job.max_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_max_weight);
+    job.max_sc = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_max_scale);
 
     mask = SettingGet_i(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_field_mask);
-    hb_overlap =
+    job.mask = mask;
+    job.hb_overlap =
       SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_hb_overlap);
-    hb_overlap_base =
+    job.hb_overlap_base =
       SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_hb_overlap_base);
-    tors_tole =
+    job.tors_tole =
       SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_tors_tolerance);
-    tors_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_tors_weight);
+    job.tors_wt =
+      SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_tors_weight);
     vdw_vis_mode =
       SettingGet_i(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_vdw_vis_mode);
+    job.vdw_vis_mode = vdw_vis_mode;
     solvent_radius =
       SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_solvent_radius);
 
-    avd_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_avd_weight);
-    avd_gp = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_avd_gap);
-    avd_rg = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_avd_range);
-    avd_ex = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_avd_excl);
-    if(avd_gp < 0.0F)
-      avd_gp = 1.5F * solvent_radius;
-    if(avd_rg < 0.0F)
-      avd_rg = solvent_radius;
-
+    job.avd_wt = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_avd_weight);
+    job.avd_gp = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_avd_gap);
+    job.avd_rg = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_avd_range);
+    job.avd_ex = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_avd_excl);
+    if(job.avd_gp < 0.0F)
+      job.avd_gp = 1.5F * solvent_radius;
+    if(job.avd_rg < 0.0F)
+      job.avd_rg = solvent_radius;
+    job.avd_range = solvent_radius * 0.75;
+    nb_skin = SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_nb_skin);
+
+    job.vdw_vis_min = job.vdw_vis_mid = job.vdw_vis_max = 0.0F;
     if(vdw_vis_mode) {
-      vdw_vis_min =
+      job.vdw_vis_min =
         SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_vdw_vis_min);
-      vdw_vis_mid =
+      job.vdw_vis_mid =
         SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_vdw_vis_mid);
-      vdw_vis_max =
+      job.vdw_vis_max =
         SettingGet_f(G, cs->Setting, obj->Obj.Setting, cSetting_sculpt_vdw_vis_max);
 
       if(!cs->SculptCGO)
@@ -1783,6 +2311,7 @@ float SculptIterateObject(CSculpt * I, ObjectMolecule * obj,
     ai0 = obj->AtomInfo;
     {
       int a;
+      float max_vdw = 0.0F;
       for(a = 0; a < obj->NAtom; a++) {
         if(ai0->flags & cAtomFlag_exclude) {
           exclude[a] = true;
@@ -1802,13 +2331,57 @@ float SculptIterateObject(CSculpt * I, ObjectMolecule * obj,
           active_flag = true;
           active[n_active] = a;
           n_active++;
+          if(max_vdw < ai0->vdw)
+            max_vdw = ai0->vdw;
         }
         atm2idx[a] = a1;
         ai0++;
       }
+
+      /* the non-bonded pair list must cover the largest cutoff in use */
+      if((cSculptVDW | cSculptVDW14) & mask) {
+        nb_radius = 2 * max_vdw * ((job.vdw > job.vdw14) ? job.vdw : job.vdw14);
+      } else {
+        nb_min_ex = job.avd_ex;
+      }
+      if(cSculptAvoid & mask) {
+        float avd_radius = 2 * max_vdw + job.avd_gp + job.avd_rg;
+        if(nb_radius < avd_radius)
+          nb_radius = avd_radius;
+        if(nb_min_ex > job.avd_ex)
+          nb_min_ex = job.avd_ex;
+      }
     }
 
     if(active_flag) {
+      int n_term = shk->NDistCon + shk->NLineCon + shk->NPyraCon +
+        shk->NPlanCon + shk->NTorsCon;
+
+      /* displacements are accumulated per part (SCULPT_N_PART of them) and
+         summed at the end of each cycle; part 0 is disp/cnt itself */
+      if(n_term + n_active * 20 >= SCULPT_PAR_MIN)
+        n_part_max = SCULPT_N_PART;
+      part = Calloc(SculptPart, n_part_max);
+      if(part) {
+        int t;
+        part[0].disp = disp;
+        part[0].cnt = cnt;
+        for(t = 1; t < n_part_max; t++) {
+          part[t].disp = Alloc(float, 3 * obj->NAtom);
+          part[t].cnt = Alloc(int, obj->NAtom);
+          if(!(part[t].disp && part[t].cnt))
+            break;
+        }
+        if(t < n_part_max) {
+          /* run serially rather than with some other number of parts */
+          for(; t > 0; t--) {
+            FreeP(part[t].disp);
+            FreeP(part[t].cnt);
+          }
+          n_part_max = 1;
+        }
+      }
+      job.part = part;
 
       /* first, create coordinate -> vertex mapping */
       /* and count number of constraints */
@@ -1835,497 +2408,75 @@ float SculptIterateObject(CSculpt * I, ObjectMolecule * obj,
         }
       }
 
-      while(n_cycle--) {
-
-        total_strain = 0.0F;
-        total_count = 0;
-        /* initialize displacements to zero */
-
-        v = disp;
-        i = cnt;
-        for(aa = 0; aa < n_active; aa++) {
-          int a = active[aa];
-          v = disp + a * 3;
-          cnt[a] = 0;
-          *(v) = 0.0F;
-          *(v + 1) = 0.0F;
-          *(v + 2) = 0.0F;
-        }
-
-        /* apply distance constraints */
-
-        {
-          ShakerDistCon *sdc = shk->DistCon;
-          int a,ndc = shk->NDistCon;
-          for(a = 0; a < ndc; a++) {
-            int sdc_type = sdc->type;
-            int b1 = sdc->at0;
-            int b2 = sdc->at1;
-
-            switch (sdc_type) {
-            case cShakerDistBond:
-              eval_flag = cSculptBond & mask;
-              wt = bond_wt;
-              break;
-            case cShakerDistAngle:
-              eval_flag = cSculptAngl & mask;
-              wt = angl_wt;
-              break;
-            case cShakerDistLimit:
-              eval_flag = cSculptTri & mask;
-              wt = tri_wt;
-              break;
-            case cShakerDistMinim:
-              eval_flag = cSculptMin & mask;
-              wt = min_wt * sdc->weight;
-              break;
-            case cShakerDistMaxim:
-              eval_flag = cSculptMax & mask;
-              wt = max_wt * sdc->weight;
-              break;
-            default:
-              eval_flag = false;
-              wt = 0.0F;
-              break;
-            }
-
-            if(eval_flag && !(exclude[b1] || exclude[b2])) {
-              a1 = atm2idx[b1]; /* coordinate set indices */
-              a2 = atm2idx[b2];
-              if((a1 >= 0) && (a2 >= 0)) {
-                v1 = cs_coord + 3 * a1;
-                v2 = cs_coord + 3 * a2;
-                switch (sdc_type) {
-                case cShakerDistLimit:
-                  strain =
-                    ShakerDoDistLimit(sdc->targ * tri_sc, v1, v2, disp + b1 * 3,
-                                      disp + b2 * 3, wt);
-                  if(strain > 0.0F) {
-                    cnt[b1]++;
-                    cnt[b2]++;
-                    total_strain += strain;
-                    total_count++;
-                  }
-                  break;
-                case cShakerDistMaxim:
-                  strain =
-                    ShakerDoDistLimit(sdc->targ * max_sc, v1, v2, disp + b1 * 3,
-                                      disp + b2 * 3, wt);
-                  if(strain > 0.0F) {
-                    cnt[b1]++;
-                    cnt[b2]++;
-                    total_strain += strain;
-                    total_count++;
-                  }
-                  break;
-                case cShakerDistMinim:
-                  strain =
-                    ShakerDoDistMinim(sdc->targ * min_sc, v1, v2, disp + b1 * 3,
-                                      disp + b2 * 3, wt);
-                  if(strain > 0.0F) {
-                    cnt[b1]++;
-                    cnt[b2]++;
-                    total_strain += strain;
-                    total_count++;
-                  }
-                  break;
-                default:
-                  total_strain +=
-                    ShakerDoDist(sdc->targ, v1, v2, disp + b1 * 3, disp + b2 * 3, wt);
-                  cnt[b1]++;
-                  cnt[b2]++;
-                  total_count++;
-                }
-              }
-            }
-            sdc++;
-          }
-        }
-        /* apply line constraints */
-
-        if(cSculptLine & mask) {
-          ShakerLineCon *slc = shk->LineCon;
-          int nlc = shk->NLineCon;
-          int a,b1,b2;
-          for(a = 0; a < nlc; a++) {
-            b0 = slc->at0;
-            b1 = slc->at1;
-            b2 = slc->at2;
-            a0 = atm2idx[b0];   /* coordinate set indices */
-            a1 = atm2idx[b1];
-            a2 = atm2idx[b2];
-
-            if((a0 >= 0) && (a1 >= 0) && (a2 >= 0)
-               && !(exclude[b0] || exclude[b1] || exclude[b2])) {
-              cnt[b0]++;
-              cnt[b1]++;
-              cnt[b2]++;
-              v0 = cs_coord + 3 * a0;
-              v1 = cs_coord + 3 * a1;
-              v2 = cs_coord + 3 * a2;
-              total_strain +=
-                ShakerDoLine(v0, v1, v2, disp + b0 * 3, disp + b1 * 3, disp + b2 * 3,
-                             line_wt);
-              total_count++;
-            }
-            slc++;
-          }
-        }
-
-        /* apply pyramid constraints */
-
-        if(cSculptPyra & mask) {
-          ShakerPyraCon *spc = shk->PyraCon;
-          int npc = shk->NPyraCon;
-          int a,b1,b2;
-          for(a = 0; a < npc; a++) {
-
-            b0 = spc->at0;
-            b1 = spc->at1;
-            b2 = spc->at2;
-            b3 = spc->at3;
-            a0 = atm2idx[b0];
-            a1 = atm2idx[b1];
-            a2 = atm2idx[b2];
-            a3 = atm2idx[b3];
-
-            if((a0 >= 0) && (a1 >= 0) && (a2 >= 0) && (a3 >= 0)
-               && !(exclude[b0] || exclude[b1] || exclude[b2] || exclude[b3])) {
-              v0 = cs_coord + 3 * a0;
-              v1 = cs_coord + 3 * a1;
-              v2 = cs_coord + 3 * a2;
-              v3 = cs_coord + 3 * a3;
-              total_strain += ShakerDoPyra(spc->targ1,
-                                           spc->targ2,
-                                           v0, v1, v2, v3,
-                                           disp + b0 * 3,
-                                           disp + b1 * 3,
-                                           disp + b2 * 3,
-                                           disp + b3 * 3, pyra_wt, pyra_inv_wt);
-              total_count++;
-
-              cnt[b0]++;
-              cnt[b1]++;
-              cnt[b2]++;
-              cnt[b3]++;
-            }
-            spc++;
-          }
-        }
-
-        if(cSculptPlan & mask) {
-          ShakerPlanCon *snc = shk->PlanCon;
-          int npc = shk->NPlanCon;
-          int a,b1,b2;
-          /* apply planarity constraints */
-
-          snc = shk->PlanCon;
-          for(a = 0; a < npc; a++) {
-
-            b0 = snc->at0;
-            b1 = snc->at1;
-            b2 = snc->at2;
-            b3 = snc->at3;
-            a0 = atm2idx[b0];
-            a1 = atm2idx[b1];
-            a2 = atm2idx[b2];
-            a3 = atm2idx[b3];
-
-            if((a0 >= 0) && (a1 >= 0) && (a2 >= 0) && (a3 >= 0)
-               && !(exclude[b0] || exclude[b1] || exclude[b2] || exclude[b3])) {
-              v0 = cs_coord + 3 * a0;
-              v1 = cs_coord + 3 * a1;
-              v2 = cs_coord + 3 * a2;
-              v3 = cs_coord + 3 * a3;
-              total_strain += ShakerDoPlan(v0, v1, v2, v3,
-                                           disp + b0 * 3,
-                                           disp + b1 * 3,
-                                           disp + b2 * 3,
-                                           disp + b3 * 3,
-                                           snc->target, snc->fixed, plan_wt);
-              total_count++;
-              cnt[b0]++;
-              cnt[b1]++;
-              cnt[b2]++;
-              cnt[b3]++;
-            }
+      while(part && n_cycle--) {
+        int t, n_part;
 
-            snc++;
-          }
-        }
-
-        /* apply torsion constraints */
-
-        if(cSculptTors & mask) {
-          ShakerTorsCon *stc = shk->TorsCon;
-          int ntc = shk->NTorsCon;
-          int a,b1,b2;
-          /* apply planarity constraints */
-
-          for(a = 0; a < ntc; a++) {
-
-            b0 = stc->at0;
-            b1 = stc->at1;
-            b2 = stc->at2;
-            b3 = stc->at3;
-            a0 = atm2idx[b0];
-            a1 = atm2idx[b1];
-            a2 = atm2idx[b2];
-            a3 = atm2idx[b3];
-
-            if((a0 >= 0) && (a1 >= 0) && (a2 >= 0) && (a3 >= 0)
-               && !(exclude[b0] || exclude[b1] || exclude[b2] || exclude[b3])) {
-              v0 = cs_coord + 3 * a0;
-              v1 = cs_coord + 3 * a1;
-              v2 = cs_coord + 3 * a2;
-              v3 = cs_coord + 3 * a3;
-              total_strain += ShakerDoTors(stc->type,
-                                           v0, v1, v2, v3,
-                                           disp + b0 * 3,
-                                           disp + b1 * 3,
-                                           disp + b2 * 3,
-                                           disp + b3 * 3, tors_tole, tors_wt);
-              total_count++;
-              cnt[b0]++;
-              cnt[b1]++;
-              cnt[b2]++;
-              cnt[b3]++;
-            }
-            stc++;
-          }
-        }
         /* apply nonbonded interactions */
 
+        job.nb_flag = false;
+        job.cgo = NULL;
         if((n_cycle > 0) && (nb_skip_count > 0)) {
           /*skip and then weight extra */
           nb_skip_count--;
           vdw_magnify += 1.0F;
         } else {
-          int nb_off0, nb_off1;
-          int v0i, v1i, v2i;
-          int x0i;
-          int don_b0;
-          int acc_b0;
-          int b1;
-          vdw_magnified = vdw_magnify;
+          job.vdw_magnified = vdw_magnify;
           vdw_magnify = 1.0F;
 
           nb_skip_count = nb_skip;
           if((cSculptVDW | cSculptVDW14 | cSculptAvoid) & mask) {
-            /* compute non-bonded interations */
+            job.nb_flag = SculptUpdateNBList(I, cs, cs_coord, atm2idx, active, n_active,
+                                             nb_radius, nb_skin, nb_min_ex);
+            if(vdw_vis_mode && cgo && (n_cycle < 1))
+              job.cgo = cgo;
+          }
+        }
 
-            /* construct nonbonded hash */
+        n_part = n_part_max;
+        if(job.cgo || (n_term + (job.nb_flag ? I->NB.n_pair : 0) < SCULPT_PAR_MIN))
+          n_part = 1;
+        job.n_part = n_part;
 
-            nb_next = 1;
-            for(aa = 0; aa < n_active; aa++) {
-              b0 = active[aa];
-              a0 = atm2idx[b0];
-              VLACheck(I->NBList, int, nb_next + 2);
-              v0 = cs_coord + 3 * a0;
-              hash = nb_hash(v0);
-              i = I->NBList + nb_next;
-              *(i++) = *(I->NBHash + hash);
-              *(i++) = hash;
-              *(i++) = b0;
-              *(I->NBHash + hash) = nb_next;
-              nb_next += 3;
-            }
+        /* initialize displacements to zero */
 
-            /* find neighbors for each atom */
-            if((cSculptVDW | cSculptVDW14) & mask) {
-              for(aa = 0; aa < n_active; aa++) {
-                b0 = active[aa];
-                a0 = atm2idx[b0];
-                ai0 = obj->AtomInfo + b0;
-                v0 = cs_coord + 3 * a0;
-                don_b0 = I->Don[b0];
-                acc_b0 = I->Acc[b0];
-                v0i = (int) (*v0);
-                v1i = (int) (*(v0 + 1));
-                v2i = (int) (*(v0 + 2));
-                x0i = ex_hash_i0(b0);
-                for(h = -4; h < 5; h += 4) {
-                  nb_off0 = nb_hash_off_i0(v0i, h);
-                  for(k = -4; k < 5; k += 4) {
-                    nb_off1 = nb_off0 | nb_hash_off_i1(v1i, k);
-                    for(l = -4; l < 5; l += 4) {
-                      /*  offset = *(I->NBHash+nb_hash_off(v0,h,k,l)); */
-                      offset = *(I->NBHash + (nb_off1 | nb_hash_off_i2(v2i, l)));
-                      while(offset) {
-                        i = I->NBList + offset;
-                        b1 = *(i + 2);
-                        if(b1 > b0) {
-                          /* determine exclusion (if any) */
-                          {
-                            int xoffset;
-                            int *I_EXList = I->EXList;
-                            int ex1;
-                            int *j;
-                            xoffset = *(I->EXHash + (x0i | ex_hash_i1(b1)));
-                            ex = 10;
-                            while(xoffset) {
-                              xoffset = (*(j = I_EXList + xoffset));
-                              if((*(j + 1) == b0) && (*(j + 2) == b1)) {
-                                ex1 = *(j + 3);
-                                if(ex1 < ex) {
-                                  ex = ex1;
-                                }
-                              }
-                            }
-                          }
-                          if(ex > 3) {
-                            ai1 = obj->AtomInfo + b1;
-                            cutoff = ai0->vdw + ai1->vdw;
-
-                            if(ex == 10) {      /* standard interaction -- no exclusion */
-                              if(don_b0 && I->Acc[b1]) {        /* h-bond */
-                                if(ai0->protons == cAN_H) {
-                                  cutoff -= hb_overlap;
-                                } else {
-                                  cutoff -= hb_overlap_base;
-                                }
-                              } else if(acc_b0 && I->Don[b1]) { /* h-bond */
-                                if(ai1->protons == cAN_H) {
-                                  cutoff -= hb_overlap;
-                                } else {
-                                  cutoff -= hb_overlap_base;
-                                }
-                              }
-                              if(cSculptVDW & mask) {
-                                vdw_cutoff = cutoff * vdw;
-                                wt = vdw_wt * vdw_magnified;
-                                a1 = atm2idx[b1];
-                                v1 = cs_coord + 3 * a1;
-                                if(vdw_vis_mode && cgo && (n_cycle < 1)
-                                   && ((!((ai0->protekted && ai1->protekted)
-                                          || (ai0->flags & ai1->flags & cAtomFlag_fix))
-                                       ) || (ai0->flags & cAtomFlag_study)
-                                       || (ai1->flags & cAtomFlag_study))) {
-                                  SculptCGOBump(v0, v1, ai0->vdw, ai1->vdw, cutoff,
-                                                vdw_vis_min, vdw_vis_mid, vdw_vis_max,
-                                                good_color, bad_color, vdw_vis_mode, cgo);
-                                }
-                                if(SculptCheckBump(v0, v1, diff, &len, vdw_cutoff))
-                                  if(SculptDoBump(vdw_cutoff, len, diff,
-                                                  disp + b0 * 3, disp + b1 * 3, wt,
-                                                  &total_strain)) {
-                                    cnt[b0]++;
-                                    cnt[b1]++;
-                                    total_count++;
-                                  }
-                              }
-                            } else if(ex == 4) {        /* 1-4 interation */
-                              cutoff *= vdw14;
-                              wt = vdw_wt14 * vdw_magnified;
-
-                              if(cSculptVDW14 & mask) {
-                                a1 = atm2idx[b1];
-                                v1 = cs_coord + 3 * a1;
-                                if(SculptCheckBump(v0, v1, diff, &len, cutoff)) {
-                                  if(SculptDoBump(cutoff, len, diff,
-                                                  disp + b0 * 3, disp + b1 * 3, wt,
-                                                  &total_strain)) {
-                                    cnt[b0]++;
-                                    cnt[b1]++;
-                                    total_count++;
-                                  }
-                                }
-                              }
-                            } else if(ex == 5) {
-                              /* do nothing */
-                            }
-                          }
-                        }
-                        offset = (*i);
-                      }
-                    }
-                  }
-                }
-              }
-            }
+        for(t = 0; t < n_part; t++) {
+          float *t_disp = part[t].disp;
+          int *t_cnt = part[t].cnt;
+          for(aa = 0; aa < n_active; aa++) {
+            int a = active[aa];
+            float *v = t_disp + a * 3;
+            t_cnt[a] = 0;
+            *(v) = 0.0F;
+            *(v + 1) = 0.0F;
+            *(v + 2) = 0.0F;
+          }
+          part[t].strain = 0.0F;
+          part[t].count = 0;
+        }
 
-            if(cSculptAvoid & mask) {
-              float target;
-              float range = solvent_radius * 0.75;
-              /* tweak nb distances to avoid
-                 sitting in the surface
-                 rendition danger zone for too
-                 long (vdw1+vdw2+0.75*solvent) */
-              for(aa = 0; aa < n_active; aa++) {
-                b0 = active[aa];
-                a0 = atm2idx[b0];
-                ai0 = obj->AtomInfo + b0;
-                v0 = cs_coord + 3 * a0;
-                don_b0 = I->Don[b0];
-                acc_b0 = I->Acc[b0];
-                v0i = (int) (*v0);
-                v1i = (int) (*(v0 + 1));
-                v2i = (int) (*(v0 + 2));
-                x0i = ex_hash_i0(b0);
-                for(h = -8; h < 9; h += 4) {
-                  nb_off0 = nb_hash_off_i0(v0i, h);
-                  for(k = -8; k < 9; k += 4) {
-                    nb_off1 = nb_off0 | nb_hash_off_i1(v1i, k);
-                    for(l = -8; l < 9; l += 4) {
-                      /*  offset = *(I->NBHash+nb_hash_off(v0,h,k,l)); */
-                      offset = *(I->NBHash + (nb_off1 | nb_hash_off_i2(v2i, l)));
-                      while(offset) {
-                        i = I->NBList + offset;
-                        b1 = *(i + 2);
-                        if(b1 > b0) {
-                          /* determine exclusion (if any) */
-                          {
-                            int xoffset;
-                            int *I_EXList = I->EXList;
-                            int ex1;
-                            int *j;
-                            xoffset = *(I->EXHash + (x0i | ex_hash_i1(b1)));
-                            ex = 10;
-                            while(xoffset) {
-                              xoffset = (*(j = I_EXList + xoffset));
-                              if((*(j + 1) == b0) && (*(j + 2) == b1)) {
-                                ex1 = *(j + 3);
-                                if(ex1 < ex) {
-                                  ex = ex1;
-                                }
-                              }
-                            }
-                          }
-                          if(ex > avd_ex) {     /* either non-covalent or extended chain */
-                            ai1 = obj->AtomInfo + b1;
-                            target = ai0->vdw + ai1->vdw + avd_gp;
-                            a1 = atm2idx[b1];
-                            v1 = cs_coord + 3 * a1;
-
-                            if(SculptCheckAvoid(v0, v1, diff, &len, target, avd_rg)) {
-                              if(SculptDoAvoid(target, range, len, diff,
-                                               disp + b0 * 3, disp + b1 * 3, avd_wt,
-                                               &total_strain)) {
-                                cnt[b0]++;
-                                cnt[b1]++;
-                                total_count++;
-                              }
-                            }
-                          }
-                        }
-                        offset = (*i);
-                      }
-                    }
-                  }
-                }
-              }
-            }
+        if(n_part > 1)
+          TaskPoolRun(G, 0, n_part, SculptEvalTask, &job);
+        else
+          SculptEvalPart(&job, 0);
 
-            /* clean up nonbonded hash */
+        /* reduce the parts in order */
 
-            i = I->NBList + 2;
-            while(nb_next > 1) {
-              *(I->NBHash + *i) = 0;
-              i += 3;
-              nb_next -= 3;
+        total_strain = part[0].strain;
+        total_count = part[0].count;
+        for(t = 1; t < n_part; t++) {
+          float *t_disp = part[t].disp;
+          int *t_cnt = part[t].cnt;
+          for(aa = 0; aa < n_active; aa++) {
+            int a = active[aa];
+            if(t_cnt[a]) {
+              cnt[a] += t_cnt[a];
+              add3f(t_disp + a * 3, disp + a * 3, disp + a * 3);
             }
           }
+          total_strain += part[t].strain;
+          total_count += part[t].count;
         }
+
         /* average the displacements */
 
         if(n_cycle >= 0) {
@@ -2389,6 +2540,15 @@ float SculptIterateObject(CSculpt * I, ObjectMolecule * obj,
         }
       }
 
+      if(part) {
+        int t;
+        for(t = 1; t < n_part_max; t++) {
+          FreeP(part[t].disp);
+          FreeP(part[t].cnt);
+        }
+        FreeP(part);
+      }
+
       task_time = UtilGetSeconds(G) - task_time;
       PRINTFB(G, FB_Sculpt, FB_Blather)
         " Sculpt: %2.5f seconds %8.3f %d %8.3f\n", task_time, total_strain, total_count,
@@ -2431,10 +2591,11 @@ void SculptFree(CSculpt * I)
 {
   VLAFreeP(I->Don);
   VLAFreeP(I->Acc);
-  VLAFreeP(I->NBList);
+  VLAFreeP(I->NB.active);
+  VLAFreeP(I->NB.ref);
+  VLAFreeP(I->NB.pair);
   VLAFreeP(I->EXList);
 
-  FreeP(I->NBHash);
   FreeP(I->EXHash);
   ShakerFree(I->Shaker);
   OOFreeP(I);
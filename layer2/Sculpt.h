@@ -33,12 +33,24 @@ Z* -------------------------------------------------------------------
 #define cSculptMax   0x400
 #define cSculptAvoid 0x800
 
+/* non-bonded pairs of active atoms, valid while no atom has moved more
+   than half of (radius - cutoff) away from its reference position */
+typedef struct {
+  CoordSet *cs;
+  int n_active;
+  int *active;                  /* VLA: atoms the list was built for */
+  float *ref;                   /* VLA: their coordinates at build time */
+  float radius;
+  int min_ex;
+  int *pair;                    /* VLA: b0, b1, exclusion */
+  int n_pair;
+} SculptNBList;
+
 typedef struct CSculpt {
   PyMOLGlobals *G;
   CShaker *Shaker;
   ObjectMolecule *Obj;
-  int *NBHash;
-  int *NBList;
+  SculptNBList NB;
   int *EXHash;
   int *EXList;
   int *Don;
@@ -83,6 +83,10 @@ public:
 
   void reset();
   bool next();
+
+  int getState() {
+    return state;
+  }
 };
 
 /*
@@ -80,6 +80,7 @@
 
 #include "MovieScene.h"
 #include "Texture.h"
+#include "TaskPool.h"
 
 #ifndef _PYMOL_NOPY
 #include "ce_types.h"
@@ -6785,6 +6786,7 @@ int ExecutiveMapSet(PyMOLGlobals * G, const char *name, int operator_, const cha
         /* copy after calculation so that operand can include target */
 
         memcpy(ms->Field->data->data, l_value, n_pnt * sizeof(float));
+        IsofieldInvalidate(ms->Field);
 
         FreeP(present);
         FreeP(l_value);
@@ -6975,8 +6977,12 @@ int ExecutiveMapNew(PyMOLGlobals * G, const char *name, int type, float *grid,
               }
               if(!ms->Active)
                 ObjectMapStatePurge(G, ms);
-              else if(clamp_flag) {
-                ObjectMapStateClamp(ms, clamp_floor, clamp_ceiling);
+              else {
+                /* ObjectMapNewStateFromDesc may already have indexed the
+                   field before it was filled */
+                IsofieldInvalidate(ms->Field);
+                if(clamp_flag)
+                  ObjectMapStateClamp(ms, clamp_floor, clamp_ceiling);
               }
             }
             if(once_flag)
@@ -11658,6 +11664,214 @@ float *ExecutiveRMSStates(PyMOLGlobals * G, const char *s1, int target, int mode
 }
 
 
+/*========================================================================*/
+typedef struct {
+  PyMOLGlobals *G;
+  int n_state, n_atom;          /* n_state: states or objects */
+  int fit;
+  float *coord;                 /* n_atom coordinates per state */
+  double *sumsq;                /* per state sums of squared norms (fit only) */
+  int *valid;
+  float *result;
+  TaskPoolCounter next;
+} RMSMatrixJob;
+
+static void ExecutiveRMSMatrixTask(void *ctx, int index)
+{
+  RMSMatrixJob *J = (RMSMatrixJob *) ctx;
+  int n = J->n_state;
+  size_t stride = (size_t) 3 * J->n_atom;
+  int i, j;
+
+  /* rows get shorter as i grows, so hand them out one at a time */
+  while((i = J->next++) < n) {
+    const float *v1 = J->coord + i * stride;
+    J->result[(size_t) i * n + i] = J->valid[i] ? 0.0F : -1.0F;
+    for(j = i + 1; j < n; j++) {
+      float rms = -1.0F;
+      if(J->valid[i] && J->valid[j]) {
+        const float *v2 = J->coord + j * stride;
+        if(J->fit)
+          rms = MatrixGetFitRMSQCP(J->n_atom, v1, v2, J->sumsq[i], J->sumsq[j]);
+        else
+          rms = MatrixGetRMS(J->G, J->n_atom, v1, v2, NULL);
+      }
+      J->result[(size_t) i * n + j] = rms;
+      J->result[(size_t) j * n + i] = rms;
+    }
+    if(!index)
+      OrthoBusyFast(J->G, i, n);
+  }
+}
+
+
+/*========================================================================*/
+/*
+ * All-vs-all RMS matrix (fitted with QCP if fit is set) as n x n floats,
+ * over either
+ *
+ * - the states of a selection (mode 0), or
+ * - the objects of a selection in the given state (mode 1, state < 0 for
+ *   the current one), pairing their selected atoms in order, so every
+ *   object must contribute the same number of atoms.
+ *
+ * -1 marks states or objects which lack coordinates for some of their
+ * atoms.  Objects with one state stand in for every state if
+ * static_singletons is set.  Free the result with FreeP.
+ */
+float *ExecutiveRMSMatrix(PyMOLGlobals * G, const char *s1, int mode, int state,
+                          int fit, int quiet, int *n_result)
+{
+  SelectorTmp tmpsele1(G, s1);
+  int sele1 = tmpsele1.getIndex();
+  int static_singletons = SettingGetGlobal_b(G, cSetting_static_singletons);
+  RMSMatrixJob job;
+  ObjectMolecule **atom_obj = NULL;
+  int *atom_atm = NULL;
+  float *result = NULL;
+  int n_sele = 0, n_atom = 0, n = 0;
+  int ok = true;
+  int a, s;
+
+  *n_result = 0;
+  if(sele1 < 0)
+    return NULL;
+
+  SelectorUpdateTable(G, cSelectorUpdateTableAllStates, -1);
+  {
+    SeleAtomIterator iter(G, sele1);
+    while(iter.next())
+      n_sele++;
+    if(n_sele) {
+      atom_obj = Alloc(ObjectMolecule *, n_sele);
+      atom_atm = Alloc(int, n_sele);
+      CHECKOK(ok, atom_obj);
+      CHECKOK(ok, atom_atm);
+      for(a = 0, iter.reset(); ok && iter.next(); a++) {
+        atom_obj[a] = iter.obj;
+        atom_atm[a] = iter.getAtm();
+      }
+    }
+  }
+
+  if(ok && n_sele) {
+    if(mode == 1) {
+      /* the table lists each object's atoms together */
+      n = 1;
+      for(a = 1; a < n_sele; a++)
+        if(atom_obj[a] != atom_obj[a - 1])
+          n++;
+      n_atom = n_sele / n;
+      for(a = 0; ok && (a < n_sele); a++) {
+        if(atom_obj[a] != atom_obj[(a / n_atom) * n_atom]) {
+          PRINTFB(G, FB_Executive, FB_Errors)
+            " ExecutiveRMSMatrix-Error: objects must have the same number of atoms selected.\n"
+            ENDFB(G);
+          ok = false;
+        }
+      }
+      if(state < 0)
+        state = SceneGetState(G);
+    } else {
+      n = SelectorCountStates(G, sele1);
+      n_atom = n_sele;
+    }
+  }
+  if(ok && !(n && n_atom)) {
+    PRINTFB(G, FB_Executive, FB_Errors)
+      " ExecutiveRMSMatrix-Error: no atoms or states selected.\n" ENDFB(G);
+    ok = false;
+  }
+
+  job.G = G;
+  job.n_state = n;
+  job.n_atom = n_atom;
+  job.fit = fit;
+  job.coord = NULL;
+  job.sumsq = NULL;
+  job.valid = NULL;
+  job.next = 0;
+  if(ok) {
+    job.coord = Alloc(float, (size_t) n * 3 * n_atom);
+    job.sumsq = Calloc(double, n);
+    job.valid = Calloc(int, n);
+    result = Alloc(float, (size_t) n * n);
+    CHECKOK(ok, job.coord);
+    CHECKOK(ok, job.sumsq);
+    CHECKOK(ok, job.valid);
+    CHECKOK(ok, result);
+  }
+
+  /* gather (and center) the coordinates of each state or object once */
+  for(s = 0; ok && (s < n); s++) {
+    float *v = job.coord + (size_t) s * 3 * n_atom;
+    double center[3] = { 0.0, 0.0, 0.0 };
+    int first = (mode == 1) ? s * n_atom : 0;
+    int cs_state = (mode == 1) ? state : s;
+    int valid = true;
+    for(a = 0; a < n_atom; a++) {
+      ObjectMolecule *obj = atom_obj[first + a];
+      CoordSet *cs = NULL;
+      if(cs_state < obj->NCSet)
+        cs = ObjectMoleculeGetCoordSet(obj, cs_state);
+      else if(static_singletons && (obj->NCSet == 1))
+        cs = obj->CSet[0];
+      if(!(cs && CoordSetGetAtomVertex(cs, atom_atm[first + a], v + 3 * a))) {
+        valid = false;
+        break;
+      }
+      center[0] += v[3 * a];
+      center[1] += v[3 * a + 1];
+      center[2] += v[3 * a + 2];
+    }
+    job.valid[s] = valid;
+    if(valid && fit) {
+      double sumsq = 0.0;
+      for(a = 0; a < 3; a++)
+        center[a] /= n_atom;
+      for(a = 0; a < n_atom; a++) {
+        float *va = v + 3 * a;
+        va[0] -= (float) center[0];
+        va[1] -= (float) center[1];
+        va[2] -= (float) center[2];
+        sumsq += (double) va[0] * va[0] + (double) va[1] * va[1] +
+          (double) va[2] * va[2];
+      }
+      job.sumsq[s] = sumsq;
+    }
+    if(mode != 1) {
+      /* state s was copied, so streamed trajectories may drop it again */
+      for(a = 0; a < n_atom; a++)
+        if(!a || atom_obj[a] != atom_obj[a - 1])
+          PlugIOManagerTrajStreamTrim(atom_obj[a], -1);
+    }
+  }
+
+  if(ok) {
+    job.result = result;
+    if(n > 1)
+      TaskPoolRun(G, 0, TaskPoolGetNThread(G), ExecutiveRMSMatrixTask, &job);
+    else
+      ExecutiveRMSMatrixTask(&job, 0);
+    *n_result = n;
+    if(!quiet) {
+      PRINTFB(G, FB_Executive, FB_Actions)
+        " ExecutiveRMSMatrix: %d x %d %s matrix over %d %s of %d atoms.\n", n, n,
+        fit ? "fitted RMS" : "RMS", n, (mode == 1) ? "objects" : "states",
+        n_atom ENDFB(G);
+    }
+  } else {
+    FreeP(result);
+  }
+  FreeP(job.valid);
+  FreeP(job.sumsq);
+  FreeP(job.coord);
+  FreeP(atom_atm);
+  FreeP(atom_obj);
+  return result;
+}
+
+
 /*========================================================================*/
 float ExecutiveRMSPairs(PyMOLGlobals * G, WordType * sele, int pairs, int mode)
 {
@@ -16984,62 +17198,121 @@ for(a = 0; a < 3; a++) {
 printf("\n");
 #endif
 
-PyObject * ExecutiveCEAlign(PyMOLGlobals * G, PyObject * listA, PyObject * listB, int lenA, int lenB, float d0, float d1, int windowSize, int gapMax) {
-#ifdef _PYMOL_NOPY
-  return NULL;
-#else
+#ifndef _PYMOL_NOPY
+/* aligns coordsB against a target whose coordinates and distance matrix
+   have already been computed */
+static PyObject *ExecutiveCEAlignToTarget(PyMOLGlobals * G, pcePoint coordsA, double **dmA,
+                                          int lenA, PyObject * listB, int lenB,
+                                          float d0, float d1, int windowSize, int gapMax,
+                                          int maxKept)
+{
   int i=0;
   int smaller;
-  double **dmA ,**dmB, **S;
+  double **dmB, **S;
   int bufferSize;
-  pcePoint coordsA, coordsB;
+  pcePoint coordsB;
   pathCache paths = NULL;
   PyObject * result;
 
   smaller = lenA < lenB ? lenA : lenB;
-	
+
   /* get the coodinates from the Python objects */
-  coordsA = (pcePoint) getCoords(listA, lenA);
   coordsB = (pcePoint) getCoords(listB, lenB);
-	
-  /* calculate the distance matrix for each protein */
-  dmA = (double**) calcDM(coordsA, lenA);
-  dmB = (double**) calcDM(coordsB, lenB);
-	
+
+  /* calculate the distance matrix for the mobile protein */
+  dmB = (double**) calcDM(G, coordsB, lenB);
+
   /* calculate the CE Similarity matrix */
-  S = (double**) calcS(dmA, dmB, lenA, lenB, windowSize);
-	
+  S = (double**) calcS(G, dmA, dmB, lenA, lenB, windowSize);
+
   /* find the best path through the CE Sim. matrix */
   bufferSize = 0;
 
   /* the following line HANGS PyMOL */
-  paths = (pathCache) findPath(S, dmA, dmB, lenA, lenB, d0, d1, windowSize, gapMax, &bufferSize);
-	
+  paths = (pathCache) findPath(G, S, dmA, dmB, lenA, lenB, d0, d1, windowSize, gapMax,
+                               maxKept, &bufferSize);
+
   /* Get the optimal superposition here... */
   result = (PyObject*) findBest(coordsA, coordsB, paths, bufferSize, smaller, windowSize);
-	
+
   /* release memory */
-  free(coordsA);
   free(coordsB);
   for ( i = 0; i < bufferSize; ++i )
     free(paths[i]);
   free(paths);
-	
-  /* distance matrices	 */
-  for ( i = 0; i < lenA; i++ )
-    free( dmA[i] );
-  free(dmA);
-	
+
+  /* distance matrix */
   for  ( i = 0; i < lenB; i++ )
     free( dmB[i] );
   free(dmB);
-	
+
   /* similarity matrix */
   for ( i = 0; i < lenA; i++ )
     free( S[i] );
   free(S);
-	
+
   return (PyObject*) result;
+}
+#endif
+
+PyObject * ExecutiveCEAlign(PyMOLGlobals * G, PyObject * listA, PyObject * listB, int lenA, int lenB, float d0, float d1, int windowSize, int gapMax, int maxKept) {
+#ifdef _PYMOL_NOPY
+  return NULL;
+#else
+  int i=0;
+  double **dmA;
+  pcePoint coordsA;
+  PyObject * result;
+
+  coordsA = (pcePoint) getCoords(listA, lenA);
+  dmA = (double**) calcDM(G, coordsA, lenA);
+
+  result = ExecutiveCEAlignToTarget(G, coordsA, dmA, lenA, listB, lenB,
+                                    d0, d1, windowSize, gapMax, maxKept);
+
+  free(coordsA);
+  for ( i = 0; i < lenA; i++ )
+    free( dmA[i] );
+  free(dmA);
+
+  return (PyObject*) result;
+#endif
+}
+
+/*
+ * Aligns each coordinate list in listsB against listA, computing the
+ * target's coordinates and distance matrix only once.  Returns a list
+ * with one ExecutiveCEAlign result (or None) per mobile.
+ */
+PyObject * ExecutiveCEAlignBatch(PyMOLGlobals * G, PyObject * listA, int lenA, PyObject * listsB, float d0, float d1, int windowSize, int gapMax, int maxKept) {
+#ifdef _PYMOL_NOPY
+  return NULL;
+#else
+  int i=0;
+  int nB = PyList_Size(listsB);
+  double **dmA;
+  pcePoint coordsA;
+  PyObject * result = PyList_New(nB);
+
+  coordsA = (pcePoint) getCoords(listA, lenA);
+  dmA = (double**) calcDM(G, coordsA, lenA);
+
+  for ( i = 0; i < nB; i++ ) {
+    PyObject * listB = PyList_GetItem(listsB, i);
+    int lenB = PyList_Check(listB) ? PyList_Size(listB) : 0;
+    PyObject * item = NULL;
+    if ( lenB >= 2 * windowSize )
+      item = ExecutiveCEAlignToTarget(G, coordsA, dmA, lenA, listB, lenB,
+                                      d0, d1, windowSize, gapMax, maxKept);
+    PyList_SetItem(result, i, PConvAutoNone(item));
+  }
+
+  free(coordsA);
+  for ( i = 0; i < lenA; i++ )
+    free( dmA[i] );
+  free(dmA);
+
+  return result;
 #endif
 }
 
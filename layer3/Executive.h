@@ -293,6 +293,8 @@ void ExecutiveUpdateCmd(PyMOLGlobals * G, const char *sele1, const char *sele2,
 float ExecutiveRMSPairs(PyMOLGlobals * G, WordType * sele, int pairs, int mode);
 float *ExecutiveRMSStates(PyMOLGlobals * G, const char *s1, int target, int mode, int quiet,
                           int mix);
+float *ExecutiveRMSMatrix(PyMOLGlobals * G, const char *s1, int mode, int state,
+                          int fit, int quiet, int *n_result);
 int *ExecutiveIdentify(PyMOLGlobals * G, const char *s1, int mode);
 int ExecutiveIndex(PyMOLGlobals * G, const char *s1, int mode, int **indexVLA,
                    ObjectMolecule *** objVLA);
@@ -563,7 +565,9 @@ int ExecutiveIsomeshEtc(PyMOLGlobals * G,
 int ExecutiveAssignAtomTypes(PyMOLGlobals * G, const char *s1, int format, int state, int quiet);
 
 PyObject * ExecutiveCEAlign(PyMOLGlobals * G, PyObject * listA, PyObject * listB, int lenA, int lenB,
-			    float d0, float d1, int windowSize, int gapMax);
+			    float d0, float d1, int windowSize, int gapMax, int maxKept);
+PyObject * ExecutiveCEAlignBatch(PyMOLGlobals * G, PyObject * listA, int lenA, PyObject * listsB,
+				 float d0, float d1, int windowSize, int gapMax, int maxKept);
 
 #ifdef _PYMOL_LIB
 int *ExecutiveGetRepsInSceneForObject(PyMOLGlobals *G, const char *name);
@@ -84,6 +84,23 @@ CObject * PlugIOManagerLoad(PyMOLGlobals * G, CObject ** obj_ptr,
   return 0;
 }
 
+CoordSet *PlugIOManagerTrajStreamGet(ObjectMolecule * obj, int state)
+{
+  return NULL;
+}
+
+void PlugIOManagerTrajStreamTrim(ObjectMolecule * obj, int keep_state)
+{
+}
+
+void PlugIOManagerTrajStreamSetDirty(ObjectMolecule * obj, int state)
+{
+}
+
+void PlugIOManagerTrajStreamFree(ObjectMolecule * obj)
+{
+}
+
 #else
 
 #include "molfile_plugin.h"
@@ -145,6 +162,319 @@ static molfile_plugin_t * find_plugin(CPlugIOManager * I, const char * plugin_ty
   return NULL;
 }
 
+/* a trajectory which is read on demand instead of up front.  The file
+ * is indexed once (state -> frame number in the file) and states are
+ * decoded into obj->CSet when requested.  The molfile API has no random
+ * access, so a handle is kept open for sequential playback and frames
+ * are skipped (read_next_timestep with a NULL timestep, which is a seek
+ * for the fixed-size formats like DCD) to get to a requested frame. */
+struct _CTrajStream {
+  molfile_plugin_t *plugin;
+  char *FileName;
+  char *PluginType;
+  void *Handle;                 /* open file handle or NULL */
+  int NextFrame;                /* frame which Handle reads next */
+  int NAtom;
+  CoordSet *Tmpl;               /* copied for every decoded state */
+  int Start;                    /* object state of the first frame */
+  int NState;
+  int *Frame;                   /* VLA: file frame for each state */
+  int *Stamp;                   /* VLA: last use, 0 if not decoded by us */
+  CoordSet **Decoded;           /* VLA: the set decoded into each state */
+  char *Dirty;                  /* VLA: edited since decoding, never evicted */
+  unsigned int *Sum;            /* VLA: coordinate checksum when decoded */
+  int NDecoded;                 /* states with a Stamp */
+  int Clock;
+};
+
+/* catches coordinate edits which didn't mark the state dirty */
+static unsigned int TrajStreamSum(const CoordSet * cs)
+{
+  const unsigned char *p = (const unsigned char *) cs->Coord;
+  const unsigned char *stop = p + sizeof(float) * 3 * cs->NIndex;
+  unsigned int sum = 2166136261U;
+  while(p < stop)
+    sum = (sum ^ *(p++)) * 16777619U;
+  return sum;
+}
+
+static char *TrajStreamStrDup(const char *str)
+{
+  char *result = Alloc(char, strlen(str) + 1);
+  if(result)
+    strcpy(result, str);
+  return result;
+}
+
+static void TrajStreamClose(CTrajStream * I)
+{
+  if(I->Handle) {
+    I->plugin->close_file_read(I->Handle);
+    I->Handle = NULL;
+  }
+}
+
+/* returns the coordinate set for state, decoding it if necessary */
+CoordSet *PlugIOManagerTrajStreamGet(ObjectMolecule * obj, int state)
+{
+  CTrajStream *I = obj->TrajStream;
+  PyMOLGlobals *G = obj->Obj.G;
+  CoordSet *cs = NULL;
+  molfile_timestep_t timestep;
+  int natoms, frame, idx;
+
+  if(state < 0 || state >= obj->NCSet)
+    return NULL;
+  if(!I || obj->CSet[state])
+    cs = obj->CSet[state];
+  else {
+    idx = state - I->Start;
+    if(idx < 0 || idx >= I->NState)
+      return NULL;
+    frame = I->Frame[idx];
+
+    /* rewind if the frame is behind us */
+    if(I->Handle && I->NextFrame > frame)
+      TrajStreamClose(I);
+    if(!I->Handle) {
+      I->Handle = I->plugin->open_file_read(I->FileName, I->PluginType, &natoms);
+      I->NextFrame = 0;
+      if(!I->Handle) {
+        PRINTFB(G, FB_ObjectMolecule, FB_Errors)
+          " ObjectMolecule: plugin '%s' cannot reopen '%s'.\n", I->PluginType,
+          I->FileName ENDFB(G);
+        return NULL;
+      }
+    }
+    while(I->NextFrame < frame) {
+      if(I->plugin->read_next_timestep(I->Handle, I->NAtom, NULL))
+        break;
+      I->NextFrame++;
+    }
+    if(I->NextFrame == frame && (cs = CoordSetCopy(I->Tmpl))) {
+      memset(&timestep, 0, sizeof(molfile_timestep_t));
+      timestep.coords = (float *) cs->Coord;
+      if(I->plugin->read_next_timestep(I->Handle, I->NAtom, &timestep)) {
+        cs->fFree();
+        cs = NULL;
+      } else {
+        I->NextFrame++;
+        cs->invalidateRep(cRepAll, cRepInvRep);
+        obj->CSet[state] = cs;
+        I->Decoded[idx] = cs;
+        I->Dirty[idx] = false;
+        I->Sum[idx] = TrajStreamSum(cs);
+        PRINTFB(G, FB_ObjectMolecule, FB_Blather)
+          " ObjectMolecule: read set %d into state %d...\n", frame + 1, state + 1
+          ENDFB(G);
+      }
+    }
+    if(!cs) {
+      TrajStreamClose(I);
+      PRINTFB(G, FB_ObjectMolecule, FB_Errors)
+        " ObjectMolecule: unable to read set %d of '%s'.\n", frame + 1,
+        I->FileName ENDFB(G);
+      return NULL;
+    }
+  }
+  if(I && cs) {
+    idx = state - I->Start;
+    if(idx >= 0 && idx < I->NState && I->Decoded[idx] == cs) {
+      if(!I->Stamp[idx])
+        I->NDecoded++;
+      I->Stamp[idx] = ++I->Clock;
+    }
+  }
+  return cs;
+}
+
+/* drops the least recently used clean states we decoded until no more
+ * than traj_stream_states of them are left.  Edited (dirty) states and
+ * sets which replaced ours don't count and are never freed.  Since this
+ * frees coordinate sets, it's only called where nobody holds on to them
+ * (ObjectMoleculeUpdate, and loops over states once they are done with
+ * one), never while decoding.  keep_state < 0 keeps the current state */
+void PlugIOManagerTrajStreamTrim(ObjectMolecule * obj, int keep_state)
+{
+  CTrajStream *I = obj->TrajStream;
+  int a, state, n_resident = 0, lru;
+  int max_resident;
+
+  if(!I)
+    return;
+  max_resident = SettingGetGlobal_i(obj->Obj.G, cSetting_traj_stream_states);
+  if(max_resident < 1)
+    max_resident = 1;
+  if(I->NDecoded <= max_resident)
+    return;
+  if(keep_state < 0)
+    keep_state = ObjectGetCurrentState(&obj->Obj, false);
+
+  I->NDecoded = 0;
+  for(a = 0; a < I->NState; a++) {
+    state = I->Start + a;
+    if(I->Stamp[a]) {
+      if(state < obj->NCSet && obj->CSet[state] == I->Decoded[a]) {
+        I->NDecoded++;
+        if(!I->Dirty[a])
+          n_resident++;
+      } else {
+        I->Stamp[a] = 0;        /* freed or replaced behind our back */
+        I->Decoded[a] = NULL;
+      }
+    }
+  }
+  while(n_resident > max_resident) {
+    lru = -1;
+    for(a = 0; a < I->NState; a++) {
+      if(I->Stamp[a] && !I->Dirty[a] && (I->Start + a != keep_state) &&
+         (lru < 0 || I->Stamp[a] < I->Stamp[lru]))
+        lru = a;
+    }
+    if(lru < 0)
+      break;
+    state = I->Start + lru;
+    n_resident--;
+    if(TrajStreamSum(obj->CSet[state]) != I->Sum[lru]) {
+      I->Dirty[lru] = true;
+      continue;
+    }
+    obj->CSet[state]->fFree();
+    obj->CSet[state] = NULL;
+    I->Stamp[lru] = 0;
+    I->Decoded[lru] = NULL;
+    I->NDecoded--;
+  }
+}
+
+/* marks the decoded set of state (all of them for state < 0) as edited,
+ * so that it stays resident instead of being reread from the file */
+void PlugIOManagerTrajStreamSetDirty(ObjectMolecule * obj, int state)
+{
+  CTrajStream *I = obj->TrajStream;
+  int a, start = 0, stop;
+
+  if(!I)
+    return;
+  stop = I->NState;
+  if(state >= 0) {
+    start = state - I->Start;
+    stop = start + 1;
+    if(start < 0 || stop > I->NState)
+      return;
+  }
+  for(a = start; a < stop; a++)
+    if(I->Stamp[a])
+      I->Dirty[a] = true;
+}
+
+void PlugIOManagerTrajStreamFree(ObjectMolecule * obj)
+{
+  CTrajStream *I = obj->TrajStream;
+  if(!I)
+    return;
+  TrajStreamClose(I);
+  if(I->Tmpl)
+    I->Tmpl->fFree();
+  VLAFreeP(I->Frame);
+  VLAFreeP(I->Stamp);
+  VLAFreeP(I->Decoded);
+  VLAFreeP(I->Dirty);
+  VLAFreeP(I->Sum);
+  FreeP(I->FileName);
+  FreeP(I->PluginType);
+  FreeP(I);
+  obj->TrajStream = NULL;
+}
+
+/* index pass of PlugIOManagerLoadTraj for streamed trajectories: assigns
+ * file frames to states without decoding any coordinates.  Takes
+ * ownership of tmpl, but not of file_handle */
+static int PlugIOManagerLoadTrajStream(PyMOLGlobals * G, ObjectMolecule * obj,
+                                       molfile_plugin_t * plugin, void *file_handle,
+                                       const char *fname, const char *plugin_type,
+                                       int natoms, CoordSet * tmpl, int frame,
+                                       int interval, int start, int stop, int max)
+{
+  CTrajStream *I = NULL;
+  int cnt = 0, icnt = interval, ncnt = 0;
+  int a;
+
+  ok_assert(1, I = Calloc(CTrajStream, 1));
+  I->plugin = plugin;
+  I->NAtom = natoms;
+  I->Tmpl = tmpl;
+  ok_assert(1, I->FileName = TrajStreamStrDup(fname));
+  ok_assert(1, I->PluginType = TrajStreamStrDup(plugin_type));
+  ok_assert(1, I->Frame = VLAlloc(int, 1000));
+
+  /* same frame selection as the eager loader (without averaging) */
+  while(!plugin->read_next_timestep(file_handle, natoms, NULL)) {
+    cnt++;
+    if(cnt >= start) {
+      icnt--;
+      if(icnt <= 0) {
+        icnt = interval;
+        VLACheck(I->Frame, int, ncnt);
+        I->Frame[ncnt++] = cnt - 1;
+        if((stop > 0 && cnt >= stop) || (max > 0 && ncnt >= max))
+          break;
+      }
+    }
+  }
+
+  if(!ncnt) {
+    FreeP(I->FileName);
+    FreeP(I->PluginType);
+    VLAFreeP(I->Frame);
+    FreeP(I);
+    tmpl->fFree();
+    return true;
+  }
+
+  if(frame < 0)
+    frame = obj->NCSet;
+  I->Start = frame;
+  I->NState = ncnt;
+  ok_assert(1, I->Stamp = VLACalloc(int, ncnt));
+  ok_assert(1, I->Decoded = VLACalloc(CoordSet *, ncnt));
+  ok_assert(1, I->Dirty = VLACalloc(char, ncnt));
+  ok_assert(1, I->Sum = VLACalloc(unsigned int, ncnt));
+  VLACheck(obj->CSet, CoordSet *, frame + ncnt - 1);
+  ok_assert(1, obj->CSet);
+  for(a = frame; a < frame + ncnt; a++) {
+    if(obj->CSet[a]) {
+      obj->CSet[a]->fFree();
+      obj->CSet[a] = NULL;
+    }
+  }
+  if(obj->NCSet < frame + ncnt)
+    obj->NCSet = frame + ncnt;
+  obj->TrajStream = I;
+
+  PRINTFB(G, FB_ObjectMolecule, FB_Details)
+    " ObjectMolecule: indexed %d sets into states %d-%d (streamed)...\n", ncnt,
+    frame + 1, frame + ncnt ENDFB(G);
+
+  /* decode the first state so that there is something to look at */
+  PlugIOManagerTrajStreamGet(obj, frame);
+  return true;
+
+ok_except1:
+  if(I) {
+    FreeP(I->FileName);
+    FreeP(I->PluginType);
+    VLAFreeP(I->Frame);
+    VLAFreeP(I->Stamp);
+    VLAFreeP(I->Decoded);
+    VLAFreeP(I->Dirty);
+    VLAFreeP(I->Sum);
+    FreeP(I);
+  }
+  tmpl->fFree();
+  return false;
+}
+
 int PlugIOManagerLoadTraj(PyMOLGlobals * G, ObjectMolecule * obj,
                           const char *fname, int frame,
                           int interval, int average, int start,
@@ -178,6 +508,7 @@ int PlugIOManagerLoadTraj(PyMOLGlobals * G, ObjectMolecule * obj,
       int icnt = interval;
       int n_avg = 0;
       int ncnt = 0;
+      int ok = true;
       CoordSet *cs = obj->NCSet > 0 ? obj->CSet[0] : obj->CSTmpl ? obj->CSTmpl : NULL;
 
       timestep.coords = NULL;
@@ -214,7 +545,15 @@ int PlugIOManagerLoadTraj(PyMOLGlobals * G, ObjectMolecule * obj,
 
       timestep.coords = (float *) cs->Coord;
 
-      {
+      if(average < 2 && !obj->TrajStream &&
+         SettingGetGlobal_i(G, cSetting_traj_stream_states) > 0) {
+        /* don't read any coordinates yet, just index the frames */
+        zoom_flag = !obj->NCSet;
+        ok = PlugIOManagerLoadTrajStream(G, obj, plugin, file_handle, fname,
+                                         plugin_type, natoms, cs, frame,
+                                         interval, start, stop, max);
+        cs = NULL;
+      } else {
 	  /* read_next_timestep fills in &timestep for each iteration; we need
 	   * to copy that out to a new CoordSet, each time. */
           while(!plugin->read_next_timestep(file_handle, natoms, &timestep)) {
@@ -301,8 +640,8 @@ int PlugIOManagerLoadTraj(PyMOLGlobals * G, ObjectMolecule * obj,
           if(SettingGetGlobal_i(G, cSetting_auto_zoom)) {
             ExecutiveWindowZoom(G, obj->Obj.Name, 0.0, -1, 0, 0, quiet);        /* auto zoom (all states) */
           }
+        return ok;
   }
-  return true;
 ok_except1:
   return false;
 }
@@ -40,6 +40,18 @@ ObjectMolecule *PlugIOManagerLoadMol(PyMOLGlobals * G, ObjectMolecule *origObj,
 CObject * PlugIOManagerLoad(PyMOLGlobals * G, CObject ** obj_ptr,
     const char *fname, int state, int quiet, const char *plugin_type);
 
+/* streamed trajectories (traj_stream_states > 0): states of obj which
+   aren't resident are NULL in obj->CSet and get decoded on request.
+   Code which edits coordinates in place marks the state dirty, so that
+   the edit isn't dropped along with the decoded set.  Decoding never
+   frees anything; PlugIOManagerTrajStreamTrim does, so it may only be
+   called where no coordinate set of obj is held */
+typedef struct _CTrajStream CTrajStream;
+CoordSet *PlugIOManagerTrajStreamGet(ObjectMolecule * obj, int state);
+void PlugIOManagerTrajStreamTrim(ObjectMolecule * obj, int keep_state);
+void PlugIOManagerTrajStreamSetDirty(ObjectMolecule * obj, int state);
+void PlugIOManagerTrajStreamFree(ObjectMolecule * obj);
+
 #ifdef __cplusplus
 }
 #endif
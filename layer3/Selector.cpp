@@ -39,6 +39,7 @@ Z* -------------------------------------------------------------------
 #include"Seq.h"
 #include"Editor.h"
 #include"Seeker.h"
+#include"PlugIOManager.h"
 
 #include"OVContext.h"
 #include"OVLexicon.h"
@@ -46,6 +47,7 @@ Z* -------------------------------------------------------------------
 #include"Parse.h"
 
 #include"ListMacros.h"
+#include"TaskPool.h"
 
 #define SelectorWordLength 1024
 typedef char SelectorWordType[SelectorWordLength];
@@ -129,9 +131,38 @@ typedef struct {
   int type;                     /* 0 = value 1 = operation 2 = pre-operation */
   unsigned int code;
   SelectorWordType text;
-  int *sele;
+  int *sele;                    /* per-atom tags, or NULL when the list is packed in bits */
+  ov_uint64 *bits;              /* one bit per atom, for untagged lists */
 } EvalElem;
 
+#define SELE_BIT_WORDS(n)  (((n) + 63) >> 6)
+#define SELE_BIT_ONE(a)    (((ov_uint64) 1) << ((a) & 63))
+#define SELE_BIT_GET(w, a) ((w)[(a) >> 6] & SELE_BIT_ONE(a))
+#define SELE_BIT_SET(w, a) ((w)[(a) >> 6] |= SELE_BIT_ONE(a))
+
+/* packs the truth of "expr" (in terms of AtomInfoType *ai) for all
+   non-dummy table entries into "bits", a whole word at a time */
+#define SELE_BITS_EVAL(I, bits, expr) { \
+    TableRec *tbl_ = (I)->Table; \
+    ObjectMolecule **obj_ = (I)->Obj; \
+    int n_ = (I)->NAtom, w_, a_, hi_; \
+    for(w_ = 0; (w_ << 6) < n_; w_++) { \
+      ov_uint64 word_ = 0; \
+      a_ = w_ << 6; \
+      hi_ = a_ + 64; \
+      if(a_ < cNDummyAtoms) \
+        a_ = cNDummyAtoms; \
+      if(hi_ > n_) \
+        hi_ = n_; \
+      for(; a_ < hi_; a_++) { \
+        AtomInfoType *ai = obj_[tbl_[a_].model]->AtomInfo + tbl_[a_].atom; \
+        if(expr) \
+          word_ |= SELE_BIT_ONE(a_); \
+      } \
+      (bits)[w_] = word_; \
+    } \
+  }
+
 typedef struct {
   int model;
   int atom;
@@ -139,6 +170,17 @@ typedef struct {
   float f1;
 } TableRec;
 
+/* the atoms one object contributes to the table for a given state,
+   retained between table updates until the object's atoms change */
+typedef struct {
+  ObjectMolecule *obj;
+  int state;
+  int n_atom;                   /* obj->NAtom when built */
+  unsigned int cs_generation;   /* of obj->CSet[state] when built, or 0 */
+  int *atom;                    /* NULL means all atoms, in order */
+  int n;
+} TableSegRec;
+
 typedef struct {
   int ID;
   int justOneObjectFlag;
@@ -167,7 +209,8 @@ struct _CSelector {
   OVLexicon *Lex;
   OVOneToAny *Key;
   OVOneToOne *NameOffset;
-
+  TableSegRec *Seg;             /* VLA, in object order of the last table update */
+  int NSeg;
 };
 
 typedef struct {
@@ -209,6 +252,7 @@ static int *SelectorUpdateTableSingleObject(PyMOLGlobals * G, ObjectMolecule * o
                                             int req_state,
                                             int no_dummies, int *idx,
                                             int n_idx, int numbered_tags);
+static void SelectorInvalidateTableSeg(CSelector * I, ObjectMolecule * obj);
 
 
 /*========================================================================*/
@@ -742,7 +786,8 @@ int SelectorResidueVLAsTo3DMatchScores(PyMOLGlobals * G, CMatch * match,
   float *inter1 = Calloc(float, cINTER_ENTRIES * n1);
   float *inter2 = Calloc(float, cINTER_ENTRIES * n2);
   float *v_ca = Calloc(float, 3 * n_max);
-  if(inter1 && inter2 && v_ca) {
+  float **mat = MatchGetPairScores(match);
+  if(inter1 && inter2 && v_ca && mat) {
     int pass;
 
     for(pass = 0; pass < 2; pass++) {
@@ -992,7 +1037,7 @@ int SelectorResidueVLAsTo3DMatchScores(PyMOLGlobals * G, CMatch * match,
               comp3 = (float) -log(diff / rms_exp);
               score = (1 - coord_wt) * score + coord_wt * comp3 * scale;
             }
-            match->mat[a][b] = seq_wt * match->mat[a][b] + score;
+            mat[a][b] = seq_wt * mat[a][b] + score;
           }
         }
       }
@@ -3951,6 +3996,7 @@ static int *SelectorGetIndexVLAImpl(PyMOLGlobals * G, CSelector *I, int sele)
 /*========================================================================*/
 void SelectorUpdateObjectSele(PyMOLGlobals * G, ObjectMolecule * obj)
 {
+  SelectorInvalidateTableSeg(G->Selector, obj);
   if(obj->Obj.Name[0]) {
     SelectorDelete(G, obj->Obj.Name);
     SelectorCreate(G, obj->Obj.Name, NULL, obj, true, NULL);    
@@ -5340,7 +5386,134 @@ static double max6d(double a, double b, double c, double d, double e, double f)
 
 #define D_SMALL10 1e-10
 
-typedef double AtomSF[11];
+/* five-term gaussian density of one atom with its occupancy, b-factor
+   and the map's blur applied: sum of a[t] * exp(-b[t] * d * d) where d
+   is the blurred distance, out to d < cut */
+typedef struct {
+  float a[5], b[5];
+  float cut;
+} GaussianKernel;
+
+/* expf for -87 <= x <= 0 (Cephes polynomial, ~1 ulp), written without
+   branches or calls so the term loop in SelectorMapGaussianPlane can
+   vectorize */
+#ifdef _PYMOL_INLINE
+__inline__
+#endif
+static float SelectorGaussianExp(float x)
+{
+  union {
+    float f;
+    int i;
+  } pow2n;
+  float z, y;
+  int n;
+  n = (int) (x * 1.44269504088896341F - 0.5F);  /* round, as x <= 0 */
+  z = x - n * 0.693359375F;
+  z = z + n * 2.12194440e-4F;
+  y = 1.9875691500E-4F;
+  y = y * z + 1.3981999507E-3F;
+  y = y * z + 8.3334519073E-3F;
+  y = y * z + 4.1665795894E-2F;
+  y = y * z + 1.6666665459E-1F;
+  y = y * z + 5.0000001201E-1F;
+  y = y * z * z + z + 1.0F;
+  pow2n.i = (n + 127) << 23;
+  return y * pow2n.f;
+}
+
+typedef struct {
+  PyMOLGlobals *G;
+  ObjectMapState *oMap;
+  MapType *map;
+  float *point;
+  GaussianKernel *kernel;
+  float blur_factor;
+  int use_max;
+  int n_plane;
+  double *sum, *sumsq;          /* per plane, summed in order afterwards */
+  TaskPoolCounter next;
+} GaussianJob;
+
+/* fills one plane (first map index) of the map.  The gaussian terms of
+   all atoms near a grid point are gathered first so that they can be
+   evaluated in one simple loop. */
+static void SelectorMapGaussianPlane(GaussianJob * J, int a, float **arg_vla,
+                                     float **amp_vla)
+{
+  ObjectMapState *oMap = J->oMap;
+  MapType *map = J->map;
+  float *point = J->point;
+  GaussianKernel *kernel = J->kernel;
+  float blur_factor = J->blur_factor;
+  float *arg = *arg_vla, *amp = *amp_vla;
+  double sum = 0.0, sumsq = 0.0;
+  int b, c, h, i, j, k, l, m, t;
+  float d, e_val, *v2;
+  for(b = oMap->Min[1]; b <= oMap->Max[1]; b++) {
+    for(c = oMap->Min[2]; c <= oMap->Max[2]; c++) {
+      int n_term = 0;
+      e_val = 0.0F;
+      v2 = F4Ptr(oMap->Field->points, a, b, c, 0);
+      if(MapExclLocus(map, v2, &h, &k, &l)) {
+        i = *(MapEStart(map, h, k, l));
+        if(i) {
+          j = map->EList[i++];
+          while(j >= 0) {
+            GaussianKernel *kern = kernel + j;
+            d = (float) diff3f(point + 3 * j, v2) * blur_factor;   /* scale up width */
+            if(d < kern->cut) {
+              d = d * d;
+              if(d < R_SMALL8)
+                d = R_SMALL8;
+              VLACheck(arg, float, n_term + 4);
+              VLACheck(amp, float, n_term + 4);
+              for(t = 0; t < 5; t++) {
+                float x = -kern->b[t] * d;
+                arg[n_term] = (x < -87.0F) ? -87.0F : x;
+                amp[n_term] = kern->a[t];
+                n_term++;
+              }
+            }
+            j = map->EList[i++];
+          }
+        }
+      }
+      for(m = 0; m < n_term; m++)
+        amp[m] *= SelectorGaussianExp(arg[m]);
+      for(m = 0; m < n_term; m += 5) {
+        float e_partial = (amp[m] + amp[m + 1] + amp[m + 2] + amp[m + 3] + amp[m + 4])
+          * blur_factor;        /* scale down intensity */
+        if(!J->use_max)
+          e_val += e_partial;
+        else if(e_partial > e_val)
+          e_val = e_partial;
+      }
+      F3(oMap->Field->data, a, b, c) = e_val;
+      sum += e_val;
+      sumsq += (e_val * e_val);
+    }
+  }
+  J->sum[a - oMap->Min[0]] = sum;
+  J->sumsq[a - oMap->Min[0]] = sumsq;
+  *arg_vla = arg;
+  *amp_vla = amp;
+}
+
+static void SelectorMapGaussianTask(void *ctx, int index)
+{
+  GaussianJob *J = (GaussianJob *) ctx;
+  float *arg = VLAlloc(float, 500);
+  float *amp = VLAlloc(float, 500);
+  int a;
+  while((a = J->next++) < J->n_plane) {
+    if(!index)
+      OrthoBusyFast(J->G, a, J->n_plane);
+    SelectorMapGaussianPlane(J, J->oMap->Min[0] + a, &arg, &amp);
+  }
+  VLAFreeP(arg);
+  VLAFreeP(amp);
+}
 
 
 /*========================================================================*/
@@ -5350,9 +5523,8 @@ int SelectorMapGaussian(PyMOLGlobals * G, int sele1, ObjectMapState * oMap,
 {
   CSelector *I = G->Selector;
   MapType *map;
-  float *v2;
   int n1, n2;
-  int a, b, c, i, j, h, k, l;
+  int a, b, c;
   int at;
   int s, idx;
   AtomInfoType *ai;
@@ -5365,11 +5537,10 @@ int SelectorMapGaussian(PyMOLGlobals * G, int sele1, ObjectMapState * oMap,
   float *occup = NULL, *oc;
   int prot;
   int once_flag;
-  float d, e_val;
   double sum, sumsq;
   float mean, stdev;
-  double sf[256][11], *sfp;
-  AtomSF *atom_sf = NULL;
+  double sf[256][11];
+  GaussianKernel *kernel = NULL;
   double b_adjust = (double) SettingGetGlobal_f(G, cSetting_gaussian_b_adjust);
   double elim = 7.0;
   double rcut2;
@@ -5647,7 +5818,7 @@ int SelectorMapGaussian(PyMOLGlobals * G, int sele1, ObjectMapState * oMap,
   sfidx = Alloc(int, n1);
   b_factor = Alloc(float, n1);
   occup = Alloc(float, n1);
-  atom_sf = Alloc(AtomSF, n1);
+  kernel = Alloc(GaussianKernel, n1);
 
   if(!quiet) {
     PRINTFB(G, FB_ObjectMap, FB_Details)
@@ -5702,6 +5873,7 @@ int SelectorMapGaussian(PyMOLGlobals * G, int sele1, ObjectMapState * oMap,
 
   for(a = 0; a < n1; a++) {
     double *src_sf;
+    double atom_sf[10];
 
     src_sf = &sf[sfidx[a]][0];
     bfact = b_factor[a];
@@ -5711,19 +5883,23 @@ int SelectorMapGaussian(PyMOLGlobals * G, int sele1, ObjectMapState * oMap,
       sfa = src_sf[b];
       sfb = src_sf[b + 1];
 
-      atom_sf[a][b] = occup[a] * sfa * pow(sqrt1d(4 * PI / (sfb + bfact)), 3.0);
-      atom_sf[a][b + 1] = 4 * PI * PI / (sfb + bfact);
+      atom_sf[b] = occup[a] * sfa * pow(sqrt1d(4 * PI / (sfb + bfact)), 3.0);
+      atom_sf[b + 1] = 4 * PI * PI / (sfb + bfact);
 
     }
 
     rcut2 = max6d(0.0,
-                  (elim + log(max2d(fabs(atom_sf[a][0]), D_SMALL10))) / atom_sf[a][1],
-                  (elim + log(max2d(fabs(atom_sf[a][2]), D_SMALL10))) / atom_sf[a][3],
-                  (elim + log(max2d(fabs(atom_sf[a][4]), D_SMALL10))) / atom_sf[a][5],
-                  (elim + log(max2d(fabs(atom_sf[a][6]), D_SMALL10))) / atom_sf[a][7],
-                  (elim + log(max2d(fabs(atom_sf[a][8]), D_SMALL10))) / atom_sf[a][9]);
+                  (elim + log(max2d(fabs(atom_sf[0]), D_SMALL10))) / atom_sf[1],
+                  (elim + log(max2d(fabs(atom_sf[2]), D_SMALL10))) / atom_sf[3],
+                  (elim + log(max2d(fabs(atom_sf[4]), D_SMALL10))) / atom_sf[5],
+                  (elim + log(max2d(fabs(atom_sf[6]), D_SMALL10))) / atom_sf[7],
+                  (elim + log(max2d(fabs(atom_sf[8]), D_SMALL10))) / atom_sf[9]);
     rcut = ((float) sqrt1d(rcut2)) / blur_factor;
-    atom_sf[a][10] = rcut;
+    for(b = 0; b < 5; b++) {
+      kernel[a].a[b] = (float) atom_sf[2 * b];
+      kernel[a].b[b] = (float) atom_sf[2 * b + 1];
+    }
+    kernel[a].cut = rcut;
     if(max_rcut < rcut)
       max_rcut = rcut;
   }
@@ -5734,68 +5910,39 @@ int SelectorMapGaussian(PyMOLGlobals * G, int sele1, ObjectMapState * oMap,
     n2 = 0;
     map = MapNew(G, -max_rcut, point, n1, NULL);
     if(map) {
+      GaussianJob job;
       MapSetupExpress(map);
+      job.G = G;
+      job.oMap = oMap;
+      job.map = map;
+      job.point = point;
+      job.kernel = kernel;
+      job.blur_factor = blur_factor;
+      job.use_max = use_max;
+      job.n_plane = oMap->Max[0] - oMap->Min[0] + 1;
+      job.sum = Alloc(double, job.n_plane);
+      job.sumsq = Alloc(double, job.n_plane);
+      job.next = 0;
       sum = 0.0;
       sumsq = 0.0;
-      for(a = oMap->Min[0]; a <= oMap->Max[0]; a++) {
-        OrthoBusyFast(G, a - oMap->Min[0], oMap->Max[0] - oMap->Min[0] + 1);
-        for(b = oMap->Min[1]; b <= oMap->Max[1]; b++) {
-          for(c = oMap->Min[2]; c <= oMap->Max[2]; c++) {
-            e_val = 0.0;
-            v2 = F4Ptr(oMap->Field->points, a, b, c, 0);
-            if(MapExclLocus(map, v2, &h, &k, &l)) {
-              i = *(MapEStart(map, h, k, l));
-              if(i) {
-                j = map->EList[i++];
-                if(use_max) {
-                  float e_partial;
-                  while(j >= 0) {
-                    d = (float) diff3f(point + 3 * j, v2) * blur_factor;        
-                    /* scale up width */
-                    sfp = atom_sf[j];
-                    if(d < sfp[10]) {
-                      d = d * d;
-                      if(d < R_SMALL8)
-                        d = R_SMALL8;
-                      e_partial = (float) ((sfp[0] * exp(-sfp[1] * d))
-                                           + (sfp[2] * exp(-sfp[3] * d))
-                                           + (sfp[4] * exp(-sfp[5] * d))
-                                           + (sfp[6] * exp(-sfp[7] * d))
-                                           + (sfp[8] * exp(-sfp[9] * d))) * blur_factor;       
-                      /* scale down intensity */
-                      if(e_partial > e_val)
-                        e_val = e_partial;
-                    }
-                    j = map->EList[i++];
-                  }
-                } else {
-                  while(j >= 0) {
-                    d = (float) diff3f(point + 3 * j, v2) * blur_factor;       
-                    /* scale up width */
-                    sfp = atom_sf[j];
-                    if(d < sfp[10]) {
-                      d = d * d;
-                      if(d < R_SMALL8)
-                        d = R_SMALL8;
-                      e_val += (float) ((sfp[0] * exp(-sfp[1] * d))
-                                        + (sfp[2] * exp(-sfp[3] * d))
-                                        + (sfp[4] * exp(-sfp[5] * d))
-                                        + (sfp[6] * exp(-sfp[7] * d))
-                                        + (sfp[8] * exp(-sfp[9] * d))) * blur_factor;  
-                      /* scale down intensity */
-                    }
-                    j = map->EList[i++];
-                  }
-                }
-              }
-            }
-            F3(oMap->Field->data, a, b, c) = e_val;
-            sum += e_val;
-            sumsq += (e_val * e_val);
-            n2++;
-          }
-        }
-      }
+      if(job.sum && job.sumsq) {
+        int n_thread = TaskPoolGetNThread(G);
+        if(n_thread > job.n_plane)
+          n_thread = job.n_plane;
+        TaskPoolRun(G, n_thread, n_thread, SelectorMapGaussianTask, &job);
+        for(a = 0; a < job.n_plane; a++) {
+          sum += job.sum[a];
+          sumsq += job.sumsq[a];
+        }
+      }
+      n2 = job.n_plane * (oMap->Max[1] - oMap->Min[1] + 1) *
+        (oMap->Max[2] - oMap->Min[2] + 1);
+      if(!(job.sum && job.sumsq))
+        n2 = 0;
+      FreeP(job.sum);
+      FreeP(job.sumsq);
+    }
+    if(map && n2) {
       mean = (float) (sum / n2);
       stdev = (float) sqrt1d((sumsq - (sum * sum / n2)) / (n2 - 1));
       if(normalize) {
@@ -5826,12 +5973,13 @@ int SelectorMapGaussian(PyMOLGlobals * G, int sele1, ObjectMapState * oMap,
         }
       }
       oMap->Active = true;
-      MapFree(map);
     }
+    if(map)
+      MapFree(map);
   }
   FreeP(point);
   FreeP(sfidx);
-  FreeP(atom_sf);
+  FreeP(kernel);
   FreeP(b_factor);
   FreeP(occup);
   return (c);
@@ -6369,7 +6517,7 @@ bool SeleCoordIterator::next() {
     if(statearg < 0 && statemax < obj->NCSet)
       statemax = obj->NCSet;
 
-    if(state >= obj->NCSet || !(cs = obj->CSet[state]))
+    if(!(cs = ObjectMoleculeGetCoordSet(obj, state)))
       continue;
 
     if(!SelectorIsMember(G, obj->AtomInfo[atm].selEntry, sele))
@@ -6488,6 +6636,40 @@ PyObject *SelectorGetCoordsAsNumPy(PyMOLGlobals * G, int sele, int state)
 #endif
 }
 
+/*========================================================================*/
+/*
+ * Get selection coordinates as a writable Nx3 numpy array which aliases the
+ * coordinate set memory (see CoordSetAsNumPyView). Only possible if the
+ * selection covers a contiguous range of a single coordinate set. Unlike
+ * SelectorGetCoordsAsNumPy, object matrices are not applied.
+ */
+PyObject *SelectorGetCoordsAsNumPyView(PyMOLGlobals * G, int sele, int state)
+{
+  SeleCoordIterator iter(G, sele, state);
+  CoordSet *cs = NULL;
+  int offset = 0, nAtom = 0;
+
+  SelectorUpdateTable(G, state, -1);
+
+  while(iter.next()) {
+    if(!cs) {
+      cs = iter.cs;
+      offset = iter.getIdx();
+    } else if(cs != iter.cs || iter.getIdx() != offset + nAtom) {
+      PRINTFB(G, FB_Selector, FB_Errors)
+        " Selector-Error: selection is not contiguous in a single coordinate set\n"
+        ENDFB(G);
+      return NULL;
+    }
+    nAtom++;
+  }
+
+  if(!cs)
+    return NULL;
+
+  return CoordSetAsNumPyView(cs, offset, nAtom);
+}
+
 /*========================================================================*/
 /*
  * Load coordinates from a Nx3 sequence into the given selection.
@@ -6595,6 +6777,7 @@ int SelectorLoadCoords(PyMOLGlobals * G, PyObject * coords, int sele, int state)
 
       // invalidate reps
       iter.cs->invalidateRep(cRepAll, cRepInvRep);
+      PlugIOManagerTrajStreamSetDirty(iter.obj, iter.getState());
     }
 
     // handle matrix
@@ -7029,24 +7212,21 @@ void SelectorUpdateCmd(PyMOLGlobals * G, int sele0, int sele1, int sta0, int sta
         ccc++;
         for(cc1 = 0; cc1 < obj1->NCSet; cc1++) {        /* iterate over all source states */
           if((cc1 == sta1) || (sta1 < 0)) {
-            cs1 = obj1->CSet[cc1];
+            cs1 = ObjectMoleculeGetCoordSet(obj1, cc1);
             if(cs1 && (((sta0 < 0) && (cc1 < obj0->NCSet)) ||   /* multiple states */
                        (cc1 == sta0) || /* single state */
                        ((sta0 >= 0) && (sta1 >= 0)))) { /* explicit state */
 
-              if((sta0 < 0) || (sta0 >= obj0->NCSet)) {
-                cs0 = obj0->CSet[cc1];
-              } else if(sta0 < obj0->NCSet) {
-                cs0 = obj0->CSet[sta0];
-              } else {
-                cs0 = NULL;
-              }
+              int st0 = ((sta0 < 0) || (sta0 >= obj0->NCSet)) ? cc1 : sta0;
+              cs0 = ObjectMoleculeGetCoordSet(obj0, st0);
 
               if(cs0) {
                 ci0 = cs0->atmToIdx(at0);
 
-                if(ci0 >= 0)
+                if(ci0 >= 0) {
                   CoordSetGetAtomVertex(cs1, at1, cs0->Coord + 3 * ci0);
+                  PlugIOManagerTrajStreamSetDirty(obj0, st0);
+                }
               }
             }
           }
@@ -7286,6 +7466,7 @@ int SelectorCreateObjectMolecule(PyMOLGlobals * G, int sele, const char *name,
           }
         }
       VLASize(cs2->IdxToAtm, int, c);
+      CoordSetViewDetach(cs2, true);
       VLASize(cs2->Coord, float, c * 3);
       cs2->NIndex = c;
       if(target >= 0) {
@@ -7450,6 +7631,7 @@ int SelectorPurgeObjectMembers(PyMOLGlobals * G, ObjectMolecule * obj)
   short changed = 0;
 
   CSelector *I = G->Selector;
+  SelectorInvalidateTableSeg(I, obj);
   if(I->Member) {
     for(a = 0; a < obj->NAtom; a++) {
       s = obj->AtomInfo[a].selEntry;
@@ -8177,14 +8359,135 @@ int SelectorUpdateTable(PyMOLGlobals * G, int req_state, int domain)
   return (SelectorUpdateTableImpl(G, G->Selector, req_state, domain));
 }
 
+/* forget the cached table segment of an object whose atoms changed */
+static void SelectorInvalidateTableSeg(CSelector * I, ObjectMolecule * obj)
+{
+  int a;
+  if(!I)
+    return;
+  for(a = 0; a < I->NSeg; a++) {
+    TableSegRec *seg = I->Seg + a;
+    if(seg->obj == obj) {
+      FreeP(seg->atom);
+      seg->obj = NULL;
+    }
+  }
+}
+
+typedef struct {
+  ObjectMolecule *obj;
+  int state;                    /* -1 = all states */
+  int build;                    /* atoms must be (re)collected */
+  int *atom;                    /* NULL = all atoms */
+  int n;
+  int model, start;
+  int included_one, excluded_one;
+} TableJobRec;
+
+typedef struct {
+  PyMOLGlobals *G;
+  CSelector *I;
+  TableJobRec *job;
+  int n_job;
+  int domain;
+  int *piece;                   /* fill pieces: job, first, count */
+  int n_piece;
+} TableUpdateRec;
+
+#define cTableFillPiece 65536
+
+static void SelectorTableCollectTask(void *ctx, int index)
+{
+  TableUpdateRec *U = (TableUpdateRec *) ctx;
+  TableJobRec *job = U->job + index;
+  ObjectMolecule *obj = job->obj;
+  int domain = U->domain;
+  int a, n = 0, n_atom = obj->NAtom;
+  int *atom;
+  CoordSet *cs = NULL;
+
+  if(!job->build)
+    return;
+  if((job->state < 0) && (domain < 0)) {
+    job->atom = NULL;
+    job->n = n_atom;
+    return;
+  }
+  atom = Alloc(int, n_atom ? n_atom : 1);
+  if(!atom) {
+    job->n = 0;
+    return;
+  }
+  if(job->state >= 0) {
+    if(job->state < obj->NCSet)
+      cs = obj->CSet[job->state];
+    if(!cs) {
+      job->atom = atom;
+      job->n = 0;
+      return;
+    }
+  }
+  for(a = 0; a < n_atom; a++) {
+    /* does coordinate exist for this atom in the requested state? */
+    if(cs && (cs->atmToIdx(a) < 0))
+      continue;
+    if(domain >= 0) {
+      if(!SelectorIsMember(U->G, obj->AtomInfo[a].selEntry, domain)) {
+        job->excluded_one = true;
+        continue;
+      }
+      job->included_one = true;
+    }
+    atom[n++] = a;
+  }
+  job->atom = atom;
+  job->n = n;
+}
+
+static void SelectorTableFillTask(void *ctx, int index)
+{
+  TableUpdateRec *U = (TableUpdateRec *) ctx;
+  const int *piece = U->piece + 3 * index;
+  TableJobRec *job = U->job + piece[0];
+  TableRec *rec = U->I->Table + job->start + piece[1];
+  int a, stop = piece[1] + piece[2];
+  int model = job->model;
+
+  for(a = piece[1]; a < stop; a++) {
+    rec->model = model;
+    rec->atom = job->atom ? job->atom[a] : a;
+    rec->index = 0;
+    rec->f1 = 0.0F;
+    rec++;
+  }
+}
+
+static void SelectorTableRun(PyMOLGlobals * G, int n_task, int n_work,
+                             TaskPoolFn * fn, void *ctx)
+{
+  int a;
+  int n_thread = TaskPoolGetNThread(G);
+  if((n_thread > 1) && (n_task > 1) && (n_work >= cTableFillPiece)) {
+    TaskPoolRun(G, n_thread, n_task, fn, ctx);
+  } else {
+    for(a = 0; a < n_task; a++)
+      fn(ctx, a);
+  }
+}
+
 int SelectorUpdateTableImpl(PyMOLGlobals * G, CSelector *I, int req_state, int domain)
 {
-  int a = 0;
+  int a = 0, b;
   ov_size c = 0;
   int modelCnt;
   int state = req_state;
   void *iterator = NULL;
   ObjectMolecule *obj = NULL;
+  TableUpdateRec U;
+  TableJobRec *job;
+  TableSegRec *seg;
+  int n_job = 0, n_seg = 0;
+  ov_size n_total = 0;
 
   /* Origin and Center are dummy objects */
   if(!I->Origin)
@@ -8206,11 +8509,13 @@ int SelectorUpdateTableImpl(PyMOLGlobals * G, CSelector *I, int req_state, int d
       I->NCSet = obj->NCSet;
     modelCnt++;
   }
-  /* allocate space for each atom, in the record table */
-  I->Table = Calloc(TableRec, c);
-  ErrChkPtr(G, I->Table);
-  I->Obj = Calloc(ObjectMolecule *, modelCnt);
-  ErrChkPtr(G, I->Obj);
+
+  UtilZeroMem(&U, sizeof(U));
+  U.G = G;
+  U.I = I;
+  U.domain = domain;
+  U.job = Calloc(TableJobRec, modelCnt);
+  ErrChkPtr(G, U.job);
 
   switch (req_state) {
   case cSelectorUpdateTableAllStates:
@@ -8221,38 +8526,12 @@ int SelectorUpdateTableImpl(PyMOLGlobals * G, CSelector *I, int req_state, int d
     break;
   }
 
-  c = 0;
-  modelCnt = 0;
-
-  /* update the origin and center dummies */
-  obj = I->Origin;
-  if(obj) {
-    I->Obj[modelCnt] = I->Origin;
-    obj->SeleBase = c;          /* make note of where this object starts */
-    for(a = 0; a < obj->NAtom; a++) {
-      I->Table[c].model = modelCnt;
-      I->Table[c].atom = a;
-      c++;
-    }
-    modelCnt++;
-  }
-
-  obj = I->Center;
-  if(obj) {
-    I->Obj[modelCnt] = I->Center;
-    obj->SeleBase = c;          /* make note of where this object starts */
-    for(a = 0; a < obj->NAtom; a++) {
-      I->Table[c].model = modelCnt;
-      I->Table[c].atom = a;
-      c++;
-    }
-    modelCnt++;
-  }
-
   if(req_state < cSelectorUpdateTableAllStates) {
     state = SceneGetState(G);   /* just in case... */
   }
 
+  /* work out which atoms each object contributes, reusing what was
+     collected last time for objects whose atoms haven't changed */
   while(ExecutiveIterateObjectMolecule(G, &obj, &iterator)) {
     int skip_flag = false;
     if(req_state < 0) {
@@ -8274,94 +8553,157 @@ int SelectorUpdateTableImpl(PyMOLGlobals * G, CSelector *I, int req_state, int d
     } else {
       if(state >= obj->NCSet)
         skip_flag = true;
-      else if(!obj->CSet[state])
+      else if(!ObjectMoleculeGetCoordSet(obj, state))
         skip_flag = true;
     }
 
-    if(!skip_flag) {
-      /* fill in the table */
-      I->Obj[modelCnt] = obj;
-      {
-        int n_atom = obj->NAtom;
-        TableRec *rec = I->Table + c;
-        TableRec *start_rec = rec;
-        if(state < 0) {         /* all states */
-          if(domain < 0) {      /* domain=all */
-            for(a = 0; a < n_atom; a++) {
-              rec->model = modelCnt;
-              rec->atom = a;
-              rec++;
-            }
-          } else {
-            AtomInfoType *ai = obj->AtomInfo;
-            int included_one = false;
-            int excluded_one = false;
-            for(a = 0; a < n_atom; a++) {
-              if(SelectorIsMember(G, ai->selEntry, domain)) {
-                rec->model = modelCnt;
-                rec->atom = a;
-                rec++;
-                included_one = true;
-              } else {
-                excluded_one = true;
-              }
-              ai++;
-            }
-            if(included_one && excluded_one)
-              I->SeleBaseOffsetsValid = false;  /* partial objects in domain, so
-                                                   base offsets are invalid */
+    if(skip_flag) {
+      obj->SeleBase = 0;
+      continue;
+    }
+
+    job = U.job + n_job++;
+    job->obj = obj;
+    job->state = state;
+    job->build = true;
+    if((domain < 0) && (state >= 0)) {
+      CoordSet *cs = (state < obj->NCSet) ? obj->CSet[state] : NULL;
+      seg = NULL;
+      if((n_job - 1 < I->NSeg) && (I->Seg[n_job - 1].obj == obj))
+        seg = I->Seg + n_job - 1;
+      else
+        for(b = 0; b < I->NSeg; b++)
+          if(I->Seg[b].obj == obj) {
+            seg = I->Seg + b;
+            break;
           }
-        } else {                /* specific states */
-          CoordSet *cs;
-          int idx;
-          if(domain < 0) {
-            for(a = 0; a < n_atom; a++) {
-              /* does coordinate exist for this atom in the requested state? */
-              if(state < obj->NCSet)
-                cs = obj->CSet[state];
-              else
-                cs = NULL;
-              if(cs) {
-                idx = cs->atmToIdx(a);
-                if(idx >= 0) {
-                  rec->model = modelCnt;
-                  rec->atom = a;
-                  rec++;
-                }
-              }
-            }
-          } else {
-            AtomInfoType *ai = obj->AtomInfo;
-            for(a = 0; a < n_atom; a++) {
-              /* does coordinate exist for this atom in the requested state? */
-              if(state < obj->NCSet)
-                cs = obj->CSet[state];
-              else
-                cs = NULL;
-              if(cs) {
-                idx = cs->atmToIdx(a);
-                if(idx >= 0) {
-                  if(SelectorIsMember(G, ai->selEntry, domain)) {
-                    rec->model = modelCnt;
-                    rec->atom = a;
-                    rec++;
-                  }
-                }
-              }
-              ai++;
-            }
+      if(seg && (seg->state == state) && (seg->n_atom == obj->NAtom) &&
+         (seg->cs_generation == (cs ? cs->Generation : 0))) {
+        job->atom = seg->atom;
+        job->n = seg->n;
+        job->build = false;
+      }
+    }
+    n_total += obj->NAtom;
+  }
+  U.n_job = n_job;
+
+  SelectorTableRun(G, n_job, (int) n_total, SelectorTableCollectTask, &U);
+
+  /* allocate space for each atom, in the record table */
+  I->Table = Alloc(TableRec, c);
+  ErrChkPtr(G, I->Table);
+  I->Obj = Calloc(ObjectMolecule *, modelCnt);
+  ErrChkPtr(G, I->Obj);
+
+  c = 0;
+  modelCnt = 0;
+
+  /* update the origin and center dummies */
+  obj = I->Origin;
+  if(obj) {
+    I->Obj[modelCnt] = I->Origin;
+    obj->SeleBase = c;          /* make note of where this object starts */
+    for(a = 0; a < obj->NAtom; a++) {
+      UtilZeroMem(I->Table + c, sizeof(TableRec));
+      I->Table[c].model = modelCnt;
+      I->Table[c].atom = a;
+      c++;
+    }
+    modelCnt++;
+  }
+
+  obj = I->Center;
+  if(obj) {
+    I->Obj[modelCnt] = I->Center;
+    obj->SeleBase = c;          /* make note of where this object starts */
+    for(a = 0; a < obj->NAtom; a++) {
+      UtilZeroMem(I->Table + c, sizeof(TableRec));
+      I->Table[c].model = modelCnt;
+      I->Table[c].atom = a;
+      c++;
+    }
+    modelCnt++;
+  }
+
+  /* lay out the segments, then fill them in parallel pieces */
+  U.piece = VLAlloc(int, 3 * (n_job + 1));
+  for(a = 0; a < n_job; a++) {
+    job = U.job + a;
+    obj = job->obj;
+    if(job->included_one && job->excluded_one)
+      I->SeleBaseOffsetsValid = false;  /* partial objects in domain, so
+                                           base offsets are invalid */
+    if(!job->n) {               /* skip excluded models */
+      obj->SeleBase = 0;
+      continue;
+    }
+    I->Obj[modelCnt] = obj;
+    job->model = modelCnt++;
+    job->start = c;
+    obj->SeleBase = c;          /* make note of where this object starts */
+    c += job->n;
+    for(b = 0; b < job->n; b += cTableFillPiece) {
+      VLACheck(U.piece, int, 3 * U.n_piece + 2);
+      U.piece[3 * U.n_piece] = a;
+      U.piece[3 * U.n_piece + 1] = b;
+      U.piece[3 * U.n_piece + 2] = (job->n - b < cTableFillPiece) ?
+        (job->n - b) : cTableFillPiece;
+      U.n_piece++;
+    }
+  }
+  SelectorTableRun(G, U.n_piece, (int) c, SelectorTableFillTask, &U);
+  VLAFreeP(U.piece);
+
+  /* retain the per-state atom lists for the next update (lists of all
+     atoms cost nothing to rebuild, and domain lists are transient) */
+  if(domain < 0) {
+    TableSegRec *new_seg = VLACalloc(TableSegRec, n_job + I->NSeg + 1);
+    for(a = 0; a < n_job; a++) {
+      job = U.job + a;
+      if(job->state < 0)
+        continue;
+      if(!job->build) {         /* take it over from its old record */
+        for(b = 0; b < I->NSeg; b++)
+          if(I->Seg[b].obj == job->obj) {
+            I->Seg[b].obj = NULL;
+            I->Seg[b].atom = NULL;
           }
-        }
-        if(rec != start_rec) {  /* skip excluded models */
-          modelCnt++;
-          obj->SeleBase = c;    /* make note of where this object starts */
-          c += (rec - start_rec);
-        } else {
-          obj->SeleBase = 0;
+      }
+      seg = new_seg + n_seg++;
+      seg->obj = job->obj;
+      seg->state = job->state;
+      seg->n_atom = job->obj->NAtom;
+      {
+        CoordSet *cs = (job->state < job->obj->NCSet) ? job->obj->CSet[job->state] : NULL;
+        seg->cs_generation = cs ? cs->Generation : 0;
+      }
+      seg->atom = job->atom;
+      seg->n = job->n;
+    }
+    for(b = 0; b < I->NSeg; b++) {
+      /* keep lists of objects which weren't looked at per-state this time */
+      seg = I->Seg + b;
+      if(seg->obj) {
+        for(a = 0; a < n_seg; a++)
+          if(new_seg[a].obj == seg->obj)
+            break;
+        if(a == n_seg) {
+          new_seg[n_seg++] = *seg;
+          continue;
         }
       }
+      FreeP(seg->atom);
     }
+    VLAFreeP(I->Seg);
+    I->Seg = new_seg;
+    I->NSeg = n_seg;
+  } else {
+    for(a = 0; a < n_job; a++)
+      FreeP(U.job[a].atom);     /* never cached */
   }
+  FreeP(U.job);
+
   I->NModel = modelCnt;
   I->NAtom = c;
   I->Flag1 = Alloc(int, c);
@@ -8405,24 +8747,161 @@ static int *SelectorSelect(PyMOLGlobals * G, const char *sele, int state, int do
 
 
 /*========================================================================*/
-static int SelectorModulate1(PyMOLGlobals * G, EvalElem * base, int state)
+/*
+ * Untagged operands (property predicates and the logic combining them)
+ * are kept as packed bits, so that and/or/not work a word at a time and
+ * each operand costs 1/32 of an int array.  Anything which needs per-atom
+ * tags unpacks the operand first with SelectorEvalTags().
+ */
+static ov_uint64 *SelectorEvalNewBits(PyMOLGlobals * G, EvalElem * e)
 {
   CSelector *I = G->Selector;
-  int a, d, e;
-  int c = 0;
-  float dist;
-  int nbond;
-  float *v2;
-  CoordSet *cs;
-  int ok = true;
-  int nCSet;
-  MapType *map;
-  int i, j, h, k, l;
-  int n1, at, idx;
-  ObjectMolecule *obj;
+  e->type = STYP_LIST;
+  e->sele = NULL;
+  e->bits = Calloc(ov_uint64, SELE_BIT_WORDS(I->NAtom));
+  ErrChkPtr(G, e->bits);
+  return e->bits;
+}
 
-  if(state < 0) {
-    switch (state) {
+static int *SelectorEvalTags(PyMOLGlobals * G, EvalElem * e)
+{
+  if(!e->sele && e->bits) {
+    CSelector *I = G->Selector;
+    int a, n_atom = I->NAtom;
+    ov_uint64 *bits = e->bits;
+    e->sele = Alloc(int, n_atom);
+    ErrChkPtr(G, e->sele);
+    for(a = 0; a < n_atom; a++)
+      e->sele[a] = SELE_BIT_GET(bits, a) ? 1 : 0;
+    FreeP(e->bits);
+  }
+  return e->sele;
+}
+
+static void SelectorEvalFree(EvalElem * e)
+{
+  FreeP(e->sele);
+  FreeP(e->bits);
+}
+
+static int SelectorBitsCount(const ov_uint64 * bits, int n_atom)
+{
+  int a, c = 0;
+  int n_word = SELE_BIT_WORDS(n_atom);
+  for(a = 0; a < n_word; a++) {
+    ov_uint64 w = bits[a];
+    w = w - ((w >> 1) & 0x5555555555555555ULL);
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    c += (int) ((w * 0x0101010101010101ULL) >> 56);
+  }
+  return c;
+}
+
+/* and/or/and-not where at least one operand is packed; the result stays
+   packed unless it has to carry the tags of the other operand */
+static int SelectorLogic2Bits(PyMOLGlobals * G, EvalElem * base)
+{
+  CSelector *I = G->Selector;
+  int a, n_atom = I->NAtom;
+  int n_word = SELE_BIT_WORDS(n_atom);
+  int code = base[1].code;
+  int c = 0;
+
+  if(base[0].bits && !base[2].bits && (code != SELE_ANT2)) {
+    /* and/or are symmetric: keep the tagged operand on the left */
+    base[0].sele = base[2].sele;
+    base[2].sele = NULL;
+    base[2].bits = base[0].bits;
+    base[0].bits = NULL;
+  }
+
+  if(base[0].bits) {
+    ov_uint64 *bits0 = base[0].bits;
+    if(base[2].bits) {
+      const ov_uint64 *bits2 = base[2].bits;
+      switch (code) {
+      case SELE_OR_2:
+      case SELE_IOR2:
+        for(a = 0; a < n_word; a++)
+          bits0[a] |= bits2[a];
+        break;
+      case SELE_AND2:
+        for(a = 0; a < n_word; a++)
+          bits0[a] &= bits2[a];
+        break;
+      case SELE_ANT2:
+        for(a = 0; a < n_word; a++)
+          bits0[a] &= ~bits2[a];
+        break;
+      }
+    } else {                    /* and-not with a tagged operand */
+      const int *sele2 = base[2].sele;
+      for(a = 0; a < n_atom; a++)
+        if(sele2[a])
+          bits0[a >> 6] &= ~SELE_BIT_ONE(a);
+    }
+    c = SelectorBitsCount(bits0, n_atom);
+  } else {
+    int *sele0 = base[0].sele;
+    const ov_uint64 *bits2 = base[2].bits;
+    switch (code) {
+    case SELE_OR_2:
+    case SELE_IOR2:
+      for(a = 0; a < n_atom; a++) {
+        if(SELE_BIT_GET(bits2, a) && (sele0[a] < 1))
+          sele0[a] = 1;         /* use higher tag */
+        if(sele0[a])
+          c++;
+      }
+      break;
+    case SELE_AND2:
+      for(a = 0; a < n_atom; a++) {
+        if(sele0[a] && SELE_BIT_GET(bits2, a)) {
+          if(sele0[a] < 1)
+            sele0[a] = 1;       /* use higher tag */
+          c++;
+        } else {
+          sele0[a] = 0;
+        }
+      }
+      break;
+    case SELE_ANT2:
+      for(a = 0; a < n_atom; a++) {
+        if(sele0[a] && !SELE_BIT_GET(bits2, a))
+          c++;
+        else
+          sele0[a] = 0;
+      }
+      break;
+    }
+  }
+  SelectorEvalFree(base + 2);
+  PRINTFD(G, FB_Selector)
+    " SelectorLogic2Bits: %d atoms selected.\n", c ENDFD;
+  return (1);
+}
+
+
+/*========================================================================*/
+static int SelectorModulate1(PyMOLGlobals * G, EvalElem * base, int state)
+{
+  CSelector *I = G->Selector;
+  int a, d, e;
+  int c = 0;
+  float dist;
+  int nbond;
+  float *v2;
+  CoordSet *cs;
+  int ok = true;
+  int nCSet;
+  MapType *map;
+  int i, j, h, k, l;
+  int n1, at, idx;
+  ObjectMolecule *obj;
+
+  if(state < 0) {
+    switch (state) {
     case -2:
     case -3:
       state = SceneGetState(G);
@@ -8430,6 +8909,7 @@ static int SelectorModulate1(PyMOLGlobals * G, EvalElem * base, int state)
     }
   }
 
+  SelectorEvalTags(G, base);
   base[1].sele = base[0].sele;  /* base1 has the mask */
   base->sele = Calloc(int, I->NAtom);
   for(a = 0; a < I->NAtom; a++)
@@ -8647,15 +9127,11 @@ static int SelectorSelect0(PyMOLGlobals * G, EvalElem * passed_base)
   ObjectMolecule **i_obj = I->Obj;
   int a, b, flag;
   EvalElem *base = passed_base;
-  int c = 0;
   int state;
   int static_singletons;
   ObjectMolecule *obj, *cur_obj = NULL;
   CoordSet *cs;
-
-  base->type = STYP_LIST;
-  base->sele = Calloc(int, I->NAtom);
-  ErrChkPtr(G, base->sele);
+  ov_uint64 *bits = SelectorEvalNewBits(G, base);
 
   switch (base->code) {
   case SELE_HBAs:
@@ -8678,44 +9154,34 @@ static int SelectorSelect0(PyMOLGlobals * G, EvalElem * passed_base)
     switch (base->code) {
     case SELE_HBAs:
     case SELE_ACCz:
-      for(a = cNDummyAtoms; a < I->NAtom; a++)
-        base[0].sele[a] = i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].hb_acceptor;
+      SELE_BITS_EVAL(I, bits, ai->hb_acceptor);
       break;
     case SELE_HBDs:
     case SELE_DONz:
-      for(a = cNDummyAtoms; a < I->NAtom; a++)
-        base[0].sele[a] = i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].hb_donor;
+      SELE_BITS_EVAL(I, bits, ai->hb_donor);
       break;
 
     }
     break;
   case SELE_NONz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] = false;
     break;
   case SELE_BNDz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] = i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].bonded;
+    SELE_BITS_EVAL(I, bits, ai->bonded);
     break;
   case SELE_HETz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] = i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].hetatm;
+    SELE_BITS_EVAL(I, bits, ai->hetatm);
     break;
   case SELE_HYDz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] = i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].isHydrogen();
+    SELE_BITS_EVAL(I, bits, ai->isHydrogen());
     break;
   case SELE_METz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++) {
-      b = i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].protons;
-      base[0].sele[a] = (
-          (b >  2 && b <  5) ||
-          (b > 10 && b < 14) ||
-          (b > 18 && b < 32) ||
-          (b > 36 && b < 51) ||
-          (b > 54 && b < 85) ||
-          b > 86);
-    }
+    SELE_BITS_EVAL(I, bits, (
+          (ai->protons >  2 && ai->protons <  5) ||
+          (ai->protons > 10 && ai->protons < 14) ||
+          (ai->protons > 18 && ai->protons < 32) ||
+          (ai->protons > 36 && ai->protons < 51) ||
+          (ai->protons > 54 && ai->protons < 85) ||
+          ai->protons > 86));
     break;
   case SELE_BB_z:
   case SELE_SC_z:
@@ -8724,62 +9190,46 @@ static int SelectorSelect0(PyMOLGlobals * G, EvalElem * passed_base)
       flag = (base->code == SELE_BB_z);
       for(a = cNDummyAtoms; a < I->NAtom; a++) {
         ai = i_obj[i_table[a].model]->AtomInfo + i_table[a].atom;
-        if(!(ai->flags & cAtomFlag_polymer)) {
-          base[0].sele[a] = 0;
+        if(!(ai->flags & cAtomFlag_polymer))
           continue;
-        }
-        base[0].sele[a] = !flag;
+        int match = !flag;
         for(b = 0; backbone_names[b][0]; b++) {
           if(!(strcmp(ai->name, backbone_names[b]))) {
-            base[0].sele[a] = flag;
+            match = flag;
             break;
           }
         }
+        if(match)
+          SELE_BIT_SET(bits, a);
       }
     }
     break;
   case SELE_FXDz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] =
-        i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].flags & cAtomFlag_fix;
+    SELE_BITS_EVAL(I, bits, ai->flags & cAtomFlag_fix);
     break;
   case SELE_RSTz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] =
-        i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].flags & cAtomFlag_restrain;
+    SELE_BITS_EVAL(I, bits, ai->flags & cAtomFlag_restrain);
     break;
   case SELE_POLz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] =
-        i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].flags & cAtomFlag_polymer;
+    SELE_BITS_EVAL(I, bits, ai->flags & cAtomFlag_polymer);
     break;
   case SELE_SOLz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] =
-        i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].flags & cAtomFlag_solvent;
+    SELE_BITS_EVAL(I, bits, ai->flags & cAtomFlag_solvent);
     break;
   case SELE_PTDz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] = i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].protekted;
+    SELE_BITS_EVAL(I, bits, ai->protekted);
     break;
   case SELE_MSKz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] = i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].masked;
+    SELE_BITS_EVAL(I, bits, ai->masked);
     break;
   case SELE_ORGz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] =
-        i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].flags & cAtomFlag_organic;
+    SELE_BITS_EVAL(I, bits, ai->flags & cAtomFlag_organic);
     break;
   case SELE_INOz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] =
-        i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].flags & cAtomFlag_inorganic;
+    SELE_BITS_EVAL(I, bits, ai->flags & cAtomFlag_inorganic);
     break;
   case SELE_GIDz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++)
-      base[0].sele[a] =
-        i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].flags & cAtomFlag_guide;
+    SELE_BITS_EVAL(I, bits, ai->flags & cAtomFlag_guide);
     break;
 
   case SELE_PREz:
@@ -8788,7 +9238,6 @@ static int SelectorSelect0(PyMOLGlobals * G, EvalElem * passed_base)
     flag = false;
     cs = NULL;
     for(a = cNDummyAtoms; a < I->NAtom; a++) {
-      base[0].sele[a] = false;
       obj = i_obj[i_table[a].model];
       if(obj != cur_obj) {      /* different object */
         if(state >= obj->NCSet)
@@ -8808,43 +9257,30 @@ static int SelectorSelect0(PyMOLGlobals * G, EvalElem * passed_base)
         cur_obj = obj;
       }
       if(flag && cs) {
-        if(cs->atmToIdx(i_table[a].atom) >= 0) {
-          base[0].sele[a] = true;
-          c++;
-        }
+        if(cs->atmToIdx(i_table[a].atom) >= 0)
+          SELE_BIT_SET(bits, a);
       }
     }
     break;
   case SELE_ALLz:
-    for(a = cNDummyAtoms; a < I->NAtom; a++) {
-      base[0].sele[a] = true;
-      c++;
-    }
+    for(a = cNDummyAtoms; a < I->NAtom; a++)
+      SELE_BIT_SET(bits, a);
     break;
   case SELE_ORIz:
-    for(a = 0; a < I->NAtom; a++) {
-      base[0].sele[a] = false;
-      c++;
-    }
     if(I->Origin)
       ObjectMoleculeDummyUpdate(I->Origin, cObjectMoleculeDummyOrigin);
-    base[0].sele[cDummyOrigin] = true;
+    SELE_BIT_SET(bits, cDummyOrigin);
     break;
   case SELE_CENz:
-    for(a = 0; a < I->NAtom; a++) {
-      base[0].sele[a] = false;
-      c++;
-    }
     if(I->Center)
       ObjectMoleculeDummyUpdate(I->Center, cObjectMoleculeDummyCenter);
-    base[0].sele[cDummyCenter] = true;
+    SELE_BIT_SET(bits, cDummyCenter);
     break;
   case SELE_VISz:
     {
       ObjectMolecule *last_obj = NULL;
       AtomInfoType *ai;
       for(a = cNDummyAtoms; a < I->NAtom; a++) {
-        flag = false;
         obj = i_obj[i_table[a].model];
         if(obj->Obj.Enabled) {
           ai = obj->AtomInfo + i_table[a].atom;
@@ -8855,25 +9291,21 @@ static int SelectorSelect0(PyMOLGlobals * G, EvalElem * passed_base)
             last_obj = obj;
           }
 
-          flag = ai->isVisible();
+          if(ai->isVisible())
+            SELE_BIT_SET(bits, a);
         }
-        base[0].sele[a] = flag;
-        if(flag)
-          c++;
       }
     }
     break;
   case SELE_ENAz:
     for(a = cNDummyAtoms; a < I->NAtom; a++) {
-      flag = (i_obj[i_table[a].model]->Obj.Enabled);
-      base[0].sele[a] = flag;
-      if(flag)
-        c++;
+      if(i_obj[i_table[a].model]->Obj.Enabled)
+        SELE_BIT_SET(bits, a);
     }
     break;
   }
   PRINTFD(G, FB_Selector)
-    " SelectorSelect0: %d atoms selected.\n", c ENDFD;
+    " SelectorSelect0: %d atoms selected.\n", SelectorBitsCount(bits, I->NAtom) ENDFD;
 
   return (1);
 }
@@ -8889,7 +9321,7 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
   TableRec *i_table = I->Table, *table_a;
   int ignore_case = SettingGetGlobal_b(G, cSetting_ignore_case);
   int I_NAtom = I->NAtom;
-  int *base_0_sele_a;
+  ov_uint64 *bits = NULL;
 
   int model, sele, s, col_idx;
   int flag;
@@ -8902,11 +9334,17 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
   ObjectMolecule *cur_obj = NULL;
   CoordSet *cs = NULL;
 
-  base->type = STYP_LIST;
-  base->sele = Calloc(int, I_NAtom);    /* starting with zeros */
+  if(base->code == SELE_SELs) { /* named selections carry tags */
+    base->type = STYP_LIST;
+    base->bits = NULL;
+    base->sele = Calloc(int, I_NAtom);  /* starting with zeros */
+    ErrChkPtr(G, base->sele);
+  } else {
+    bits = SelectorEvalNewBits(G, base);
+  }
   PRINTFD(G, FB_Selector)
-    " SelectorSelect1: base: %p sele: %p\n", (void *) base, (void *) base->sele ENDFD;
-  ErrChkPtr(G, base->sele);
+    " SelectorSelect1: base: %p sele: %p bits: %p\n", (void *) base,
+    (void *) base->sele, (void *) base->bits ENDFD;
   switch (base->code) {
   case SELE_PEPs:
     if(base[1].text[0]) {
@@ -8945,8 +9383,7 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
                     for(d = b; d < I_NAtom; d++) {
                       ai2 = i_obj[i_table[d].model]->AtomInfo + i_table[d].atom;        /* complete residue */
                       if(AtomInfoSameResidue(G, ai1, ai2)) {
-                        c++;
-                        base[0].sele[d] = true;
+                        SELE_BIT_SET(bits, d);
                       }
                     }
                   }
@@ -8971,13 +9408,10 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
 
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
         table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
         for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          if((*base_0_sele_a = WordMatcherMatchInteger(matcher, table_a->atom + 1)))
-            c++;
+          if(WordMatcherMatchInteger(matcher, table_a->atom + 1))
+            SELE_BIT_SET(bits, a);
           table_a++;
-          base_0_sele_a++;
         }
         WordMatcherFree(matcher);
       }
@@ -8991,17 +9425,7 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
       WordMatchOptionsConfigInteger(&options);
 
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
-        table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          if((*base_0_sele_a =
-              WordMatcherMatchInteger(matcher,
-                                      i_obj[table_a->model]->AtomInfo[table_a->atom].id)))
-            c++;
-          table_a++;
-          base_0_sele_a++;
-        }
+        SELE_BITS_EVAL(I, bits, WordMatcherMatchInteger(matcher, ai->id));
         WordMatcherFree(matcher);
       }
     }
@@ -9012,22 +9436,8 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
 
       WordMatchOptionsConfigInteger(&options);
 
-      table_a = i_table + cNDummyAtoms;
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
-        table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          if((*base_0_sele_a =
-              WordMatcherMatchInteger(matcher,
-                                      i_obj[table_a->model]->AtomInfo[table_a->atom].
-                                      rank)))
-            c++;
-          table_a++;
-          base_0_sele_a++;
-        }
+        SELE_BITS_EVAL(I, bits, WordMatcherMatchInteger(matcher, ai->rank));
         WordMatcherFree(matcher);
       }
     }
@@ -9046,7 +9456,6 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
       matcher = WordMatcherNew(G, base[1].text, &options, false);
 
       table_a = i_table + cNDummyAtoms;
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
       last_obj = NULL;
       for(a = cNDummyAtoms; a < I_NAtom; a++) {
         obj = i_obj[table_a->model];
@@ -9081,10 +9490,9 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
                                           obj->AtomInfo[table_a->atom].name,
                                           ignore_case) < 0);
 
-        if((*base_0_sele_a = hit_flag))
-          c++;
+        if(hit_flag)
+          SELE_BIT_SET(bits, a);
         table_a++;
-        base_0_sele_a++;
       }
       if(matcher)
         WordMatcherFree(matcher);
@@ -9096,25 +9504,8 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
 
       WordMatchOptionsConfigAlphaList(&options, wildcard[0], ignore_case);
 
-      table_a = i_table + cNDummyAtoms;
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
-	AtomInfoType * ai;
-        int prevmodel;
-        table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-	prevmodel = -1;
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          ai = i_obj[table_a->model]->AtomInfo + table_a->atom;
-#ifndef NO_MMLIBS
-#endif
-          if((*base_0_sele_a = WordMatcherMatchAlpha(matcher, LexStr(G, ai->textType))))
-	    c++;
-          table_a++;
-          base_0_sele_a++;
-        }
+        SELE_BITS_EVAL(I, bits, WordMatcherMatchAlpha(matcher, LexStr(G, ai->textType)));
         WordMatcherFree(matcher);
       }
     }
@@ -9126,21 +9517,8 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
 
       WordMatchOptionsConfigAlphaList(&options, wildcard[0], ignore_case);
 
-      table_a = i_table + cNDummyAtoms;
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
-        table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          if((*base_0_sele_a =
-              WordMatcherMatchAlpha(matcher,
-                                    i_obj[table_a->model]->AtomInfo[table_a->atom].elem)))
-            c++;
-          table_a++;
-          base_0_sele_a++;
-        }
+        SELE_BITS_EVAL(I, bits, WordMatcherMatchAlpha(matcher, ai->elem));
         WordMatcherFree(matcher);
       }
     }
@@ -9148,29 +9526,14 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
   case SELE_STRO:
     {
       CWordMatchOptions options;
-      int prevmodel;
       char mmstereotype[2];
       mmstereotype[1] = 0;
       WordMatchOptionsConfigAlphaList(&options, wildcard[0], ignore_case);
 
-      table_a = i_table + cNDummyAtoms;
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
-        table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-	prevmodel = -1;
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-#ifndef NO_MMLIBS
-#endif
-	  mmstereotype[0] = convertStereoToChar(i_obj[table_a->model]->AtomInfo[table_a->atom].mmstereo);
-          if((*base_0_sele_a =
-              WordMatcherMatchAlpha(matcher,mmstereotype)))
-            c++;
-          table_a++;
-          base_0_sele_a++;
-        }
+        SELE_BITS_EVAL(I, bits,
+                       (mmstereotype[0] = convertStereoToChar(ai->mmstereo),
+                        WordMatcherMatchAlpha(matcher, mmstereotype)));
         WordMatcherFree(matcher);
       }
     }
@@ -9181,21 +9544,8 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
 
       WordMatchOptionsConfigAlphaList(&options, wildcard[0], ignore_case);
 
-      table_a = i_table + cNDummyAtoms;
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
-        table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          if((*base_0_sele_a =
-              WordMatcherMatchAlpha(matcher,
-                                    i_obj[table_a->model]->AtomInfo[table_a->atom].segi)))
-            c++;
-          table_a++;
-          base_0_sele_a++;
-        }
+        SELE_BITS_EVAL(I, bits, WordMatcherMatchAlpha(matcher, ai->segi));
         WordMatcherFree(matcher);
       }
     }
@@ -9207,56 +9557,25 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
       if(WordMatchComma(G, base[1].text, rep_names[a].word, ignore_case) < 0)
         rep_mask |= rep_names[a].value;
     }
-    for(SelectorAtomIterator iter(G); iter.next();) {
-      if(iter.getAtomInfo()->visRep & rep_mask) {
-        base[0].sele[iter.a] = true;
-        c++;
-      } else {
-        base[0].sele[iter.a] = false;
-      }
-    }
+    SELE_BITS_EVAL(I, bits, ai->visRep & rep_mask);
     break;
   case SELE_COLs:
     col_idx = ColorGetIndex(G, base[1].text);
-    for(a = cNDummyAtoms; a < I_NAtom; a++) {
-      base[0].sele[a] = false;
-      if(i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].color == col_idx) {
-        base[0].sele[a] = true;
-        c++;
-      }
-    }
+    SELE_BITS_EVAL(I, bits, ai->color == col_idx);
     break;
   case SELE_CCLs:
-    col_idx = ColorGetIndex(G, base[1].text);
-    for(a = cNDummyAtoms; a < I_NAtom; a++) {
-      base[0].sele[a] = false;
-      {
-        AtomInfoType *ai = i_obj[i_table[a].model]->AtomInfo + i_table[a].atom;
-        if(ai->has_setting) {
-          int value;
-          if(SettingUniqueGet_color(G, ai->unique_id, cSetting_cartoon_color, &value)) {
-            if(value == col_idx) {
-              base[0].sele[a] = true;
-              c++;
-            }
-          }
-        }
-      }
-    }
-    break;
   case SELE_RCLs:
-    col_idx = ColorGetIndex(G, base[1].text);
-    for(a = cNDummyAtoms; a < I_NAtom; a++) {
-      base[0].sele[a] = false;
-      {
+    {
+      int setting_index = (base->code == SELE_CCLs) ?
+        cSetting_cartoon_color : cSetting_ribbon_color;
+      col_idx = ColorGetIndex(G, base[1].text);
+      for(a = cNDummyAtoms; a < I_NAtom; a++) {
         AtomInfoType *ai = i_obj[i_table[a].model]->AtomInfo + i_table[a].atom;
         if(ai->has_setting) {
           int value;
-          if(SettingUniqueGet_color(G, ai->unique_id, cSetting_ribbon_color, &value)) {
-            if(value == col_idx) {
-              base[0].sele[a] = true;
-              c++;
-            }
+          if(SettingUniqueGet_color(G, ai->unique_id, setting_index, &value)) {
+            if(value == col_idx)
+              SELE_BIT_SET(bits, a);
           }
         }
       }
@@ -9270,9 +9589,6 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
 
       WordMatchOptionsConfigAlphaList(&options, wildcard[0], ignore_case);
 
-      table_a = i_table + cNDummyAtoms;
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       int offset = 0;
       switch (base->code) {
         case SELE_CHNs:
@@ -9286,19 +9602,10 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
       }
 
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
-        table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          if((*base_0_sele_a =
-              WordMatcherMatchAlpha(matcher, LexStr(G,
-                  *reinterpret_cast<int /* decltype(AtomInfoType::chain) */ *>
-                  (((char*)(i_obj[table_a->model]->AtomInfo + table_a->atom)) + offset)
-                  ))))
-            c++;
-          table_a++;
-          base_0_sele_a++;
-        }
+        SELE_BITS_EVAL(I, bits,
+                       WordMatcherMatchAlpha(matcher, LexStr(G,
+                           *reinterpret_cast<int /* decltype(AtomInfoType::chain) */ *>
+                           (((char*) ai) + offset))));
         WordMatcherFree(matcher);
       }
     }
@@ -9310,22 +9617,8 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
 
       WordMatchOptionsConfigAlphaList(&options, wildcard[0], ignore_case);
 
-      table_a = i_table + cNDummyAtoms;
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
-        table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          if((*base_0_sele_a =
-              WordMatcherMatchAlpha(matcher,
-                                    i_obj[table_a->model]->AtomInfo[table_a->atom].
-                                    ssType)))
-            c++;
-          table_a++;
-          base_0_sele_a++;
-        }
+        SELE_BITS_EVAL(I, bits, WordMatcherMatchAlpha(matcher, ai->ssType));
         WordMatcherFree(matcher);
       }
     }
@@ -9335,12 +9628,8 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
     state = state - 1;
     obj = NULL;
 
-    if(state < 0) {
-      for(a = cNDummyAtoms; a < I_NAtom; a++)
-        base[0].sele[a] = false;
-    } else {
+    if(state >= 0) {
       for(a = cNDummyAtoms; a < I_NAtom; a++) {
-        base[0].sele[a] = false;
         obj = i_obj[i_table[a].model];
         if(obj != cur_obj) {    /* different object */
           if(state >= obj->NCSet)
@@ -9354,10 +9643,8 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
           cur_obj = obj;
         }
         if(flag && cs) {
-          if(cs->atmToIdx(i_table[a].atom) >= 0) {
-            base[0].sele[a] = true;
-            c++;
-          }
+          if(cs->atmToIdx(i_table[a].atom) >= 0)
+            SELE_BIT_SET(bits, a);
         }
       }
     }
@@ -9369,21 +9656,8 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
 
       WordMatchOptionsConfigAlphaList(&options, wildcard[0], ignore_case);
 
-      table_a = i_table + cNDummyAtoms;
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
-        table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          if((*base_0_sele_a =
-              WordMatcherMatchAlpha(matcher,
-                                    i_obj[table_a->model]->AtomInfo[table_a->atom].alt)))
-            c++;
-          table_a++;
-          base_0_sele_a++;
-        }
+        SELE_BITS_EVAL(I, bits, WordMatcherMatchAlpha(matcher, ai->alt));
         WordMatcherFree(matcher);
       }
     }
@@ -9391,13 +9665,7 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
   case SELE_FLGs:
     sscanf(base[1].text, "%d", &flag);
     flag = (1 << flag);
-    for(a = cNDummyAtoms; a < I_NAtom; a++) {
-      if(i_obj[i_table[a].model]->AtomInfo[i_table[a].atom].flags & flag) {
-        base[0].sele[a] = true;
-        c++;
-      } else
-        base[0].sele[a] = false;
-    }
+    SELE_BITS_EVAL(I, bits, ai->flags & flag);
     break;
   case SELE_NTYs:
     {
@@ -9406,18 +9674,7 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
       WordMatchOptionsConfigInteger(&options);
 
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
-        table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          if((*base_0_sele_a =
-              WordMatcherMatchInteger(matcher,
-                                      i_obj[table_a->model]->AtomInfo[table_a->atom].
-                                      customType)))
-            c++;
-          table_a++;
-          base_0_sele_a++;
-        }
+        SELE_BITS_EVAL(I, bits, WordMatcherMatchInteger(matcher, ai->customType));
         WordMatcherFree(matcher);
       }
     }
@@ -9425,24 +9682,11 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
   case SELE_RSIs:
     {
       CWordMatchOptions options;
-      AtomInfoType *ai;
 
       WordMatchOptionsConfigMixed(&options, wildcard[0], ignore_case);
 
-      table_a = i_table + cNDummyAtoms;
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
-        table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          ai = i_obj[table_a->model]->AtomInfo + table_a->atom;
-          if((*base_0_sele_a = WordMatcherMatchMixed(matcher, ai->resi, ai->resv)))
-            c++;
-          table_a++;
-          base_0_sele_a++;
-        }
+        SELE_BITS_EVAL(I, bits, WordMatcherMatchMixed(matcher, ai->resi, ai->resv));
         WordMatcherFree(matcher);
       }
     }
@@ -9454,21 +9698,8 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
 
       WordMatchOptionsConfigAlphaList(&options, wildcard[0], ignore_case);
 
-      table_a = i_table + cNDummyAtoms;
-      base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
       if((matcher = WordMatcherNew(G, base[1].text, &options, true))) {
-        table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
-
-        for(a = cNDummyAtoms; a < I_NAtom; a++) {
-          if((*base_0_sele_a =
-              WordMatcherMatchAlpha(matcher,
-                                    i_obj[table_a->model]->AtomInfo[table_a->atom].resn)))
-            c++;
-          table_a++;
-          base_0_sele_a++;
-        }
+        SELE_BITS_EVAL(I, bits, WordMatcherMatchAlpha(matcher, ai->resn));
         WordMatcherFree(matcher);
       }
     }
@@ -9616,11 +9847,7 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
 
         int obj_matches = false;
 
-        for(a = 0; a < I_NAtom; a++)    /* zero out first before iterating through selections */
-          base[0].sele[a] = false;
-
         table_a = i_table + cNDummyAtoms;
-        base_0_sele_a = &base[0].sele[cNDummyAtoms];
         last_obj = NULL;
         for(a = cNDummyAtoms; a < I_NAtom; a++) {
           obj = i_obj[table_a->model];
@@ -9630,13 +9857,10 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
             last_obj = obj;
           }
           if(obj_matches) {
-            if((index < 0) || (table_a->atom == index)) {
-              *base_0_sele_a = true;
-              c++;
-            }
+            if((index < 0) || (table_a->atom == index))
+              SELE_BIT_SET(bits, a);
           }
           table_a++;
-          base_0_sele_a++;
         }
         WordMatcherFree(matcher);
       } else {
@@ -9660,25 +9884,10 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
           }
         if(model) {
           model--;
-          if(index >= 0) {
-            for(a = cNDummyAtoms; a < I_NAtom; a++) {
-              if(i_table[a].model == model)
-                if(i_table[a].atom == index) {
-                  base[0].sele[a] = true;
-                  c++;
-                } else {
-                  base[0].sele[a] = false;
-              } else
-                base[0].sele[a] = false;
-            }
-          } else {
-            for(a = cNDummyAtoms; a < I_NAtom; a++) {
-              if(i_table[a].model == model) {
-                base[0].sele[a] = true;
-                c++;
-              } else
-                base[0].sele[a] = false;
-            }
+          for(a = cNDummyAtoms; a < I_NAtom; a++) {
+            if(i_table[a].model == model)
+              if((index < 0) || (i_table[a].atom == index))
+                SELE_BIT_SET(bits, a);
           }
         } else {
           PRINTFB(G, FB_Selector, FB_Errors)
@@ -9689,6 +9898,8 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
     }
     break;
   }
+  if(bits)
+    c = SelectorBitsCount(bits, I_NAtom);
   PRINTFD(G, FB_Selector)
     " SelectorSelect1:  %d atoms selected.\n", c ENDFD;
   return (ok);
@@ -9699,18 +9910,14 @@ static int SelectorSelect1(PyMOLGlobals * G, EvalElem * base, int quiet)
 static int SelectorSelect2(PyMOLGlobals * G, EvalElem * base, int state)
 {
   int a;
-  int c = 0;
   int ok = true;
   int oper;
   float comp1;
   int exact;
   int ignore_case = SettingGetGlobal_b(G, cSetting_ignore_case);
 
-  AtomInfoType *at1;
   CSelector *I = G->Selector;
-  base->type = STYP_LIST;
-  base->sele = Calloc(int, I->NAtom);
-  ErrChkPtr(G, base->sele);
+  ov_uint64 *bits = SelectorEvalNewBits(G, base);
   switch (base->code) {
   case SELE_XVLx:
   case SELE_YVLx:
@@ -9737,12 +9944,9 @@ static int SelectorSelect2(PyMOLGlobals * G, EvalElem * base, int state)
         sN = s0 + 1;
       }
 
-      for(a = cNDummyAtoms; a < I->NAtom; a++)
-        base[0].sele[a] = false;
-
       for(s = s0; s < sN; s++) {
         for(a = cNDummyAtoms; a < I->NAtom; a++) {
-          if(base[0].sele[a])
+          if(SELE_BIT_GET(bits, a))
             continue;
 
           obj = I->Obj[I->Table[a].model];
@@ -9763,7 +9967,8 @@ static int SelectorSelect2(PyMOLGlobals * G, EvalElem * base, int state)
             idx++;
           }
 
-          base[0].sele[a] = fcmp(cs->Coord[idx], comp1, oper);
+          if(fcmp(cs->Coord[idx], comp1, oper))
+            SELE_BIT_SET(bits, a);
         }
       }
     }
@@ -9789,144 +9994,48 @@ static int SelectorSelect2(PyMOLGlobals * G, EvalElem * base, int state)
         case SCMP_GTHN:
           switch (base->code) {
           case SELE_BVLx:
-            for(a = cNDummyAtoms; a < I->NAtom; a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->b > comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
+            SELE_BITS_EVAL(I, bits, ai->b > comp1);
             break;
           case SELE_QVLx:
-            for(a = cNDummyAtoms; a < I->NAtom; a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->q > comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
+            SELE_BITS_EVAL(I, bits, ai->q > comp1);
             break;
           case SELE_PCHx:
-            for(a = cNDummyAtoms; a < I->NAtom; a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->partialCharge > comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
+            SELE_BITS_EVAL(I, bits, ai->partialCharge > comp1);
             break;
           case SELE_FCHx:
-            for(a = cNDummyAtoms; a < I->NAtom; a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->formalCharge > comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
+            SELE_BITS_EVAL(I, bits, ai->formalCharge > comp1);
             break;
           }
           break;
         case SCMP_LTHN:
           switch (base->code) {
           case SELE_BVLx:
-            for(a = cNDummyAtoms; a < I->NAtom; a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->b < comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
+            SELE_BITS_EVAL(I, bits, ai->b < comp1);
             break;
           case SELE_QVLx:
-            for(a = cNDummyAtoms; a < I->NAtom; a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->q < comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
+            SELE_BITS_EVAL(I, bits, ai->q < comp1);
             break;
           case SELE_PCHx:
-            for(a = cNDummyAtoms; a < I->NAtom; a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->partialCharge < comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
+            SELE_BITS_EVAL(I, bits, ai->partialCharge < comp1);
             break;
           case SELE_FCHx:
-            for(a = cNDummyAtoms; a < I->NAtom; a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(at1->formalCharge < comp1) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
+            SELE_BITS_EVAL(I, bits, ai->formalCharge < comp1);
             break;
           }
           break;
         case SCMP_EQAL:
           switch (base->code) {
           case SELE_BVLx:
-            for(a = cNDummyAtoms; a < I->NAtom; a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(fabs(at1->b - comp1) < R_SMALL4) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
+            SELE_BITS_EVAL(I, bits, fabs(ai->b - comp1) < R_SMALL4);
             break;
           case SELE_QVLx:
-            for(a = cNDummyAtoms; a < I->NAtom; a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(fabs(at1->q - comp1) < R_SMALL4) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
+            SELE_BITS_EVAL(I, bits, fabs(ai->q - comp1) < R_SMALL4);
             break;
           case SELE_PCHx:
-            for(a = cNDummyAtoms; a < I->NAtom; a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(fabs(at1->partialCharge - comp1) < R_SMALL4) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
+            SELE_BITS_EVAL(I, bits, fabs(ai->partialCharge - comp1) < R_SMALL4);
             break;
           case SELE_FCHx:
-            for(a = cNDummyAtoms; a < I->NAtom; a++) {
-              at1 = &I->Obj[I->Table[a].model]->AtomInfo[I->Table[a].atom];
-              if(fabs(at1->formalCharge - comp1) < R_SMALL4) {
-                base[0].sele[a] = true;
-                c++;
-              } else {
-                base[0].sele[a] = false;
-              }
-            }
+            SELE_BITS_EVAL(I, bits, fabs(ai->formalCharge - comp1) < R_SMALL4);
             break;
           }
           break;
@@ -9937,7 +10046,7 @@ static int SelectorSelect2(PyMOLGlobals * G, EvalElem * base, int state)
   }
 
   PRINTFD(G, FB_Selector)
-    " SelectorSelect2: %d atoms selected.\n", c ENDFD;
+    " SelectorSelect2: %d atoms selected.\n", SelectorBitsCount(bits, I->NAtom) ENDFD;
   return (ok);
 }
 
@@ -9962,7 +10071,25 @@ static int SelectorLogic1(PyMOLGlobals * G, EvalElem * inp_base, int state)
   int a0, a1, a2;
   ObjectMolecule *lastObj = NULL;
 
+  if((base->code == SELE_NOT1) && base[1].bits) {
+    ov_uint64 *bits = base[1].bits;
+    int n_word = SELE_BIT_WORDS(n_atom);
+    for(a = 0; a < n_word; a++)
+      bits[a] = ~bits[a];
+    if(n_atom & 63)
+      bits[n_word - 1] &= SELE_BIT_ONE(n_atom) - 1;
+    base[0].bits = bits;
+    base[0].sele = NULL;
+    base[1].bits = NULL;
+    base[0].type = STYP_LIST;
+    PRINTFD(G, FB_Selector)
+      " SelectorLogic1: %d atoms selected.\n", SelectorBitsCount(bits, n_atom) ENDFD;
+    return (1);
+  }
+
+  SelectorEvalTags(G, base + 1);
   base[0].sele = base[1].sele;
+  base[0].bits = NULL;
   base[1].sele = NULL;
   base[0].type = STYP_LIST;
   switch (base->code) {
@@ -10516,6 +10643,20 @@ static int SelectorLogic2(PyMOLGlobals * G, EvalElem * base)
 
   AtomInfoType *at1, *at2;
 
+  switch (base[1].code) {
+  case SELE_OR_2:
+  case SELE_IOR2:
+  case SELE_AND2:
+  case SELE_ANT2:
+    if(base[0].bits || base[2].bits)
+      return SelectorLogic2Bits(G, base);
+    break;
+  default:
+    SelectorEvalTags(G, base);
+    SelectorEvalTags(G, base + 2);
+    break;
+  }
+
   switch (base[1].code) {
 
   case SELE_OR_2:
@@ -10668,6 +10809,9 @@ int SelectorOperator22(PyMOLGlobals * G, EvalElem * base, int state)
     }
   }
 
+  SelectorEvalTags(G, base);
+  SelectorEvalTags(G, base + 4);
+
   switch (code) {
   case SELE_WIT_:
   case SELE_BEY_:
@@ -10759,7 +10903,7 @@ int SelectorOperator22(PyMOLGlobals * G, EvalElem * base, int state)
     }
     break;
   }
-  FreeP(base[4].sele);
+  SelectorEvalFree(base + 4);
   PRINTFD(G, FB_Selector)
     " SelectorOperator22: %d atoms selected.\n", c ENDFD;
   return (1);
@@ -11129,6 +11273,7 @@ int *SelectorEvaluate(PyMOLGlobals * G, SelectorWordType * word, int state, int
                   Stack[depth].code = SELE_IOR2;
                   Stack[depth].level = Stack[depth].imp_op_level;
                   Stack[depth].sele = NULL;
+                  Stack[depth].bits = NULL;
                   Stack[depth].text[0] = 0;
                   if(level < Stack[depth].level)
                     level = Stack[depth].level;
@@ -11243,14 +11388,14 @@ int *SelectorEvaluate(PyMOLGlobals * G, SelectorWordType * word, int state, int
       else 
 	ok = 0;
     else
-      result = Stack[totDepth].sele;    /* return the selection list */
+      result = SelectorEvalTags(G, Stack + totDepth);   /* return the selection list */
   }
   if(!ok) {
     for(a = 1; a <= depth; a++) {
       PRINTFD(G, FB_Selector)
         " Selector: releasing %d %x %p\n", a, Stack[a].type, (void *) Stack[a].sele ENDFD;
       if(Stack[a].type == STYP_LIST)
-        FreeP(Stack[a].sele);
+        SelectorEvalFree(Stack + a);
     }
     depth = 0;
     {
@@ -11420,7 +11565,12 @@ void SelectorFree(PyMOLGlobals * G)
 
 void SelectorFreeImpl(PyMOLGlobals * G, CSelector *I, short init2)
 {
+  int a;
   SelectorCleanImpl(G, I);
+  for(a = 0; a < I->NSeg; a++)
+    FreeP(I->Seg[a].atom);
+  VLAFreeP(I->Seg);
+  I->NSeg = 0;
   if(I->Origin)
     if(I->Origin->Obj.fFree)
       I->Origin->Obj.fFree((CObject *) I->Origin);
@@ -78,6 +78,7 @@ int SelectorGetPDB(PyMOLGlobals * G, char **charVLA, int cLen, int sele, int sta
                    ObjectMolecule * single_object);
 int SelectorLoadCoords(PyMOLGlobals * G, PyObject * coords, int sele, int state);
 PyObject *SelectorGetCoordsAsNumPy(PyMOLGlobals * G, int sele, int state);
+PyObject *SelectorGetCoordsAsNumPyView(PyMOLGlobals * G, int sele, int state);
 PyObject *SelectorGetChemPyModel(PyMOLGlobals * G, int sele, int state, double *ref);
 float SelectorSumVDWOverlap(PyMOLGlobals * G, int sele1, int state1,
                             int sele2, int state2, float adjust);
@@ -346,137 +346,6 @@ static PyObject *CmdFixChemistry(PyObject * self, PyObject * args)
   return APIResultOk(ok);
 }
 
-static PyObject *CmdRayAntiThread(PyObject * self, PyObject * args)
-{
-  PyMOLGlobals *G = NULL;
-  int ok = false;
-  PyObject *py_thread_info;
-
-  CRayAntiThreadInfo *thread_info = NULL;
-
-  ok = PyArg_ParseTuple(args, "OO", &self, &py_thread_info);
-  if(ok)
-    ok = PyCObject_Check(py_thread_info);
-  if(ok)
-    ok = ((thread_info = (CRayAntiThreadInfo *) PyCObject_AsVoidPtr(py_thread_info)) != NULL);
-  if(ok) {
-    API_SETUP_PYMOL_GLOBALS;
-    ok = (G != NULL);
-  } else {
-    API_HANDLE_ERROR;
-  }
-  if(ok) {
-    PUnblock(G);
-    RayAntiThread(thread_info);
-    PBlock(G);
-  }
-  return APIResultOk(ok);
-}
-
-static PyObject *CmdRayHashThread(PyObject * self, PyObject * args)
-{
-  PyMOLGlobals *G = NULL;
-  int ok = false;
-  PyObject *py_thread_info;
-
-  CRayHashThreadInfo *thread_info = NULL;
-
-  ok = PyArg_ParseTuple(args, "OO", &self, &py_thread_info);
-  if(ok)
-    ok = PyCObject_Check(py_thread_info);
-  if(ok)
-    ok = ((thread_info = (CRayHashThreadInfo*) PyCObject_AsVoidPtr(py_thread_info)) != NULL);
-  if(ok) {
-    API_SETUP_PYMOL_GLOBALS;
-    ok = (G != NULL);
-  }
-  if(ok) {
-    PUnblock(G);
-    RayHashThread(thread_info);
-    PBlock(G);
-  }
-  return APIResultOk(ok);
-}
-
-static PyObject *CmdRayTraceThread(PyObject * self, PyObject * args)
-{
-  PyMOLGlobals *G = NULL;
-  int ok = false;
-  PyObject *py_thread_info;
-
-  CRayThreadInfo *thread_info = NULL;
-
-  ok = PyArg_ParseTuple(args, "OO", &self, &py_thread_info);
-  if(ok)
-    ok = PyCObject_Check(py_thread_info);
-  if(ok)
-    ok = ((thread_info = (CRayThreadInfo*) PyCObject_AsVoidPtr(py_thread_info)) != NULL);
-  if(ok) {
-    API_SETUP_PYMOL_GLOBALS;
-    ok = (G != NULL);
-  } else {
-    API_HANDLE_ERROR;
-  }
-  if(ok) {
-    PUnblock(G);
-    RayTraceThread(thread_info);
-    PBlock(G);
-  }
-  return APIResultOk(ok);
-}
-
-static PyObject *CmdCoordSetUpdateThread(PyObject * self, PyObject * args)
-{
-  PyMOLGlobals *G = NULL;
-  int ok = false;
-  PyObject *py_thread_info;
-
-  CCoordSetUpdateThreadInfo *thread_info = NULL;
-
-  ok = PyArg_ParseTuple(args, "OO", &self, &py_thread_info);
-  if(ok)
-    ok = PyCObject_Check(py_thread_info);
-  if(ok)
-    ok = ((thread_info = (CCoordSetUpdateThreadInfo*) PyCObject_AsVoidPtr(py_thread_info)) != NULL);
-  if(ok) {
-    API_SETUP_PYMOL_GLOBALS;
-    ok = (G != NULL);
-  }
-  if(ok) {
-    PUnblock(G);
-    CoordSetUpdateThread(thread_info);
-    PBlock(G);
-  }
-  return APIResultOk(ok);
-}
-
-static PyObject *CmdObjectUpdateThread(PyObject * self, PyObject * args)
-{
-  PyMOLGlobals *G = NULL;
-  int ok = false;
-  PyObject *py_thread_info;
-
-  CObjectUpdateThreadInfo *thread_info = NULL;
-
-  ok = PyArg_ParseTuple(args, "OO", &self, &py_thread_info);
-  if(ok)
-    ok = PyCObject_Check(py_thread_info);
-  if(ok)
-    ok = ((thread_info = (CObjectUpdateThreadInfo*) PyCObject_AsVoidPtr(py_thread_info)) != NULL);
-  if(ok) {
-    API_SETUP_PYMOL_GLOBALS;
-    ok = (G != NULL);
-  } else {
-    API_HANDLE_ERROR;
-  }
-  if(ok) {
-    PUnblock(G);
-    SceneObjectUpdateThread(thread_info);
-    PBlock(G);
-  }
-  return APIResultOk(ok);
-}
-
 static PyObject *CmdGetMovieLocked(PyObject * self, PyObject * args)
 {
   PyMOLGlobals *G = NULL;
@@ -2207,10 +2076,11 @@ static PyObject *CmdGetCoordsAsNumPy(PyObject * self, PyObject * args)
   PyMOLGlobals *G = NULL;
   char *str1;
   int state = 0;
+  short copy = 1;
   OrthoLineType s1;
   PyObject *result = NULL;
 
-  if(!PyArg_ParseTuple(args, "Os|i", &self, &str1, &state)) {
+  if(!PyArg_ParseTuple(args, "Os|ih", &self, &str1, &state, &copy)) {
     API_HANDLE_ERROR;
     ok_raise(2);
   }
@@ -2223,7 +2093,10 @@ static PyObject *CmdGetCoordsAsNumPy(PyObject * self, PyObject * args)
     int sele1 = SelectorIndexByName(G, s1);
     if(sele1 >= 0) {
       int unblock = PAutoBlock(G);
-      result = SelectorGetCoordsAsNumPy(G, sele1, state);
+      if(copy)
+        result = SelectorGetCoordsAsNumPy(G, sele1, state);
+      else
+        result = SelectorGetCoordsAsNumPyView(G, sele1, state);
       PAutoUnblock(G, unblock);
     }
     SelectorFreeTmp(G, s1);
@@ -4513,6 +4386,35 @@ static PyObject *CmdGetMovieLength(PyObject * self, PyObject * args)
   return (APIResultCode(result));
 }
 
+static PyObject *CmdGetMovieCacheStats(PyObject * self, PyObject * args)
+{
+  PyMOLGlobals *G = NULL;
+  PyObject *result = NULL;
+  CMovieCacheStats stats;
+  int ok = false;
+  ok = PyArg_ParseTuple(args, "O", &self);
+  if(ok) {
+    API_SETUP_PYMOL_GLOBALS;
+    ok = (G != NULL);
+  } else {
+    API_HANDLE_ERROR;
+  }
+  if(ok && (ok = APIEnterNotModal(G))) {
+    MovieGetCacheStats(G, &stats);
+    APIExit(G);
+    result = Py_BuildValue("{s:i,s:i,s:n,s:n,s:i,s:i,s:i,s:i}",
+                           "frames", stats.n_image,
+                           "frames_compressed", stats.n_packed,
+                           "bytes", (Py_ssize_t) stats.image_bytes,
+                           "bytes_compressed", (Py_ssize_t) stats.packed_bytes,
+                           "hits", stats.hits,
+                           "hits_compressed", stats.unpacks,
+                           "misses", stats.misses,
+                           "evictions", stats.evictions);
+  }
+  return APIAutoNone(result);
+}
+
 static PyObject *CmdIdentify(PyObject * self, PyObject * args)
 {
   PyMOLGlobals *G = NULL;
@@ -4979,6 +4881,51 @@ static PyObject *CmdIntraFit(PyObject * self, PyObject * args)
   return APIAutoNone(result);
 }
 
+static PyObject *CmdIntraRMSMatrix(PyObject * self, PyObject * args)
+{
+  PyMOLGlobals *G = NULL;
+  char *str1;
+  int mode, state, fit, quiet;
+  int n = 0;
+  float *rms = NULL;
+  PyObject *result = NULL;
+
+  if(!PyArg_ParseTuple(args, "Osiiii", &self, &str1, &mode, &state, &fit, &quiet)) {
+    API_HANDLE_ERROR;
+    ok_raise(2);
+  }
+
+#ifdef _PYMOL_NUMPY
+  /* before anything gets allocated, since it returns on failure */
+  import_array1(NULL);
+#endif
+
+  API_SETUP_PYMOL_GLOBALS;
+  ok_assert(2, G && APIEnterNotModal(G));
+  rms = ExecutiveRMSMatrix(G, str1, mode, state, fit, quiet, &n);
+  APIExit(G);
+  ok_assert(2, rms);
+
+#ifdef _PYMOL_NUMPY
+  {
+    npy_intp dims[2] = { n, n };
+    if((result = PyArray_SimpleNew(2, dims, NPY_FLOAT32)))
+      memcpy(PyArray_DATA((PyArrayObject *) result), rms, sizeof(float) * n * n);
+  }
+#else
+  {
+    int a;
+    result = PyList_New(n);
+    for(a = 0; a < n; a++)
+      PyList_SetItem(result, a, PConvFloatArrayToPyList(rms + a * n, n));
+  }
+#endif
+  FreeP(rms);
+
+ok_except2:
+  return APIAutoNone(result);
+}
+
 static PyObject *CmdGetAtomCoords(PyObject * self, PyObject * args)
 {
   PyMOLGlobals *G = NULL;
@@ -7987,14 +7934,14 @@ static PyObject *CmdCEAlign(PyObject *self, PyObject *args)
 {
   PyMOLGlobals * G = NULL;
   int ok = false;
-  int windowSize = 8, gap_max=30;
+  int windowSize = 8, gap_max=30, max_kept=20;
   float d0=3.0, d1=4.0;
   PyObject *listA, *listB, *result;
   Py_ssize_t lenA, lenB;
 
   /* Unpack the arguments from Python */
 
-  ok = PyArg_ParseTuple(args, "OOO|ffii", &self, &listA, &listB, &d0, &d1, &windowSize, &gap_max);
+  ok = PyArg_ParseTuple(args, "OOO|ffiii", &self, &listA, &listB, &d0, &d1, &windowSize, &gap_max, &max_kept);
 
   /* Handle errors */
 
@@ -8024,12 +7971,43 @@ static PyObject *CmdCEAlign(PyObject *self, PyObject *args)
 
   if(ok) {
     APIEnterBlocked(G);
-    result = (PyObject*) ExecutiveCEAlign(G, listA, listB, lenA, lenB, d0, d1, windowSize, gap_max);
+    result = (PyObject*) ExecutiveCEAlign(G, listA, listB, lenA, lenB, d0, d1, windowSize, gap_max, max_kept);
     APIExitBlocked(G);
   }
   return result;
 }
 
+static PyObject *CmdCEAlignBatch(PyObject *self, PyObject *args)
+{
+  PyMOLGlobals * G = NULL;
+  int ok = false;
+  int windowSize = 8, gap_max=30, max_kept=20;
+  float d0=3.0, d1=4.0;
+  PyObject *listA, *listsB, *result = NULL;
+  Py_ssize_t lenA = 0;
+
+  ok = PyArg_ParseTuple(args, "OOO|ffiii", &self, &listA, &listsB, &d0, &d1, &windowSize, &gap_max, &max_kept);
+
+  if(ok) {
+    API_SETUP_PYMOL_GLOBALS;
+    ok = (G != NULL);
+  } else {
+    API_HANDLE_ERROR;
+  }
+
+  if(ok) {
+    lenA = PyList_Size(listA);
+    ok = (lenA > 0) && PyList_Check(listsB);
+  }
+
+  if(ok) {
+    APIEnterBlocked(G);
+    result = ExecutiveCEAlignBatch(G, listA, lenA, listsB, d0, d1, windowSize, gap_max, max_kept);
+    APIExitBlocked(G);
+  }
+  return APIAutoNone(result);
+}
+
 static PyObject *CmdVolumeColor(PyObject * self, PyObject * args)
 {
   PyMOLGlobals * G = NULL;
@@ -8238,6 +8216,7 @@ static PyMethodDef Cmd_methods[] = {
   /*  {"cache",                 CmdCache,                METH_VARARGS }, */
   {"cartoon", CmdCartoon, METH_VARARGS},
   {"cealign", CmdCEAlign, METH_VARARGS},
+  {"cealign_batch", CmdCEAlignBatch, METH_VARARGS},
   {"center", CmdCenter, METH_VARARGS},
   {"cif_get_array", CmdCifGetArray, METH_VARARGS},
   {"clip", CmdClip, METH_VARARGS},
@@ -8245,7 +8224,6 @@ static PyMethodDef Cmd_methods[] = {
   {"color", CmdColor, METH_VARARGS},
   {"colordef", CmdColorDef, METH_VARARGS},
   {"combine_object_ttt", CmdCombineObjectTTT, METH_VARARGS},
-  {"coordset_update_thread", CmdCoordSetUpdateThread, METH_VARARGS},
   {"copy", CmdCopy, METH_VARARGS},
   {"copy_image", CmdCopyImage, METH_VARARGS},
   {"create", CmdCreate, METH_VARARGS},
@@ -8309,6 +8287,7 @@ static PyMethodDef Cmd_methods[] = {
   {"get_modal_draw", CmdGetModalDraw, METH_VARARGS},
   {"get_moment", CmdGetMoment, METH_VARARGS},
   {"get_movie_length", CmdGetMovieLength, METH_VARARGS},
+  {"get_movie_cache_stats", CmdGetMovieCacheStats, METH_VARARGS},
   {"get_movie_locked", CmdGetMovieLocked, METH_VARARGS},
   {"get_movie_playing", CmdGetMoviePlaying, METH_VARARGS},
   {"get_names", CmdGetNames, METH_VARARGS},
@@ -8354,6 +8333,7 @@ static PyMethodDef Cmd_methods[] = {
   {"import_coords", CmdImportCoords, METH_VARARGS},
   {"index", CmdIndex, METH_VARARGS},
   {"intrafit", CmdIntraFit, METH_VARARGS},
+  {"intra_rms_matrix", CmdIntraRMSMatrix, METH_VARARGS},
   {"invert", CmdInvert, METH_VARARGS},
   {"interrupt", CmdInterrupt, METH_VARARGS},
   {"isolevel", CmdIsolevel, METH_VARARGS},
@@ -8390,7 +8370,6 @@ static PyMethodDef Cmd_methods[] = {
   {"mmatrix", CmdMMatrix, METH_VARARGS},
   {"multisave", CmdMultiSave, METH_VARARGS},
   {"mview", CmdMView, METH_VARARGS},
-  {"object_update_thread", CmdObjectUpdateThread, METH_VARARGS},
   {"origin", CmdOrigin, METH_VARARGS},
   {"orient", CmdOrient, METH_VARARGS},
   {"onoff", CmdOnOff, METH_VARARGS},
@@ -8406,9 +8385,6 @@ static PyMethodDef Cmd_methods[] = {
   {"pseudoatom", CmdPseudoatom, METH_VARARGS},
   {"push_undo", CmdPushUndo, METH_VARARGS},
   {"quit", CmdQuit, METH_VARARGS},
-  {"ray_trace_thread", CmdRayTraceThread, METH_VARARGS},
-  {"ray_hash_thread", CmdRayHashThread, METH_VARARGS},
-  {"ray_anti_thread", CmdRayAntiThread, METH_VARARGS},
   {"ramp_new", CmdRampNew, METH_VARARGS},
   {"ready", CmdReady, METH_VARARGS},
   {"rebuild", CmdRebuild, METH_VARARGS},
@@ -60,6 +60,7 @@
 #include "TypeFace.h"
 #include "PlugIOManager.h"
 #include "MovieScene.h"
+#include "TaskPool.h"
 
 #include "PyMOL.h"
 #include "PyMOLGlobals.h"
@@ -2146,6 +2147,7 @@ void PyMOL_Start(CPyMOL * I)
   TetsurfInit(G);
   EditorInit(G);
   ShaderMgrInit(G);
+  TaskPoolInit(G);
 #ifdef TRACKER_UNIT_TEST
   TrackerUnitTest(G);
 #endif
@@ -2216,6 +2218,7 @@ void PyMOL_Stop(CPyMOL * I)
 {
   PyMOLGlobals *G = I->G;
   G->Terminating = true;
+  TaskPoolFree(G);
   TetsurfFree(G);
   IsosurfFree(G);
   WizardFree(G);
@@ -34,6 +34,7 @@
 #include "os_std.h"
 
 #include "ce_types.h"
+#include "TaskPool.h"
 
 #include "tnt/tnt.h"
 #include "tnt/jama_lu.h"
@@ -50,7 +51,28 @@ TA2<double> transpose(const TA2<double>& v);
 /////////////////////////////////////////////////////////////////////////////
 // CE Specific
 /////////////////////////////////////////////////////////////////////////////
-double** calcDM(pcePoint coords, int len)
+typedef struct {
+  pcePoint coords;
+  double** dm;
+  int len;
+  TaskPoolCounter next;
+} ceDMJob;
+
+static void calcDMTask(void* ctx, int index)
+{
+  ceDMJob* J = (ceDMJob*) ctx;
+  pcePoint coords = J->coords;
+  int row, col;
+  while ((row = J->next++) < J->len) {
+    for (col = 0; col < J->len; col++) {
+      J->dm[row][col] = sqrt(pow(coords[row].x - coords[col].x,2) +
+			     pow(coords[row].y - coords[col].y,2) +
+			     pow(coords[row].z - coords[col].z,2) );
+    }
+  }
+}
+
+double** calcDM(PyMOLGlobals* G, pcePoint coords, int len)
 {
   int i = 0;
 
@@ -58,40 +80,40 @@ double** calcDM(pcePoint coords, int len)
   for (i = 0; i < len; i++)
     dm[i] = (double*) malloc( sizeof(double)*len);
 
-  int row=0, col=0;
-  for (row = 0; row < len; row++) {
-    for (col = 0; col < len; col++) {
-      dm[row][col] = sqrt(pow(coords[row].x - coords[col].x,2) +
-			  pow(coords[row].y - coords[col].y,2) +
-			  pow(coords[row].z - coords[col].z,2) );
-    }
-  }
+  ceDMJob job;
+  job.coords = coords;
+  job.dm = dm;
+  job.len = len;
+  job.next = 0;
+  TaskPoolRun(G, 0, TaskPoolGetNThread(G), calcDMTask, &job);
   return dm;
 }
 
-double** calcS(double** d1, double** d2, int lenA, int lenB, int wSize)
+typedef struct {
+  double** d1;
+  double** d2;
+  double** S;
+  int lenA, lenB, wSize;
+  TaskPoolCounter next;
+} ceSimJob;
+
+static void calcSTask(void* ctx, int index)
 {
-  int i;
+  ceSimJob* J = (ceSimJob*) ctx;
+  double** d1 = J->d1;
+  double** d2 = J->d2;
+  int lenA = J->lenA, lenB = J->lenB, wSize = J->wSize;
   double winSize = (double) wSize;
-  // initialize the 2D similarity matrix
-  double** S = (double**) malloc(sizeof(double*)*lenA);
-  for (i = 0; i < lenA; i++)
-    S[i] = (double*) malloc( sizeof(double)*lenB);
-  
   double sumSize = (winSize-1.0)*(winSize-2.0) / 2.0;
-  //
-  // This is where the magic of CE comes out.  In the similarity matrix,
-  // for each i and j, the value of ceSIM[i][j] is how well the residues
-  // i - i+winSize in protein A, match to residues j - j+winSize in protein
-  // B.  A value of 0 means absolute match; a value >> 1 means bad match.
-  //
   int iA, iB, row, col;
-  for (iA = 0; iA < lenA; iA++) {
+
+  while ((iA = J->next++) < lenA) {
+    double* S = J->S[iA];
     for (iB = 0; iB < lenB; iB++) {
-      S[iA][iB] = -1.0;
+      S[iB] = -1.0;
       if (iA > lenA - wSize || iB > lenB - wSize)
 	continue;
-		
+
       double score = 0.0;
 
       //
@@ -107,9 +129,35 @@ double** calcS(double** d1, double** d2, int lenA, int lenB, int wSize)
 	}
       }
 
-      S[iA][iB] = score / sumSize;
+      S[iB] = score / sumSize;
     }
   }
+}
+
+double** calcS(PyMOLGlobals* G, double** d1, double** d2, int lenA, int lenB, int wSize)
+{
+  int i;
+  // initialize the 2D similarity matrix
+  double** S = (double**) malloc(sizeof(double*)*lenA);
+  for (i = 0; i < lenA; i++)
+    S[i] = (double*) malloc( sizeof(double)*lenB);
+  
+  //
+  // This is where the magic of CE comes out.  In the similarity matrix,
+  // for each i and j, the value of ceSIM[i][j] is how well the residues
+  // i - i+winSize in protein A, match to residues j - j+winSize in protein
+  // B.  A value of 0 means absolute match; a value >> 1 means bad match.
+  // Rows are independent, so they are filled by the task pool.
+  //
+  ceSimJob job;
+  job.d1 = d1;
+  job.d2 = d2;
+  job.S = S;
+  job.lenA = lenA;
+  job.lenB = lenB;
+  job.wSize = wSize;
+  job.next = 0;
+  TaskPoolRun(G, 0, TaskPoolGetNThread(G), calcSTask, &job);
   return S;
 }
 
@@ -152,12 +200,248 @@ pcePoint getCoords(PyObject* L, int length)
 }
 
 
+// inputs of the path search, shared by all seeds
+typedef struct {
+  double** S;
+  double** dA;
+  double** dB;
+  int lenA, lenB;
+  float D0, D1;
+  int winSize, gapMax;
+  int smaller, winSum;
+  int* winCache;
+} ceSearch;
+
+// scratch space for extending one seed
+typedef struct {
+  path curPath;
+  double** allScoreBuffer;
+  int* tIndex;
+} ceScratch;
+
+static int ceScratchInit(ceScratch* W, int smaller, int gapMax)
+{
+  int i, j;
+  W->curPath = (path) malloc( sizeof(afp)*smaller );
+  W->tIndex = (int*) malloc(sizeof(int)*smaller);
+  W->allScoreBuffer = (double**) calloc(smaller, sizeof(double*));
+  if (!(W->curPath && W->tIndex && W->allScoreBuffer))
+    return false;
+  for ( i = 0; i < smaller; i++ ) {
+    W->allScoreBuffer[i] = (double*) malloc( (gapMax*2+1) * sizeof(double));
+    if (!W->allScoreBuffer[i])
+      return false;
+    // initialize the ASB
+    for ( j = 0; j < gapMax*2+1; j++ )
+      W->allScoreBuffer[i][j] = 1e6;
+  }
+  return true;
+}
 
-pathCache findPath( double** S, double** dA, double** dB, int lenA, int lenB, float D0, float D1, int winSize, int gapMax, int * bufferSize )
+static void ceScratchPurge(ceScratch* W, int smaller)
 {
-  // CE-specific cutoffs
-  const int MAX_KEPT = 20;
+  int i;
+  if (W->allScoreBuffer) {
+    for ( i = 0; i < smaller; i++ )
+      free(W->allScoreBuffer[i]);
+    free(W->allScoreBuffer);
+  }
+  free(W->tIndex);
+  free(W->curPath);
+}
+
+//
+// Check all possible paths starting from iA, iB.  Returns the length of
+// the longest acceptable path (0 if the seed never extends) and its score
+// in *pathScore; the first (length) entries of W->curPath hold the path.
+//
+static int ceExtendSeed(ceSearch* C, ceScratch* W, int iA, int iB, double* pathScore)
+{
+  double** S = C->S;
+  double** dA = C->dA;
+  double** dB = C->dB;
+  int lenA = C->lenA, lenB = C->lenB;
+  int winSize = C->winSize, gapMax = C->gapMax;
+  int winSum = C->winSum;
+  int* winCache = C->winCache;
+  path curPath = W->curPath;
+  double** allScoreBuffer = W->allScoreBuffer;
+  int* tIndex = W->tIndex;
+  int gapBestIndex = -1;
+  int lastLength = 0;
+
+  int i;
+  for ( i = 0; i < C->smaller; i++ ) {
+    curPath[i].first = -1;
+    curPath[i].second = -1;
+  }
+  curPath[0].first = iA;
+  curPath[0].second = iB;
+  int curPathLength = 1;
+  tIndex[curPathLength-1] = 0;
+  double curTotalScore = 0.0;
+
+  int done = 0;
+  while ( ! done ) {
+    double gapBestScore = 1e6;
+    gapBestIndex = -1;
+    int g;
+
+    //
+    // Check all possible gaps [1..gapMax] from here
+    //
+    for ( g = 0; g < (gapMax*2)+1; g++ ) {
+      int jA = curPath[curPathLength-1].first + winSize;
+      int jB = curPath[curPathLength-1].second + winSize;
 
+      if ( (g+1) % 2 == 0 ) {
+	jA += (g+1)/2;
+      }
+      else { // ( g odd )
+	jB += (g+1)/2;
+      }
+
+      //
+      // Following are three heuristics to ensure high quality
+      // long paths and make sure we don't run over the end of
+      // the S, matrix.
+
+      // 1st: If jA and jB are at the end of the matrix
+      if ( jA > lenA-winSize || jB > lenB-winSize ){
+	// FIXME, was: jA > lenA-winSize-1 || jB > lenB-winSize-1
+	continue;
+      }
+      // 2nd: If this gapped octapeptide is bad, ignore it.
+      if ( S[jA][jB] > C->D0 )
+	continue;
+      // 3rd: if too close to end, ignore it.
+      if ( S[jA][jB] == -1.0 )
+	continue;
+
+      double curScore = 0.0;
+      int s;
+      for ( s = 0; s < curPathLength; s++ ) {
+	curScore += fabs( dA[curPath[s].first][jA] - dB[curPath[s].second][jB] );
+	curScore += fabs( dA[curPath[s].first  + (winSize-1)][jA+(winSize-1)] - 
+			  dB[curPath[s].second + (winSize-1)][jB+(winSize-1)] );
+	int k;
+	for ( k = 1; k < winSize-1; k++ )
+	  curScore += fabs( dA[curPath[s].first  + k][ jA + (winSize-1) - k ] - 
+			    dB[curPath[s].second + k][ jB + (winSize-1) - k ] );
+      }
+
+      curScore /= (double) winSize * (double) curPathLength;
+
+      if ( curScore >= C->D1 ) {
+	continue;
+      }
+
+      // store GAPPED best
+      if ( curScore < gapBestScore ) {
+	curPath[curPathLength].first = jA;
+	curPath[curPathLength].second = jB;
+	gapBestScore = curScore;
+	gapBestIndex = g;
+	allScoreBuffer[curPathLength-1][g] = curScore;
+      }
+    } /// ROF -- END GAP SEARCHING
+
+    //
+    // DONE GAPPING:
+    //
+
+    // calculate curTotalScore
+    curTotalScore = 0.0;
+    int jGap, gA, gB;
+    double score1=0.0, score2=0.0;
+
+    if ( gapBestIndex != -1 ) {
+      jGap = (gapBestIndex + 1 ) / 2;
+      if ((gapBestIndex + 1 ) % 2 == 0) {
+	gA = curPath[ curPathLength-1 ].first + winSize + jGap;
+	gB = curPath[ curPathLength-1 ].second + winSize;
+      }
+      else {
+	gA = curPath[ curPathLength-1 ].first + winSize;
+	gB = curPath[ curPathLength-1 ].second + winSize + jGap;
+      }
+
+      // perfect
+      score1 = (allScoreBuffer[curPathLength-1][gapBestIndex] * winSize * curPathLength
+		+ S[gA][gB]*winSum)/(winSize*curPathLength+winSum);
+
+      // perfect
+      score2 = ((curPathLength > 1 ? (allScoreBuffer[curPathLength-2][tIndex[curPathLength-1]])
+		 : S[iA][iB])
+		* winCache[curPathLength-1] 
+		+ score1 * (winCache[curPathLength] - winCache[curPathLength-1]))
+	/ winCache[curPathLength];
+
+      curTotalScore = score2;
+      // heuristic -- path is getting sloppy, stop looking
+      if ( curTotalScore > C->D1 ) {
+	done = 1;
+	gapBestIndex=-1;
+	break;
+      }
+      else {
+	allScoreBuffer[curPathLength-1][gapBestIndex] = curTotalScore;
+	tIndex[curPathLength] = gapBestIndex;
+	curPathLength++;
+      }
+    }
+    else {
+      // if here, then there was no good gapped path
+      // so quit and restart from iA, iB+1
+      done = 1;
+      curPathLength--;
+      break;
+    }
+
+    // each extension is longer than the last, so only the final one
+    // can matter to the caller
+    lastLength = curPathLength;
+    *pathScore = curTotalScore;
+  } /// END WHILE
+
+  return lastLength;
+}
+
+// one block of seed rows, extended concurrently
+typedef struct {
+  ceSearch* C;
+  ceScratch* scratch;
+  int iA0, nRows;
+  int limit;                    // no seed is needed beyond this iB
+  int* seedLength;              // per seed: path length, or -1 if skipped
+  double* seedScore;
+  TaskPoolCounter next;
+} ceSeedJob;
+
+static void ceSeedTask(void* ctx, int index)
+{
+  ceSeedJob* J = (ceSeedJob*) ctx;
+  ceSearch* C = J->C;
+  int lenB = C->lenB;
+  int r, iB;
+
+  while ((r = J->next++) < J->nRows) {
+    int iA = J->iA0 + r;
+    int* seedLength = J->seedLength + r * lenB;
+    double* seedScore = J->seedScore + r * lenB;
+    for ( iB = 0; iB < lenB; iB++ ) {
+      seedLength[iB] = -1;
+      if ( C->S[iA][iB] >= C->D0 || C->S[iA][iB] == -1.0 )
+	continue;
+      if ( iB > J->limit )
+	break;
+      seedLength[iB] = ceExtendSeed(C, J->scratch + index, iA, iB, seedScore + iB);
+    }
+  }
+}
+
+pathCache findPath( PyMOLGlobals* G, double** S, double** dA, double** dB, int lenA, int lenB, float D0, float D1, int winSize, int gapMax, int maxKept, int * bufferSize )
+{
   // the best Path's score
   double bestPathScore = 1e6;
   int bestPathLength = 0;
@@ -166,23 +450,26 @@ pathCache findPath( double** S, double** dA, double** dB, int lenA, int lenB, fl
   int smaller = ( lenA < lenB ) ? lenA : lenB;
   int winSum = (winSize-1)*(winSize-2)/2;
 
+  if ( maxKept < 1 )
+    maxKept = 1;
+
   path bestPath = (path) malloc(sizeof(afp)*smaller);
 
   // index variable for below
-  int i, j;
+  int i;
   for ( i = 0; i < smaller; i++ ) {
     bestPath[i].first = -1;
     bestPath[i].second = -1;
   }
 
   //======================================================================
-  // for storing the best 20 paths
+  // for storing the best (maxKept) paths
   int bufferIndex = 0; //, bufferSize = 0;
-  int lenBuffer[MAX_KEPT];
-  double scoreBuffer[MAX_KEPT];
-  pathCache pathBuffer = (pathCache) malloc(sizeof(path*)*MAX_KEPT);
+  int* lenBuffer = (int*) malloc(sizeof(int)*maxKept);
+  double* scoreBuffer = (double*) malloc(sizeof(double)*maxKept);
+  pathCache pathBuffer = (pathCache) malloc(sizeof(path*)*maxKept);
 
-  for ( i = 0; i < MAX_KEPT; i++ ) {
+  for ( i = 0; i < maxKept; i++ ) {
     // initialize the paths
     scoreBuffer[i] = 1e6;
     lenBuffer[i] = 0;
@@ -196,244 +483,144 @@ pathCache findPath( double** S, double** dA, double** dB, int lenA, int lenB, fl
   for ( i = 0; i < smaller; i++ )
     winCache[i] = (i+1)*i*winSize/2 + (i+1)*winSum;
 
-  // allScoreBuffer
-  // this 2D array keeps track of all partial gapped scores
-  double** allScoreBuffer = (double**) malloc(sizeof(double*)*smaller);
-  for ( i = 0; i < smaller; i++ ) {
-    allScoreBuffer[i] = (double*) malloc( (gapMax*2+1) * sizeof(double));
-    // initialize the ASB
-    for ( j = 0; j < gapMax*2+1; j++ )
-      allScoreBuffer[i][j] = 1e6;
-  }
-	
-  int* tIndex = (int*) malloc(sizeof(int)*smaller);
-  int gapBestIndex = -1;
+  ceSearch search;
+  search.S = S;
+  search.dA = dA;
+  search.dB = dB;
+  search.lenA = lenA;
+  search.lenB = lenB;
+  search.D0 = D0;
+  search.D1 = D1;
+  search.winSize = winSize;
+  search.gapMax = gapMax;
+  search.smaller = smaller;
+  search.winSum = winSum;
+  search.winCache = winCache;
+
+  //======================================================================
+  // Seeds are extended independently of each other, a block of rows at a
+  // time, by the task pool.  Only the bookkeeping below (best path, ring
+  // buffer, early exits) depends on the order of the seeds, so it is
+  // replayed serially in the original order.
+  //
+  int n_thread = TaskPoolGetNThread(G);
+  int nBlockRows = 4 * n_thread;
+  ceScratch* scratch = (ceScratch*) calloc(n_thread, sizeof(ceScratch));
+  int* seedLength = (int*) malloc(sizeof(int) * nBlockRows * lenB);
+  double* seedScore = (double*) malloc(sizeof(double) * nBlockRows * lenB);
+  int ok = (scratch && seedLength && seedScore);
+  for ( i = 0; ok && i < n_thread; i++ )
+    ok = ceScratchInit(scratch + i, smaller, gapMax);
 
   //======================================================================
   // Start the search through the CE matrix.
   //
   int iA, iB;
-  for ( iA = 0; iA < lenA; iA++ ) {
-    if ( iA > lenA - winSize*(bestPathLength-1) )
+  int stop = !ok;
+  for ( int iA0 = 0; !stop && iA0 < lenA; iA0 += nBlockRows ) {
+    if ( iA0 > lenA - winSize*(bestPathLength-1) )
       break;
 
-    for ( iB = 0; iB < lenB; iB++ ) {
-      if ( S[iA][iB] >= D0 )
-	continue;
-			
-      if ( S[iA][iB] == -1.0 )
-	continue;
-			
-      if ( iB > lenB - winSize*(bestPathLength-1) )
+    ceSeedJob job;
+    job.C = &search;
+    job.scratch = scratch;
+    job.iA0 = iA0;
+    job.nRows = ( lenA - iA0 < nBlockRows ) ? lenA - iA0 : nBlockRows;
+    job.limit = lenB - winSize*(bestPathLength-1);
+    job.seedLength = seedLength;
+    job.seedScore = seedScore;
+    job.next = 0;
+    TaskPoolRun(G, n_thread, n_thread, ceSeedTask, &job);
+
+    for ( iA = iA0; iA < iA0 + job.nRows; iA++ ) {
+      if ( iA > lenA - winSize*(bestPathLength-1) ) {
+	stop = 1;
 	break;
-
-      //
-      // Restart curPath here.
-      //
-      path curPath = (path) malloc( sizeof(afp)*smaller );
-
-      int i;
-      for ( i = 0; i < smaller; i++ ) {
-	curPath[i].first = -1;
-	curPath[i].second = -1;
       }
-      curPath[0].first = iA;
-      curPath[0].second = iB;
-      int curPathLength = 1;
-      tIndex[curPathLength-1] = 0;
-      double curTotalScore = 0.0;
-
-      //
-      // Check all possible paths starting from iA, iB
-      //
-      int done = 0;
-      while ( ! done ) {
-	double gapBestScore = 1e6;
-	gapBestIndex = -1;
-	int g;
-
-	//
-	// Check all possible gaps [1..gapMax] from here
-	//
-	for ( g = 0; g < (gapMax*2)+1; g++ ) {
-	  int jA = curPath[curPathLength-1].first + winSize;
-	  int jB = curPath[curPathLength-1].second + winSize;
-
-	  if ( (g+1) % 2 == 0 ) {
-	    jA += (g+1)/2;
-	  }
-	  else { // ( g odd )
-	    jB += (g+1)/2;
-	  }
-
-	  //
-	  // Following are three heuristics to ensure high quality
-	  // long paths and make sure we don't run over the end of
-	  // the S, matrix.
-					
-	  // 1st: If jA and jB are at the end of the matrix
-	  if ( jA > lenA-winSize || jB > lenB-winSize ){
-	    // FIXME, was: jA > lenA-winSize-1 || jB > lenB-winSize-1
-	    continue;
-	  }
-	  // 2nd: If this gapped octapeptide is bad, ignore it.
-	  if ( S[jA][jB] > D0 )
-	    continue;
-	  // 3rd: if too close to end, ignore it.
-	  if ( S[jA][jB] == -1.0 )
-	    continue;
-					
-	  double curScore = 0.0;
-	  int s;
-	  for ( s = 0; s < curPathLength; s++ ) {
-	    curScore += fabs( dA[curPath[s].first][jA] - dB[curPath[s].second][jB] );
-	    curScore += fabs( dA[curPath[s].first  + (winSize-1)][jA+(winSize-1)] - 
-			      dB[curPath[s].second + (winSize-1)][jB+(winSize-1)] );
-	    int k;
-	    for ( k = 1; k < winSize-1; k++ )
-	      curScore += fabs( dA[curPath[s].first  + k][ jA + (winSize-1) - k ] - 
-				dB[curPath[s].second + k][ jB + (winSize-1) - k ] );
-	  }
-					
-	  curScore /= (double) winSize * (double) curPathLength;
-
-	  if ( curScore >= D1 ) {
-	    continue;
-	  }
-
-	  // store GAPPED best					
-	  if ( curScore < gapBestScore ) {
-	    curPath[curPathLength].first = jA;
-	    curPath[curPathLength].second = jB;
-	    gapBestScore = curScore;
-	    gapBestIndex = g;
-	    allScoreBuffer[curPathLength-1][g] = curScore;
-	  }
-	} /// ROF -- END GAP SEARCHING
-				
-	//
-	// DONE GAPPING:
-	//
-
-	// calculate curTotalScore
-	curTotalScore = 0.0;
-	int jGap, gA, gB;
-	double score1=0.0, score2=0.0;
-				
-	if ( gapBestIndex != -1 ) {
-	  jGap = (gapBestIndex + 1 ) / 2;
-	  if ((gapBestIndex + 1 ) % 2 == 0) {
-	    gA = curPath[ curPathLength-1 ].first + winSize + jGap;
-	    gB = curPath[ curPathLength-1 ].second + winSize;
-	  }
-	  else {
-	    gA = curPath[ curPathLength-1 ].first + winSize;
-	    gB = curPath[ curPathLength-1 ].second + winSize + jGap;
-	  }
 
-	  // perfect
-	  score1 = (allScoreBuffer[curPathLength-1][gapBestIndex] * winSize * curPathLength
-		    + S[gA][gB]*winSum)/(winSize*curPathLength+winSum);
-
-	  // perfect
-	  score2 = ((curPathLength > 1 ? (allScoreBuffer[curPathLength-2][tIndex[curPathLength-1]])
-		     : S[iA][iB])
-		    * winCache[curPathLength-1] 
-		    + score1 * (winCache[curPathLength] - winCache[curPathLength-1]))
-	    / winCache[curPathLength];
-
-	  curTotalScore = score2;
-	  // heuristic -- path is getting sloppy, stop looking
-	  if ( curTotalScore > D1 ) {
-	    done = 1;
-	    gapBestIndex=-1;
-	    break;
-	  }
-	  else {
-	    allScoreBuffer[curPathLength-1][gapBestIndex] = curTotalScore;
-	    tIndex[curPathLength] = gapBestIndex;
-	    curPathLength++;
-	  }
-	}
-	else {
-	  // if here, then there was no good gapped path
-	  // so quit and restart from iA, iB+1
-	  done = 1;
-	  curPathLength--;
+      for ( iB = 0; iB < lenB; iB++ ) {
+	if ( S[iA][iB] >= D0 )
+	  continue;
+			
+	if ( S[iA][iB] == -1.0 )
+	  continue;
+			
+	if ( iB > lenB - winSize*(bestPathLength-1) )
 	  break;
-	}
 
-	//
-	// test this gapped path against the best seen
-	// starting from iA, iB
-	// 
+	int curPathLength = seedLength[(iA - iA0) * lenB + iB];
+	double curTotalScore = seedScore[(iA - iA0) * lenB + iB];
 
 	// if our currently best gapped path from iA and iB is LONGER
 	// than the current best; or, it's equal length and the score's
 	// better, keep the new path.
-	if ( curPathLength > bestPathLength ||
-	     (curPathLength == bestPathLength && curTotalScore < bestPathScore )) {
+	if ( curPathLength > 0 &&
+	     ( curPathLength > bestPathLength ||
+	       (curPathLength == bestPathLength && curTotalScore < bestPathScore ))) {
 	  bestPathLength = curPathLength;
 	  bestPathScore = curTotalScore;
-	  // deep copy curPath
-	  path tempPath = (path) malloc( sizeof(afp)*smaller );
-
-	  int i;
+	  // rebuild the path itself
+	  ceExtendSeed(&search, scratch, iA, iB, &curTotalScore);
 	  for ( i = 0; i < smaller; i++ ) {
-	    tempPath[i].first = curPath[i].first;
-	    tempPath[i].second = curPath[i].second;
+	    if ( i < curPathLength ) {
+	      bestPath[i].first = scratch->curPath[i].first;
+	      bestPath[i].second = scratch->curPath[i].second;
+	    } else {
+	      bestPath[i].first = -1;
+	      bestPath[i].second = -1;
+	    }
 	  }
-
-	  free(bestPath);
-	  bestPath = tempPath;
 	}
-      } /// END WHILE
 
-      //
-      // At this point, we've found the best path starting at iA, iB.
-      //
-      if ( bestPathLength > lenBuffer[bufferIndex] ||
-	   ( bestPathLength == lenBuffer[bufferIndex] &&
-	     bestPathScore < scoreBuffer[bufferIndex] )) {
-
-	// we're going to add an entry to the ring-buffer.
-	// Adjust maxSize values and curIndex accordingly.
-	bufferIndex = ( bufferIndex == MAX_KEPT-1 ) ? 0 : bufferIndex+1;
-	*bufferSize = ( *bufferSize < MAX_KEPT ) ? (*bufferSize)+1 : MAX_KEPT;
-	path pathCopy = (path) malloc( sizeof(afp)*smaller );
-
-	int i;
-	for ( i = 0; i < smaller; i++ ) {
-	  pathCopy[i].first = bestPath[i].first;
-	  pathCopy[i].second = bestPath[i].second;
-	}
+	//
+	// At this point, we've found the best path starting at iA, iB.
+	//
+	if ( bestPathLength > lenBuffer[bufferIndex] ||
+	     ( bestPathLength == lenBuffer[bufferIndex] &&
+	       bestPathScore < scoreBuffer[bufferIndex] )) {
 
-	if ( bufferIndex == 0 && (*bufferSize) == MAX_KEPT ) {
-	  if ( pathBuffer[MAX_KEPT-1] )
-	    free(pathBuffer[MAX_KEPT-1]); 
-	  pathBuffer[MAX_KEPT-1] = pathCopy;
-	  scoreBuffer[MAX_KEPT-1] = bestPathScore;
-	  lenBuffer[MAX_KEPT-1] = bestPathLength;
-	}
-	else {	
-	  if ( pathBuffer[bufferIndex-1] )
-	    free(pathBuffer[bufferIndex-1]);
-	  pathBuffer[bufferIndex-1] = pathCopy;
-	  scoreBuffer[bufferIndex-1] = bestPathScore;
-	  lenBuffer[bufferIndex-1] = bestPathLength;
+	  // we're going to add an entry to the ring-buffer.
+	  // Adjust maxSize values and curIndex accordingly.
+	  bufferIndex = ( bufferIndex == maxKept-1 ) ? 0 : bufferIndex+1;
+	  *bufferSize = ( *bufferSize < maxKept ) ? (*bufferSize)+1 : maxKept;
+	  path pathCopy = (path) malloc( sizeof(afp)*smaller );
+
+	  for ( i = 0; i < smaller; i++ ) {
+	    pathCopy[i].first = bestPath[i].first;
+	    pathCopy[i].second = bestPath[i].second;
+	  }
+
+	  if ( bufferIndex == 0 && (*bufferSize) == maxKept ) {
+	    if ( pathBuffer[maxKept-1] )
+	      free(pathBuffer[maxKept-1]); 
+	    pathBuffer[maxKept-1] = pathCopy;
+	    scoreBuffer[maxKept-1] = bestPathScore;
+	    lenBuffer[maxKept-1] = bestPathLength;
+	  }
+	  else {	
+	    if ( pathBuffer[bufferIndex-1] )
+	      free(pathBuffer[bufferIndex-1]);
+	    pathBuffer[bufferIndex-1] = pathCopy;
+	    scoreBuffer[bufferIndex-1] = bestPathScore;
+	    lenBuffer[bufferIndex-1] = bestPathLength;
+	  }
 	}
-      }
-      free(curPath); curPath=0;
-    } // ROF -- end for iB
-  } // ROF -- end for iA
+      } // ROF -- end for iB
+    } // ROF -- end for iA
+  }
 
   // free memory
-  for ( i = 0; i < smaller; i++ )
-    free(allScoreBuffer[i]);
-  free(allScoreBuffer);
-  free(tIndex);
+  if ( scratch ) {
+    for ( i = 0; i < n_thread; i++ )
+      ceScratchPurge(scratch + i, smaller);
+    free(scratch);
+  }
+  free(seedScore);
+  free(seedLength);
   free(winCache);
   free(bestPath);
+  free(scoreBuffer);
+  free(lenBuffer);
 
   return pathBuffer;
 }
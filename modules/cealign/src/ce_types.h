@@ -2,6 +2,7 @@
 #define _CE_TYPES_H
 
 #include"os_python.h"
+#include"PyMOLGlobals.h"
 
 /*
 // Typical XYZ point and array of points
@@ -24,16 +25,16 @@ typedef struct {
 // Function Declarations
 /////////////////////////////////////////////////////////////////////////////
 // Calculates the CE Similarity Matrix
-double** calcS(double** d1, double** d2, int lenA, int lenB, int wSize);
+double** calcS(PyMOLGlobals* G, double** d1, double** d2, int lenA, int lenB, int wSize);
 
 // calculates a simple distance matrix
-double** calcDM(pcePoint coords, int len);
+double** calcDM(PyMOLGlobals* G, pcePoint coords, int len);
 
 // Converter: Python Object -> C Structs
 pcePoint getCoords( PyObject* L, int len );
 
-// Optimal path finding algorithm (CE).
-pathCache findPath(double** S, double** dA, double**dB, int lenA, int lenB, float D0, float D1, int winSize, int gapMax, int* bufferSize);
+// Optimal path finding algorithm (CE), keeping up to maxKept candidate paths.
+pathCache findPath(PyMOLGlobals* G, double** S, double** dA, double**dB, int lenA, int lenB, float D0, float D1, int winSize, int gapMax, int maxKept, int* bufferSize);
 
 // filter through the results and find the best
 PyObject* findBest( pcePoint coordsA, pcePoint coordsB, pathCache paths, int bufferSize, int smaller, int winSize );
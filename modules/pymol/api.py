@@ -162,6 +162,7 @@ from exporting import \
       copy_image,         \
       cache,              \
       export_coords,      \
+      get_cache_stats,    \
       get_pdbstr,         \
       get_cifstr,         \
       get_session,        \
@@ -281,7 +282,9 @@ from fitting import \
       intra_fit,         \
       intra_rms,         \
       intra_rms_cur,     \
+      intra_rms_matrix,  \
       cealign,          \
+      cealign_batch,    \
       pair_fit          
 
 #--------------------------------------------------------------------
@@ -325,6 +328,7 @@ from moving import \
       mpng,              \
       frame,             \
       get_movie_playing, \
+      get_movie_cache_stats, \
       set_frame,         \
       get_state,         \
       get_frame         
@@ -178,8 +178,6 @@ if __name__=='pymol.cmd':
 
         _adjust_coord = internal._adjust_coord
         _alt = internal._alt
-        _coordset_update_spawn = internal._coordset_update_spawn
-        _coordset_update_thread = internal._coordset_update_thread
         _copy_image = internal._copy_image
         _ctrl = internal._ctrl
         _ctsh = internal._ctsh
@@ -193,13 +191,8 @@ if __name__=='pymol.cmd':
         _invalidate_color_sc = internal._invalidate_color_sc
         _load = internal._load
         _mpng = internal._mpng
-        _object_update_spawn = internal._object_update_spawn
-        _object_update_thread = internal._object_update_thread
         _png = internal._png
         _quit = internal._quit
-        _ray_anti_spawn = internal._ray_anti_spawn
-        _ray_hash_spawn = internal._ray_hash_spawn
-        _ray_spawn = internal._ray_spawn
         _refresh = internal._refresh
         _sgi_stereo = internal._sgi_stereo
         _special = internal._special
@@ -207,6 +200,7 @@ if __name__=='pymol.cmd':
         _cache_get = internal._cache_get
         _cache_set = internal._cache_set
         _cache_clear = internal._cache_clear
+        _cache_get_stats = internal._cache_get_stats
         _cache_purge = internal._cache_purge
         _cache_mark = internal._cache_mark
         _sdof = internal._sdof
@@ -1363,7 +1363,13 @@ NOTES
     cartoon, flags
 
     All strings must be explicitly quoted.  This operation typically
-    takes several seconds per thousand atoms altered.  
+    takes several seconds per thousand atoms altered.
+
+    Assignments which only use numbers, strings, numeric atom
+    properties, arithmetic, comparisons, "and", "or", "not",
+    "a if c else b", min, max, abs, int and float are evaluated
+    natively instead (see the "alter_native" setting), which is
+    much faster.
 
     You may need to issue a "rebuild" in order to update associated
     representations.
@@ -80,6 +80,11 @@ NOTES
     "cache optimize" will iterate through the list of scenes provided
     (or all defined scenes), compute any missing surfaces, and store
     them in the cache for later reuse.
+
+    Cached results include molecular surfaces, cartoons and spheres.
+    If the "cache_dir" setting names a directory, results are also
+    looked up in and (unless read_only) written to that directory, so
+    they persist across sessions.  See also "get_cache_stats".
     
 PYMOL API
 
@@ -145,6 +150,40 @@ PYMOL API
         if _self._raising(r,_self): raise QuietException         
         return r
 
+    def get_cache_stats(reset=0, quiet=1, _self=cmd):
+        '''
+DESCRIPTION
+
+    "get_cache_stats" returns the hit and miss counters of the cache
+    of precomputed results (see "cache").
+
+USAGE
+
+    get_cache_stats [ reset [, quiet ]]
+
+ARGUMENTS
+
+    reset = 0/1: set the counters back to zero after reading them
+    {default: 0}
+
+NOTES
+
+    The result is a dictionary with the keys "hits", "misses",
+    "disk_hits" (hits read from cache_dir), "disk_writes", "entries"
+    (in memory) and "memory" (approximate size of the in-memory cache,
+    in 4 byte units).
+
+PYMOL API
+
+    cmd.get_cache_stats(int reset, int quiet)
+
+        '''
+        r = _self._cache_get_stats(int(reset), _self=_self)
+        if not int(quiet):
+            print " cache: %d hits (%d from disk), %d misses, %d written to disk."%(
+                r['hits'], r['disk_hits'], r['misses'], r['disk_writes'])
+        return r
+
     _resn_to_aa =  {
             'ALA' : 'A',
             'CYS' : 'C',
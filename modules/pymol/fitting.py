@@ -27,7 +27,7 @@ if __name__=='pymol.fitting':
 
         def cealign(target, mobile, target_state=1, mobile_state=1, quiet=1,
                     guide=1, d0=3.0, d1=4.0, window=8, gap_max=30, transform=1,
-                    object=None, _self=cmd):
+                    object=None, max_kept=20, _self=cmd):
                 '''
 DESCRIPTION
 
@@ -44,6 +44,9 @@ NOTES
     default behavior. Otherwise, PyMOL will use all atoms. If "quiet" is set
     to -1, PyMOL will print the rotation matrix as well.
 
+    "max_kept" is the number of best candidate paths which are superposed
+    to pick the final alignment.
+
     Reference: Shindyalov IN, Bourne PE (1998) Protein structure alignment by
     incremental combinatorial extension (CE) of the optimal path.  Protein
     Engineering 11(9) 739-747.
@@ -98,7 +101,7 @@ SEE ALSO
                         _self.lock(_self)
 
                         # call the C function
-                        r = _cmd.cealign( _self._COb, sel1, sel2, float(d0), float(d1), int(window), int(gap_max) )
+                        r = _cmd.cealign( _self._COb, sel1, sel2, float(d0), float(d1), int(window), int(gap_max), int(max_kept) )
 
                         (aliLen, RMSD, rotMat, i1, i2) = r
                         if quiet==-1:
@@ -135,6 +138,71 @@ SEE ALSO
                 if _self._raising(r,_self): raise pymol.CmdException             
                 return ( {"alignment_length": aliLen, "RMSD" : RMSD, "rotation_matrix" : rotMat } )
 
+        def cealign_batch(target, mobiles, target_state=1, mobile_state=1, quiet=1,
+                    guide=1, d0=3.0, d1=4.0, window=8, gap_max=30, transform=1,
+                    max_kept=20, _self=cmd):
+                '''
+DESCRIPTION
+
+    API only. "cealign_batch" aligns each of a list of mobile selections
+    onto one target with the CE algorithm, computing the target's distance
+    matrix only once. Returns a list with one result dictionary (as
+    returned by cealign) per mobile, or None where the alignment failed.
+    As with cealign, each mobile object is superimposed onto the target
+    unless transform=0.
+
+SEE ALSO
+
+    cealign
+                '''
+                quiet = int(quiet)
+                window = int(window)
+                guide = "" if int(guide)==0 else "and guide"
+
+                if window < 3:
+                        print "CEalign-Error: window size must be an integer greater than 2."
+                        raise pymol.CmdException
+                if int(gap_max) < 0:
+                        print "CEalign-Error: gap_max must be a positive integer."
+                        raise pymol.CmdException
+
+                if _self.is_string(mobiles):
+                        mobiles = _self.get_object_list(mobiles)
+                target = selector.process("(%s) %s" % (target,guide))
+                mobiles = [selector.process("(%s) %s" % (m,guide)) for m in mobiles]
+
+                sel1 = _self.get_model(target, state=target_state).get_coord_list()
+                if len(sel1) < 2 * window:
+                        print "CEalign-Error: Your target selection is too short."
+                        raise pymol.CmdException
+                sel2 = [_self.get_model(m, state=mobile_state).get_coord_list()
+                        for m in mobiles]
+
+                r = DEFAULT_ERROR
+                try:
+                        _self.lock(_self)
+                        r = _cmd.cealign_batch( _self._COb, sel1, sel2, float(d0), float(d1),
+                                        int(window), int(gap_max), int(max_kept) )
+                finally:
+                        _self.unlock(r,_self)
+                if r is None or _self._raising(r,_self): raise pymol.CmdException
+
+                result = []
+                for (mobile, ri) in zip(mobiles, r):
+                        if ri is None:
+                                if not quiet:
+                                        print " CEalign-Error: alignment of %s failed" % mobile
+                                result.append(None)
+                                continue
+                        (aliLen, RMSD, rotMat, i1, i2) = ri
+                        if not quiet:
+                                print " %s: RMSD %f over %i residues" % (mobile, float(RMSD), int(aliLen))
+                        if int(transform):
+                                for model in _self.get_object_list("(" + mobile + ")"):
+                                        _self.transform_object(model, rotMat, state=0)
+                        result.append({"alignment_length": aliLen, "RMSD" : RMSD, "rotation_matrix" : rotMat })
+                return result
+
         def extra_fit(selection='(all)', reference='', method='align', zoom=1,
                 quiet=0, _self=cmd, **kwargs):
             '''
@@ -508,7 +576,7 @@ PYTHON EXAMPLE
 
 SEE ALSO
 
-        fit, rms, rms_cur, intra_fit, intra_rms, pair_fit
+        fit, rms, rms_cur, intra_fit, intra_rms, intra_rms_matrix, pair_fit
                 '''
                 # preprocess selection
                 selection = selector.process(selection)
@@ -531,6 +599,59 @@ SEE ALSO
 		if _self._raising(r,_self): raise pymol.CmdException		 
 		return r
 
+        rms_matrix_mode_dict = {
+                'states'  : 0,
+                'objects' : 1,
+                }
+        rms_matrix_mode_sc = Shortcut(rms_matrix_mode_dict.keys())
+
+        def intra_rms_matrix(selection, fit=1, quiet=1, mode="states", state=-1, _self=cmd):
+                '''
+DESCRIPTION
+
+        "intra_rms_matrix" calculates the rms values between all pairs of
+        states (mode=states) or objects (mode=objects) over an atom
+        selection, optionally after fitting each pair.  Coordinates are
+        left unchanged.  The result is returned as an N x N numpy array,
+        where -1.0 marks states or objects with missing coordinates.
+
+        With mode=objects, the selected atoms of each object are paired in
+        order, so all objects must have the same number of atoms selected,
+        and coordinates are taken from the given state (default: current).
+
+PYMOL API
+
+        cmd.intra_rms_matrix( string selection, int fit, int quiet,
+                string mode, int state )
+
+PYTHON EXAMPLE
+
+        from pymol import cmd
+        rms = cmd.intra_rms_matrix("(name CA)")
+        rms = cmd.intra_rms_matrix("(name CA)", mode="objects", state=1)
+
+SEE ALSO
+
+        intra_fit, intra_rms, intra_rms_cur
+                '''
+                # preprocess selection
+                selection = selector.process(selection)
+                if str(mode) in ('0', '1'):
+                        mode = int(mode)
+                else:
+                        mode = rms_matrix_mode_dict[rms_matrix_mode_sc.auto_err(str(mode), 'mode')]
+                r = DEFAULT_ERROR
+                try:
+                        _self.lock(_self)
+                        r = _cmd.intra_rms_matrix(_self._COb,"("+str(selection)+")",
+                                                  mode,int(state)-1,int(fit),int(quiet))
+                finally:
+                        _self.unlock(r,_self)
+                if r is None:
+                        r = DEFAULT_ERROR
+                if _self._raising(r,_self): raise pymol.CmdException
+                return r
+
 	def fit(mobile, target, mobile_state=0, target_state=0,
 		quiet=1, matchmaker=0, cutoff=2.0, cycles=0, object=None, _self=cmd):
 		'''
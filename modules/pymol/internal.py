@@ -3,7 +3,6 @@ import os
 import cmd
 import types
 from pymol import _cmd
-import threading
 import traceback
 import thread
 import re
@@ -26,8 +25,126 @@ def _cache_validate(_self=cmd):
             _pymol._cache = []
         if not hasattr(_pymol,"_cache_memory"):
             _pymol._cache_memory = 0
+        if not hasattr(_pymol,"_cache_stats"):
+            _pymol._cache_stats = {
+                'hits' : 0,       # results found in memory or on disk
+                'misses' : 0,     # results which had to be computed
+                'disk_hits' : 0,  # results read from cache_dir
+                'disk_writes' : 0,
+                }
     finally:
         _self.unlock_data(_self)
+
+def _cache_count(key, _self=cmd):
+    try:
+        _self.lock_data(_self)
+        _cache_validate(_self)
+        _self._pymol._cache_stats[key] += 1
+    finally:
+        _self.unlock_data(_self)
+
+# persistent cache (cache_dir): one marshalled output per file, named by a
+# digest of the input and of the PyMOL build which produced it (cached
+# representations contain raw native arrays).  cache_dir may be shared,
+# so entries are never unpickled: marshal can only produce plain data, a
+# header ties each file to its input and build and checksums the payload,
+# and anything but nested tuples and lists of scalars is rejected.
+
+_cache_disk_magic = 'PyMOL cache 1\n'
+
+def _cache_disk_digest(input):
+    import hashlib
+    import marshal
+    # version 0 doesn't record string interning, so equal inputs always
+    # give equal digests
+    return hashlib.sha1(marshal.dumps((_cmd.get_version(), input), 0)).digest()
+
+def _cache_disk_path(cache_dir, digest):
+    import binascii
+    return os.path.join(os.path.expanduser(cache_dir),
+                        binascii.hexlify(digest) + '.pmc')
+
+_cache_disk_types = (str, unicode, int, long, float, bool, types.NoneType)
+
+def _cache_disk_check(output):
+    stack = [output]
+    while stack:
+        item = stack.pop()
+        if type(item) in (tuple, list):
+            stack.extend(item)
+        elif type(item) not in _cache_disk_types:
+            return 0
+    return 1
+
+def _cache_disk_read(cache_dir, input):
+    import hashlib
+    import marshal
+    digest = _cache_disk_digest(input)
+    path = _cache_disk_path(cache_dir, digest)
+    if not os.path.exists(path):
+        return None
+    try:
+        handle = open(path, 'rb')
+        try:
+            data = handle.read()
+        finally:
+            handle.close()
+        start = len(_cache_disk_magic)
+        stop = start + 40
+        if data[:start] != _cache_disk_magic or data[start:start + 20] != digest:
+            return None
+        payload = data[stop:]
+        if hashlib.sha1(payload).digest() != data[start + 20:stop]:
+            return None
+        output = marshal.loads(payload)
+        if _cache_disk_check(output):
+            return output
+    except:
+        traceback.print_exc()
+    return None
+
+def _cache_disk_write(cache_dir, input, output):
+    import hashlib
+    import marshal
+    import tempfile
+    digest = _cache_disk_digest(input)
+    path = _cache_disk_path(cache_dir, digest)
+    if os.path.exists(path):
+        return 0
+    try:
+        payload = marshal.dumps(output, 2)
+        dirname = os.path.dirname(path)
+        if not os.path.isdir(dirname):
+            os.makedirs(dirname)
+        # write to a temporary file first, so that concurrent readers
+        # never see partial entries
+        fd, tmp_path = tempfile.mkstemp('.tmp', '', dirname)
+        handle = os.fdopen(fd, 'wb')
+        try:
+            handle.write(_cache_disk_magic)
+            handle.write(digest)
+            handle.write(hashlib.sha1(payload).digest())
+            handle.write(payload)
+        finally:
+            handle.close()
+        os.rename(tmp_path, path)
+        return 1
+    except:
+        traceback.print_exc()
+    return 0
+
+def _cache_size(output):
+    # same units as PCacheSet (layer1/P.cpp): tuple items, plus 4-byte
+    # words of binary strings
+    size = 0
+    if isinstance(output, tuple):
+        size = len(output)
+        for item in output:
+            if isinstance(item, tuple):
+                size = size + len(item)
+            elif isinstance(item, str):
+                size = size + len(item) / 4
+    return size
         
 def _cache_clear(_self=cmd):
     r = DEFAULT_SUCCESS
@@ -39,6 +156,21 @@ def _cache_clear(_self=cmd):
     finally:
         _self.unlock_data(_self)
     return r
+
+def _cache_get_stats(reset=0, _self=cmd):
+    try:
+        _self.lock_data(_self)
+        _cache_validate(_self)
+        _pymol = _self._pymol
+        result = dict(_pymol._cache_stats)
+        result['entries'] = len(_pymol._cache)
+        result['memory'] = _pymol._cache_memory
+        if reset:
+            for key in _pymol._cache_stats:
+                _pymol._cache_stats[key] = 0
+    finally:
+        _self.unlock_data(_self)
+    return result
     
 def _cache_mark(_self=cmd):
     r = DEFAULT_SUCCESS
@@ -86,7 +218,7 @@ def _cache_purge(max_size, _self=cmd):
         _self.unlock_data(_self)
     return result
         
-def _cache_get(target, hash_size = None, _self=cmd):
+def _cache_get(target, hash_size = None, _self=cmd, cache_dir='', max_size=0):
     result = None
     try:
         _self.lock_data(_self)
@@ -108,10 +240,23 @@ def _cache_get(target, hash_size = None, _self=cmd):
             traceback.print_exc()
     finally:
         _self.unlock_data(_self)
+    if result == None and cache_dir:
+        result = _cache_disk_read(cache_dir, target[2])
+        if result != None:
+            _cache_count('disk_hits', _self)
+            # keep it in memory like a computed result, so that the next
+            # lookup doesn't go to disk again (target[0] is the input size)
+            target[0] = target[0] + _cache_size(result)
+            target[3] = result
+            _cache_set(target, max_size, _self)
+    _cache_count('misses' if result == None else 'hits', _self)
     return result
 
-def _cache_set(new_entry, max_size, _self=cmd):
+def _cache_set(new_entry, max_size, _self=cmd, cache_dir=''):
     r = DEFAULT_SUCCESS
+    if cache_dir:
+        if _cache_disk_write(cache_dir, new_entry[2], new_entry[3]):
+            _cache_count('disk_writes', _self)
     try:
         _self.lock_data(_self)
         _pymol = _self._pymol
@@ -130,6 +275,11 @@ def _cache_set(new_entry, max_size, _self=cmd):
                         found = 1
                         break
                 count = count + 1
+            if not found and max_size > 0 and new_entry[0] > max_size:
+                # larger than the whole budget (input keys alone are
+                # O(NAtom) for cartoons and spheres): keeping it would
+                # just flush everything else
+                found = 1
             if not found:
                 _pymol._cache.append(new_entry)
                 _pymol._cache_memory = _pymol._cache_memory + new_entry[0]
@@ -142,111 +292,6 @@ def _cache_set(new_entry, max_size, _self=cmd):
         _self.unlock_data(_self)
     return r
         
-# ray tracing threads
-
-def _ray_anti_spawn(thread_info,_self=cmd):
-    # WARNING: internal routine, subject to change      
-    # internal routine to support multithreaded raytracing
-    thread_list = []
-    for a in thread_info[1:]:
-        t = threading.Thread(target=_cmd.ray_anti_thread,
-                                    args=(_self._COb,a))
-        t.setDaemon(1)
-        thread_list.append(t)
-    for t in thread_list:
-        t.start()
-    _cmd.ray_anti_thread(_self._COb,thread_info[0])
-    for t in thread_list:
-        t.join()
-
-def _ray_hash_spawn(thread_info,_self=cmd):
-    # WARNING: internal routine, subject to change      
-    # internal routine to support multithreaded raytracing
-    thread_list = []
-    for a in thread_info[1:]:
-        if a != None:
-            t = threading.Thread(target=_cmd.ray_hash_thread,
-                                 args=(_self._COb,a))
-            t.setDaemon(1)
-            thread_list.append(t)
-    for t in thread_list:
-        t.start()
-    if thread_info[0] != None:
-        _cmd.ray_hash_thread(_self._COb,thread_info[0])
-    for t in thread_list:
-        t.join()
-
-def _ray_spawn(thread_info,_self=cmd):
-    # WARNING: internal routine, subject to change      
-    # internal routine to support multithreaded raytracing
-    thread_list = []
-    for a in thread_info[1:]:
-        t = threading.Thread(target=_cmd.ray_trace_thread,
-                                    args=(_self._COb,a))
-        t.setDaemon(1)
-        thread_list.append(t)
-    for t in thread_list:
-        t.start()
-    _cmd.ray_trace_thread(_self._COb,thread_info[0])
-    for t in thread_list:
-        t.join()
-
-def _coordset_update_thread(list_lock,thread_info,_self=cmd):
-    # WARNING: internal routine, subject to change
-    while 1:
-        list_lock.acquire()
-        if not len(thread_info):
-            list_lock.release()
-            break
-        else:
-            info = thread_info.pop(0)
-            list_lock.release()
-        _cmd.coordset_update_thread(_self._COb,info)
-
-def _coordset_update_spawn(thread_info,n_thread,_self=cmd):
-    # WARNING: internal routine, subject to change
-    if len(thread_info):
-        list_lock = threading.Lock() # mutex for list
-        thread_list = []
-        for a in range(1,n_thread):
-            t = threading.Thread(target=_coordset_update_thread,
-                                        args=(list_lock,thread_info))
-            t.setDaemon(1)
-            thread_list.append(t)
-        for t in thread_list:
-            t.start()
-        _coordset_update_thread(list_lock,thread_info)
-        for t in thread_list:
-            t.join()
-
-def _object_update_thread(list_lock,thread_info,_self=cmd):
-    # WARNING: internal routine, subject to change
-    while 1:
-        list_lock.acquire()
-        if not len(thread_info):
-            list_lock.release()
-            break
-        else:
-            info = thread_info.pop(0)
-            list_lock.release()
-        _cmd.object_update_thread(_self._COb,info)
-
-def _object_update_spawn(thread_info,n_thread,_self=cmd):
-    # WARNING: internal routine, subject to change
-    if len(thread_info):
-        list_lock = threading.Lock() # mutex for list
-        thread_list = []
-        for a in range(1,n_thread):
-            t = threading.Thread(target=_object_update_thread,
-                                        args=(list_lock,thread_info))
-            t.setDaemon(1)
-            thread_list.append(t)
-        for t in thread_list:
-            t.start()
-        _object_update_thread(list_lock,thread_info)
-        for t in thread_list:
-            t.join()
-
 # status reporting
 
 # do command (while API already locked)
@@ -77,6 +77,35 @@ DECRIPTION
         if _self._raising(r,_self): raise pymol.CmdException
         return r
     
+    def get_movie_cache_stats(quiet=1, _self=cmd):
+        '''
+DESCRIPTION
+
+    "get_movie_cache_stats" returns a dictionary describing the movie
+    frame cache: frames and bytes held uncompressed and compressed,
+    cache hits, misses and evictions.
+
+SEE ALSO
+
+    movie_cache_max, movie_cache_compress, cache_frames
+        '''
+        r = DEFAULT_ERROR
+        try:
+            _self.lock(_self)
+            r = _cmd.get_movie_cache_stats(_self._COb)
+        finally:
+            _self.unlock(r,_self)
+        if _self._raising(r,_self): raise pymol.CmdException
+        if not int(quiet):
+            lookups = r['hits'] + r['hits_compressed'] + r['misses']
+            print " Movie cache: %d frames (%.1f MB), %d compressed (%.1f MB)" % (
+                r['frames'], r['bytes'] / 1048576.0,
+                r['frames_compressed'], r['bytes_compressed'] / 1048576.0)
+            print " Movie cache: %d lookups, hit rate %.1f%%, %d evictions" % (
+                lookups, 100.0 * (lookups - r['misses']) / max(lookups, 1),
+                r['evictions'])
+        return r
+
     def mdump(_self=cmd):
         '''
 DESCRIPTION
@@ -947,7 +947,7 @@ DESCRIPTION
         if _raising(r,_self): raise pymol.CmdException
         return r
 
-    def get_coords(selection='all', state=1, quiet=1, _self=cmd):
+    def get_coords(selection='all', state=1, quiet=1, copy=1, _self=cmd):
         '''
 DESCRIPTION
 
@@ -958,10 +958,15 @@ ARGUMENTS
     selection = str: atom selection {default: all}
 
     state = int: state index or all states if state=0 {default: 1}
+
+    copy = 0/1: {default: 1} copy=0 returns a writable array which shares
+    memory with the coordinate set, without applying object matrices. Only
+    possible if the selection is a contiguous range of a single state.
+    Representations get updated once the array is released.
         '''
         selection = selector.process(selection)
         with _self.lockcm:
-            r = _cmd.get_coords(_self._COb, selection, int(state) - 1)
+            r = _cmd.get_coords(_self._COb, selection, int(state) - 1, int(copy))
             return r
 
     def get_coordset(name, state=1, copy=1, quiet=1, _self=cmd):
@@ -976,10 +981,11 @@ ARGUMENTS
 
     state = int: state index {default: 1}
 
-    copy = 0/1: {default: 1} WARNING: only use copy=0 if you know what you're
-    doing. copy=0 will return a numpy array which is a wrapper of the internal
-    coordinate set memory. If the internal memory gets freed or reallocated,
-    this wrapper will become invalid.
+    copy = 0/1: {default: 1} copy=0 returns a writable numpy array which
+    shares memory with the internal coordinate set. If the coordinate set
+    gets freed or resized, the array keeps the old memory and no longer
+    aliases the object. Representations get updated once the array is
+    released.
         '''
         with _self.lockcm:
             r = _cmd.get_coordset(_self._COb, name, int(state) - 1, int(copy))
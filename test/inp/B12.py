@@ -0,0 +1,34 @@
+# 
+# align consecutive PDB entries with the banded and full-matrix
+# dynamic programming in MatchAlign, comparing time and results
+#
+
+from glob import glob
+
+import time
+from pymol import cmd
+import sys, os, os.path
+
+ent_dir = "pdb"
+
+def align_all(mode):
+   cmd.set("align_linear_memory", mode)
+   result = []
+   start = time.time()
+   for i in range(1, len(list)):
+      r = cmd.align("m%d" % i, "m%d" % (i - 1), cycles=0, transform=0)
+      result.append(r)
+   return (time.time() - start, result)
+
+cmd.feedback('disable', 'all', 'everything')
+list = glob("pdb/*/*")[:50]
+for i in range(len(list)):
+   cmd.load(list[i], "m%d" % i, quiet=1)
+   cmd.remove("m%d and not polymer" % i)
+
+(t0, r0) = align_all(0)
+(t1, r1) = align_all(1)
+print "full matrix %6.2f sec, banded %6.2f sec over %d alignments" % (t0, t1, len(r0))
+for i in range(len(r0)):
+   if r0[i] != r1[i]:
+      print "mismatch", list[i + 1], list[i], r0[i], r1[i]
@@ -0,0 +1,47 @@
+#
+# sort a large merged object with the comparison heap sort and the
+# key-encoded radix sort (sort_radix), comparing time and atom order
+#
+
+from glob import glob
+
+import time
+from pymol import cmd
+import sys, os, os.path
+
+ent_dir = "pdb"
+
+def atom_order(name):
+   result = []
+   cmd.iterate(name, "result.append((segi, chain, resi, resn, name, alt, ID))",
+               space={'result': result})
+   return result
+
+def sort_one(name, mode):
+   cmd.set("sort_radix", mode)
+   start = time.time()
+   cmd.sort(name)
+   return time.time() - start
+
+cmd.set("auto_zoom", "off")
+cmd.feedback('disable', 'all', 'everything')
+list = glob("pdb/*/*")[:200]
+for i in range(len(list)):
+   cmd.load(list[i], "m%d" % i, quiet=1)
+   cmd.alter("m%d" % i, "ID = index")
+
+for mode in (0, 1):
+   cmd.set("sort_radix", mode)
+   start = time.time()
+   cmd.create("big%d" % mode, "m*")
+   print "mode %d: merged %d atoms in %6.2f sec" % (
+      mode, cmd.count_atoms("big%d" % mode), time.time() - start)
+   # scramble the order so that the sort has work to do
+   cmd.alter("big%d" % mode, "chain = chr(65 + (ID * 7) % 26)")
+
+t0 = sort_one("big0", 0)
+t1 = sort_one("big1", 1)
+print "heap sort %6.2f sec, radix sort %6.2f sec over %d atoms" % (
+   t0, t1, cmd.count_atoms("big0"))
+if atom_order("big0") != atom_order("big1"):
+   print "mismatch in atom order"
@@ -0,0 +1,43 @@
+# -c
+
+# the key-encoded radix sort (sort_radix=1) must order atoms exactly
+# like the comparison sort
+
+from pymol import cmd
+
+print "BEGIN-LOG"
+
+cmd.set("auto_zoom", "off")
+for (i, f) in enumerate(["1tii", "il2", "3al1", "pept", "names", "odd01", "small02"]):
+   cmd.load("dat/%s.pdb" % f, "m%d" % i)
+cmd.create("big", "m*")
+cmd.create("copy", "m*")
+cmd.delete("m*")
+cmd.alter("big or copy", "ID = index")
+
+# scramble the fields the sort looks at, including negative residue
+# numbers, insertion codes, alternate locations and hetero flags
+cmd.alter("big or copy", "chain = chr(65 + (ID * 7) % 26)")
+cmd.alter("(big or copy) and index 1-500", "resi = str(((ID * 13) % 97) - 40) + ('', 'A', 'B')[ID % 3]")
+cmd.alter("(big or copy) and index 200-900", "alt = ('', 'A', 'B')[ID % 3]")
+cmd.alter("(big or copy) and index 400-1200", "segi = ('', 'S1', 'S2')[ID % 3]; type = ('ATOM', 'HETATM')[ID % 2]")
+cmd.alter("(big or copy) and index 100-300", "name = ('CA', 'N', 'C', 'O', 'CB')[ID % 5]")
+
+def atom_order(name):
+   result = []
+   cmd.iterate(name, "result.append((segi, chain, resi, resn, name, alt, ID))",
+               space={'result': result})
+   return result
+
+cmd.set("sort_radix", 0)
+cmd.sort("big")
+cmd.set("sort_radix", 1)
+cmd.sort("copy")
+
+order0 = atom_order("big")
+order1 = atom_order("copy")
+assert len(order0) == cmd.count_atoms("big")
+assert order0 == order1
+print "%d atoms in the same order" % len(order0)
+
+print "END-LOG"
@@ -0,0 +1,78 @@
+# -c
+
+# alter, iterate and alter_state evaluated natively (alter_native=1) must
+# leave exactly the same atom properties and coordinates as Python
+
+from pymol import cmd
+
+print "BEGIN-LOG"
+
+cmd.set("auto_zoom", "off")
+cmd.load("dat/1tii.pdb", "obj0")
+cmd.load("dat/pept.pdb", "pep")
+cmd.create("obj0", "pep", 1, 1)
+cmd.delete("pep")
+cmd.create("obj1", "obj0")
+
+exprs = [
+   ("alter", "b = 0"),
+   ("alter", "color = 5"),
+   ("alter", "b = min(max(b * 0.5 + q, 0.0), 99.0); q = 1.0 if b > 20 else 0.5"),
+   ("alter", "resv = resv + 1000; ss = 'H' if ss == 'H' else 'L'"),
+   ("alter", "formal_charge = -1 if name == 'OXT' else 0; flags = flags | 0x100"),
+   ("alter", "vdw = abs(b - 10) / 7 + 1; partial_charge = float(int(q * 3)) // 2"),
+   ("alter", "b = resv % 7 - (resv // 3) * 2.5; t = -b; q = t if t > 0 and not b == 0 else 1"),
+   ("alter", "b = scale * q"),
+   ("iterate", "t = b * q"),
+   ("alter_state", "x = x + 1.0; y = -y; z = z * 2"),
+   ("alter_state", "x = (x + y) / 3; z = min(z, y) - max(x, 0.5)"),
+   ]
+
+# min, max, ... only resolve if the namespace provides __builtins__
+space = {'scale': 2.5, '__builtins__': __builtins__}
+
+def props(name):
+   result = []
+   cmd.iterate_state(1, name, "result.append((b, q, color, resv, resi, ss, "
+                     "formal_charge, partial_charge, vdw, flags, x, y, z))",
+                     space={'result': result}, atomic=1)
+   return result
+
+def run_one(kind, name, expr):
+   if kind == "alter":
+      return cmd.alter(name, expr, quiet=1, space=space)
+   elif kind == "iterate":
+      return cmd.iterate(name, expr, quiet=1, space=space)
+   return cmd.alter_state(1, name, expr, quiet=1, space=space)
+
+for kind, expr in exprs:
+   cmd.set("alter_native", 0)
+   r0 = run_one(kind, "obj0", expr)
+   cmd.set("alter_native", 1)
+   r1 = run_one(kind, "obj1", expr)
+   assert r0 == r1, (kind, expr, r0, r1)
+   assert props("obj0") == props("obj1"), (kind, expr)
+   print kind, "ok:", expr
+
+# unsupported expressions and errors fall back to Python
+cmd.set("raise_exceptions", 0)
+for expr in ["b = len(name)", "b = 1 / (resv - resv)"]:
+   cmd.set("alter_native", 0)
+   r0 = cmd.alter("obj0", expr, quiet=1)
+   cmd.set("alter_native", 1)
+   r1 = cmd.alter("obj1", expr, quiet=1)
+   assert props("obj0") == props("obj1"), expr
+   print "fallback ok:", expr
+
+# without __builtins__, Python raises NameError for min, so must native
+for expr in ["b = min(b, 1.0)", "b = 1 if True else 0"]:
+   cmd.set("alter_native", 0)
+   r0 = cmd.alter("obj0", expr, quiet=1, space={'scale': 2.5})
+   cmd.set("alter_native", 1)
+   r1 = cmd.alter("obj1", expr, quiet=1, space={'scale': 2.5})
+   assert r0 == r1, (expr, r0, r1)
+   assert props("obj0") == props("obj1"), expr
+   print "no builtins ok:", expr
+cmd.set("raise_exceptions", 1)
+
+print "END-LOG"
@@ -0,0 +1,46 @@
+# -c
+
+# the banded dynamic programming in MatchAlign (align_linear_memory=1)
+# must give the same alignments as the full score matrix
+
+import pymol
+from pymol import cmd
+
+print "BEGIN-LOG"
+
+cmd.load("dat/1tii.pdb", "tii")
+cmd.load("dat/il2.pdb", "il2")
+cmd.load("dat/3al1.pdb", "al1")
+cmd.load("dat/pept.pdb", "pept")
+
+# align only works between different objects
+cmd.create("tiiA", "tii and chain A")
+cmd.create("tiiD", "tii and chain D")
+cmd.create("tiiE", "tii and chain E")
+cmd.create("al1A", "al1 and chain A")
+cmd.create("al1B", "al1 and chain B")
+
+pairs = [("tiiD", "tiiE"),
+         ("tiiA", "tiiD"),
+         ("il2", "tiiA"),
+         ("al1A", "al1B"),
+         ("pept", "il2")]
+
+def align_all(mode, **kw):
+   cmd.set("align_linear_memory", mode)
+   return [cmd.align(m, t, cycles=0, transform=0, **kw)
+           for (m, t) in pairs]
+
+for kw in [{}, {'max_gap': 0}, {'max_gap': 5}, {'max_skip': 3},
+           {'gap': -2.0, 'extend': -0.1}]:
+   r0 = align_all(0, **kw)
+   r1 = align_all(1, **kw)
+   assert r0 == r1, (kw, r0, r1)
+   print kw, "ok"
+
+# super scores structure on top of sequence and keeps the full matrix
+r = cmd.super("tiiD", "tiiE", cycles=0, transform=0)
+assert r[1] > 0
+
+cmd.set("align_linear_memory", 1)
+print "END-LOG"
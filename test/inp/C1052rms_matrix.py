@@ -0,0 +1,70 @@
+# -c
+
+import pymol
+from pymol import cmd
+
+from random import random,seed
+
+print "BEGIN-LOG"
+
+seed(123)
+
+cmd.load("dat/pept.pdb","ref")
+
+for a in xrange(1,9):
+   cmd.create("trg","ref",1,a)
+   cmd.alter_state(a,"trg","x=x+random()/2")
+   cmd.alter_state(a,"trg","y=y+random()/2")
+   cmd.alter_state(a,"trg","z=z+random()/2")
+
+def close(x,y):
+   return abs(x-y) < 1e-3
+
+# states against intra_rms / intra_rms_cur
+
+fitted = cmd.intra_rms_matrix("trg")
+plain = cmd.intra_rms_matrix("trg",fit=0)
+assert len(fitted) == 8 and len(plain) == 8
+
+for a in xrange(1,9):
+   r = cmd.intra_rms("trg",a)
+   r_cur = cmd.intra_rms_cur("trg",a)
+   for b in xrange(8):
+      assert close(fitted[a-1][b],fitted[b][a-1])
+      if b == a-1:
+         assert close(fitted[b][b],0.0)
+         assert close(plain[b][b],0.0)
+      else:
+         assert close(fitted[a-1][b],r[b])
+         assert close(plain[a-1][b],r_cur[b])
+
+print "states ok"
+
+# objects against rms / rms_cur
+
+for a in xrange(1,5):
+   cmd.create("obj%d"%a,"trg",a,1)
+
+sele = "obj* and name CA"
+fitted = cmd.intra_rms_matrix(sele,mode="objects",state=1)
+plain = cmd.intra_rms_matrix(sele,fit=0,mode="objects",state=1)
+assert len(fitted) == 4 and len(plain) == 4
+
+for a in xrange(1,5):
+   for b in xrange(1,5):
+      if a == b:
+         continue
+      assert close(fitted[a-1][b-1],cmd.rms("obj%d and name CA"%a,"obj%d and name CA"%b))
+      assert close(plain[a-1][b-1],cmd.rms_cur("obj%d and name CA"%a,"obj%d and name CA"%b))
+
+print "objects ok"
+
+# unequal atom counts are refused
+
+try:
+   cmd.intra_rms_matrix("(obj1 and name CA) or obj2",mode="objects")
+   assert False
+except pymol.CmdException:
+   pass
+
+print "END-LOG"
@@ -0,0 +1,83 @@
+# -c
+
+# the gaussian map (float kernel, filled in parallel) must agree with
+# the double precision scattering sum to float rounding, and must not
+# depend on the number of threads
+
+import math
+from pymol import cmd
+
+try:
+   import numpy
+except ImportError:
+   numpy = None  # get_volume_field needs it
+
+print "BEGIN-LOG"
+
+# scattering factors: five (a, b) pairs per element
+sf = {
+   'C': [(2.310000, 20.843899), (1.020000, 10.207500), (1.588600, 0.568700),
+         (0.865000, 51.651199), (0.215600, 0.0)],
+   'N': [(12.212600, 0.005700), (3.132200, 9.893300), (2.012500, 28.997499),
+         (1.166300, 0.582600), (-11.528999, 0.0)],
+   'O': [(3.048500, 13.277100), (2.286800, 5.701100), (1.546300, 0.323900),
+         (0.867000, 32.908897), (0.250800, 0.0)],
+   }
+
+def reference(atoms, origin, grid, dim):
+   kernels = []
+   for (elem, xyz, b_fact, q) in atoms:
+      terms = []
+      for (a, b) in sf[elem]:
+         terms.append((q * a * math.pow(math.sqrt(4 * math.pi / (b + b_fact)), 3.0),
+                       4 * math.pi * math.pi / (b + b_fact)))
+      rcut2 = max([0.0] + [(7.0 + math.log(max(abs(a), 1e-10))) / b for (a, b) in terms])
+      kernels.append((xyz, terms, math.sqrt(rcut2)))
+   field = {}
+   for i in range(dim[0]):
+      for j in range(dim[1]):
+         for k in range(dim[2]):
+            v = (origin[0] + i * grid, origin[1] + j * grid, origin[2] + k * grid)
+            e = 0.0
+            for (xyz, terms, cut) in kernels:
+               d = math.sqrt(sum([(v[c] - xyz[c]) ** 2 for c in range(3)]))
+               if d < cut:
+                  d = max(d * d, 1e-8)
+                  e += sum([a * math.exp(-b * d) for (a, b) in terms])
+            field[i, j, k] = e
+   return field
+
+cmd.load("dat/pept.pdb", "pept")
+cmd.remove("not resi 1-2 or elem S")
+atoms = []
+cmd.iterate_state(1, "pept", "atoms.append((elem, (x, y, z), b, q))",
+                  space={'atoms': atoms})
+
+# a box whose corners are multiples of the grid, so that grid points are
+# exactly origin + index * grid
+grid = 0.5
+lo = [math.floor(min([a[1][c] for a in atoms])) - 2.0 for c in range(3)]
+box = [lo, [c + 10.0 for c in lo]]
+dim = [20, 20, 20]
+
+if numpy is None:
+   print "numpy not available, skipped"
+else:
+   ref = reference(atoms, lo, grid, dim)
+   scale = max(ref.values())
+
+   for n_thread in (1, 3, 8):
+      cmd.set("max_threads", n_thread)
+      cmd.map_new("g%d" % n_thread, "gaussian", grid, "pept", buffer=0.0,
+                  box=box, normalize=0)
+      field = cmd.get_volume_field("g%d" % n_thread)
+      assert list(field.shape) == dim, field.shape
+      worst = max([abs(field[key] - ref[key]) for key in ref])
+      assert worst < 1e-5 * scale, (n_thread, worst, scale)
+      if n_thread == 1:
+         first = field
+      else:
+         assert (field == first).all(), n_thread
+      print "%d thread(s) ok" % n_thread
+
+print "END-LOG"